@@ -260,7 +260,8 @@ static int
 cfs_hash_hh_hnode_add(struct cfs_hash *hs, struct cfs_hash_bd *bd,
 		      struct hlist_node *hnode)
 {
-	hlist_add_head(hnode, cfs_hash_hh_hhead(hs, bd));
+	/* publish the new node to lockless RCU readers of the chain */
+	hlist_add_head_rcu(hnode, cfs_hash_hh_hhead(hs, bd));
 	return -1; /* unknown depth */
 }
 
@@ -268,7 +269,8 @@ static int
 cfs_hash_hh_hnode_del(struct cfs_hash *hs, struct cfs_hash_bd *bd,
 		      struct hlist_node *hnode)
 {
-	hlist_del_init(hnode);
+	/* lockless RCU readers may still walk on from the node */
+	hlist_del_init_rcu(hnode);
 	return -1; /* unknown depth */
 }
 
@@ -304,7 +306,8 @@ cfs_hash_hd_hnode_add(struct cfs_hash *hs, struct cfs_hash_bd *bd,
 
 	hh = container_of(cfs_hash_hd_hhead(hs, bd),
 			  struct cfs_hash_head_dep, hd_head);
-	hlist_add_head(hnode, &hh->hd_head);
+	/* publish the new node to lockless RCU readers of the chain */
+	hlist_add_head_rcu(hnode, &hh->hd_head);
 	return ++hh->hd_depth;
 }
 
@@ -316,7 +319,8 @@ cfs_hash_hd_hnode_del(struct cfs_hash *hs, struct cfs_hash_bd *bd,
 
 	hh = container_of(cfs_hash_hd_hhead(hs, bd),
 			  struct cfs_hash_head_dep, hd_head);
-	hlist_del_init(hnode);
+	/* lockless RCU readers may still walk on from the node */
+	hlist_del_init_rcu(hnode);
 	return --hh->hd_depth;
 }
 
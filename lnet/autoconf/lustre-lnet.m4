@@ -680,6 +680,24 @@ sk_data_ready, [
 EXTRA_KCFLAGS="$tmp_flags"
 ]) # LN_CONFIG_SK_DATA_READY
 
+#
+# LN_CONFIG_SK_INCOMING_CPU
+#
+# 3.19 struct sock records the CPU which processed the last incoming
+# packet in 'sk_incoming_cpu'
+#
+AC_DEFUN([LN_CONFIG_SK_INCOMING_CPU], [
+LB_CHECK_COMPILE([if 'struct sock' has 'sk_incoming_cpu'],
+sk_incoming_cpu, [
+	#include <net/sock.h>
+],[
+	((struct sock *)0)->sk_incoming_cpu = 0;
+],[
+	AC_DEFINE(HAVE_SK_INCOMING_CPU, 1,
+		['struct sock' has 'sk_incoming_cpu'])
+])
+]) # LN_CONFIG_SK_INCOMING_CPU
+
 #
 # LN_EXPORT_KMAP_TO_PAGE
 #
@@ -733,6 +751,8 @@ LN_CONFIG_TCP_SENDPAGE
 LN_EXPORT_KMAP_TO_PAGE
 # 3.15
 LN_CONFIG_SK_DATA_READY
+# 3.19
+LN_CONFIG_SK_INCOMING_CPU
 # 4.x
 LN_CONFIG_SOCK_CREATE_KERN
 # 4.11
@@ -533,9 +533,13 @@ int lnet_lib_init(void);
 void lnet_lib_exit(void);
 
 extern unsigned lnet_transaction_timeout;
+extern unsigned int lnet_health_sensitivity;
+extern unsigned int lnet_recovery_interval;
+extern unsigned int lnet_retry_count;
 extern unsigned int lnet_numa_range;
 extern unsigned int lnet_peer_discovery_disabled;
 extern int portal_rotor;
+extern int portal_spread;
 
 int lnet_notify(struct lnet_ni *ni, lnet_nid_t peer, int alive,
 		time64_t when);
@@ -607,6 +611,7 @@ void lnet_return_tx_credits_locked(struct lnet_msg *msg);
 void lnet_return_rx_credits_locked(struct lnet_msg *msg);
 void lnet_schedule_blocked_locked(struct lnet_rtrbufpool *rbp);
 void lnet_drop_routed_msgs_locked(struct list_head *list, int cpt);
+void lnet_post_routed_msgs(struct list_head *list);
 
 /* portals functions */
 /* portals attributes */
@@ -649,6 +654,7 @@ struct lnet_match_table *lnet_mt_of_attach(unsigned int index,
 					   enum lnet_ins_pos pos);
 int lnet_mt_match_md(struct lnet_match_table *mtable,
 		     struct lnet_match_info *info, struct lnet_msg *msg);
+void lnet_mt_stats_reset(void);
 
 /* portals match/attach functions */
 void lnet_ptl_attach_md(struct lnet_me *me, struct lnet_libmd *md,
@@ -700,7 +706,7 @@ int lnet_fault_ctl(int cmd, struct libcfs_ioctl_data *data);
 int lnet_fault_init(void);
 void lnet_fault_fini(void);
 
-bool lnet_drop_rule_match(struct lnet_hdr *hdr);
+bool lnet_drop_rule_match(struct lnet_hdr *hdr, bool send);
 
 int lnet_delay_rule_add(struct lnet_fault_attr *attr);
 int lnet_delay_rule_del(lnet_nid_t src, lnet_nid_t dst, bool shutdown);
@@ -712,6 +718,24 @@ bool lnet_delay_rule_match_locked(struct lnet_hdr *hdr, struct lnet_msg *msg);
 
 /** @} lnet_fault_simulation */
 
+/** \addtogroup lnet_sel_policy @{ */
+
+int lnet_sel_policy_add(char *nids, __u32 priority);
+int lnet_sel_policy_del(char *nids);
+int lnet_sel_policy_get(struct lnet_ioctl_sel_policy *policy);
+void lnet_sel_policy_fini(void);
+__u32 lnet_sel_priority_locked(struct lnet_sel_stats *ss, lnet_nid_t nid);
+void lnet_sel_stats_update(struct lnet_sel_stats *ss, unsigned int nob,
+			   ktime_t sent);
+__u64 lnet_sel_vtime(struct lnet_sel_stats *ss, __u64 vtime);
+__u64 lnet_sel_backlog(struct lnet_sel_stats *ss, __u64 vtime);
+void lnet_sel_charge(struct lnet_sel_stats *ss, __u64 *vtime,
+		     unsigned int nob);
+int lnet_select_bench(lnet_nid_t nid, unsigned int count, __u64 *cached_ns,
+		      __u64 *uncached_ns);
+
+/** @} lnet_sel_policy */
+
 void lnet_counters_get(struct lnet_counters *counters);
 void lnet_counters_reset(void);
 
@@ -821,6 +845,7 @@ int lnet_sock_connect(struct socket **sockp, int *fatal,
 
 int lnet_peers_start_down(void);
 int lnet_peer_buffer_credits(struct lnet_net *net);
+void lnet_rtr_tune_stats_get(struct lnet_ioctl_rtr_tune_stats *stats);
 
 int lnet_router_checker_start(void);
 void lnet_router_checker_stop(void);
@@ -910,6 +935,61 @@ lnet_set_peer_ni_health_locked(struct lnet_peer_ni *lpni, bool health)
 	lpni->lpni_healthy = health;
 }
 
+/*
+ * NIs and peer NIs start at LNET_MAX_HEALTH_VALUE. Every failed send
+ * knocks lnet_health_sensitivity off the value, which is then earned back
+ * at the same rate for every lnet_recovery_interval seconds without
+ * another failure. Recovery is computed when the value is read, so there
+ * is no thread walking all the interfaces to restore them.
+ *
+ * The value is updated under a single CPT lock while it is shared by all
+ * CPTs, so concurrent failures may occasionally be counted once only. This
+ * is harmless, as it is only used to rank interfaces against each other.
+ */
+#define LNET_MAX_HEALTH_VALUE	1000
+
+static inline int
+lnet_healthv_get(atomic_t *healthv, time64_t failed)
+{
+	int value = atomic_read(healthv);
+	time64_t intervals;
+
+	if (lnet_health_sensitivity == 0)
+		return LNET_MAX_HEALTH_VALUE;
+	if (value >= LNET_MAX_HEALTH_VALUE)
+		return value;
+
+	intervals = (ktime_get_seconds() - failed) /
+		    max_t(unsigned int, lnet_recovery_interval, 1);
+	if (intervals >= LNET_MAX_HEALTH_VALUE)
+		return LNET_MAX_HEALTH_VALUE;
+
+	return min_t(time64_t, LNET_MAX_HEALTH_VALUE,
+		     value + intervals * lnet_health_sensitivity);
+}
+
+static inline void
+lnet_healthv_dec(atomic_t *healthv, time64_t *failed)
+{
+	int value = lnet_healthv_get(healthv, *failed);
+
+	value -= min_t(int, value, lnet_health_sensitivity);
+	atomic_set(healthv, value);
+	*failed = ktime_get_seconds();
+}
+
+static inline int
+lnet_ni_healthv(struct lnet_ni *ni)
+{
+	return lnet_healthv_get(&ni->ni_healthv, ni->ni_health_time);
+}
+
+static inline int
+lnet_peer_ni_healthv(struct lnet_peer_ni *lpni)
+{
+	return lnet_healthv_get(&lpni->lpni_healthv, lpni->lpni_health_time);
+}
+
 static inline bool
 lnet_is_peer_net_healthy_locked(struct lnet_peer_net *peer_net)
 {
@@ -76,6 +76,11 @@ struct lnet_msg {
 	lnet_nid_t		msg_src_nid_param;
 	lnet_nid_t		msg_rtr_nid_param;
 
+	/* number of times this message has been resent after a failure */
+	__u32			msg_retry_count;
+	/* when the message was handed to the LND */
+	ktime_t			msg_send_time;
+
 	/* committed for sending */
 	unsigned int		msg_tx_committed:1;
 	/* CPT # this message committed for sending */
@@ -103,6 +108,7 @@ struct lnet_msg {
 	unsigned int          msg_peerrtrcredit:1; /* taken a peer router credit */
 	unsigned int          msg_onactivelist:1; /* on the activelist */
 	unsigned int	      msg_rdma_get:1;
+	unsigned int	      msg_tx_posted:1;    /* handed to the LND */
 
 	struct lnet_peer_ni  *msg_txpeer;         /* peer I'm sending to */
 	struct lnet_peer_ni  *msg_rxpeer;         /* peer I received from */
@@ -308,6 +314,24 @@ struct lnet_element_stats {
 	struct lnet_comm_count el_drop_stats;
 };
 
+/*
+ * Path selection state, kept for each local NI and peer NI, see
+ * sel_policy.c. Updated without serialization across CPTs: the values are
+ * estimates used to rank interfaces and a lost update is harmless.
+ */
+struct lnet_sel_stats {
+	/* moving average of small message send completion time, in ns */
+	__u64			ss_latency;
+	/* moving average of large message throughput, in bytes per usec */
+	__u64			ss_bandwidth;
+	/* virtual time at which the work queued on this interface ends */
+	__u64			ss_vtime;
+	/* priority given by the selection policies, lower is preferred */
+	__u32			ss_priority;
+	/* the_lnet.ln_sel_seq when ss_priority was computed */
+	__u32			ss_policy_seq;
+};
+
 struct lnet_net {
 	/* chain on the ln_nets */
 	struct list_head	net_list;
@@ -350,6 +374,9 @@ struct lnet_net {
 
 	/* network state */
 	enum lnet_net_state	net_state;
+
+	/* start vtime of the last send selected on this net */
+	__u64			net_sel_vtime;
 };
 
 struct lnet_ni {
@@ -394,6 +421,12 @@ struct lnet_ni {
 	/* NI FSM */
 	enum lnet_ni_state	ni_state;
 
+	/* health value, see lnet_ni_healthv() */
+	atomic_t		ni_healthv;
+
+	/* when the last send over this NI failed */
+	time64_t		ni_health_time;
+
 	/* per NI LND tunables */
 	struct lnet_lnd_tunables ni_lnd_tunables;
 
@@ -409,6 +442,9 @@ struct lnet_ni {
 	/* sequence number used to round robin over nis within a net */
 	__u32			ni_seq;
 
+	/* latency, bandwidth and policy state for path selection */
+	struct lnet_sel_stats	ni_sel;
+
 	/*
 	 * equivalent interfaces to use
 	 * This is an array because socklnd bonding can still be configured
@@ -476,6 +512,10 @@ struct lnet_peer_ni {
 	int			lpni_rtrcredits;
 	/* low water mark */
 	int			lpni_minrtrcredits;
+	/* # router credits allotted, see lnet_rtr_tune() */
+	int			lpni_rtrcredits_quota;
+	/* low water mark since the credits were last auto-tuned */
+	int			lpni_tune_minrtrcredits;
 	/* bytes queued for sending */
 	long			lpni_txqnob;
 	/* alive/dead? */
@@ -514,10 +554,16 @@ struct lnet_peer_ni {
 	int			lpni_rtr_refcount;
 	/* sequence number used to round robin over peer nis within a net */
 	__u32			lpni_seq;
+	/* latency, bandwidth and policy state for path selection */
+	struct lnet_sel_stats	lpni_sel;
 	/* sequence number used to round robin over gateways */
 	__u32			lpni_gw_seq;
 	/* health flag */
 	bool			lpni_healthy;
+	/* health value, see lnet_peer_ni_healthv() */
+	atomic_t		lpni_healthv;
+	/* when the last send to this peer NI failed */
+	time64_t		lpni_health_time;
 	/* returned RC ping features. Protected with lpni_lock */
 	unsigned int		lpni_ping_feats;
 	/* routes on this peer */
@@ -536,6 +582,29 @@ struct lnet_peer_ni {
 /* Preferred path added due to traffic on non-MR peer_ni */
 #define LNET_PEER_NI_NON_MR_PREF	(1 << 0)
 
+/* number of directly connected nets cached in a peer selection table */
+#define LNET_PEER_SEL_NETS	4
+
+/*
+ * The nets over which a peer is reachable without routing, paired with
+ * the matching local net. Computed the first time a message is sent to
+ * the peer after the local or the peer configuration changed, so that
+ * lnet_select_pathway() does not match every peer net against the local
+ * nets on each send.
+ */
+struct lnet_peer_sel_table {
+	/* lnet_get_dlc_seq_locked() when the table was computed */
+	__u32			pst_dlc_seq;
+	/* lp_sel_gen when the table was computed */
+	__u32			pst_gen;
+	/* number of entries in pst_nets, -1 if too many to be cached */
+	int			pst_nnets;
+	struct {
+		struct lnet_net		*pse_net;
+		struct lnet_peer_net	*pse_peer_net;
+	}			pst_nets[LNET_PEER_SEL_NETS];
+};
+
 struct lnet_peer {
 	/* chain on pt_peer_list */
 	struct list_head	lp_peer_list;
@@ -602,6 +671,12 @@ struct lnet_peer {
 
 	/* tasks waiting on discovery of this peer */
 	wait_queue_head_t	lp_dc_waitq;
+
+	/* bumped when peer nets are attached or detached */
+	__u32			lp_sel_gen;
+
+	/* cached selection state, protected by lp_lock for update */
+	struct lnet_peer_sel_table lp_sel_table;
 };
 
 /*
@@ -667,6 +742,9 @@ struct lnet_peer_net {
 
 	/* reference count */
 	atomic_t		lpn_refcount;
+
+	/* start vtime of the last send selected on this peer net */
+	__u64			lpn_sel_vtime;
 };
 
 /* peer hash size */
@@ -752,6 +830,8 @@ struct lnet_rtrbufpool {
 	int			rbp_credits;
 	/* low water mark */
 	int			rbp_mincredits;
+	/* low water mark since the pool was last auto-tuned */
+	int			rbp_tune_mincredits;
 };
 
 struct lnet_rtrbuf {
@@ -805,6 +885,24 @@ struct lnet_match_info {
 #define LNET_MT_EXHAUSTED_BITS		(LNET_MT_HASH_BITS - LNET_MT_BITS_U64)
 #define LNET_MT_EXHAUSTED_BMAP		((1 << LNET_MT_EXHAUSTED_BITS) + 1)
 
+/* # buckets of the histogram of match list walk lengths: 0, 1, 2-3, 4-7,
+ * ... and the last one for everything longer */
+#define LNET_MT_WALK_NBKTS		8
+
+/* matching statistics of a match table, under lnet_res_lock(mt_cpt) */
+struct lnet_mt_stats {
+	/* # messages matched against the table */
+	__u64			ms_nmatch;
+	/* # MEs walked to match them */
+	__u64			ms_nwalk;
+	/* # messages which stole a buffer from the table */
+	__u64			ms_nsteal;
+	/* longest walk */
+	unsigned int		ms_max_walk;
+	/* log2 histogram of walk lengths */
+	__u64			ms_walk_hist[LNET_MT_WALK_NBKTS];
+};
+
 /* portal match table */
 struct lnet_match_table {
 	/* reserved for upcoming patches, CPU partition ID */
@@ -813,9 +911,12 @@ struct lnet_match_table {
 	/* match table is set as "enabled" if there's non-exhausted MD
 	 * attached on mt_mhash, it's only valid for wildcard portal */
 	unsigned int		mt_enabled;
+	/* spread rotor of incoming "PUT" arriving on this CPT */
+	unsigned int		mt_rotor;
 	/* bitmap to flag whether MEs on mt_hash are exhausted or not */
 	__u64			mt_exhausted[LNET_MT_EXHAUSTED_BMAP];
 	struct list_head	*mt_mhash;	/* matching hash */
+	struct lnet_mt_stats	mt_stats;
 };
 
 /* these are only useful for wildcard portal */
@@ -839,8 +940,6 @@ struct lnet_portal {
 	struct list_head	ptl_msg_delayed;
 	/* Match table for each CPT */
 	struct lnet_match_table	**ptl_mtables;
-	/* spread rotor of incoming "PUT" */
-	unsigned int		ptl_rotor;
 	/* # active entries for this portal */
 	int			ptl_mt_nmaps;
 	/* array of active entries' cpu-partition-id */
@@ -923,6 +1022,10 @@ struct lnet {
 	struct list_head		ln_test_peers;
 	struct list_head		ln_drop_rules;
 	struct list_head		ln_delay_rules;
+	/* path selection policies, protected by lnet_net_lock/EX */
+	struct list_head		ln_sel_rules;
+	/* bumped whenever ln_sel_rules changes */
+	__u32				ln_sel_seq;
 	/* LND instances */
 	struct list_head		ln_nets;
 	/* the loopback NI */
@@ -933,6 +1036,10 @@ struct lnet {
 	struct list_head		ln_msg_resend;
 	/* spin lock to protect the msg resend list */
 	spinlock_t			ln_msg_resend_lock;
+	/* # of failed sends which lowered the health of an NI and peer NI */
+	atomic_t			ln_health_failures;
+	/* # of failed PUTs passed to lnet_send() again */
+	atomic_t			ln_health_resends;
 
 	/* remote networks with routes to them */
 	struct list_head		*ln_remote_nets_hash;
@@ -944,6 +1051,10 @@ struct lnet {
 	__u64				ln_routers_version;
 	/* percpt router buffer pools */
 	struct lnet_rtrbufpool		**ln_rtrpools;
+	/* router buffer and credit auto-tuning */
+	struct lnet_ioctl_rtr_tune_stats ln_rtr_tune;
+	/* when router buffers and credits were last auto-tuned */
+	time64_t			ln_rtr_tune_last;
 
 	/*
 	 * Ping target / Push source
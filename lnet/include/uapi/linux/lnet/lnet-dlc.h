@@ -244,9 +244,32 @@ struct lnet_ioctl_set_value {
 	__u32 sv_value;
 };
 
+/*
+ * Path selection policy: local NIs and peer NIs matching the nidlist in
+ * lsp_nids are ranked by lsp_priority, lower values being preferred.
+ */
+struct lnet_ioctl_sel_policy {
+	struct libcfs_ioctl_hdr lsp_hdr;
+	__u32 lsp_idx;
+	__u32 lsp_priority;
+	char lsp_nids[LNET_MAX_STR_LEN];
+};
+
+/* decisions of the router buffer and credit auto-tuning */
+struct lnet_ioctl_rtr_tune_stats {
+	__u32 rts_pool_grow;		/* # buffer pool increases */
+	__u32 rts_pool_shrink;		/* # buffer pool decreases */
+	__u32 rts_pool_capped;		/* # increases cut by the memory cap */
+	__u32 rts_credits_grant;	/* # peer router credit increases */
+	__u32 rts_credits_reclaim;	/* # peer router credit decreases */
+	__u32 rts_padding;
+	__u64 rts_pool_bytes;		/* memory held by router buffers */
+};
+
 struct lnet_ioctl_lnet_stats {
 	struct libcfs_ioctl_hdr st_hdr;
 	struct lnet_counters st_cntrs;
+	struct lnet_ioctl_rtr_tune_stats st_rtr_tune;
 };
 
 #endif /* _LNET_DLC_H_ */
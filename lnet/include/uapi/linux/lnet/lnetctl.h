@@ -51,6 +51,15 @@ enum {
 #define LNET_GET_BIT		(1 << 2)
 #define LNET_REPLY_BIT		(1 << 3)
 
+/** distributions of the latency added by delay rules */
+enum {
+	/** uniform within latency +/- jitter */
+	LNET_DELAY_DIST_UNIFORM,
+	/** normal, with jitter as standard deviation */
+	LNET_DELAY_DIST_NORMAL,
+	LNET_DELAY_DIST_MAX,
+};
+
 /** ioctl parameter for LNet fault simulation */
 struct lnet_fault_attr {
 	/**
@@ -88,6 +97,12 @@ struct lnet_fault_attr {
 			 * with da_rate
 			 */
 			__u32			da_interval;
+			/**
+			 * if non-zero, a matched message is failed by the
+			 * sender before it reaches the LND, as a local
+			 * error, instead of being lost on the receiver
+			 */
+			__u32			da_local;
 		} drop;
 		/** message latency simulation */
 		struct {
@@ -99,6 +114,29 @@ struct lnet_fault_attr {
 			__u32			la_interval;
 			/** latency to delay */
 			__u32			la_latency;
+			/** microseconds of latency added to la_latency */
+			__u32			la_latency_us;
+			/**
+			 * if non-zero, the latency of each message is drawn
+			 * from distribution la_dist, spread by this many
+			 * microseconds. Messages are not reordered, so under
+			 * load a message also waits for the previous one.
+			 */
+			__u32			la_jitter_us;
+			/** LNET_DELAY_DIST_* */
+			__u32			la_dist;
+			/**
+			 * bandwidth of the delayed messages in KiB/s, zero
+			 * means unlimited. Messages are paced by a token
+			 * bucket of la_burst KiB.
+			 */
+			__u32			la_bandwidth;
+			__u32			la_burst;
+			/**
+			 * max # of messages held by the rule, more are
+			 * dropped; zero means no limit
+			 */
+			__u32			la_queue_depth;
 		} delay;
 		__u64			space[8];
 	} u;
@@ -125,6 +163,10 @@ struct lnet_fault_stat {
 		struct {
 			/** total # delayed messages */
 			__u64			ls_delayed;
+			/** # messages dropped because the queue was full */
+			__u64			ls_overflow;
+			/** # messages held by the rule now */
+			__u64			ls_queued;
 		} delay;
 		__u64			space[8];
 	} u;
@@ -37,9 +37,11 @@
 
 #define LST_FEAT_NONE		(0)
 #define LST_FEAT_BULK_LEN	(1 << 0)	/* enable variable page size */
+#define LST_FEAT_LAT_STATS	(1 << 1)	/* RPC latency histograms */
 
 #define LST_FEATS_EMPTY		(LST_FEAT_NONE)
-#define LST_FEATS_MASK		(LST_FEAT_NONE | LST_FEAT_BULK_LEN)
+#define LST_FEATS_MASK		(LST_FEAT_NONE | LST_FEAT_BULK_LEN | \
+				 LST_FEAT_LAT_STATS)
 
 #define LST_NAME_SIZE		32		/* max name buffer length */
 
@@ -510,4 +512,26 @@ struct sfw_counters {
 	__u32 ping_errors;
 } WIRE_ATTR;
 
+/*
+ * Latencies of the test RPCs a node has sent, in microseconds. Latencies
+ * below LST_LAT_SUBBKTS have a bucket each, larger ones are counted in
+ * LST_LAT_SUBBKTS buckets per power of two, so a percentile taken from the
+ * histogram is within 1/LST_LAT_SUBBKTS of the real value. The last bucket
+ * also counts anything beyond 2^LST_LAT_MAX_BITS us, which is longer than
+ * any RPC timeout.
+ */
+#define LST_LAT_SUBBITS		3
+#define LST_LAT_SUBBKTS		(1 << LST_LAT_SUBBITS)
+#define LST_LAT_MAX_BITS	28
+#define LST_LAT_NBKTS		((LST_LAT_MAX_BITS - LST_LAT_SUBBITS + 1) * \
+				 LST_LAT_SUBBKTS)
+
+struct sfw_lat_counters {
+	/** # of RPCs completed successfully */
+	__u64 lat_count;
+	/** sum of their latencies */
+	__u64 lat_sum_us;
+	__u32 lat_buckets[LST_LAT_NBKTS];
+} WIRE_ATTR;
+
 #endif
@@ -32,6 +32,8 @@
 #ifndef __UAPI_LNET_SOCKLND_H__
 #define __UAPI_LNET_SOCKLND_H__
 
+#include <linux/types.h>
+
 #define SOCKLND_CONN_NONE     (-1)
 #define SOCKLND_CONN_ANY	0
 #define SOCKLND_CONN_CONTROL	1
@@ -41,4 +43,17 @@
 
 #define SOCKLND_CONN_ACK	SOCKLND_CONN_BULK_IN
 
+/* connection statistics, returned in ioc_inlbuf1 by IOC_LIBCFS_GET_CONN */
+struct socklnd_conn_stats {
+	__u64	scs_tx_bytes;	/* bytes sent */
+	__u64	scs_rx_bytes;	/* bytes received */
+	__u64	scs_tx_usecs;	/* scheduler time spent sending */
+	__u64	scs_rx_usecs;	/* scheduler time spent receiving */
+	__u64	scs_age;	/* seconds since the connection was made */
+	__s32	scs_rx_cpu;	/* CPU receiving its packets, -1 if unknown */
+	__u32	scs_padding;
+	__u64	scs_tx_msgs;	/* messages sent */
+	__u64	scs_tx_coalesced; /* of them, sent behind another one */
+};
+
 #endif
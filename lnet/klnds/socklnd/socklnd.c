@@ -81,6 +81,7 @@ ksocknal_create_route(__u32 ipaddr, int port)
         route->ksnr_deleted = 0;
         route->ksnr_conn_count = 0;
         route->ksnr_share_count = 0;
+	memset(route->ksnr_conns, 0, sizeof(route->ksnr_conns));
 
         return (route);
 }
@@ -354,7 +355,11 @@ ksocknal_associate_route_conn_locked(struct ksock_route *route, struct ksock_con
                         iface->ksni_nroutes++;
         }
 
-        route->ksnr_connected |= (1<<type);
+	/* the route is connected for this type once it has all the
+	 * connections of this type it wants */
+	route->ksnr_conns[type]++;
+	if (route->ksnr_conns[type] >= ksocknal_route_conns_wanted(type))
+		route->ksnr_connected |= (1 << type);
         route->ksnr_conn_count++;
 
         /* Successful connection => further attempts can
@@ -1071,6 +1076,7 @@ ksocknal_create_conn(struct lnet_ni *ni, struct ksock_route *route,
 	conn->ksnc_rx_scheduled = 0;
 
 	INIT_LIST_HEAD(&conn->ksnc_tx_queue);
+	INIT_LIST_HEAD(&conn->ksnc_tx_batch);
 	conn->ksnc_tx_ready = 0;
 	conn->ksnc_tx_scheduled = 0;
 	conn->ksnc_tx_carrier = NULL;
@@ -1219,27 +1225,37 @@ ksocknal_create_conn(struct lnet_ni *ni, struct ksock_route *route,
                 goto failed_2;
         }
 
-	/* Refuse to duplicate an existing connection, unless this is a
-	 * loopback connection */
+	/* Refuse to duplicate existing connections beyond the number of
+	 * connections of this type the connecting side wants, unless this
+	 * is a loopback connection. The peer_ni decides how many it wants
+	 * for passive connections. */
 	if (conn->ksnc_ipaddr != conn->ksnc_myipaddr) {
+		int ndup = 0;
+
 		list_for_each(tmp, &peer_ni->ksnp_conns) {
 			conn2 = list_entry(tmp, struct ksock_conn, ksnc_list);
 
-                        if (conn2->ksnc_ipaddr != conn->ksnc_ipaddr ||
-                            conn2->ksnc_myipaddr != conn->ksnc_myipaddr ||
-                            conn2->ksnc_type != conn->ksnc_type)
-                                continue;
+			if (conn2->ksnc_ipaddr != conn->ksnc_ipaddr ||
+			    conn2->ksnc_myipaddr != conn->ksnc_myipaddr ||
+			    conn2->ksnc_type != conn->ksnc_type)
+				continue;
 
-                        /* Reply on a passive connection attempt so the peer_ni
-                         * realises we're connected. */
-                        LASSERT (rc == 0);
-                        if (!active)
-                                rc = EALREADY;
+			ndup++;
+		}
 
-                        warn = "duplicate";
-                        goto failed_2;
-                }
-        }
+		if (ndup >= (active ?
+			     ksocknal_route_conns_wanted(conn->ksnc_type) :
+			     SOCKNAL_CONNS_PER_PEER_MAX)) {
+			/* Reply on a passive connection attempt so the
+			 * peer_ni realises we're connected. */
+			LASSERT(rc == 0);
+			if (!active)
+				rc = EALREADY;
+
+			warn = "duplicate";
+			goto failed_2;
+		}
+	}
 
         /* If the connection created by this route didn't bind to the IP
          * address the route connected to, the connection/route matching
@@ -1271,6 +1287,18 @@ ksocknal_create_conn(struct lnet_ni *ni, struct ksock_route *route,
 	peer_ni->ksnp_send_keepalive = 0;
 	peer_ni->ksnp_error = 0;
 
+	/* Process the connection where the NIC delivers its packets, so
+	 * that the socket data is still cache hot */
+	if (*ksocknal_tunables.ksnd_rx_affinity) {
+		int cpu = ksocknal_lib_rx_cpu(conn);
+		int rx_cpt;
+
+		rx_cpt = cpu < 0 ? -1 : cfs_cpt_of_cpu(lnet_cpt_table(), cpu);
+		if (rx_cpt >= 0 &&
+		    ksocknal_data.ksnd_sched_info[rx_cpt]->ksi_nthreads > 0)
+			cpt = rx_cpt;
+	}
+
 	sched = ksocknal_choose_scheduler_locked(cpt);
 	if (!sched) {
 		CERROR("no schedulers available. node is unhealthy\n");
@@ -1285,6 +1313,7 @@ ksocknal_create_conn(struct lnet_ni *ni, struct ksock_route *route,
         conn->ksnc_scheduler = sched;
 
 	conn->ksnc_tx_last_post = ktime_get_seconds();
+	conn->ksnc_created = conn->ksnc_tx_last_post;
 	/* Set the deadline for the outgoing HELLO to drain */
 	conn->ksnc_tx_bufnob = sock->sk->sk_wmem_queued;
 	conn->ksnc_tx_deadline = ktime_get_seconds() +
@@ -1437,8 +1466,6 @@ ksocknal_close_conn_locked(struct ksock_conn *conn, int error)
          * Caller holds ksnd_global_lock exclusively in irq context */
 	struct ksock_peer_ni *peer_ni = conn->ksnc_peer;
 	struct ksock_route *route;
-	struct ksock_conn *conn2;
-	struct list_head *tmp;
 
 	LASSERT(peer_ni->ksnp_error == 0);
 	LASSERT(!conn->ksnc_closing);
@@ -1451,19 +1478,11 @@ ksocknal_close_conn_locked(struct ksock_conn *conn, int error)
 	if (route != NULL) {
 		/* dissociate conn from route... */
 		LASSERT(!route->ksnr_deleted);
-		LASSERT((route->ksnr_connected & (1 << conn->ksnc_type)) != 0);
-
-		conn2 = NULL;
-		list_for_each(tmp, &peer_ni->ksnp_conns) {
-			conn2 = list_entry(tmp, struct ksock_conn, ksnc_list);
+		LASSERT(route->ksnr_conns[conn->ksnc_type] > 0);
 
-			if (conn2->ksnc_route == route &&
-			    conn2->ksnc_type == conn->ksnc_type)
-				break;
-
-			conn2 = NULL;
-		}
-		if (conn2 == NULL)
+		route->ksnr_conns[conn->ksnc_type]--;
+		if (route->ksnr_conns[conn->ksnc_type] <
+		    ksocknal_route_conns_wanted(conn->ksnc_type))
 			route->ksnr_connected &= ~(1 << conn->ksnc_type);
 
 		conn->ksnc_route = NULL;
@@ -1664,6 +1683,7 @@ ksocknal_destroy_conn(struct ksock_conn *conn)
 	LASSERT (!conn->ksnc_tx_scheduled);
 	LASSERT (!conn->ksnc_rx_scheduled);
 	LASSERT(list_empty(&conn->ksnc_tx_queue));
+	LASSERT(list_empty(&conn->ksnc_tx_batch));
 
         /* complete current receive if any */
         switch (conn->ksnc_rx_state) {
@@ -2192,6 +2212,7 @@ ksocknal_ctl(struct lnet_ni *ni, unsigned int cmd, void *arg)
                 int           rxmem;
                 int           nagle;
 		struct ksock_conn *conn = ksocknal_get_conn_by_idx(ni, data->ioc_count);
+		struct socklnd_conn_stats *stats;
 
                 if (conn == NULL)
                         return -ENOENT;
@@ -2208,6 +2229,25 @@ ksocknal_ctl(struct lnet_ni *ni, unsigned int cmd, void *arg)
 		data->ioc_u32[4] = conn->ksnc_scheduler->kss_info->ksi_cpt;
                 data->ioc_u32[5] = rxmem;
                 data->ioc_u32[6] = conn->ksnc_peer->ksnp_id.pid;
+
+		stats = (struct socklnd_conn_stats *)data->ioc_inlbuf1;
+		if (stats != NULL && data->ioc_inllen1 >= sizeof(*stats)) {
+			stats->scs_tx_bytes = conn->ksnc_tx_bytes;
+			stats->scs_rx_bytes = conn->ksnc_rx_bytes;
+			stats->scs_tx_msgs = conn->ksnc_tx_msgs;
+			stats->scs_tx_coalesced = conn->ksnc_tx_coalesced;
+			stats->scs_tx_usecs = div_u64(conn->ksnc_tx_time,
+						      NSEC_PER_USEC);
+			stats->scs_rx_usecs = div_u64(conn->ksnc_rx_time,
+						      NSEC_PER_USEC);
+			stats->scs_age = ktime_get_seconds() -
+					 conn->ksnc_created;
+			stats->scs_rx_cpu = -1;
+			if (ksocknal_connsock_addref(conn) == 0) {
+				stats->scs_rx_cpu = ksocknal_lib_rx_cpu(conn);
+				ksocknal_connsock_decref(conn);
+			}
+		}
                 ksocknal_conn_decref(conn);
                 return 0;
         }
@@ -74,6 +74,7 @@
 #define SOCKNAL_RESCHED         100             /* # scheduler loops before reschedule */
 #define SOCKNAL_INSANITY_RECONN 5000            /* connd is trying on reconn infinitely */
 #define SOCKNAL_ENOMEM_RETRY    1		/* seconds between retries */
+#define SOCKNAL_CONNS_PER_PEER_MAX 16		/* max # conns of a type per route */
 
 #define SOCKNAL_SINGLE_FRAG_TX      0           /* disable multi-fragment sends */
 #define SOCKNAL_SINGLE_FRAG_RX      0           /* disable multi-fragment receives */
@@ -159,6 +160,14 @@ struct ksock_tunables {
         unsigned int     *ksnd_zc_min_payload;  /* minimum zero copy payload size */
         int              *ksnd_zc_recv;         /* enable ZC receive (for Chelsio TOE) */
         int              *ksnd_zc_recv_min_nfrags; /* minimum # of fragments to enable ZC receive */
+	/* # connections of each bulk type per route */
+	int		 *ksnd_conns_per_peer;
+	/* socket busy poll time for receives (usecs), 0 to disable */
+	int		 *ksnd_busy_poll;
+	/* schedule connections on the CPT of their receive queue? */
+	int		 *ksnd_rx_affinity;
+	/* max # bytes of small messages sent in one go, 0 to disable */
+	int		 *ksnd_tx_coalesce;
 #ifdef CPU_AFFINITY
         int              *ksnd_irq_affinity;    /* enable IRQ affinity? */
 #endif
@@ -363,6 +372,8 @@ struct ksock_conn {
 	struct list_head	ksnc_tx_queue;
 	/* next TX that can carry a LNet message or ZC-ACK */
 	struct ksock_tx		*ksnc_tx_carrier;
+	/* small TXs sent together with the one being sent */
+	struct list_head	ksnc_tx_batch;
 	/* when (in seconds) tx times out */
 	time64_t		ksnc_tx_deadline;
 	/* send buffer marker */
@@ -375,6 +386,22 @@ struct ksock_conn {
 	int			ksnc_tx_scheduled;
 	/* time stamp of the last posted TX */
 	time64_t		ksnc_tx_last_post;
+
+	/* -- STATS -- */
+	/* when the connection was established */
+	time64_t		ksnc_created;
+	/* # bytes sent */
+	__u64			ksnc_tx_bytes;
+	/* # bytes received */
+	__u64			ksnc_rx_bytes;
+	/* # messages sent */
+	__u64			ksnc_tx_msgs;
+	/* # messages sent coalesced behind another one */
+	__u64			ksnc_tx_coalesced;
+	/* scheduler time spent sending (nsecs) */
+	__u64			ksnc_tx_time;
+	/* scheduler time spent receiving (nsecs) */
+	__u64			ksnc_rx_time;
 };
 
 struct ksock_route {
@@ -393,6 +420,8 @@ struct ksock_route {
         unsigned int          ksnr_deleted:1;   /* been removed from peer_ni? */
         unsigned int          ksnr_share_count; /* created explicitly? */
         int                   ksnr_conn_count;  /* # conns established by this route */
+	/* # conns currently established by type */
+	int			ksnr_conns[SOCKLND_CONN_NTYPES];
 };
 
 #define SOCKNAL_KEEPALIVE_PING          1       /* cookie for keepalive ping */
@@ -489,6 +518,17 @@ ksocknal_route_mask(void)
                 (1 << SOCKLND_CONN_BULK_OUT));
 }
 
+/* # connections of \a type a route should establish */
+static inline int
+ksocknal_route_conns_wanted(int type)
+{
+	/* small messages gain nothing from being spread over sockets */
+	if (type == SOCKLND_CONN_CONTROL)
+		return 1;
+
+	return *ksocknal_tunables.ksnd_conns_per_peer;
+}
+
 static inline struct list_head *
 ksocknal_nid2peerlist (lnet_nid_t nid)
 {
@@ -674,6 +714,7 @@ extern int ksocknal_tunables_init(void);
 extern void ksocknal_lib_csum_tx(struct ksock_tx *tx);
 
 extern int ksocknal_lib_memory_pressure(struct ksock_conn *conn);
+extern int ksocknal_lib_rx_cpu(struct ksock_conn *conn);
 extern int ksocknal_lib_bind_thread_to_cpu(int id);
 
 #endif /* _SOCKLND_SOCKLND_H_ */
@@ -109,10 +109,34 @@ ksocknal_free_tx(struct ksock_tx *tx)
 	}
 }
 
+/* "consume" \a nob bytes of the iov of \a tx */
+static void
+ksocknal_consume_iov(struct ksock_tx *tx, int nob)
+{
+	struct kvec *iov = tx->tx_iov;
+
+	LASSERT(nob <= tx->tx_resid);
+	tx->tx_resid -= nob;
+
+	while (nob != 0) {
+		LASSERT(tx->tx_niov > 0);
+
+		if (nob < (int)iov->iov_len) {
+			iov->iov_base += nob;
+			iov->iov_len -= nob;
+			return;
+		}
+
+		nob -= iov->iov_len;
+		tx->tx_iov = ++iov;
+		tx->tx_niov--;
+	}
+}
+
 static int
 ksocknal_send_iov(struct ksock_conn *conn, struct ksock_tx *tx)
 {
-	struct kvec *iov = tx->tx_iov;
+	struct ksock_tx *next;
         int    nob;
         int    rc;
 
@@ -124,24 +148,23 @@ ksocknal_send_iov(struct ksock_conn *conn, struct ksock_tx *tx)
         if (rc <= 0)                            /* sent nothing? */
                 return (rc);
 
-        nob = rc;
-        LASSERT (nob <= tx->tx_resid);
-        tx->tx_resid -= nob;
+	nob = min(rc, tx->tx_resid);
+	ksocknal_consume_iov(tx, nob);
+	nob = rc - nob;
 
-        /* "consume" iov */
-        do {
-                LASSERT (tx->tx_niov > 0);
+	/* the rest was sent from the TXs coalesced with this one */
+	list_for_each_entry(next, &conn->ksnc_tx_batch, tx_list) {
+		int sent;
 
-                if (nob < (int) iov->iov_len) {
-			iov->iov_base += nob;
-                        iov->iov_len -= nob;
-                        return (rc);
-                }
+		if (nob == 0)
+			break;
 
-                nob -= iov->iov_len;
-                tx->tx_iov = ++iov;
-                tx->tx_niov--;
-        } while (nob != 0);
+		LASSERT(tx->tx_resid == 0);
+		sent = min(nob, next->tx_resid);
+		ksocknal_consume_iov(next, sent);
+		nob -= sent;
+	}
+	LASSERT(nob == 0);
 
         return (rc);
 }
@@ -215,8 +238,10 @@ ksocknal_transmit(struct ksock_conn *conn, struct ksock_tx *tx)
                 }
 
 		bufnob = conn->ksnc_sock->sk->sk_wmem_queued;
-                if (rc > 0)                     /* sent something? */
-                        conn->ksnc_tx_bufnob += rc; /* account it */
+		if (rc > 0) {			/* sent something? */
+			conn->ksnc_tx_bufnob += rc; /* account it */
+			conn->ksnc_tx_bytes += rc;
+		}
 
 		if (bufnob < conn->ksnc_tx_bufnob) {
 			/* allocated send buffer bytes < computed; infer
@@ -268,6 +293,7 @@ ksocknal_recv_iov(struct ksock_conn *conn)
 
         /* received something... */
         nob = rc;
+	conn->ksnc_rx_bytes += nob;
 
 	conn->ksnc_peer->ksnp_last_alive = ktime_get_seconds();
 	conn->ksnc_rx_deadline = ktime_get_seconds() +
@@ -312,6 +338,7 @@ ksocknal_recv_kiov(struct ksock_conn *conn)
 
         /* received something... */
         nob = rc;
+	conn->ksnc_rx_bytes += nob;
 
 	conn->ksnc_peer->ksnp_last_alive = ktime_get_seconds();
 	conn->ksnc_rx_deadline = ktime_get_seconds() +
@@ -1391,12 +1418,55 @@ ksocknal_sched_cansleep(struct ksock_sched *sched)
 	return rc;
 }
 
+/*
+ * Move the small TXs queued behind \a tx on \a conn to ksnc_tx_batch, so
+ * they are sent together with \a tx in one sendmsg rather than one call
+ * and TCP segment each. Only TXs held entirely in iovs are coalesced, and
+ * at most tx_coalesce bytes are sent together; this caps the time the
+ * first of them waits for its completion.
+ *
+ * Called holding kss_lock, \a tx already dequeued.
+ */
+static void
+ksocknal_tx_batch_locked(struct ksock_conn *conn, struct ksock_tx *tx)
+{
+	int nob = *ksocknal_tunables.ksnd_tx_coalesce - tx->tx_resid;
+	int niov = tx->tx_niov;
+	struct ksock_tx *next;
+
+	LASSERT(list_empty(&conn->ksnc_tx_batch));
+
+	if (SOCKNAL_SINGLE_FRAG_TX || tx->tx_nkiov != 0)
+		return;
+
+	while (!list_empty(&conn->ksnc_tx_queue)) {
+		next = list_entry(conn->ksnc_tx_queue.next,
+				  struct ksock_tx, tx_list);
+
+		if (next->tx_nkiov != 0 ||
+		    next->tx_resid != next->tx_nob ||
+		    next->tx_nob > nob ||
+		    niov + next->tx_niov > LNET_MAX_IOV)
+			break;
+
+		/* it can't carry ZC-ACKs once it's being sent */
+		if (conn->ksnc_tx_carrier == next)
+			ksocknal_next_tx_carrier(conn);
+
+		list_move_tail(&next->tx_list, &conn->ksnc_tx_batch);
+		nob -= next->tx_nob;
+		niov += next->tx_niov;
+	}
+}
+
 int ksocknal_scheduler(void *arg)
 {
 	struct ksock_sched_info	*info;
 	struct ksock_sched *sched;
 	struct ksock_conn *conn;
 	struct ksock_tx	*tx;
+	struct ksock_tx	*next;
+	ktime_t start;
 	int rc;
 	int nloops = 0;
 	long id = (long)arg;
@@ -1434,7 +1504,10 @@ int ksocknal_scheduler(void *arg)
                         conn->ksnc_rx_ready = 0;
 			spin_unlock_bh(&sched->kss_lock);
 
+			start = ktime_get();
 			rc = ksocknal_process_receive(conn);
+			conn->ksnc_rx_time +=
+				ktime_to_ns(ktime_sub(ktime_get(), start));
 
 			spin_lock_bh(&sched->kss_lock);
 
@@ -1488,6 +1561,7 @@ int ksocknal_scheduler(void *arg)
 
                         /* dequeue now so empty list => more to send */
 			list_del(&tx->tx_list);
+			ksocknal_tx_batch_locked(conn, tx);
 
                         /* Clear tx_ready in case send isn't complete.  Do
                          * it BEFORE we call process_transmit, since
@@ -1502,18 +1576,42 @@ int ksocknal_scheduler(void *arg)
                                 ksocknal_txlist_done(NULL, &zlist, 0);
                         }
 
-                        rc = ksocknal_process_transmit(conn, tx);
+			start = ktime_get();
+			rc = ksocknal_process_transmit(conn, tx);
+			conn->ksnc_tx_time +=
+				ktime_to_ns(ktime_sub(ktime_get(), start));
 
                         if (rc == -ENOMEM || rc == -EAGAIN) {
                                 /* Incomplete send: replace tx on HEAD of tx_queue */
 				spin_lock_bh(&sched->kss_lock);
+				list_splice_init(&conn->ksnc_tx_batch,
+						 &conn->ksnc_tx_queue);
 				list_add(&tx->tx_list,
 					     &conn->ksnc_tx_queue);
 			} else {
 				/* Complete send; tx -ref */
+				if (rc == 0)
+					conn->ksnc_tx_msgs++;
 				ksocknal_tx_decref(tx);
 
+				/* so are the coalesced TXs sent in full */
+				while (!list_empty(&conn->ksnc_tx_batch)) {
+					next = list_entry(
+						conn->ksnc_tx_batch.next,
+						struct ksock_tx, tx_list);
+					if (next->tx_resid != 0)
+						break;
+
+					list_del(&next->tx_list);
+					conn->ksnc_tx_msgs++;
+					conn->ksnc_tx_coalesced++;
+					ksocknal_tx_decref(next);
+				}
+
 				spin_lock_bh(&sched->kss_lock);
+				/* requeue the rest on HEAD of tx_queue */
+				list_splice_init(&conn->ksnc_tx_batch,
+						 &conn->ksnc_tx_queue);
                                 /* assume space for more */
                                 conn->ksnc_tx_ready = 1;
                         }
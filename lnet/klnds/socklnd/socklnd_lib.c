@@ -70,6 +70,16 @@ ksocknal_lib_zc_capable(struct ksock_conn *conn)
 	return ((caps & NETIF_F_SG) != 0 && (caps & NETIF_F_CSUM_MASK) != 0);
 }
 
+static void
+ksocknal_lib_csum_tx_once(struct ksock_conn *conn, struct ksock_tx *tx)
+{
+	if (*ksocknal_tunables.ksnd_enable_csum	       && /* checksum enabled */
+	    conn->ksnc_proto == &ksocknal_protocol_v2x && /* V2.x connection  */
+	    tx->tx_nob == tx->tx_resid		       && /* frist sending    */
+	    tx->tx_msg.ksm_csum == 0)			  /* not checksummed  */
+		ksocknal_lib_csum_tx(tx);
+}
+
 int
 ksocknal_lib_send_iov(struct ksock_conn *conn, struct ksock_tx *tx)
 {
@@ -77,11 +87,7 @@ ksocknal_lib_send_iov(struct ksock_conn *conn, struct ksock_tx *tx)
 	int		nob;
 	int		rc;
 
-	if (*ksocknal_tunables.ksnd_enable_csum	       && /* checksum enabled */
-	    conn->ksnc_proto == &ksocknal_protocol_v2x && /* V2.x connection  */
-	    tx->tx_nob == tx->tx_resid		       && /* frist sending    */
-	    tx->tx_msg.ksm_csum == 0)			  /* not checksummed  */
-		ksocknal_lib_csum_tx(tx);
+	ksocknal_lib_csum_tx_once(conn, tx);
 
 	/* NB we can't trust socket ops to either consume our iovs
 	 * or leave them alone. */
@@ -94,8 +100,10 @@ ksocknal_lib_send_iov(struct ksock_conn *conn, struct ksock_tx *tx)
 #else
 		struct kvec *scratchiov = conn->ksnc_scheduler->kss_scratch_iov;
 		unsigned int niov = tx->tx_niov;
+		struct ksock_tx *next;
 #endif
 		struct msghdr msg = { .msg_flags = MSG_DONTWAIT };
+		int resid = tx->tx_resid;
                 int  i;
 
 		for (nob = i = 0; i < niov; i++) {
@@ -103,8 +111,22 @@ ksocknal_lib_send_iov(struct ksock_conn *conn, struct ksock_tx *tx)
 			nob += scratchiov[i].iov_len;
 		}
 
+#if !SOCKNAL_SINGLE_FRAG_TX
+		/* append the small TXs coalesced with this one, see
+		 * ksocknal_tx_batch_locked() */
+		list_for_each_entry(next, &conn->ksnc_tx_batch, tx_list) {
+			ksocknal_lib_csum_tx_once(conn, next);
+
+			for (i = 0; i < next->tx_niov; i++) {
+				scratchiov[niov++] = next->tx_iov[i];
+				nob += next->tx_iov[i].iov_len;
+			}
+			resid += next->tx_resid;
+		}
+#endif
+
 		if (!list_empty(&conn->ksnc_tx_queue) ||
-		    nob < tx->tx_resid)
+		    nob < resid)
 			msg.msg_flags |= MSG_MORE;
 
 		rc = kernel_sendmsg(sock, &msg, scratchiov, niov, nob);
@@ -537,6 +559,23 @@ ksocknal_lib_setup_sock (struct socket *sock)
         }
 #endif
 
+#ifdef SO_BUSY_POLL
+	/* Busy poll the device queue for a while when a receive finds the
+	 * socket empty, rather than waiting for the interrupt. This is only
+	 * an optimization, e.g. the kernel may not allow it, so the
+	 * connection goes on without it. */
+	if (*ksocknal_tunables.ksnd_busy_poll > 0) {
+		option = *ksocknal_tunables.ksnd_busy_poll;
+
+		rc = kernel_setsockopt(sock, SOL_SOCKET, SO_BUSY_POLL,
+				       (char *)&option, sizeof(option));
+		if (rc != 0)
+			CDEBUG_LIMIT(D_WARNING,
+				     "Can't set SO_BUSY_POLL %d, not busy polling: rc = %d\n",
+				     option, rc);
+	}
+#endif
+
         /* snapshot tunables */
         keep_idle  = *ksocknal_tunables.ksnd_keepalive_idle;
         keep_count = *ksocknal_tunables.ksnd_keepalive_count;
@@ -750,3 +789,16 @@ ksocknal_lib_memory_pressure(struct ksock_conn *conn)
 
 	return rc;
 }
+
+/* CPU which received the last packet of \a conn, -1 if not known */
+int
+ksocknal_lib_rx_cpu(struct ksock_conn *conn)
+{
+#ifdef HAVE_SK_INCOMING_CPU
+	int cpu = READ_ONCE(conn->ksnc_sock->sk->sk_incoming_cpu);
+
+	if (cpu >= 0 && cpu < nr_cpu_ids && cpu_online(cpu))
+		return cpu;
+#endif
+	return -1;
+}
@@ -139,6 +139,22 @@ static unsigned int zc_recv_min_nfrags = 16;
 module_param(zc_recv_min_nfrags, int, 0644);
 MODULE_PARM_DESC(zc_recv_min_nfrags, "minimum # of fragments to enable ZC recv");
 
+static int conns_per_peer = 1;
+module_param(conns_per_peer, int, 0444);
+MODULE_PARM_DESC(conns_per_peer, "# bulk connections per peer IP address");
+
+static int busy_poll;
+module_param(busy_poll, int, 0644);
+MODULE_PARM_DESC(busy_poll, "usecs to busy poll sockets for received data (0 to disable)");
+
+static int rx_affinity;
+module_param(rx_affinity, int, 0644);
+MODULE_PARM_DESC(rx_affinity, "schedule connections on the CPT receiving their data");
+
+static int tx_coalesce = (8 << 10);
+module_param(tx_coalesce, int, 0644);
+MODULE_PARM_DESC(tx_coalesce, "max # bytes of queued small messages sent together (0 to disable)");
+
 #ifdef SOCKNAL_BACKOFF
 static int backoff_init = 3;
 module_param(backoff_init, int, 0644);
@@ -188,6 +204,10 @@ int ksocknal_tunables_init(void)
         ksocknal_tunables.ksnd_zc_min_payload     = &zc_min_payload;
         ksocknal_tunables.ksnd_zc_recv            = &zc_recv;
         ksocknal_tunables.ksnd_zc_recv_min_nfrags = &zc_recv_min_nfrags;
+	ksocknal_tunables.ksnd_conns_per_peer	  = &conns_per_peer;
+	ksocknal_tunables.ksnd_busy_poll	  = &busy_poll;
+	ksocknal_tunables.ksnd_rx_affinity	  = &rx_affinity;
+	ksocknal_tunables.ksnd_tx_coalesce	  = &tx_coalesce;
 
 #ifdef CPU_AFFINITY
 	if (enable_irq_affinity) {
@@ -211,5 +231,10 @@ int ksocknal_tunables_init(void)
         if (*ksocknal_tunables.ksnd_zc_min_payload < (2 << 10))
                 *ksocknal_tunables.ksnd_zc_min_payload = (2 << 10);
 
+	if (conns_per_peer < 1)
+		conns_per_peer = 1;
+	if (conns_per_peer > SOCKNAL_CONNS_PER_PEER_MAX)
+		conns_per_peer = SOCKNAL_CONNS_PER_PEER_MAX;
+
 	return 0;
 };
@@ -122,6 +122,21 @@ module_param(lnet_transaction_timeout, uint, 0444);
 MODULE_PARM_DESC(lnet_transaction_timeout,
 		"Time in seconds to wait for a REPLY or an ACK");
 
+unsigned int lnet_health_sensitivity = 100;
+module_param(lnet_health_sensitivity, uint, 0644);
+MODULE_PARM_DESC(lnet_health_sensitivity,
+		"Health value lost on each failed send, out of 1000 (0 to disable)");
+
+unsigned int lnet_recovery_interval = 1;
+module_param(lnet_recovery_interval, uint, 0644);
+MODULE_PARM_DESC(lnet_recovery_interval,
+		"Seconds for an interface to regain the health lost on one failure");
+
+unsigned int lnet_retry_count = 2;
+module_param(lnet_retry_count, uint, 0644);
+MODULE_PARM_DESC(lnet_retry_count,
+		"Number of times a PUT which failed before reaching the LND is resent");
+
 /*
  * This sequence number keeps track of how many times DLC was used to
  * update the local NIs. It is incremented when a NI is added or
@@ -776,6 +791,7 @@ lnet_prepare(lnet_pid_t requested_pid)
 	INIT_LIST_HEAD(&the_lnet.ln_routers);
 	INIT_LIST_HEAD(&the_lnet.ln_drop_rules);
 	INIT_LIST_HEAD(&the_lnet.ln_delay_rules);
+	INIT_LIST_HEAD(&the_lnet.ln_sel_rules);
 	INIT_LIST_HEAD(&the_lnet.ln_dc_request);
 	INIT_LIST_HEAD(&the_lnet.ln_dc_working);
 	INIT_LIST_HEAD(&the_lnet.ln_dc_expired);
@@ -1687,6 +1703,7 @@ lnet_shutdown_lndnet(struct lnet_net *net)
 	net->net_state = LNET_NET_STATE_DELETING;
 
 	list_del_init(&net->net_list);
+	lnet_incr_dlc_seq();
 
 	while (!list_empty(&net->net_ni_list)) {
 		ni = list_entry(net->net_ni_list.next,
@@ -2005,6 +2022,7 @@ lnet_startup_lndnet(struct lnet_net *net, struct lnet_lnd_tunables *tun)
 
 		lnet_net_lock(LNET_LOCK_EX);
 		list_add_tail(&net->net_list, &the_lnet.ln_nets);
+		lnet_incr_dlc_seq();
 		lnet_net_unlock(LNET_LOCK_EX);
 	}
 
@@ -2315,6 +2333,7 @@ LNetNIFini()
 		LASSERT(!the_lnet.ln_niinit_self);
 
 		lnet_fault_fini();
+		lnet_sel_policy_fini();
 
 		lnet_router_debugfs_init();
 		lnet_peer_discovery_stop();
@@ -3156,11 +3175,15 @@ LNetCtl(unsigned int cmd, void *arg)
 	{
 		struct lnet_ioctl_lnet_stats *lnet_stats = arg;
 
-		if (lnet_stats->st_hdr.ioc_len < sizeof(*lnet_stats))
+		/* older tools don't know about the auto-tuning stats */
+		if (lnet_stats->st_hdr.ioc_len <
+		    offsetof(struct lnet_ioctl_lnet_stats, st_rtr_tune))
 			return -EINVAL;
 
 		mutex_lock(&the_lnet.ln_api_mutex);
 		lnet_counters_get(&lnet_stats->st_cntrs);
+		if (lnet_stats->st_hdr.ioc_len >= sizeof(*lnet_stats))
+			lnet_rtr_tune_stats_get(&lnet_stats->st_rtr_tune);
 		mutex_unlock(&the_lnet.ln_api_mutex);
 		return 0;
 	}
@@ -3217,6 +3240,34 @@ LNetCtl(unsigned int cmd, void *arg)
 		return 0;
 	}
 
+	case IOC_LIBCFS_ADD_SEL_POLICY:
+	case IOC_LIBCFS_DEL_SEL_POLICY: {
+		struct lnet_ioctl_sel_policy *policy = arg;
+
+		if (policy->lsp_hdr.ioc_len < sizeof(*policy))
+			return -EINVAL;
+
+		policy->lsp_nids[sizeof(policy->lsp_nids) - 1] = '\0';
+
+		mutex_lock(&the_lnet.ln_api_mutex);
+		if (cmd == IOC_LIBCFS_ADD_SEL_POLICY)
+			rc = lnet_sel_policy_add(policy->lsp_nids,
+						 policy->lsp_priority);
+		else
+			rc = lnet_sel_policy_del(policy->lsp_nids);
+		mutex_unlock(&the_lnet.ln_api_mutex);
+		return rc;
+	}
+
+	case IOC_LIBCFS_GET_SEL_POLICY: {
+		struct lnet_ioctl_sel_policy *policy = arg;
+
+		if (policy->lsp_hdr.ioc_len < sizeof(*policy))
+			return -EINVAL;
+
+		return lnet_sel_policy_get(policy);
+	}
+
 	case IOC_LIBCFS_GET_BUF: {
 		struct lnet_ioctl_pool_cfg *pool_cfg;
 		size_t total = sizeof(*config) + sizeof(*pool_cfg);
@@ -746,9 +746,27 @@ lnet_ni_send(struct lnet_ni *ni, struct lnet_msg *msg)
 	LASSERT (LNET_NETTYP(LNET_NIDNET(ni->ni_nid)) == LOLND ||
 		 (msg->msg_txcredit && msg->msg_peertxcredit));
 
+	msg->msg_send_time = ktime_get();
+
+	if (unlikely(!list_empty(&the_lnet.ln_drop_rules)) &&
+	    lnet_drop_rule_match(&msg->msg_hdr, true)) {
+		CDEBUG(D_NET, "%s->%s: failing %s to simulate a local error\n",
+		       libcfs_nid2str(ni->ni_nid),
+		       libcfs_id2str(msg->msg_target),
+		       lnet_msgtyp2str(msg->msg_type));
+		lnet_finalize(msg, -EHOSTUNREACH);
+		return;
+	}
+
+	/* set before the LND gets the message, which it may complete at
+	 * any time; cleared if the LND refused it, the message is only
+	 * ours again then */
+	msg->msg_tx_posted = 1;
 	rc = (ni->ni_net->net_lnd->lnd_send)(ni, priv, msg);
-	if (rc < 0)
+	if (rc < 0) {
+		msg->msg_tx_posted = 0;
 		lnet_finalize(msg, rc);
+	}
 }
 
 static int
@@ -1048,6 +1066,8 @@ lnet_post_routed_recv_locked(struct lnet_msg *msg, int do_recv)
 		lp->lpni_rtrcredits--;
 		if (lp->lpni_rtrcredits < lp->lpni_minrtrcredits)
 			lp->lpni_minrtrcredits = lp->lpni_rtrcredits;
+		if (lp->lpni_rtrcredits < lp->lpni_tune_minrtrcredits)
+			lp->lpni_tune_minrtrcredits = lp->lpni_rtrcredits;
 
 		if (lp->lpni_rtrcredits < 0) {
 			/* must have checked eager_recv before here */
@@ -1067,6 +1087,8 @@ lnet_post_routed_recv_locked(struct lnet_msg *msg, int do_recv)
 		rbp->rbp_credits--;
 		if (rbp->rbp_credits < rbp->rbp_mincredits)
 			rbp->rbp_mincredits = rbp->rbp_credits;
+		if (rbp->rbp_credits < rbp->rbp_tune_mincredits)
+			rbp->rbp_tune_mincredits = rbp->rbp_credits;
 
 		if (rbp->rbp_credits < 0) {
 			/* must have checked eager_recv before here */
@@ -1183,15 +1205,7 @@ lnet_return_tx_credits_locked(struct lnet_msg *msg)
 	}
 
 	if (txpeer != NULL) {
-		/*
-		 * TODO:
-		 * Once the patch for the health comes in we need to set
-		 * the health of the peer ni to bad when we fail to send
-		 * a message.
-		 * int status = msg->msg_ev.status;
-		 * if (status != 0)
-		 *	lnet_set_peer_ni_health_locked(txpeer, false)
-		 */
+		/* health of txpeer is updated by lnet_health_check() */
 		msg->msg_txpeer = NULL;
 		lnet_peer_ni_decref_locked(txpeer);
 	}
@@ -1229,6 +1243,28 @@ lnet_drop_routed_msgs_locked(struct list_head *list, int cpt)
 	lnet_net_lock(cpt);
 }
 
+/*
+ * Receive the routed messages on \a list, which were queued for a peer
+ * router credit and have now been given one.
+ */
+void
+lnet_post_routed_msgs(struct list_head *list)
+{
+	struct lnet_msg *msg;
+	int cpt;
+
+	while (!list_empty(list)) {
+		msg = list_entry(list->next, struct lnet_msg, msg_list);
+		list_del(&msg->msg_list);
+
+		LASSERT(msg->msg_peerrtrcredit);
+		cpt = msg->msg_rx_cpt;
+		lnet_net_lock(cpt);
+		(void) lnet_post_routed_recv_locked(msg, 1);
+		lnet_net_unlock(cpt);
+	}
+}
+
 void
 lnet_return_rx_credits_locked(struct lnet_msg *msg)
 {
@@ -1434,24 +1470,46 @@ lnet_get_best_ni(struct lnet_net *local_net, struct lnet_ni *cur_ni,
 	struct lnet_ni *ni = NULL, *best_ni = cur_ni;
 	unsigned int shortest_distance;
 	int best_credits;
+	int best_healthv;
+	__u32 best_prio;
+	__u64 best_backlog;
 
 	if (best_ni == NULL) {
 		shortest_distance = UINT_MAX;
 		best_credits = INT_MIN;
+		best_healthv = -1;
+		best_prio = 0;
+		best_backlog = 0;
 	} else {
 		shortest_distance = cfs_cpt_distance(lnet_cpt_table(), md_cpt,
 						     best_ni->ni_dev_cpt);
+		if (shortest_distance < lnet_numa_range)
+			shortest_distance = lnet_numa_range;
 		best_credits = atomic_read(&best_ni->ni_tx_credits);
+		best_healthv = lnet_ni_healthv(best_ni);
+		best_prio = lnet_sel_priority_locked(&best_ni->ni_sel,
+						     best_ni->ni_nid);
+		best_backlog = lnet_sel_backlog(&best_ni->ni_sel,
+					best_ni->ni_net->net_sel_vtime);
 	}
 
 	while ((ni = lnet_get_next_ni_locked(local_net, ni))) {
 		unsigned int distance;
 		int ni_credits;
+		int ni_healthv;
+		__u32 ni_prio;
+		__u64 ni_backlog;
 
 		if (!lnet_is_ni_healthy_locked(ni))
 			continue;
 
 		ni_credits = atomic_read(&ni->ni_tx_credits);
+		ni_healthv = lnet_ni_healthv(ni);
+		ni_prio = lnet_sel_priority_locked(&ni->ni_sel, ni->ni_nid);
+		/* cur_ni may be on another net, whose virtual clock is
+		 * not comparable with the one of local_net */
+		ni_backlog = lnet_sel_backlog(&ni->ni_sel,
+					      ni->ni_net->net_sel_vtime);
 
 		/*
 		 * calculate the distance from the CPT on which
@@ -1470,26 +1528,303 @@ lnet_get_best_ni(struct lnet_net *local_net, struct lnet_ni *cur_ni,
 			distance = lnet_numa_range;
 
 		/*
-		 * Select on shorter distance, then available
+		 * Select on health, then policy priority, then shorter
+		 * distance, then the least loaded NI according to the
+		 * latency and bandwidth measured on it, then available
 		 * credits, then round-robin.
 		 */
-		if (distance > shortest_distance) {
-			continue;
-		} else if (distance < shortest_distance) {
-			shortest_distance = distance;
-		} else if (ni_credits < best_credits) {
-			continue;
-		} else if (ni_credits == best_credits) {
-			if (best_ni && (best_ni)->ni_seq <= ni->ni_seq)
+		if (ni_healthv != best_healthv) {
+			if (ni_healthv < best_healthv)
+				continue;
+		} else if (ni_prio != best_prio) {
+			if (ni_prio > best_prio)
+				continue;
+		} else if (distance != shortest_distance) {
+			if (distance > shortest_distance)
+				continue;
+		} else if (ni_backlog != best_backlog) {
+			if (ni_backlog > best_backlog)
+				continue;
+		} else if (ni_credits != best_credits) {
+			if (ni_credits < best_credits)
 				continue;
+		} else if (best_ni && best_ni->ni_seq <= ni->ni_seq) {
+			continue;
 		}
+
 		best_ni = ni;
 		best_credits = ni_credits;
+		best_healthv = ni_healthv;
+		best_prio = ni_prio;
+		best_backlog = ni_backlog;
+		shortest_distance = distance;
 	}
 
 	return best_ni;
 }
 
+/*
+ * Return the selection table of peer \a lp, computing it again if the
+ * local or the peer configuration changed since it was last computed.
+ *
+ * Both configurations only change under lnet_net_lock/EX, so a table
+ * found up to date stays so while the caller holds lnet_net_lock.
+ */
+static struct lnet_peer_sel_table *
+lnet_peer_sel_table_locked(struct lnet_peer *lp)
+{
+	struct lnet_peer_sel_table *pst = &lp->lp_sel_table;
+	struct lnet_peer_net *lpn;
+	struct lnet_net *net;
+	__u32 dlc_seq = lnet_get_dlc_seq_locked();
+	int n = 0;
+
+	if (likely(pst->pst_gen == lp->lp_sel_gen &&
+		   pst->pst_dlc_seq == dlc_seq)) {
+		smp_rmb();
+		return pst;
+	}
+
+	spin_lock(&lp->lp_lock);
+	if (pst->pst_gen != lp->lp_sel_gen || pst->pst_dlc_seq != dlc_seq) {
+		list_for_each_entry(lpn, &lp->lp_peer_nets, lpn_peer_nets) {
+			net = lnet_get_net_locked(lpn->lpn_net_id);
+			if (net == NULL)
+				continue;
+
+			if (n == LNET_PEER_SEL_NETS) {
+				n = -1;
+				break;
+			}
+			pst->pst_nets[n].pse_net = net;
+			pst->pst_nets[n].pse_peer_net = lpn;
+			n++;
+		}
+		pst->pst_nnets = n;
+		/* publish the entries before the sequence numbers */
+		smp_wmb();
+		pst->pst_dlc_seq = dlc_seq;
+		pst->pst_gen = lp->lp_sel_gen;
+	}
+	spin_unlock(&lp->lp_lock);
+
+	return pst;
+}
+
+/*
+ * Select the best local NI to reach \a peer over one of the nets both
+ * are directly connected to, using the selection table of the peer if
+ * \a cached is set, or by matching its peer nets against the local nets
+ * otherwise. The peer net of the NI is returned in \a best_lpn.
+ *
+ * Returns NULL if no healthy directly connected net was found, or if
+ * the peer has too many of them to be cached; the caller then has to
+ * consider routes.
+ */
+static struct lnet_ni *
+lnet_find_best_ni_on_peer(struct lnet_peer *peer, int md_cpt, bool cached,
+			  struct lnet_peer_net **best_lpn)
+{
+	struct lnet_peer_sel_table *pst;
+	struct lnet_peer_net *lpn;
+	struct lnet_net *net;
+	struct lnet_ni *best_ni = NULL;
+	struct lnet_ni *ni;
+	int i;
+
+	*best_lpn = NULL;
+
+	if (!cached) {
+		list_for_each_entry(lpn, &peer->lp_peer_nets, lpn_peer_nets) {
+			if (!lnet_is_peer_net_healthy_locked(lpn))
+				continue;
+
+			net = lnet_get_net_locked(lpn->lpn_net_id);
+			if (net == NULL)
+				continue;
+
+			ni = lnet_get_best_ni(net, best_ni, md_cpt);
+			if (ni != NULL && ni->ni_net == net)
+				*best_lpn = lpn;
+			best_ni = ni;
+		}
+		return best_ni;
+	}
+
+	pst = lnet_peer_sel_table_locked(peer);
+	for (i = 0; i < pst->pst_nnets; i++) {
+		lpn = pst->pst_nets[i].pse_peer_net;
+		if (!lnet_is_peer_net_healthy_locked(lpn))
+			continue;
+
+		net = pst->pst_nets[i].pse_net;
+		ni = lnet_get_best_ni(net, best_ni, md_cpt);
+		if (ni != NULL && ni->ni_net == net)
+			*best_lpn = lpn;
+		best_ni = ni;
+	}
+
+	return best_ni;
+}
+
+/*
+ * Look at the peer NIs for the destination peer that connect to the
+ * chosen net. If a peer_ni is preferred when using the best_ni to
+ * communicate, we use that one. If there is no preferred peer_ni, or
+ * there are multiple preferred peer_ni, the available transmit credits
+ * are used. If the transmit credits are equal, we round-robin over the
+ * peer_ni.
+ */
+static struct lnet_peer_ni *
+lnet_find_best_lpni(struct lnet_peer *peer, struct lnet_peer_net *peer_net,
+		    struct lnet_ni *best_ni)
+{
+	struct lnet_peer_ni *best_lpni = NULL;
+	struct lnet_peer_ni *lpni = NULL;
+	int best_lpni_credits = INT_MIN;
+	int best_lpni_healthv = -1;
+	__u32 best_lpni_prio = 0;
+	__u64 best_lpni_vtime = 0;
+	bool preferred = false;
+	bool ni_is_pref;
+
+	while ((lpni = lnet_get_next_peer_ni_locked(peer, peer_net, lpni))) {
+		int lpni_healthv;
+		__u32 lpni_prio;
+		__u64 lpni_vtime;
+
+		/*
+		 * if this peer ni is not healthy just skip it, no point in
+		 * examining it further
+		 */
+		if (!lnet_is_peer_ni_healthy_locked(lpni))
+			continue;
+		ni_is_pref = lnet_peer_is_pref_nid_locked(lpni,
+							  best_ni->ni_nid);
+		lpni_healthv = lnet_peer_ni_healthv(lpni);
+		lpni_prio = lnet_sel_priority_locked(&lpni->lpni_sel,
+						     lpni->lpni_nid);
+		lpni_vtime = lnet_sel_vtime(&lpni->lpni_sel,
+					    lpni->lpni_peer_net->lpn_sel_vtime);
+
+		/*
+		 * Select on health, then policy priority, then the
+		 * preferred peer_ni, then the least loaded peer_ni
+		 * according to the latency and bandwidth measured on it,
+		 * then available credits, then round-robin.
+		 */
+		if (lpni_healthv != best_lpni_healthv) {
+			if (lpni_healthv < best_lpni_healthv)
+				continue;
+		} else if (lpni_prio != best_lpni_prio) {
+			if (lpni_prio > best_lpni_prio)
+				continue;
+		} else if (ni_is_pref != preferred) {
+			if (!ni_is_pref)
+				continue;
+		} else if (lpni_vtime != best_lpni_vtime) {
+			if (lpni_vtime > best_lpni_vtime)
+				continue;
+		} else if (lpni->lpni_txcredits != best_lpni_credits) {
+			if (lpni->lpni_txcredits < best_lpni_credits)
+				continue;
+		} else if (best_lpni &&
+			   best_lpni->lpni_seq <= lpni->lpni_seq) {
+			continue;
+		}
+
+		best_lpni = lpni;
+		best_lpni_credits = lpni->lpni_txcredits;
+		best_lpni_healthv = lpni_healthv;
+		best_lpni_prio = lpni_prio;
+		best_lpni_vtime = lpni_vtime;
+		preferred = ni_is_pref;
+	}
+
+	return best_lpni;
+}
+
+/**
+ * Measure the cost of selecting the local and peer NI for a send to
+ * \a nid, \a count times with the selection table of the peer and
+ * \a count times without it. Nothing is sent and the round-robin and
+ * load state of the NIs is left alone. The net lock is dropped every
+ * LNET_SELECT_BENCH_BATCH selections, and that time is not counted.
+ *
+ * \param[in] nid		NID of a known peer
+ * \param[in] count		number of selections to time
+ * \param[out] cached_ns	time taken with the selection table
+ * \param[out] uncached_ns	time taken without it
+ *
+ * \retval 0 on success
+ * \retval -ENOENT if \a nid is not a known peer NID
+ * \retval -EHOSTUNREACH if the peer is not directly reachable
+ * \retval -ESHUTDOWN if LNet is not running
+ *
+ * Call with ln_api_mutex held.
+ */
+#define LNET_SELECT_BENCH_BATCH	1000
+
+int
+lnet_select_bench(lnet_nid_t nid, unsigned int count, __u64 *cached_ns,
+		  __u64 *uncached_ns)
+{
+	struct lnet_peer_net *lpn;
+	struct lnet_peer_ni *lpni;
+	struct lnet_peer *peer;
+	struct lnet_ni *ni;
+	__u64 elapsed[2];
+	ktime_t start;
+	unsigned int i;
+	int pass;
+	int cpt;
+	int rc = 0;
+
+	if (the_lnet.ln_state != LNET_STATE_RUNNING)
+		return -ESHUTDOWN;
+
+	cpt = lnet_net_lock_current();
+	for (pass = 0; pass < 2 && rc == 0; pass++) {
+		elapsed[pass] = 0;
+		start = ktime_get();
+		for (i = 0; i < count; i++) {
+			if (i > 0 && i % LNET_SELECT_BENCH_BATCH == 0) {
+				elapsed[pass] += ktime_to_ns(ktime_sub(
+						ktime_get(), start));
+				lnet_net_unlock(cpt);
+				cond_resched();
+				lnet_net_lock(cpt);
+				start = ktime_get();
+			}
+
+			lpni = lnet_find_peer_ni_locked(nid);
+			if (lpni == NULL) {
+				rc = -ENOENT;
+				break;
+			}
+			peer = lpni->lpni_peer_net->lpn_peer;
+			lnet_peer_ni_decref_locked(lpni);
+
+			ni = lnet_find_best_ni_on_peer(peer, cpt, pass == 0,
+						       &lpn);
+			if (ni == NULL || lpn == NULL ||
+			    lnet_find_best_lpni(peer, lpn, ni) == NULL) {
+				rc = -EHOSTUNREACH;
+				break;
+			}
+		}
+		elapsed[pass] += ktime_to_ns(ktime_sub(ktime_get(), start));
+	}
+	lnet_net_unlock(cpt);
+
+	if (rc == 0) {
+		*cached_ns = elapsed[0];
+		*uncached_ns = elapsed[1];
+	}
+
+	return rc;
+}
+
 /*
  * Traffic to the LNET_RESERVED_PORTAL may not trigger peer discovery,
  * because such traffic is required to perform discovery. We therefore
@@ -1526,10 +1861,8 @@ lnet_select_pathway(lnet_nid_t src_nid, lnet_nid_t dst_nid,
 	int			cpt, cpt2, rc;
 	bool			routing;
 	bool			routing2;
-	bool			ni_is_pref;
-	bool			preferred;
 	bool			local_found;
-	int			best_lpni_credits;
+	struct lnet_peer_net	*best_lpn;
 	int			md_cpt;
 
 	/*
@@ -1556,6 +1889,7 @@ again:
 	routing = false;
 	routing2 = false;
 	local_found = false;
+	best_lpn = NULL;
 
 	/*
 	 * lnet_nid2peerni_locked() is the path that will find an
@@ -1767,6 +2101,15 @@ again:
 	if (best_ni)
 		goto pick_peer;
 
+	/*
+	 * In the common case the peer is reachable over directly
+	 * connected nets, which the selection table of the peer gives
+	 * without going through the routing decisions below.
+	 */
+	best_ni = lnet_find_best_ni_on_peer(peer, md_cpt, true, &best_lpn);
+	if (best_ni)
+		goto charge_ni;
+
 	/*
 	 * pick the best_ni by going through all the possible networks of
 	 * that peer and see which local NI is best suited to talk to that
@@ -1865,20 +2208,25 @@ again:
 		peer = best_gw->lpni_peer_net->lpn_peer;
 	}
 
+charge_ni:
 	/*
 	 * Now that we selected the NI to use increment its sequence
 	 * number so the Round Robin algorithm will detect that it has
 	 * been used and pick the next NI.
 	 */
 	best_ni->ni_seq++;
+	lnet_sel_charge(&best_ni->ni_sel, &best_ni->ni_net->net_sel_vtime,
+			msg->msg_len);
 
 pick_peer:
 	/*
 	 * At this point the best_ni is on a local network on which
 	 * the peer has a peer_ni as well
 	 */
-	peer_net = lnet_peer_get_net_locked(peer,
-					    best_ni->ni_net->net_id);
+	peer_net = best_lpn;
+	if (!peer_net)
+		peer_net = lnet_peer_get_net_locked(peer,
+						    best_ni->ni_net->net_id);
 	/*
 	 * peer_net is not available or the src_nid is explicitly defined
 	 * and the peer_net for that src_nid is unhealthy. find a route to
@@ -1927,60 +2275,7 @@ pick_peer:
 		goto again;
 	}
 
-	/*
-	 * Look at the peer NIs for the destination peer that connect
-	 * to the chosen net. If a peer_ni is preferred when using the
-	 * best_ni to communicate, we use that one. If there is no
-	 * preferred peer_ni, or there are multiple preferred peer_ni,
-	 * the available transmit credits are used. If the transmit
-	 * credits are equal, we round-robin over the peer_ni.
-	 */
-	lpni = NULL;
-	best_lpni_credits = INT_MIN;
-	preferred = false;
-	best_lpni = NULL;
-	while ((lpni = lnet_get_next_peer_ni_locked(peer, peer_net, lpni))) {
-		/*
-		 * if this peer ni is not healthy just skip it, no point in
-		 * examining it further
-		 */
-		if (!lnet_is_peer_ni_healthy_locked(lpni))
-			continue;
-		ni_is_pref = lnet_peer_is_pref_nid_locked(lpni,
-							  best_ni->ni_nid);
-
-		/* if this is a preferred peer use it */
-		if (!preferred && ni_is_pref) {
-			preferred = true;
-		} else if (preferred && !ni_is_pref) {
-			/*
-			 * this is not the preferred peer so let's ignore
-			 * it.
-			 */
-			continue;
-		} else if (lpni->lpni_txcredits < best_lpni_credits) {
-			/*
-			 * We already have a peer that has more credits
-			 * available than this one. No need to consider
-			 * this peer further.
-			 */
-			continue;
-		} else if (lpni->lpni_txcredits == best_lpni_credits) {
-			/*
-			 * The best peer found so far and the current peer
-			 * have the same number of available credits let's
-			 * make sure to select between them using Round
-			 * Robin
-			 */
-			if (best_lpni) {
-				if (best_lpni->lpni_seq <= lpni->lpni_seq)
-					continue;
-			}
-		}
-
-		best_lpni = lpni;
-		best_lpni_credits = lpni->lpni_txcredits;
-	}
+	best_lpni = lnet_find_best_lpni(peer, peer_net, best_ni);
 
 	/* if we still can't find a peer ni then we can't reach it */
 	if (!best_lpni) {
@@ -2016,6 +2311,9 @@ send:
 	 * pick the next one in Round Robin.
 	 */
 	best_lpni->lpni_seq++;
+	lnet_sel_charge(&best_lpni->lpni_sel,
+			&best_lpni->lpni_peer_net->lpn_sel_vtime,
+			msg->msg_len);
 
 	/*
 	 * grab a reference on the peer_ni so it sticks around even if
@@ -2138,6 +2436,10 @@ lnet_send(lnet_nid_t src_nid, struct lnet_msg *msg, lnet_nid_t rtr_nid)
 
 	LASSERT(!msg->msg_tx_committed);
 
+	/* keep the parameters in case the message has to be resent */
+	msg->msg_src_nid_param = src_nid;
+	msg->msg_rtr_nid_param = rtr_nid;
+
 	rc = lnet_select_pathway(src_nid, dst_nid, msg, rtr_nid);
 	if (rc < 0)
 		return rc;
@@ -2699,7 +3001,7 @@ lnet_parse(struct lnet_ni *ni, struct lnet_hdr *hdr, lnet_nid_t from_nid,
 	}
 
 	if (!list_empty(&the_lnet.ln_drop_rules) &&
-	    lnet_drop_rule_match(hdr)) {
+	    lnet_drop_rule_match(hdr, false)) {
 		CDEBUG(D_NET, "%s, src %s, dst %s: Dropping %s to simulate"
 			      "silent message loss\n",
 		       libcfs_nid2str(from_nid), libcfs_nid2str(src_nid),
@@ -218,14 +218,20 @@ lnet_msg_decommit_tx(struct lnet_msg *msg, int status)
 	counters->send_count++;
 
 incr_stats:
-	if (msg->msg_txpeer)
+	if (msg->msg_txpeer) {
 		lnet_incr_stats(&msg->msg_txpeer->lpni_stats,
 				msg->msg_type,
 				LNET_STATS_TYPE_SEND);
-	if (msg->msg_txni)
+		lnet_sel_stats_update(&msg->msg_txpeer->lpni_sel,
+				      msg->msg_len, msg->msg_send_time);
+	}
+	if (msg->msg_txni) {
 		lnet_incr_stats(&msg->msg_txni->ni_stats,
 				msg->msg_type,
 				LNET_STATS_TYPE_SEND);
+		lnet_sel_stats_update(&msg->msg_txni->ni_sel,
+				      msg->msg_len, msg->msg_send_time);
+	}
  out:
 	lnet_return_tx_credits_locked(msg);
 	msg->msg_tx_committed = 0;
@@ -456,6 +462,95 @@ lnet_complete_msg_locked(struct lnet_msg *msg, int cpt)
 	return 0;
 }
 
+/*
+ * Called for a message which failed to be sent: lower the health of the
+ * local NI and the peer NI it was sent over, and if the retry budget
+ * allows, resend it so the selection algorithm can pick another path.
+ *
+ * NB: the resend covers a narrow set of failures only. A message is
+ * resent only if it is a PUT which originated on this node and was never
+ * posted to the LND (!msg_tx_posted): it failed in LNet itself or
+ * lnd_send() refused it, so it provably never left the node, e.g. the NI
+ * or the peer NI was down, or a local drop rule (lctl net_drop_add
+ * --local) failed it.
+ *
+ * Every failure reported after the LND accepted the message, such as a tx
+ * timeout, a connection reset or an error reported by the peer, is final:
+ * it may come after the peer got the PUT, and a resend could deliver it
+ * twice. Most network errors are of this kind; for them the lowered
+ * health only steers later messages to other interfaces. A GET is never
+ * resent either, because the LND may already have created the message
+ * that will receive its REPLY.
+ *
+ * lnet.health_stats counts the failures and the resends.
+ *
+ * Returns true if the message was resent, in which case it must not be
+ * finalized.
+ */
+static bool
+lnet_health_check(struct lnet_msg *msg)
+{
+	struct lnet_ni *ni = msg->msg_txni;
+	struct lnet_peer_ni *lpni = msg->msg_txpeer;
+	int status = msg->msg_ev.status;
+	int cpt;
+	int rc;
+
+	if (!msg->msg_tx_committed || ni == NULL || lpni == NULL ||
+	    status == -ECANCELED || lnet_health_sensitivity == 0)
+		return false;
+
+	cpt = msg->msg_tx_cpt;
+	lnet_net_lock(cpt);
+
+	lnet_healthv_dec(&ni->ni_healthv, &ni->ni_health_time);
+	lnet_healthv_dec(&lpni->lpni_healthv, &lpni->lpni_health_time);
+	atomic_inc(&the_lnet.ln_health_failures);
+
+	CDEBUG(D_NET, "%s->%s: send failed: %d, health %d/%d\n",
+	       libcfs_nid2str(ni->ni_nid), libcfs_nid2str(lpni->lpni_nid),
+	       status, lnet_ni_healthv(ni), lnet_peer_ni_healthv(lpni));
+
+	if (msg->msg_tx_posted ||
+	    msg->msg_type != LNET_MSG_PUT ||
+	    msg->msg_ev.type != LNET_EVENT_SEND ||
+	    msg->msg_rx_committed ||
+	    msg->msg_retry_count >= lnet_retry_count ||
+	    (msg->msg_md != NULL &&
+	     (msg->msg_md->md_flags & LNET_MD_FLAG_ABORTED) != 0)) {
+		lnet_net_unlock(cpt);
+		return false;
+	}
+
+	/* give back the credits and references held on the failed path */
+	lnet_msg_decommit(msg, cpt, status);
+	msg->msg_retry_count++;
+	lnet_net_unlock(cpt);
+	atomic_inc(&the_lnet.ln_health_resends);
+
+	/* undo what lnet_select_pathway() did to the target */
+	msg->msg_target.nid = le64_to_cpu(msg->msg_hdr.dest_nid);
+	msg->msg_target.pid = le32_to_cpu(msg->msg_hdr.dest_pid);
+	msg->msg_target_is_router = 0;
+	msg->msg_tx_delayed = 0;
+	msg->msg_sending = 0;
+
+	CDEBUG(D_NET, "resending %s to %s, retry %u\n",
+	       lnet_msgtyp2str(msg->msg_type),
+	       libcfs_id2str(msg->msg_target), msg->msg_retry_count);
+
+	rc = lnet_send(msg->msg_src_nid_param, msg, msg->msg_rtr_nid_param);
+	if (rc < 0) {
+		CNETERR("Error resending %s to %s: %d\n",
+			lnet_msgtyp2str(msg->msg_type),
+			libcfs_id2str(msg->msg_target), rc);
+		msg->msg_ev.status = rc;
+		return false;
+	}
+
+	return true;
+}
+
 void
 lnet_finalize(struct lnet_msg *msg, int status)
 {
@@ -472,6 +567,9 @@ lnet_finalize(struct lnet_msg *msg, int status)
 
 	msg->msg_ev.status = status;
 
+	if (status != 0 && lnet_health_check(msg))
+		return;
+
 	if (msg->msg_md != NULL) {
 		cpt = lnet_cpt_of_cookie(msg->msg_md->md_lh.lh_cookie);
 
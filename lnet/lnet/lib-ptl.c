@@ -43,6 +43,14 @@ int portal_rotor = LNET_PTL_ROTOR_HASH_RT;
 module_param(portal_rotor, int, 0644);
 MODULE_PARM_DESC(portal_rotor, "redirect PUTs to different cpu-partitions");
 
+/* MEs attached to wildcard portals by threads without CPU affinity are
+ * hashed to a single match table by default, which serializes matching of
+ * all incoming messages on that portal on one CPT lock */
+int portal_spread;
+module_param(portal_spread, int, 0644);
+MODULE_PARM_DESC(portal_spread,
+		 "spread MEs of wildcard portals over all cpu-partitions");
+
 static int
 lnet_ptl_match_type(unsigned int index, struct lnet_process_id match_id,
 		    __u64 mbits, __u64 ignore_bits)
@@ -248,10 +256,15 @@ lnet_mt_of_attach(unsigned int index, struct lnet_process_id id,
 	switch (pos) {
 	default:
 		return NULL;
-	case LNET_INS_BEFORE:
 	case LNET_INS_AFTER:
-		/* posted by no affinity thread, always hash to specific
-		 * match-table to avoid buffer stealing which is heavy */
+		/* posted by no affinity thread: attach it locally if asked
+		 * to, so incoming messages can be matched on all CPTs */
+		if (portal_spread)
+			return ptl->ptl_mtables[lnet_cpt_current()];
+		/* fall through */
+	case LNET_INS_BEFORE:
+		/* otherwise always hash to specific match-table to avoid
+		 * buffer stealing which is heavy */
 		return ptl->ptl_mtables[ptl->ptl_index % LNET_CPT_NUMBER];
 	case LNET_INS_LOCAL:
 		/* posted by cpu-affinity thread */
@@ -290,7 +303,9 @@ lnet_mt_of_match(struct lnet_match_info *info, struct lnet_msg *msg)
 			return ptl->ptl_mtables[cpt];
 	}
 
-	rotor = ptl->ptl_rotor++; /* get round-robin factor */
+	/* get round-robin factor, the rotor of the local match table saves
+	 * bouncing a shared counter between CPTs */
+	rotor = ptl->ptl_mtables[lnet_cpt_current()]->mt_rotor++;
 	if (portal_rotor == LNET_PTL_ROTOR_HASH_RT && routed)
 		cpt = info->mi_cpt;
 	else
@@ -371,6 +386,43 @@ lnet_mt_match_head(struct lnet_match_table *mtable,
 	}
 }
 
+static void
+lnet_mt_stats_update(struct lnet_match_table *mtable, unsigned int walk)
+{
+	struct lnet_mt_stats *stats = &mtable->mt_stats;
+	int bkt = walk == 0 ? 0 : fls(walk);
+
+	stats->ms_nmatch++;
+	stats->ms_nwalk += walk;
+	if (walk > stats->ms_max_walk)
+		stats->ms_max_walk = walk;
+	stats->ms_walk_hist[min(bkt, LNET_MT_WALK_NBKTS - 1)]++;
+}
+
+/**
+ * Reset the matching statistics of all match tables.
+ *
+ * Call with ln_api_mutex held.
+ */
+void
+lnet_mt_stats_reset(void)
+{
+	struct lnet_match_table *mtable;
+	int i;
+	int j;
+
+	if (the_lnet.ln_portals == NULL)
+		return;
+
+	lnet_res_lock(LNET_LOCK_EX);
+	for (i = 0; i < the_lnet.ln_nportals; i++) {
+		cfs_percpt_for_each(mtable, j,
+				    the_lnet.ln_portals[i]->ptl_mtables)
+			memset(&mtable->mt_stats, 0, sizeof(mtable->mt_stats));
+	}
+	lnet_res_unlock(LNET_LOCK_EX);
+}
+
 int
 lnet_mt_match_md(struct lnet_match_table *mtable,
 		 struct lnet_match_info *info, struct lnet_msg *msg)
@@ -378,6 +430,7 @@ lnet_mt_match_md(struct lnet_match_table *mtable,
 	struct list_head	*head;
 	struct lnet_me		*me;
 	struct lnet_me		*tmp;
+	unsigned int		walk = 0;
 	int			exhausted = 0;
 	int			rc;
 
@@ -392,6 +445,7 @@ lnet_mt_match_md(struct lnet_match_table *mtable,
 		exhausted = LNET_MATCHMD_EXHAUSTED;
 
 	list_for_each_entry_safe(me, tmp, head, me_list) {
+		walk++;
 		/* ME attached but MD not attached yet */
 		if (me->me_md == NULL)
 			continue;
@@ -403,6 +457,7 @@ lnet_mt_match_md(struct lnet_match_table *mtable,
 			exhausted = 0; /* mlist is not empty */
 
 		if ((rc & LNET_MATCHMD_FINISH) != 0) {
+			lnet_mt_stats_update(mtable, walk);
 			/* don't return EXHAUSTED bit because we don't know
 			 * whether the mlist is empty or not */
 			return rc & ~LNET_MATCHMD_EXHAUSTED;
@@ -420,6 +475,8 @@ lnet_mt_match_md(struct lnet_match_table *mtable,
 		goto again; /* re-check MEs w/o ignore-bits */
 	}
 
+	lnet_mt_stats_update(mtable, walk);
+
 	if (info->mi_opc == LNET_MD_OP_GET ||
 	    !lnet_ptl_is_lazy(the_lnet.ln_portals[info->mi_portal]))
 		return LNET_MATCHMD_DROP | exhausted;
@@ -505,6 +562,8 @@ lnet_ptl_match_delay(struct lnet_portal *ptl,
 			if ((rc & LNET_MATCHMD_FINISH) != 0) {
 				/* Match found, remove from stealing list. */
 				list_del_init(&msg->msg_list);
+				if ((rc & LNET_MATCHMD_OK) != 0)
+					mtable->mt_stats.ms_nsteal++;
 			} else if (i == LNET_CPT_NUMBER - 1 || /* (1) */
 				   ptl->ptl_mt_nmaps == 0 ||   /* (2) */
 				   (ptl->ptl_mt_nmaps == 1 &&  /* (3) */
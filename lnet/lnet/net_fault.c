@@ -353,10 +353,12 @@ drop_rule_match(struct lnet_drop_rule *rule, lnet_nid_t src,
 }
 
 /**
- * Check if message from \a src to \a dst can match any existed drop rule
+ * Check if message from \a src to \a dst can match any existed drop rule.
+ * Rules with da_local set are only checked when \a send is set, by the
+ * sender, others only by the receiver.
  */
 bool
-lnet_drop_rule_match(struct lnet_hdr *hdr)
+lnet_drop_rule_match(struct lnet_hdr *hdr, bool send)
 {
 	struct lnet_drop_rule	*rule;
 	lnet_nid_t		 src = le64_to_cpu(hdr->src_nid);
@@ -375,6 +377,9 @@ lnet_drop_rule_match(struct lnet_hdr *hdr)
 
 	cpt = lnet_net_lock_current();
 	list_for_each_entry(rule, &the_lnet.ln_drop_rules, dr_link) {
+		if ((rule->dr_attr.u.drop.da_local != 0) != send)
+			continue;
+
 		drop = drop_rule_match(rule, src, dst, typ, ptl);
 		if (drop)
 			break;
@@ -386,8 +391,14 @@ lnet_drop_rule_match(struct lnet_hdr *hdr)
 
 /**
  * LNet Delay Simulation
+ *
+ * Besides delaying some messages by a fixed latency, delay rules can shape
+ * all the traffic they match: latencies drawn from a distribution, a
+ * bandwidth limit enforced by a token bucket and a queue depth beyond which
+ * messages are dropped, which is enough to emulate a WAN link or a
+ * congested fabric on a single node.
  */
-/** timestamp (second) to send delayed message */
+/** timestamp (ns) to send delayed message */
 #define msg_delay_send		 msg_ev.hdr_data
 
 struct lnet_delay_rule {
@@ -412,10 +423,18 @@ struct lnet_delay_rule {
 	time64_t		dl_delay_time;
 	/** baseline to caculate dl_delay_time */
 	time64_t		dl_time_base;
-	/** jiffies to send the next delayed message */
-	unsigned long		dl_msg_send;
+	/** timestamp (ns) to send the next delayed message */
+	__u64			dl_msg_send;
+	/** timestamp (ns) to send the last delayed message */
+	__u64			dl_last_send;
+	/** theoretical arrival time (ns) of the token bucket */
+	__u64			dl_tat;
+	/** # messages on \a dl_msg_list */
+	unsigned int		dl_nqueued;
 	/** delayed message list */
 	struct list_head	dl_msg_list;
+	/** messages dropped because dl_msg_list was full */
+	struct list_head	dl_drop_list;
 	/** statistic of delayed messages */
 	struct lnet_fault_stat	dl_stat;
 	/** timer to wakeup delay_daemon */
@@ -447,12 +466,99 @@ delay_rule_decref(struct lnet_delay_rule *rule)
 	if (atomic_dec_and_test(&rule->dl_refcount)) {
 		LASSERT(list_empty(&rule->dl_sched_link));
 		LASSERT(list_empty(&rule->dl_msg_list));
+		LASSERT(list_empty(&rule->dl_drop_list));
 		LASSERT(list_empty(&rule->dl_link));
 
 		CFS_FREE_PTR(rule);
 	}
 }
 
+/** arm the timer of \a rule for its next delayed message */
+static void
+delay_timer_arm(struct lnet_delay_rule *rule, __u64 now)
+{
+	__u64 usecs = 0;
+
+	if (rule->dl_msg_send > now)
+		usecs = div_u64(rule->dl_msg_send - now, NSEC_PER_USEC);
+
+	mod_timer(&rule->dl_timer,
+		  jiffies + usecs_to_jiffies(min_t(__u64, usecs, UINT_MAX)));
+}
+
+/** latency (ns) of the next message delayed by a rule with \a attr */
+static __u64
+delay_rule_latency(struct lnet_fault_attr *attr)
+{
+	__s64 latency = (__s64)attr->u.delay.la_latency * NSEC_PER_SEC +
+			(__s64)attr->u.delay.la_latency_us * NSEC_PER_USEC;
+	__s64 jitter = (__s64)attr->u.delay.la_jitter_us * NSEC_PER_USEC;
+	__s64 r = 0;
+	int i;
+
+	if (jitter == 0)
+		return latency;
+
+	switch (attr->u.delay.la_dist) {
+	default:
+	case LNET_DELAY_DIST_UNIFORM:
+		r = (__s64)(cfs_rand() & 0xffff) - 0x8000;
+		latency += div_s64(jitter * r, 0x8000);
+		break;
+
+	case LNET_DELAY_DIST_NORMAL:
+		/* the sum of 12 uniform variables on [0, 1) minus 6 is
+		 * close enough to a standard normal one */
+		for (i = 0; i < 12; i++)
+			r += cfs_rand() & 0xffff;
+		r -= 6 * 0x10000;
+		latency += div_s64(jitter * r, 0x10000);
+		break;
+	}
+
+	return max_t(__s64, latency, 0);
+}
+
+/**
+ * Timestamp (ns) at which a message of \a nob bytes matched at \a now
+ * should be released by \a rule. The bandwidth limit is a GCRA token
+ * bucket: a burst of la_burst KiB goes through at once, after that
+ * messages are paced at la_bandwidth. Messages are released in the order
+ * they arrived, as a link would deliver them, so jitter can delay but
+ * never reorder them: a message is never sent before the previous one.
+ * Under a steady load the jitter of a message is mostly absorbed by the
+ * wait behind its predecessors, and the released messages follow the
+ * largest latencies drawn; the configured spread only shows as such on
+ * traffic sparse enough for the queue to drain between messages.
+ *
+ * Called with dl_lock held.
+ */
+static __u64
+delay_rule_send_time(struct lnet_delay_rule *rule, unsigned int nob,
+		     __u64 now)
+{
+	struct lnet_fault_attr *attr = &rule->dl_attr;
+	__u64 send = now;
+	__u64 cost;
+	__u64 tau;
+
+	if (attr->u.delay.la_bandwidth != 0) {
+		cost = div64_u64((__u64)nob * NSEC_PER_SEC,
+				 (__u64)attr->u.delay.la_bandwidth << 10);
+		tau = div_u64((__u64)attr->u.delay.la_burst * NSEC_PER_SEC,
+			      attr->u.delay.la_bandwidth);
+
+		rule->dl_tat = max(rule->dl_tat, now) + cost;
+		if (rule->dl_tat > now + tau)
+			send = rule->dl_tat - tau;
+	}
+
+	send = max(send + delay_rule_latency(attr), rule->dl_last_send);
+	rule->dl_last_send = send;
+
+	return send;
+}
+
 /**
  * check source/destination NID, portal, message type and delay rate,
  * decide whether should delay this message or not
@@ -464,6 +570,7 @@ delay_rule_match(struct lnet_delay_rule *rule, lnet_nid_t src,
 {
 	struct lnet_fault_attr	*attr = &rule->dl_attr;
 	bool			 delay;
+	__u64			 now_ns;
 
 	if (!lnet_fault_attr_match(attr, src, dst, type, portal))
 		return false;
@@ -509,15 +616,29 @@ delay_rule_match(struct lnet_delay_rule *rule, lnet_nid_t src,
 		return false;
 	}
 
+	if (attr->u.delay.la_queue_depth != 0 &&
+	    rule->dl_nqueued >= attr->u.delay.la_queue_depth) {
+		/* tail drop, the message is finalized by delay daemon */
+		rule->dl_stat.u.delay.ls_overflow++;
+		list_add_tail(&msg->msg_list, &rule->dl_drop_list);
+		mod_timer(&rule->dl_timer, jiffies);
+		spin_unlock(&rule->dl_lock);
+		return true;
+	}
+
 	/* delay this message, update counters */
 	lnet_fault_stat_inc(&rule->dl_stat, type);
 	rule->dl_stat.u.delay.ls_delayed++;
 
+	now_ns = ktime_get_ns();
+	msg->msg_delay_send = delay_rule_send_time(rule, msg->msg_len +
+						   sizeof(struct lnet_hdr),
+						   now_ns);
 	list_add_tail(&msg->msg_list, &rule->dl_msg_list);
-	msg->msg_delay_send = ktime_get_seconds() + attr->u.delay.la_latency;
+	rule->dl_nqueued++;
 	if (rule->dl_msg_send == -1) {
 		rule->dl_msg_send = msg->msg_delay_send;
-		mod_timer(&rule->dl_timer, rule->dl_msg_send);
+		delay_timer_arm(rule, now_ns);
 	}
 
 	spin_unlock(&rule->dl_lock);
@@ -554,24 +675,27 @@ lnet_delay_rule_match_locked(struct lnet_hdr *hdr, struct lnet_msg *msg)
 	return false;
 }
 
-/** check out delayed messages for send */
+/**
+ * check out delayed messages for send, and messages which overflowed the
+ * queue of \a rule to \a drop_list
+ */
 static void
 delayed_msg_check(struct lnet_delay_rule *rule, bool all,
-		  struct list_head *msg_list)
+		  struct list_head *msg_list, struct list_head *drop_list)
 {
 	struct lnet_msg *msg;
 	struct lnet_msg *tmp;
-	time64_t now = ktime_get_seconds();
-
-	if (!all && cfs_time_seconds(rule->dl_msg_send) > now)
-		return;
+	__u64 now = ktime_get_ns();
 
 	spin_lock(&rule->dl_lock);
+	list_splice_tail_init(&rule->dl_drop_list, drop_list);
+
 	list_for_each_entry_safe(msg, tmp, &rule->dl_msg_list, msg_list) {
 		if (!all && msg->msg_delay_send > now)
 			break;
 
 		msg->msg_delay_send = 0;
+		rule->dl_nqueued--;
 		list_move_tail(&msg->msg_list, msg_list);
 	}
 
@@ -579,13 +703,13 @@ delayed_msg_check(struct lnet_delay_rule *rule, bool all,
 		del_timer(&rule->dl_timer);
 		rule->dl_msg_send = -1;
 
-	} else if (!list_empty(msg_list)) {
-		/* dequeued some timedout messages, update timer for the
-		 * next delayed message on rule */
+	} else {
+		/* update timer for the next delayed message on rule, it
+		 * may have been fired early by a dropped message */
 		msg = list_entry(rule->dl_msg_list.next,
 				 struct lnet_msg, msg_list);
 		rule->dl_msg_send = msg->msg_delay_send;
-		mod_timer(&rule->dl_timer, rule->dl_msg_send);
+		delay_timer_arm(rule, now);
 	}
 	spin_unlock(&rule->dl_lock);
 }
@@ -647,8 +771,10 @@ lnet_delay_rule_check(void)
 {
 	struct lnet_delay_rule	*rule;
 	struct list_head	 msgs;
+	struct list_head	 drops;
 
 	INIT_LIST_HEAD(&msgs);
+	INIT_LIST_HEAD(&drops);
 	while (1) {
 		if (list_empty(&delay_dd.dd_sched_rules))
 			break;
@@ -664,10 +790,13 @@ lnet_delay_rule_check(void)
 		list_del_init(&rule->dl_sched_link);
 		spin_unlock_bh(&delay_dd.dd_lock);
 
-		delayed_msg_check(rule, false, &msgs);
+		delayed_msg_check(rule, false, &msgs, &drops);
 		delay_rule_decref(rule); /* -1 for delay_dd.dd_sched_rules */
 	}
 
+	if (!list_empty(&drops))
+		delayed_msg_process(&drops, true);
+
 	if (!list_empty(&msgs))
 		delayed_msg_process(&msgs, false);
 }
@@ -717,9 +846,20 @@ int
 lnet_delay_rule_add(struct lnet_fault_attr *attr)
 {
 	struct lnet_delay_rule *rule;
+	bool			shaping;
 	int			rc = 0;
 	ENTRY;
 
+	shaping = attr->u.delay.la_latency_us != 0 ||
+		  attr->u.delay.la_jitter_us != 0 ||
+		  attr->u.delay.la_bandwidth != 0 ||
+		  attr->u.delay.la_queue_depth != 0;
+
+	/* shaping rules apply to all messages by default */
+	if (shaping && attr->u.delay.la_rate == 0 &&
+	    attr->u.delay.la_interval == 0)
+		attr->u.delay.la_rate = 1;
+
 	if (!((attr->u.delay.la_rate == 0) ^
 	      (attr->u.delay.la_interval == 0))) {
 		CDEBUG(D_NET,
@@ -729,11 +869,17 @@ lnet_delay_rule_add(struct lnet_fault_attr *attr)
 		RETURN(-EINVAL);
 	}
 
-	if (attr->u.delay.la_latency == 0) {
+	if (attr->u.delay.la_latency == 0 && !shaping) {
 		CDEBUG(D_NET, "delay latency cannot be zero\n");
 		RETURN(-EINVAL);
 	}
 
+	if (attr->u.delay.la_dist >= LNET_DELAY_DIST_MAX) {
+		CDEBUG(D_NET, "unknown latency distribution %u\n",
+		       attr->u.delay.la_dist);
+		RETURN(-EINVAL);
+	}
+
 	if (lnet_fault_attr_validate(attr) != 0)
 		RETURN(-EINVAL);
 
@@ -765,6 +911,7 @@ lnet_delay_rule_add(struct lnet_fault_attr *attr)
 
 	spin_lock_init(&rule->dl_lock);
 	INIT_LIST_HEAD(&rule->dl_msg_list);
+	INIT_LIST_HEAD(&rule->dl_drop_list);
 	INIT_LIST_HEAD(&rule->dl_sched_link);
 
 	rule->dl_attr = *attr;
@@ -784,9 +931,13 @@ lnet_delay_rule_add(struct lnet_fault_attr *attr)
 	list_add(&rule->dl_link, &the_lnet.ln_delay_rules);
 	lnet_net_unlock(LNET_LOCK_EX);
 
-	CDEBUG(D_NET, "Added delay rule: src %s, dst %s, rate %d\n",
+	CDEBUG(D_NET, "Added delay rule: src %s, dst %s, rate %d, "
+	       "latency %us+%uus, jitter %uus, bandwidth %uKiB/s, "
+	       "queue %u\n",
 	       libcfs_nid2str(attr->fa_src), libcfs_nid2str(attr->fa_src),
-	       attr->u.delay.la_rate);
+	       attr->u.delay.la_rate, attr->u.delay.la_latency,
+	       attr->u.delay.la_latency_us, attr->u.delay.la_jitter_us,
+	       attr->u.delay.la_bandwidth, attr->u.delay.la_queue_depth);
 
 	mutex_unlock(&delay_dd.dd_mutex);
 	RETURN(0);
@@ -813,12 +964,14 @@ lnet_delay_rule_del(lnet_nid_t src, lnet_nid_t dst, bool shutdown)
 	struct lnet_delay_rule	*tmp;
 	struct list_head	rule_list;
 	struct list_head	msg_list;
+	struct list_head	drop_list;
 	int			n = 0;
 	bool			cleanup;
 	ENTRY;
 
 	INIT_LIST_HEAD(&rule_list);
 	INIT_LIST_HEAD(&msg_list);
+	INIT_LIST_HEAD(&drop_list);
 
 	if (shutdown)
 		src = dst = 0;
@@ -851,7 +1004,7 @@ lnet_delay_rule_del(lnet_nid_t src, lnet_nid_t dst, bool shutdown)
 		list_del_init(&rule->dl_link);
 
 		del_timer_sync(&rule->dl_timer);
-		delayed_msg_check(rule, true, &msg_list);
+		delayed_msg_check(rule, true, &msg_list, &drop_list);
 		delay_rule_decref(rule); /* -1 for the_lnet.ln_delay_rules */
 		n++;
 	}
@@ -866,6 +1019,9 @@ lnet_delay_rule_del(lnet_nid_t src, lnet_nid_t dst, bool shutdown)
 	}
 	mutex_unlock(&delay_dd.dd_mutex);
 
+	if (!list_empty(&drop_list))
+		delayed_msg_process(&drop_list, true);
+
 	if (!list_empty(&msg_list))
 		delayed_msg_process(&msg_list, shutdown);
 
@@ -893,6 +1049,7 @@ lnet_delay_rule_list(int pos, struct lnet_fault_attr *attr,
 		spin_lock(&rule->dl_lock);
 		*attr = rule->dl_attr;
 		*stat = rule->dl_stat;
+		stat->u.delay.ls_queued = rule->dl_nqueued;
 		spin_unlock(&rule->dl_lock);
 		rc = 0;
 		break;
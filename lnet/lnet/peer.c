@@ -75,6 +75,8 @@ lnet_peer_net_added(struct lnet_net *net)
 			lpni->lpni_rtrcredits =
 				lnet_peer_buffer_credits(lpni->lpni_net);
 			lpni->lpni_minrtrcredits = lpni->lpni_rtrcredits;
+			lpni->lpni_rtrcredits_quota = lpni->lpni_rtrcredits;
+			lpni->lpni_tune_minrtrcredits = lpni->lpni_rtrcredits;
 			spin_unlock(&lpni->lpni_lock);
 
 			lnet_peer_remove_from_remote_list(lpni);
@@ -176,6 +178,7 @@ lnet_peer_ni_alloc(lnet_nid_t nid)
 	lpni->lpni_nid = nid;
 	lpni->lpni_cpt = cpt;
 	lnet_set_peer_ni_health_locked(lpni, true);
+	atomic_set(&lpni->lpni_healthv, LNET_MAX_HEALTH_VALUE);
 
 	net = lnet_get_net_locked(LNET_NIDNET(nid));
 	lpni->lpni_net = net;
@@ -184,6 +187,8 @@ lnet_peer_ni_alloc(lnet_nid_t nid)
 		lpni->lpni_mintxcredits = lpni->lpni_txcredits;
 		lpni->lpni_rtrcredits = lnet_peer_buffer_credits(net);
 		lpni->lpni_minrtrcredits = lpni->lpni_rtrcredits;
+		lpni->lpni_rtrcredits_quota = lpni->lpni_rtrcredits;
+		lpni->lpni_tune_minrtrcredits = lpni->lpni_rtrcredits;
 	} else {
 		/*
 		 * This peer_ni is not on a local network, so we
@@ -332,6 +337,7 @@ lnet_peer_detach_peer_ni_locked(struct lnet_peer_ni *lpni)
 	/* Update peer NID count. */
 	lp = lpn->lpn_peer;
 	lp->lp_nnis--;
+	lp->lp_sel_gen++;
 
 	/*
 	 * If there are no more peer nets, make the peer unfindable
@@ -1184,6 +1190,7 @@ lnet_peer_attach_peer_ni(struct lnet_peer *lp,
 	spin_unlock(&lp->lp_lock);
 
 	lp->lp_nnis++;
+	lp->lp_sel_gen++;
 	lnet_net_unlock(LNET_LOCK_EX);
 
 	CDEBUG(D_NET, "peer %s NID %s flags %#x\n",
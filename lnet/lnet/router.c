@@ -50,6 +50,14 @@ static int peer_buffer_credits;
 module_param(peer_buffer_credits, int, 0444);
 MODULE_PARM_DESC(peer_buffer_credits, "# router buffer credits per peer");
 
+static int router_tune_interval;
+module_param(router_tune_interval, int, 0644);
+MODULE_PARM_DESC(router_tune_interval, "seconds between auto-tuning of router buffers and credits (0 to disable)");
+
+static int router_buffers_max_mb;
+module_param(router_buffers_max_mb, int, 0644);
+MODULE_PARM_DESC(router_buffers_max_mb, "max MB of router buffers auto-tuning may allocate (0 for 1/8 of RAM)");
+
 static int auto_down = 1;
 module_param(auto_down, int, 0444);
 MODULE_PARM_DESC(auto_down, "Automatically mark peers down on comms error");
@@ -70,6 +78,7 @@ lnet_peer_buffer_credits(struct lnet_net *net)
 
 /* forward ref's */
 static int lnet_router_checker(void *);
+static void lnet_rtr_tune(void);
 
 static int check_routers_before_use;
 module_param(check_routers_before_use, int, 0444);
@@ -1344,6 +1353,9 @@ rescan:
 
 		lnet_prune_rc_data(0); /* don't wait for UNLINK */
 
+		if (the_lnet.ln_routing)
+			lnet_rtr_tune();
+
 		/* Call schedule_timeout() here always adds 1 to load average
 		 * because kernel counts # active tasks as nr_running
 		 * + nr_uninterruptible. */
@@ -1431,6 +1443,7 @@ lnet_rtrpool_free_bufs(struct lnet_rtrbufpool *rbp, int cpt)
 	rbp->rbp_req_nbuffers = 0;
 	rbp->rbp_nbuffers = rbp->rbp_credits = 0;
 	rbp->rbp_mincredits = 0;
+	rbp->rbp_tune_mincredits = 0;
 	lnet_net_unlock(cpt);
 
 	/* Free buffers on the free list. */
@@ -1499,7 +1512,9 @@ lnet_rtrpool_adjust_bufs(struct lnet_rtrbufpool *rbp, int nbufs, int cpt)
 	list_splice_tail(&rb_list, &rbp->rbp_bufs);
 	rbp->rbp_nbuffers += num_buffers;
 	rbp->rbp_credits += num_buffers;
-	rbp->rbp_mincredits = rbp->rbp_credits;
+	/* the low water mark shown to the user stays across resizes, it
+	 * is still the lowest the credits have been */
+	rbp->rbp_tune_mincredits = rbp->rbp_credits;
 	/* We need to schedule blocked msg using the newly
 	 * added buffers. */
 	while (!list_empty(&rbp->rbp_bufs) &&
@@ -1529,6 +1544,7 @@ lnet_rtrpool_init(struct lnet_rtrbufpool *rbp, int npages)
 	rbp->rbp_npages = npages;
 	rbp->rbp_credits = 0;
 	rbp->rbp_mincredits = 0;
+	rbp->rbp_tune_mincredits = 0;
 }
 
 void
@@ -1792,6 +1808,270 @@ lnet_rtrpools_disable(void)
 	lnet_rtrpools_free(1);
 }
 
+/*
+ * Router buffer and credit auto-tuning
+ *
+ * Every router_tune_interval seconds, each buffer pool is sized after the
+ * lowest number of free buffers it had since the last time. A pool whose
+ * messages had to wait for buffers, or nearly did, grows by half; one
+ * which left more than half of its buffers idle gives back half of the
+ * idle ones, down to the minimum size of the pool. Growth stops at
+ * router_buffers_max_mb of memory for all the pools.
+ *
+ * The router credits of the peers are rebalanced the same way: a peer
+ * whose messages waited for a credit gets more credits, up to
+ * LNET_RTR_CREDITS_SCALE times its configured number, and an idle peer
+ * returns the extra credits it was given.
+ */
+
+/* auto-tuning may raise the router credits of a peer this many times */
+#define LNET_RTR_CREDITS_SCALE	4
+
+static const int lnet_nrb_min[LNET_NRBPOOLS] = {
+	[LNET_TINY_BUF_IDX]	= LNET_NRB_TINY_MIN,
+	[LNET_SMALL_BUF_IDX]	= LNET_NRB_SMALL_MIN,
+	[LNET_LARGE_BUF_IDX]	= LNET_NRB_LARGE_MIN,
+};
+
+/* memory used by each buffer of \a rbp */
+static long
+lnet_rtrbuf_size(struct lnet_rtrbufpool *rbp)
+{
+	return offsetof(struct lnet_rtrbuf, rb_kiov[rbp->rbp_npages]) +
+	       (long)rbp->rbp_npages * PAGE_SIZE;
+}
+
+static __u64
+lnet_rtrpools_bytes(void)
+{
+	struct lnet_rtrbufpool *rtrp;
+	__u64 bytes = 0;
+	int cpt;
+	int i;
+
+	if (the_lnet.ln_rtrpools == NULL)
+		return 0;
+
+	cfs_percpt_for_each(rtrp, cpt, the_lnet.ln_rtrpools) {
+		for (i = 0; i < LNET_NRBPOOLS; i++)
+			bytes += (__u64)rtrp[i].rbp_nbuffers *
+				 lnet_rtrbuf_size(&rtrp[i]);
+	}
+
+	return bytes;
+}
+
+static __u64
+lnet_rtrpools_max_bytes(void)
+{
+	if (router_buffers_max_mb > 0)
+		return (__u64)router_buffers_max_mb << 20;
+
+	return ((__u64)NUM_CACHEPAGES << PAGE_SHIFT) / 8;
+}
+
+/* Free idle buffers of \a rbp until it has no more than \a nbufs */
+static void
+lnet_rtrpool_shrink_bufs(struct lnet_rtrbufpool *rbp, int nbufs, int cpt)
+{
+	struct lnet_rtrbuf *rb;
+	struct list_head tmp;
+
+	INIT_LIST_HEAD(&tmp);
+
+	lnet_net_lock(cpt);
+	/* buffers in use beyond nbufs are freed when they are returned */
+	rbp->rbp_req_nbuffers = nbufs;
+	while (rbp->rbp_nbuffers > nbufs && rbp->rbp_credits > 0) {
+		rb = list_entry(rbp->rbp_bufs.next, struct lnet_rtrbuf,
+				rb_list);
+		list_move(&rb->rb_list, &tmp);
+		rbp->rbp_nbuffers--;
+		rbp->rbp_credits--;
+	}
+	if (rbp->rbp_mincredits > rbp->rbp_credits)
+		rbp->rbp_mincredits = rbp->rbp_credits;
+	rbp->rbp_tune_mincredits = rbp->rbp_credits;
+	lnet_net_unlock(cpt);
+
+	while (!list_empty(&tmp)) {
+		rb = list_entry(tmp.next, struct lnet_rtrbuf, rb_list);
+		list_del(&rb->rb_list);
+		lnet_destroy_rtrbuf(rb, rbp->rbp_npages);
+	}
+}
+
+/*
+ * Resize pool \a idx of CPT \a cpt after its use since it was last tuned.
+ * \a budget is the memory the pools may still grow by.
+ */
+static void
+lnet_rtrpool_tune(struct lnet_rtrbufpool *rbp, int idx, int cpt,
+		  __s64 *budget)
+{
+	struct lnet_ioctl_rtr_tune_stats *stats = &the_lnet.ln_rtr_tune;
+	long size = lnet_rtrbuf_size(rbp);
+	int lowmark;
+	int nbufs;
+	int nrb;
+
+	lnet_net_lock(cpt);
+	nbufs = rbp->rbp_req_nbuffers;
+	lowmark = rbp->rbp_tune_mincredits;
+	rbp->rbp_tune_mincredits = rbp->rbp_credits;
+	lnet_net_unlock(cpt);
+
+	if (nbufs == 0)
+		return;
+
+	if (lowmark <= nbufs / 8) {
+		/* messages waited, or nearly did, for a buffer */
+		nrb = max(nbufs / 2, -lowmark);
+		if ((__s64)nrb * size > *budget) {
+			nrb = *budget > 0 ? div64_s64(*budget, size) : 0;
+			stats->rts_pool_capped++;
+		}
+		if (nrb <= 0)
+			return;
+
+		if (lnet_rtrpool_adjust_bufs(rbp, nbufs + nrb, cpt) != 0)
+			return;
+
+		*budget -= (__s64)nrb * size;
+		stats->rts_pool_grow++;
+		CDEBUG(D_NET, "CPT %d pool %d: grown to %d buffers\n",
+		       cpt, idx, nbufs + nrb);
+	} else if (lowmark > nbufs / 2 && nbufs > lnet_nrb_min[idx]) {
+		/* more than half of the buffers stayed idle */
+		nrb = max(nbufs - lowmark / 2, lnet_nrb_min[idx]);
+		lnet_rtrpool_shrink_bufs(rbp, nrb, cpt);
+
+		stats->rts_pool_shrink++;
+		CDEBUG(D_NET, "CPT %d pool %d: shrunk to %d buffers\n",
+		       cpt, idx, nrb);
+	}
+}
+
+/* Rebalance the router credits of the peers after their recent use */
+static void
+lnet_peer_rtrcredits_tune(void)
+{
+	struct lnet_ioctl_rtr_tune_stats *stats = &the_lnet.ln_rtr_tune;
+	struct lnet_peer_table *ptable;
+	struct lnet_peer_ni *lpni;
+	struct lnet_msg *msg;
+	struct list_head msgs;
+	int lowmark;
+	int delta;
+	int base;
+	int hash;
+	int cpt;
+
+	INIT_LIST_HEAD(&msgs);
+
+	cfs_percpt_for_each(ptable, cpt, the_lnet.ln_peer_tables) {
+		lnet_net_lock(cpt);
+		for (hash = 0; hash < LNET_PEER_HASH_SIZE; hash++) {
+			list_for_each_entry(lpni, &ptable->pt_hash[hash],
+					    lpni_hashlist) {
+				if (lpni->lpni_net == NULL)
+					continue;
+
+				base = lnet_peer_buffer_credits(lpni->lpni_net);
+
+				spin_lock(&lpni->lpni_lock);
+				lowmark = lpni->lpni_tune_minrtrcredits;
+				if (lowmark < 0 &&
+				    lpni->lpni_rtrcredits_quota <
+				    base * LNET_RTR_CREDITS_SCALE) {
+					/* messages waited for a credit */
+					delta = max(lpni->lpni_rtrcredits_quota /
+						    2, -lowmark);
+					delta = min(delta,
+						    base * LNET_RTR_CREDITS_SCALE -
+						    lpni->lpni_rtrcredits_quota);
+					lpni->lpni_rtrcredits_quota += delta;
+					lpni->lpni_rtrcredits += delta;
+
+					/* receive the messages the new
+					 * credits are for */
+					while (delta-- > 0 &&
+					       !list_empty(&lpni->lpni_rtrq)) {
+						msg = list_entry(
+							lpni->lpni_rtrq.next,
+							struct lnet_msg,
+							msg_list);
+						list_move_tail(&msg->msg_list,
+							       &msgs);
+					}
+					stats->rts_credits_grant++;
+				} else if (lowmark >
+					   lpni->lpni_rtrcredits_quota / 2 &&
+					   lpni->lpni_rtrcredits_quota > base) {
+					/* more than half of them stayed idle,
+					 * give back the extra ones */
+					delta = min(lowmark / 2,
+						    lpni->lpni_rtrcredits_quota -
+						    base);
+					lpni->lpni_rtrcredits_quota -= delta;
+					lpni->lpni_rtrcredits -= delta;
+					if (lpni->lpni_minrtrcredits >
+					    lpni->lpni_rtrcredits)
+						lpni->lpni_minrtrcredits =
+							lpni->lpni_rtrcredits;
+					stats->rts_credits_reclaim++;
+				}
+				lpni->lpni_tune_minrtrcredits =
+					lpni->lpni_rtrcredits;
+				spin_unlock(&lpni->lpni_lock);
+			}
+		}
+		lnet_net_unlock(cpt);
+
+		lnet_post_routed_msgs(&msgs);
+	}
+}
+
+static void
+lnet_rtr_tune(void)
+{
+	struct lnet_rtrbufpool *rtrp;
+	time64_t now = ktime_get_seconds();
+	__s64 budget;
+	int cpt;
+	int i;
+
+	if (router_tune_interval <= 0 ||
+	    now < the_lnet.ln_rtr_tune_last + router_tune_interval)
+		return;
+
+	/* LNet shutdown stops this thread holding ln_api_mutex */
+	if (!mutex_trylock(&the_lnet.ln_api_mutex))
+		return;
+
+	the_lnet.ln_rtr_tune_last = now;
+	if (!the_lnet.ln_routing || the_lnet.ln_rtrpools == NULL)
+		goto out;
+
+	budget = lnet_rtrpools_max_bytes() - lnet_rtrpools_bytes();
+	cfs_percpt_for_each(rtrp, cpt, the_lnet.ln_rtrpools) {
+		for (i = 0; i < LNET_NRBPOOLS; i++)
+			lnet_rtrpool_tune(&rtrp[i], i, cpt, &budget);
+	}
+
+	lnet_peer_rtrcredits_tune();
+out:
+	mutex_unlock(&the_lnet.ln_api_mutex);
+}
+
+/* Call with ln_api_mutex held */
+void
+lnet_rtr_tune_stats_get(struct lnet_ioctl_rtr_tune_stats *stats)
+{
+	*stats = the_lnet.ln_rtr_tune;
+	stats->rts_pool_bytes = lnet_rtrpools_bytes();
+}
+
 int
 lnet_notify(struct lnet_ni *ni, lnet_nid_t nid, int alive, time64_t when)
 {
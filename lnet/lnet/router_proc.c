@@ -134,6 +134,35 @@ proc_lnet_stats(struct ctl_table *table, int write, void __user *buffer,
 				    __proc_lnet_stats);
 }
 
+static int __proc_lnet_health_stats(void *data, int write,
+				    loff_t pos, void __user *buffer, int nob)
+{
+	char	tmpstr[64];
+	int	len;
+
+	if (write) {
+		atomic_set(&the_lnet.ln_health_failures, 0);
+		atomic_set(&the_lnet.ln_health_resends, 0);
+		return 0;
+	}
+
+	len = snprintf(tmpstr, sizeof(tmpstr), "failures: %d\nresends: %d",
+		       atomic_read(&the_lnet.ln_health_failures),
+		       atomic_read(&the_lnet.ln_health_resends));
+	if (pos >= len)
+		return 0;
+
+	return cfs_trace_copyout_string(buffer, nob, tmpstr + pos, "\n");
+}
+
+static int
+proc_lnet_health_stats(struct ctl_table *table, int write,
+		       void __user *buffer, size_t *lenp, loff_t *ppos)
+{
+	return lprocfs_call_handler(table->data, write, ppos, buffer, lenp,
+				    __proc_lnet_health_stats);
+}
+
 static int
 proc_lnet_routes(struct ctl_table *table, int write, void __user *buffer,
 		 size_t *lenp, loff_t *ppos)
@@ -454,9 +483,9 @@ proc_lnet_peers(struct ctl_table *table, int write, void __user *buffer,
 
 	if (*ppos == 0) {
 		s += snprintf(s, tmpstr + tmpsiz - s,
-			      "%-24s %4s %5s %5s %5s %5s %5s %5s %5s %s\n",
+			      "%-24s %4s %5s %5s %5s %5s %5s %5s %5s %5s %s\n",
 			      "nid", "refs", "state", "last", "max",
-			      "rtr", "min", "tx", "min", "queue");
+			      "rtr", "min", "tx", "min", "queue", "health");
 		LASSERT(tmpstr + tmpsiz - s > 0);
 
 		hoff++;
@@ -530,6 +559,7 @@ proc_lnet_peers(struct ctl_table *table, int write, void __user *buffer,
 			int rtrcr = peer->lpni_rtrcredits;
 			int minrtrcr = peer->lpni_minrtrcredits;
 			int txqnob = peer->lpni_txqnob;
+			int healthv = lnet_peer_ni_healthv(peer);
 
 			if (lnet_isrouter(peer) ||
 			    lnet_peer_aliveness_enabled(peer))
@@ -551,10 +581,10 @@ proc_lnet_peers(struct ctl_table *table, int write, void __user *buffer,
 			lnet_net_unlock(cpt);
 
 			s += snprintf(s, tmpstr + tmpsiz - s,
-				      "%-24s %4d %5s %5lld %5d %5d %5d %5d %5d %d\n",
+				      "%-24s %4d %5s %5lld %5d %5d %5d %5d %5d %5d %d\n",
 				      libcfs_nid2str(nid), nrefs, aliveness,
 				      lastalive, maxcr, rtrcr, minrtrcr, txcr,
-				      mintxcr, txqnob);
+				      mintxcr, txqnob, healthv);
 			LASSERT(tmpstr + tmpsiz - s > 0);
 
 		} else { /* peer is NULL */
@@ -712,9 +742,9 @@ proc_lnet_nis(struct ctl_table *table, int write, void __user *buffer,
 
 	if (*ppos == 0) {
 		s += snprintf(s, tmpstr + tmpsiz - s,
-			      "%-24s %6s %5s %4s %4s %4s %5s %5s %5s\n",
+			      "%-24s %6s %5s %4s %4s %4s %5s %5s %5s %s\n",
 			      "nid", "status", "alive", "refs", "peer",
-			      "rtr", "max", "tx", "min");
+			      "rtr", "max", "tx", "min", "health");
 		LASSERT (tmpstr + tmpsiz - s > 0);
 	} else {
 		struct lnet_ni *ni   = NULL;
@@ -761,13 +791,14 @@ proc_lnet_nis(struct ctl_table *table, int write, void __user *buffer,
 					lnet_net_lock(i);
 
 				s += snprintf(s, tmpstr + tmpsiz - s,
-				      "%-24s %6s %5lld %4d %4d %4d %5d %5d %5d\n",
+				      "%-24s %6s %5lld %4d %4d %4d %5d %5d %5d %d\n",
 				      libcfs_nid2str(ni->ni_nid), stat,
 				      last_alive, *ni->ni_refs[i],
 				      ni->ni_net->net_tunables.lct_peer_tx_credits,
 				      ni->ni_net->net_tunables.lct_peer_rtr_credits,
 				      tq->tq_credits_max,
-				      tq->tq_credits, tq->tq_credits_min);
+				      tq->tq_credits, tq->tq_credits_min,
+				      lnet_ni_healthv(ni));
 				if (i != 0)
 					lnet_net_unlock(i);
 			}
@@ -902,6 +933,180 @@ proc_lnet_portal_rotor(struct ctl_table *table, int write, void __user *buffer,
 				    __proc_lnet_portal_rotor);
 }
 
+/* one line of portals: portal, cpt, type, 4 __u64 and the histogram */
+#define LNET_PORTALS_LINE	(64 + 21 * (4 + LNET_MT_WALK_NBKTS))
+
+static const char *lnet_portal_type(struct lnet_portal *ptl)
+{
+	if (lnet_ptl_is_wildcard(ptl))
+		return "wildcard";
+	if (lnet_ptl_is_unique(ptl))
+		return "unique";
+	return "-";
+}
+
+static int __proc_lnet_portals(void *data, int write,
+			       loff_t pos, void __user *buffer, int nob)
+{
+	struct lnet_match_table *mtable;
+	struct lnet_mt_stats stats;
+	char *tmpstr;
+	char *s;
+	int tmpsiz;
+	int len;
+	int rc;
+	int i;
+	int j;
+	int k;
+
+	if (write) {
+		mutex_lock(&the_lnet.ln_api_mutex);
+		lnet_mt_stats_reset();
+		mutex_unlock(&the_lnet.ln_api_mutex);
+		return 0;
+	}
+
+	tmpsiz = LNET_PORTALS_LINE * (MAX_PORTALS * LNET_CPT_NUMBER + 1);
+	LIBCFS_ALLOC(tmpstr, tmpsiz);
+	if (tmpstr == NULL)
+		return -ENOMEM;
+
+	s = tmpstr; /* points to current position in tmpstr[] */
+
+	s += snprintf(s, tmpstr + tmpsiz - s,
+		      "%-6s %-3s %-8s %10s %12s %5s %6s %10s walk:",
+		      "portal", "cpt", "type", "matches", "walked",
+		      "avg", "max", "steals");
+	for (k = 0; k < LNET_MT_WALK_NBKTS - 1; k++)
+		s += snprintf(s, tmpstr + tmpsiz - s, " %s%u",
+			      k < 2 ? "" : "<", k < 2 ? k : 1 << k);
+	s += snprintf(s, tmpstr + tmpsiz - s, " >=%u\n",
+		      1 << (LNET_MT_WALK_NBKTS - 2));
+
+	mutex_lock(&the_lnet.ln_api_mutex);
+	if (the_lnet.ln_portals == NULL)
+		goto out;
+
+	for (i = 0; i < the_lnet.ln_nportals; i++) {
+		struct lnet_portal *ptl = the_lnet.ln_portals[i];
+
+		cfs_percpt_for_each(mtable, j, ptl->ptl_mtables) {
+			lnet_res_lock(j);
+			stats = mtable->mt_stats;
+			lnet_res_unlock(j);
+
+			if (stats.ms_nmatch == 0)
+				continue;
+
+			s += snprintf(s, tmpstr + tmpsiz - s,
+				      "%-6d %-3d %-8s %10llu %12llu %5llu "
+				      "%6u %10llu      ",
+				      i, j, lnet_portal_type(ptl),
+				      stats.ms_nmatch, stats.ms_nwalk,
+				      div64_u64(stats.ms_nwalk,
+						stats.ms_nmatch),
+				      stats.ms_max_walk, stats.ms_nsteal);
+			for (k = 0; k < LNET_MT_WALK_NBKTS; k++)
+				s += snprintf(s, tmpstr + tmpsiz - s, " %llu",
+					      stats.ms_walk_hist[k]);
+			s += snprintf(s, tmpstr + tmpsiz - s, "\n");
+			LASSERT(tmpstr + tmpsiz - s > 0);
+		}
+	}
+ out:
+	mutex_unlock(&the_lnet.ln_api_mutex);
+
+	len = s - tmpstr;
+
+	if (pos >= min_t(int, len, strlen(tmpstr)))
+		rc = 0;
+	else
+		rc = cfs_trace_copyout_string(buffer, nob,
+					      tmpstr + pos, NULL);
+
+	LIBCFS_FREE(tmpstr, tmpsiz);
+	return rc;
+}
+
+static int
+proc_lnet_portals(struct ctl_table *table, int write, void __user *buffer,
+		  size_t *lenp, loff_t *ppos)
+{
+	return lprocfs_call_handler(table->data, write, ppos, buffer, lenp,
+				    __proc_lnet_portals);
+}
+
+/* largest number of selections timed by one write to select_bench */
+#define LNET_SELECT_BENCH_MAX	10000
+
+static char lnet_select_bench_result[128];
+
+static int __proc_lnet_select_bench(void *data, int write,
+				    loff_t pos, void __user *buffer, int nob)
+{
+	const int	buf_len	= 128;
+	char		*buf;
+	char		*str;
+	char		*tmp;
+	lnet_nid_t	nid;
+	unsigned int	count = 1000;
+	__u64		cached_ns;
+	__u64		uncached_ns;
+	int		rc;
+
+	if (!write) {
+		mutex_lock(&the_lnet.ln_api_mutex);
+		if (pos >= strlen(lnet_select_bench_result))
+			rc = 0;
+		else
+			rc = cfs_trace_copyout_string(buffer, nob,
+					lnet_select_bench_result + pos, NULL);
+		mutex_unlock(&the_lnet.ln_api_mutex);
+		return rc;
+	}
+
+	LIBCFS_ALLOC(buf, buf_len);
+	if (buf == NULL)
+		return -ENOMEM;
+
+	rc = cfs_trace_copyin_string(buf, buf_len, buffer, nob);
+	if (rc < 0)
+		goto out;
+
+	/* "<nid> [<count>]" */
+	tmp = cfs_trimwhite(buf);
+	str = strsep(&tmp, " \t");
+	nid = libcfs_str2nid(str);
+	if (nid == LNET_NID_ANY ||
+	    (tmp != NULL && kstrtouint(cfs_trimwhite(tmp), 0, &count) != 0) ||
+	    count == 0 || count > LNET_SELECT_BENCH_MAX) {
+		rc = -EINVAL;
+		goto out;
+	}
+
+	mutex_lock(&the_lnet.ln_api_mutex);
+	rc = lnet_select_bench(nid, count, &cached_ns, &uncached_ns);
+	if (rc == 0)
+		snprintf(lnet_select_bench_result,
+			 sizeof(lnet_select_bench_result),
+			 "nid: %s\ncount: %u\ncached_ns: %llu\n"
+			 "uncached_ns: %llu\n",
+			 libcfs_nid2str(nid), count,
+			 div_u64(cached_ns, count),
+			 div_u64(uncached_ns, count));
+	mutex_unlock(&the_lnet.ln_api_mutex);
+out:
+	LIBCFS_FREE(buf, buf_len);
+	return rc;
+}
+
+static int
+proc_lnet_select_bench(struct ctl_table *table, int write,
+		       void __user *buffer, size_t *lenp, loff_t *ppos)
+{
+	return lprocfs_call_handler(table->data, write, ppos, buffer, lenp,
+				    __proc_lnet_select_bench);
+}
 
 static struct ctl_table lnet_table[] = {
 	/*
@@ -914,6 +1119,12 @@ static struct ctl_table lnet_table[] = {
 		.mode		= 0644,
 		.proc_handler	= &proc_lnet_stats,
 	},
+	{
+		INIT_CTL_NAME
+		.procname	= "health_stats",
+		.mode		= 0644,
+		.proc_handler	= &proc_lnet_health_stats,
+	},
 	{
 		INIT_CTL_NAME
 		.procname	= "routes",
@@ -950,6 +1161,18 @@ static struct ctl_table lnet_table[] = {
 		.mode		= 0644,
 		.proc_handler	= &proc_lnet_portal_rotor,
 	},
+	{
+		INIT_CTL_NAME
+		.procname	= "portals",
+		.mode		= 0644,
+		.proc_handler	= &proc_lnet_portals,
+	},
+	{
+		INIT_CTL_NAME
+		.procname	= "select_bench",
+		.mode		= 0644,
+		.proc_handler	= &proc_lnet_select_bench,
+	},
 	{ .procname = NULL }
 };
 
@@ -0,0 +1,313 @@
+/*
+ * GPL HEADER START
+ *
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License version 2 for more details (a copy is included
+ * in the LICENSE file that accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this program; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 021110-1307, USA
+ *
+ * GPL HEADER END
+ */
+/*
+ * This file is part of Lustre, http://www.lustre.org/
+ *
+ * lnet/lnet/sel_policy.c
+ *
+ * Multi-Rail path selection policies and load estimates
+ *
+ * Every local NI and peer NI carries a struct lnet_sel_stats. Completed
+ * sends feed it a moving average of the send completion time of small
+ * messages and of the throughput of large ones. From these, each send
+ * selected on the interface is charged an estimated cost in a virtual
+ * clock, and the selection algorithm prefers the interface whose virtual
+ * clock is the lowest. Each net has its own virtual time, so interfaces
+ * of different nets are compared on their clock ahead of the virtual
+ * time of their net. This is start-time fair queueing: each interface
+ * gets a share of the traffic inversely proportional to the cost of a
+ * message on it, so a 100G rail carries about four times the bulk traffic
+ * of a 25G rail, and a rail with twice the latency half the small
+ * messages. Idle interfaces are brought up to the virtual time of the
+ * last selection on their net, so they cannot claim a burst of traffic
+ * when they come back.
+ *
+ * Before the load estimates, interfaces are ranked by user defined
+ * policies: a nidlist and a priority, lower priorities being preferred.
+ * A policy matching a single NID expresses a preferred NID, one like
+ * "*@o2ib" a network priority, and address ranges select sets of NIDs.
+ */
+
+#define DEBUG_SUBSYSTEM S_LNET
+
+#include <lnet/lib-lnet.h>
+
+/* messages at least this large are used to estimate bandwidth */
+#define LNET_SEL_BW_MIN_NOB	(64 << 10)
+
+/* priority of interfaces which match no policy */
+#define LNET_SEL_PRIO_DEFAULT	(~0U)
+
+struct lnet_sel_rule {
+	/* chain on the_lnet.ln_sel_rules */
+	struct list_head	sr_list;
+	/* compiled form of sr_nids */
+	struct list_head	sr_nidlist;
+	__u32			sr_priority;
+	char			sr_nids[LNET_MAX_STR_LEN];
+};
+
+static struct lnet_sel_rule *
+lnet_sel_rule_find_locked(const char *nids)
+{
+	struct lnet_sel_rule *rule;
+
+	list_for_each_entry(rule, &the_lnet.ln_sel_rules, sr_list) {
+		if (strcmp(rule->sr_nids, nids) == 0)
+			return rule;
+	}
+
+	return NULL;
+}
+
+static void
+lnet_sel_rule_free(struct lnet_sel_rule *rule)
+{
+	cfs_free_nidlist(&rule->sr_nidlist);
+	LIBCFS_FREE(rule, sizeof(*rule));
+}
+
+/**
+ * Add a selection policy, or change the priority of an existing one.
+ *
+ * \param[in] nids	nidlist the policy applies to
+ * \param[in] priority	priority of the matching interfaces
+ *
+ * \retval 0 on success
+ * \retval -EINVAL if \a nids can not be parsed
+ * \retval -ENOMEM on allocation failure
+ */
+int
+lnet_sel_policy_add(char *nids, __u32 priority)
+{
+	struct lnet_sel_rule *rule;
+	struct lnet_sel_rule *old;
+	ENTRY;
+
+	if (strnlen(nids, LNET_MAX_STR_LEN) >= LNET_MAX_STR_LEN)
+		RETURN(-EINVAL);
+
+	LIBCFS_ALLOC(rule, sizeof(*rule));
+	if (rule == NULL)
+		RETURN(-ENOMEM);
+
+	strlcpy(rule->sr_nids, nids, sizeof(rule->sr_nids));
+	rule->sr_priority = priority;
+	if (!cfs_parse_nidlist(rule->sr_nids, strlen(rule->sr_nids),
+			       &rule->sr_nidlist)) {
+		LIBCFS_FREE(rule, sizeof(*rule));
+		RETURN(-EINVAL);
+	}
+
+	lnet_net_lock(LNET_LOCK_EX);
+	old = lnet_sel_rule_find_locked(rule->sr_nids);
+	if (old != NULL) {
+		old->sr_priority = priority;
+	} else {
+		list_add_tail(&rule->sr_list, &the_lnet.ln_sel_rules);
+		rule = NULL;
+	}
+	the_lnet.ln_sel_seq++;
+	lnet_net_unlock(LNET_LOCK_EX);
+
+	if (rule != NULL)
+		lnet_sel_rule_free(rule);
+
+	CDEBUG(D_NET, "selection policy %s: priority %u\n", nids, priority);
+	RETURN(0);
+}
+
+/**
+ * Delete the selection policy for \a nids.
+ *
+ * \retval 0 on success
+ * \retval -ENOENT if there is no policy for \a nids
+ */
+int
+lnet_sel_policy_del(char *nids)
+{
+	struct lnet_sel_rule *rule;
+
+	lnet_net_lock(LNET_LOCK_EX);
+	rule = lnet_sel_rule_find_locked(nids);
+	if (rule != NULL) {
+		list_del(&rule->sr_list);
+		the_lnet.ln_sel_seq++;
+	}
+	lnet_net_unlock(LNET_LOCK_EX);
+
+	if (rule == NULL)
+		return -ENOENT;
+
+	CDEBUG(D_NET, "removed selection policy %s\n", rule->sr_nids);
+	lnet_sel_rule_free(rule);
+
+	return 0;
+}
+
+/**
+ * Copy the selection policy at position \a policy->lsp_idx to \a policy.
+ *
+ * \retval 0 on success
+ * \retval -ENOENT if there are not that many policies
+ */
+int
+lnet_sel_policy_get(struct lnet_ioctl_sel_policy *policy)
+{
+	struct lnet_sel_rule *rule;
+	__u32 idx = 0;
+	int cpt;
+	int rc = -ENOENT;
+
+	cpt = lnet_net_lock_current();
+	list_for_each_entry(rule, &the_lnet.ln_sel_rules, sr_list) {
+		if (idx++ != policy->lsp_idx)
+			continue;
+
+		policy->lsp_priority = rule->sr_priority;
+		strlcpy(policy->lsp_nids, rule->sr_nids,
+			sizeof(policy->lsp_nids));
+		rc = 0;
+		break;
+	}
+	lnet_net_unlock(cpt);
+
+	return rc;
+}
+
+void
+lnet_sel_policy_fini(void)
+{
+	struct lnet_sel_rule *rule;
+	struct lnet_sel_rule *tmp;
+	struct list_head zombies;
+
+	INIT_LIST_HEAD(&zombies);
+
+	lnet_net_lock(LNET_LOCK_EX);
+	list_splice_init(&the_lnet.ln_sel_rules, &zombies);
+	the_lnet.ln_sel_seq++;
+	lnet_net_unlock(LNET_LOCK_EX);
+
+	list_for_each_entry_safe(rule, tmp, &zombies, sr_list) {
+		list_del(&rule->sr_list);
+		lnet_sel_rule_free(rule);
+	}
+}
+
+/**
+ * Priority of the interface \a nid, whose selection state is \a ss.
+ * The first policy which matches \a nid applies. The result is cached in
+ * \a ss until the policies change.
+ *
+ * Call with lnet_net_lock held.
+ */
+__u32
+lnet_sel_priority_locked(struct lnet_sel_stats *ss, lnet_nid_t nid)
+{
+	struct lnet_sel_rule *rule;
+	__u32 seq = the_lnet.ln_sel_seq;
+	__u32 priority = LNET_SEL_PRIO_DEFAULT;
+
+	if (likely(ss->ss_policy_seq == seq))
+		return ss->ss_priority;
+
+	list_for_each_entry(rule, &the_lnet.ln_sel_rules, sr_list) {
+		if (cfs_match_nid(nid, &rule->sr_nidlist)) {
+			priority = rule->sr_priority;
+			break;
+		}
+	}
+
+	ss->ss_priority = priority;
+	ss->ss_policy_seq = seq;
+
+	return priority;
+}
+
+/**
+ * Account a send of \a nob bytes, handed to the LND at \a sent, which
+ * completed successfully.
+ */
+void
+lnet_sel_stats_update(struct lnet_sel_stats *ss, unsigned int nob,
+		      ktime_t sent)
+{
+	__u64 elapsed = ktime_to_ns(ktime_sub(ktime_get(), sent));
+	__u64 sample;
+
+	if (elapsed == 0)
+		elapsed = 1;
+
+	if (nob < LNET_SEL_BW_MIN_NOB) {
+		sample = elapsed;
+		ss->ss_latency = ss->ss_latency == 0 ? sample :
+				 (ss->ss_latency * 7 + sample) / 8;
+	} else {
+		sample = div64_u64((__u64)nob * NSEC_PER_USEC, elapsed);
+		if (sample == 0)
+			sample = 1;
+		ss->ss_bandwidth = ss->ss_bandwidth == 0 ? sample :
+				   (ss->ss_bandwidth * 7 + sample) / 8;
+	}
+}
+
+/**
+ * Virtual time at which a send selected now on the interface would start,
+ * given the virtual time \a vtime of the last selection on its net.
+ */
+__u64
+lnet_sel_vtime(struct lnet_sel_stats *ss, __u64 vtime)
+{
+	return max(ss->ss_vtime, vtime);
+}
+
+/**
+ * Estimated work queued on the interface ahead of the virtual time
+ * \a vtime of its net. Unlike the virtual times themselves, which each
+ * net advances on its own, this compares between interfaces of
+ * different nets.
+ */
+__u64
+lnet_sel_backlog(struct lnet_sel_stats *ss, __u64 vtime)
+{
+	return lnet_sel_vtime(ss, vtime) - vtime;
+}
+
+/**
+ * Charge a send of \a nob bytes to the interface selected for it, and
+ * advance the virtual time \a vtime of its net.
+ */
+void
+lnet_sel_charge(struct lnet_sel_stats *ss, __u64 *vtime, unsigned int nob)
+{
+	__u64 start = lnet_sel_vtime(ss, *vtime);
+	__u64 cost = ss->ss_latency;
+
+	if (ss->ss_bandwidth != 0)
+		cost += div64_u64((__u64)nob * NSEC_PER_USEC,
+				  ss->ss_bandwidth);
+
+	ss->ss_vtime = start + cost;
+	*vtime = start;
+}
@@ -684,13 +684,45 @@ int
 lstcon_statrpc_prep(struct lstcon_node *nd, unsigned int feats,
 		    struct lstcon_rpc **crpc)
 {
+	struct srpc_stat_reqst_v1 *srq1;
 	struct srpc_stat_reqst *srq;
+	struct srpc_bulk *bulk;
+	int npg = 0;
+	int nob = 0;
 	int rc;
 
-	rc = lstcon_rpc_prep(nd, SRPC_SERVICE_QUERY_STAT, feats, 0, 0, crpc);
+	/* the node sends its latency histograms in bulk */
+	if ((feats & LST_FEAT_LAT_STATS) != 0) {
+		npg = 1;
+		nob = sizeof(struct sfw_lat_counters);
+	}
+
+	rc = lstcon_rpc_prep(nd, SRPC_SERVICE_QUERY_STAT, feats, npg, nob,
+			     crpc);
         if (rc != 0)
                 return rc;
 
+	if (npg != 0) {
+		bulk = &(*crpc)->crp_rpc->crpc_bulk;
+		bulk->bk_iovs[0].kiov_offset = 0;
+		bulk->bk_iovs[0].kiov_len    = nob;
+		bulk->bk_iovs[0].kiov_page   = alloc_page(GFP_KERNEL);
+		if (bulk->bk_iovs[0].kiov_page == NULL) {
+			lstcon_rpc_put(*crpc);
+			return -ENOMEM;
+		}
+
+		bulk->bk_sink = 1;
+	}
+
+	/* srpc_prepare_bulk() puts the bulk id in str_bulkid when sending */
+	if (npg != 0) {
+		srq1 = &(*crpc)->crp_rpc->crpc_reqstmsg.msg_body.stat_reqst_v1;
+		srq1->str_sid  = console_session.ses_id;
+		srq1->str_type = 0;
+		return 0;
+	}
+
         srq = &(*crpc)->crp_rpc->crpc_reqstmsg.msg_body.stat_reqst;
 
         srq->str_sid  = console_session.ses_id;
@@ -1470,9 +1470,13 @@ lstcon_statrpc_readent(int transop, struct srpc_msg *msg,
 		       struct lstcon_rpc_ent __user *ent_up)
 {
 	struct srpc_stat_reply *rep = &msg->msg_body.stat_reply;
+	struct srpc_client_rpc *rpc;
 	struct sfw_counters __user *sfwk_stat;
 	struct srpc_counters __user *srpc_stat;
 	struct lnet_counters __user *lnet_stat;
+	struct sfw_lat_counters __user *lat_stat;
+	struct sfw_lat_counters *lat;
+	int i;
 
         if (rep->str_status != 0)
                 return 0;
@@ -1488,6 +1492,24 @@ lstcon_statrpc_readent(int transop, struct srpc_msg *msg,
 	    copy_to_user(lnet_stat, &rep->str_lnet, sizeof(*lnet_stat)))
                 return -EFAULT;
 
+	/* latency histograms came in the bulk of the stat RPC */
+	rpc = container_of(msg, struct srpc_client_rpc, crpc_replymsg);
+	if (rpc->crpc_bulk.bk_niov == 0)
+		return 0;
+
+	lat = page_address(rpc->crpc_bulk.bk_iovs[0].kiov_page);
+	if (msg->msg_magic != SRPC_MSG_MAGIC) {
+		__swab64s(&lat->lat_count);
+		__swab64s(&lat->lat_sum_us);
+		for (i = 0; i < LST_LAT_NBKTS; i++)
+			__swab32s(&lat->lat_buckets[i]);
+	}
+
+	lat_stat = (struct sfw_lat_counters __user *)
+		((char __user *)lnet_stat + sizeof(*lnet_stat));
+	if (copy_to_user(lat_stat, lat, sizeof(*lat)))
+		return -EFAULT;
+
         return 0;
 }
 
@@ -372,7 +372,7 @@ sfw_bid2batch(struct lst_bid bid)
 }
 
 static int
-sfw_get_stats(struct srpc_stat_reqst *request, struct srpc_stat_reply *reply)
+sfw_get_stats(struct lst_sid sid, struct srpc_stat_reply *reply)
 {
 	struct sfw_session *sn = sfw_data.fw_session;
 	struct sfw_counters *cnt = &reply->str_fw;
@@ -380,12 +380,12 @@ sfw_get_stats(struct srpc_stat_reqst *request, struct srpc_stat_reply *reply)
 
         reply->str_sid = (sn == NULL) ? LST_INVALID_SID : sn->sn_id;
 
-        if (request->str_sid.ses_nid == LNET_NID_ANY) {
+        if (sid.ses_nid == LNET_NID_ANY) {
                 reply->str_status = EINVAL;
                 return 0;
         }
 
-        if (sn == NULL || !sfw_sid_equal(request->str_sid, sn->sn_id)) {
+        if (sn == NULL || !sfw_sid_equal(sid, sn->sn_id)) {
                 reply->str_status = ESRCH;
                 return 0;
         }
@@ -410,6 +410,45 @@ sfw_get_stats(struct srpc_stat_reqst *request, struct srpc_stat_reply *reply)
 	return 0;
 }
 
+/*
+ * Send the latency histograms of the client tests of the session to the
+ * console in the bulk of the stat RPC \a rpc.
+ */
+static int
+sfw_get_lat_stats(struct srpc_server_rpc *rpc)
+{
+	struct sfw_session *sn = sfw_data.fw_session;
+	struct sfw_test_instance *tsi;
+	struct sfw_lat_counters *lat;
+	struct sfw_batch *bat;
+	int rc;
+	int i;
+
+	rc = sfw_alloc_pages(rpc, CFS_CPT_ANY, 1, sizeof(*lat), 0);
+	if (rc != 0)
+		return rc;
+
+	lat = page_address(rpc->srpc_bulk->bk_iovs[0].kiov_page);
+	memset(lat, 0, sizeof(*lat));
+
+	list_for_each_entry(bat, &sn->sn_batches, bat_list) {
+		list_for_each_entry(tsi, &bat->bat_tests, tsi_list) {
+			if (!tsi->tsi_is_client)
+				continue;
+
+			spin_lock(&tsi->tsi_lock);
+			lat->lat_count += tsi->tsi_lat.lat_count;
+			lat->lat_sum_us += tsi->tsi_lat.lat_sum_us;
+			for (i = 0; i < LST_LAT_NBKTS; i++)
+				lat->lat_buckets[i] +=
+					tsi->tsi_lat.lat_buckets[i];
+			spin_unlock(&tsi->tsi_lock);
+		}
+	}
+
+	return 0;
+}
+
 int
 sfw_make_session(struct srpc_mksn_reqst *request, struct srpc_mksn_reply *reply)
 {
@@ -875,11 +914,39 @@ sfw_test_unit_done(struct sfw_test_unit *tsu)
 	return;
 }
 
+/* account a test RPC which completed at \a now, called with tsi_lock held */
+static void
+sfw_test_rpc_latency(struct sfw_test_instance *tsi,
+		     struct srpc_client_rpc *rpc, ktime_t now)
+{
+	struct sfw_lat_counters *lat = &tsi->tsi_lat;
+	__u64 usecs = max_t(s64, ktime_us_delta(now, rpc->crpc_stamp), 0);
+	int bits;
+	int idx;
+
+	if (usecs < LST_LAT_SUBBKTS) {
+		idx = usecs;
+	} else {
+		/* LST_LAT_SUBBITS bits below the most significant one pick
+		 * the bucket within its power of two */
+		bits = fls64(usecs) - 1;
+		idx = (bits - LST_LAT_SUBBITS + 1) * LST_LAT_SUBBKTS +
+		      ((usecs >> (bits - LST_LAT_SUBBITS)) &
+		       (LST_LAT_SUBBKTS - 1));
+		idx = min(idx, LST_LAT_NBKTS - 1);
+	}
+
+	lat->lat_count++;
+	lat->lat_sum_us += usecs;
+	lat->lat_buckets[idx]++;
+}
+
 static void
 sfw_test_rpc_done(struct srpc_client_rpc *rpc)
 {
 	struct sfw_test_unit *tsu = rpc->crpc_priv;
 	struct sfw_test_instance *tsi = tsu->tsu_instance;
+	ktime_t now = ktime_get();
         int                  done = 0;
 
         tsi->tsi_ops->tso_done_rpc(tsu, rpc);
@@ -891,6 +958,9 @@ sfw_test_rpc_done(struct srpc_client_rpc *rpc)
 
 	list_del_init(&rpc->crpc_list);
 
+	if (rpc->crpc_status == 0)
+		sfw_test_rpc_latency(tsi, rpc, now);
+
         /* batch is stopping or loop is done or get error */
         if (tsi->tsi_stopping ||
             tsu->tsu_loop == 0 ||
@@ -1310,10 +1380,19 @@ sfw_handle_server_rpc(struct srpc_server_rpc *rpc)
                                        &reply->msg_body.bat_reply);
                 break;
 
-        case SRPC_SERVICE_QUERY_STAT:
-                rc = sfw_get_stats(&request->msg_body.stat_reqst,
-                                   &reply->msg_body.stat_reply);
-                break;
+	case SRPC_SERVICE_QUERY_STAT:
+		/* the bulk id has its own field only in the v1 request */
+		if ((request->msg_ses_feats & LST_FEAT_LAT_STATS) == 0) {
+			rc = sfw_get_stats(request->msg_body.stat_reqst.str_sid,
+					   &reply->msg_body.stat_reply);
+			break;
+		}
+
+		rc = sfw_get_stats(request->msg_body.stat_reqst_v1.str_sid,
+				   &reply->msg_body.stat_reply);
+		if (rc == 0 && reply->msg_body.stat_reply.str_status == 0)
+			rc = sfw_get_lat_stats(rpc);
+		break;
 
         case SRPC_SERVICE_DEBUG:
                 rc = sfw_debug_session(&request->msg_body.dbg_reqst,
@@ -1440,6 +1519,17 @@ sfw_unpack_message(struct srpc_msg *msg)
 	/* srpc module should guarantee I wouldn't get crap */
         LASSERT (msg->msg_magic == __swab32(SRPC_MSG_MAGIC));
 
+	if (msg->msg_type == SRPC_MSG_STAT_REQST &&
+	    (msg->msg_ses_feats & LST_FEAT_LAT_STATS) != 0) {
+		struct srpc_stat_reqst_v1 *req = &msg->msg_body.stat_reqst_v1;
+
+		__swab32s(&req->str_type);
+		__swab64s(&req->str_rpyid);
+		__swab64s(&req->str_bulkid);
+		sfw_unpack_sid(req->str_sid);
+		return;
+	}
+
         if (msg->msg_type == SRPC_MSG_STAT_REQST) {
 		struct srpc_stat_reqst *req = &msg->msg_body.stat_reqst;
 
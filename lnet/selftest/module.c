@@ -93,6 +93,10 @@ lnet_selftest_structure_assertion(void)
 	CLASSERT(offsetof(struct srpc_msg, msg_body.tes_reqst.tsr_ndest) == 78);
 	CLASSERT(sizeof(struct srpc_stat_reply) == 136);
 	CLASSERT(sizeof(struct srpc_stat_reqst) == 28);
+	CLASSERT(sizeof(struct srpc_stat_reqst_v1) == 36);
+	CLASSERT(offsetof(struct srpc_stat_reqst_v1, str_bulkid) ==
+		 offsetof(struct srpc_generic_reqst, bulkid));
+	CLASSERT(sizeof(struct sfw_lat_counters) == 848);
 }
 
 static int __init
@@ -1341,6 +1341,7 @@ srpc_post_rpc(struct srpc_client_rpc *rpc)
                 libcfs_id2str(rpc->crpc_dest), rpc->crpc_service,
                 rpc->crpc_timeout);
 
+	rpc->crpc_stamp = ktime_get();
         srpc_add_client_rpc_timer(rpc);
         swi_schedule_workitem(&rpc->crpc_wi);
         return;
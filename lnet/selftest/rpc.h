@@ -156,6 +156,15 @@ struct srpc_stat_reqst {
         __u32                   str_type;       /* type of stat */
 } WIRE_ATTR;
 
+/* stat request of sessions with LST_FEAT_LAT_STATS, which carries the
+ * latency histograms in bulk */
+struct srpc_stat_reqst_v1 {
+	__u64			str_rpyid;	/* reply buffer matchbits */
+	__u64			str_bulkid;	/* bulk buffer matchbits */
+	struct lst_sid		str_sid;	/* session id */
+	__u32			str_type;	/* type of stat */
+} WIRE_ATTR;
+
 struct srpc_stat_reply {
         __u32                   str_status;
 	struct lst_sid		str_sid;
@@ -265,6 +274,7 @@ struct srpc_msg {
 		struct srpc_batch_reqst		bat_reqst;
 		struct srpc_batch_reply		bat_reply;
 		struct srpc_stat_reqst		stat_reqst;
+		struct srpc_stat_reqst_v1	stat_reqst_v1;
 		struct srpc_stat_reply		stat_reply;
 		struct srpc_test_reqst		tes_reqst;
 		struct srpc_test_reply		tes_reply;
@@ -212,6 +212,7 @@ struct srpc_client_rpc {
         void               (*crpc_fini)(struct srpc_client_rpc *);
         int                  crpc_status;    /* completion status */
         void                *crpc_priv;      /* caller data */
+	ktime_t			crpc_stamp;	/* when it was posted */
 
         /* state flags */
         unsigned int         crpc_aborted:1; /* being given up */
@@ -377,6 +378,8 @@ struct sfw_test_instance {
 	struct list_head	tsi_units;	/* test units */
 	struct list_head	tsi_free_rpcs;	/* free rpcs */
 	struct list_head	tsi_active_rpcs;/* active rpcs */
+	/* latencies of client RPCs, protected by tsi_lock */
+	struct sfw_lat_counters	tsi_lat;
 
 	union {
 		struct test_ping_req	ping;	  /* ping parameter */
@@ -3256,7 +3256,7 @@ int lustre_lnet_show_stats(int seq_no, struct cYAML **show_rc,
 	int rc;
 	int l_errno;
 	char err_str[LNET_MAX_STR_LEN];
-	struct cYAML *root = NULL, *stats = NULL;
+	struct cYAML *root = NULL, *stats = NULL, *tune = NULL;
 
 	snprintf(err_str, sizeof(err_str), "\"out of memory\"");
 
@@ -3327,6 +3327,34 @@ int lustre_lnet_show_stats(int seq_no, struct cYAML **show_rc,
 				data.st_cntrs.drop_length) == NULL)
 		goto out;
 
+	tune = cYAML_create_object(stats, "router_tuning");
+	if (tune == NULL)
+		goto out;
+
+	if (cYAML_create_number(tune, "pool_grow",
+				data.st_rtr_tune.rts_pool_grow) == NULL)
+		goto out;
+
+	if (cYAML_create_number(tune, "pool_shrink",
+				data.st_rtr_tune.rts_pool_shrink) == NULL)
+		goto out;
+
+	if (cYAML_create_number(tune, "pool_capped",
+				data.st_rtr_tune.rts_pool_capped) == NULL)
+		goto out;
+
+	if (cYAML_create_number(tune, "pool_bytes",
+				data.st_rtr_tune.rts_pool_bytes) == NULL)
+		goto out;
+
+	if (cYAML_create_number(tune, "credits_grant",
+				data.st_rtr_tune.rts_credits_grant) == NULL)
+		goto out;
+
+	if (cYAML_create_number(tune, "credits_reclaim",
+				data.st_rtr_tune.rts_credits_reclaim) == NULL)
+		goto out;
+
 	if (show_rc == NULL)
 		cYAML_print_tree(root);
 
@@ -3348,6 +3376,151 @@ out:
 	return rc;
 }
 
+static int ioctl_sel_policy(int ioc, char *nids, int prio, char *cmd,
+			    int seq_no, struct cYAML **err_rc)
+{
+	struct lnet_ioctl_sel_policy data;
+	int rc = LUSTRE_CFG_RC_NO_ERR;
+	char err_str[LNET_MAX_STR_LEN];
+
+	snprintf(err_str, sizeof(err_str), "\"success\"");
+
+	if (nids == NULL) {
+		snprintf(err_str, sizeof(err_str),
+			 "\"missing mandatory parameter: 'nid'\"");
+		rc = LUSTRE_CFG_RC_MISSING_PARAM;
+		goto out;
+	}
+
+	if (strlen(nids) >= sizeof(data.lsp_nids)) {
+		snprintf(err_str, sizeof(err_str),
+			 "\"nid list too long: '%s'\"", nids);
+		rc = LUSTRE_CFG_RC_BAD_PARAM;
+		goto out;
+	}
+
+	LIBCFS_IOC_INIT_V2(data, lsp_hdr);
+	data.lsp_priority = prio;
+	strncpy(data.lsp_nids, nids, sizeof(data.lsp_nids));
+
+	rc = l_ioctl(LNET_DEV_ID, ioc, &data);
+	if (rc != 0) {
+		rc = -errno;
+		snprintf(err_str, sizeof(err_str),
+			 "\"cannot %s policy for '%s': %s\"",
+			 cmd, nids, strerror(errno));
+	}
+
+out:
+	cYAML_build_error(rc, seq_no, cmd, "policy", err_str, err_rc);
+
+	return rc;
+}
+
+int lustre_lnet_config_sel_policy(char *nids, int prio, int seq_no,
+				  struct cYAML **err_rc)
+{
+	char err_str[LNET_MAX_STR_LEN];
+
+	if (prio == -1) {
+		snprintf(err_str, sizeof(err_str),
+			 "\"missing mandatory parameter: 'priority'\"");
+		cYAML_build_error(LUSTRE_CFG_RC_MISSING_PARAM, seq_no,
+				  ADD_CMD, "policy", err_str, err_rc);
+		return LUSTRE_CFG_RC_MISSING_PARAM;
+	}
+
+	if (prio < 0) {
+		snprintf(err_str, sizeof(err_str),
+			 "\"invalid priority %d, must be at least 0\"", prio);
+		cYAML_build_error(LUSTRE_CFG_RC_OUT_OF_RANGE_PARAM, seq_no,
+				  ADD_CMD, "policy", err_str, err_rc);
+		return LUSTRE_CFG_RC_OUT_OF_RANGE_PARAM;
+	}
+
+	return ioctl_sel_policy(IOC_LIBCFS_ADD_SEL_POLICY, nids, prio,
+				ADD_CMD, seq_no, err_rc);
+}
+
+int lustre_lnet_del_sel_policy(char *nids, int seq_no, struct cYAML **err_rc)
+{
+	return ioctl_sel_policy(IOC_LIBCFS_DEL_SEL_POLICY, nids, 0,
+				DEL_CMD, seq_no, err_rc);
+}
+
+int lustre_lnet_show_sel_policy(int seq_no, struct cYAML **show_rc,
+				struct cYAML **err_rc)
+{
+	struct lnet_ioctl_sel_policy data;
+	int rc = LUSTRE_CFG_RC_OUT_OF_MEM;
+	int l_errno = 0;
+	int i;
+	struct cYAML *root = NULL, *policy = NULL, *item = NULL;
+	char err_str[LNET_MAX_STR_LEN];
+
+	snprintf(err_str, sizeof(err_str), "\"out of memory\"");
+
+	root = cYAML_create_object(NULL, NULL);
+	if (root == NULL)
+		goto out;
+
+	policy = cYAML_create_seq(root, "policy");
+	if (policy == NULL)
+		goto out;
+
+	for (i = 0;; i++) {
+		LIBCFS_IOC_INIT_V2(data, lsp_hdr);
+		data.lsp_idx = i;
+
+		rc = l_ioctl(LNET_DEV_ID, IOC_LIBCFS_GET_SEL_POLICY, &data);
+		if (rc != 0) {
+			l_errno = errno;
+			break;
+		}
+
+		/* default rc to -1 incase we hit the goto */
+		rc = -1;
+
+		item = cYAML_create_seq_item(policy);
+		if (item == NULL)
+			goto out;
+
+		if (cYAML_create_string(item, "nid", data.lsp_nids) == NULL)
+			goto out;
+
+		if (cYAML_create_number(item, "priority",
+					data.lsp_priority) == NULL)
+			goto out;
+	}
+
+	if (l_errno != ENOENT) {
+		snprintf(err_str, sizeof(err_str),
+			 "\"cannot get policies: %s\"", strerror(l_errno));
+		rc = -l_errno;
+		goto out;
+	}
+
+	if (show_rc == NULL)
+		cYAML_print_tree(root);
+
+	snprintf(err_str, sizeof(err_str), "\"success\"");
+	rc = LUSTRE_CFG_RC_NO_ERR;
+out:
+	if (show_rc == NULL || rc != LUSTRE_CFG_RC_NO_ERR) {
+		cYAML_free_tree(root);
+	} else if (show_rc != NULL && *show_rc != NULL) {
+		cYAML_insert_sibling((*show_rc)->cy_child,
+					root->cy_child);
+		free(root);
+	} else {
+		*show_rc = root;
+	}
+
+	cYAML_build_error(rc, seq_no, SHOW_CMD, "policy", err_str, err_rc);
+
+	return rc;
+}
+
 typedef int (*cmd_handler_t)(struct cYAML *tree,
 			     struct cYAML **show_rc,
 			     struct cYAML **err_rc);
@@ -312,6 +312,43 @@ int lustre_lnet_show_routing(int seq_no, struct cYAML **show_rc,
 int lustre_lnet_show_stats(int seq_no, struct cYAML **show_rc,
 			   struct cYAML **err_rc);
 
+/*
+ * lustre_lnet_config_sel_policy
+ *   Add a Multi-Rail selection policy, or change the priority of an
+ *   existing one. Local and peer NIs matching the nid list are ranked
+ *   by priority when selecting the path of a message, lower values being
+ *   preferred. NIs which match no policy come last.
+ *
+ *     nids - nid list the policy applies to, ie "10.1.1.[1-4]@tcp *@o2ib"
+ *     prio - priority of the matching NIs, -1 if it was not given
+ *     seq_no - sequence number of the command
+ *     err_rc - YAML strucutre of the resultant return code.
+ */
+int lustre_lnet_config_sel_policy(char *nids, int prio, int seq_no,
+				  struct cYAML **err_rc);
+
+/*
+ * lustre_lnet_del_sel_policy
+ *   Delete the Multi-Rail selection policy for the nid list.
+ *
+ *     nids - nid list of the policy, as it was added
+ *     seq_no - sequence number of the command
+ *     err_rc - YAML strucutre of the resultant return code.
+ */
+int lustre_lnet_del_sel_policy(char *nids, int seq_no, struct cYAML **err_rc);
+
+/*
+ * lustre_lnet_show_sel_policy
+ *   Show the Multi-Rail selection policies, in the order they are
+ *   matched.
+ *
+ *     seq_no - sequence number of the command
+ *     show_rc - YAML structure of the resultant show
+ *     err_rc - YAML strucutre of the resultant return code.
+ */
+int lustre_lnet_show_sel_policy(int seq_no, struct cYAML **show_rc,
+				struct cYAML **err_rc);
+
 /*
  * lustre_lnet_config_peer_nid
  *   Add a peer nid to a peer with primary nid pnid. If no pnid is given
@@ -72,6 +72,10 @@ static int jt_set(int argc, char **argv);
 static int jt_stats(int argc, char **argv);
 static int jt_global(int argc, char **argv);
 static int jt_peers(int argc, char **argv);
+static int jt_policy(int argc, char **argv);
+static int jt_add_policy(int argc, char **argv);
+static int jt_del_policy(int argc, char **argv);
+static int jt_show_policy(int argc, char **argv);
 
 
 command_t cmd_list[] = {
@@ -87,6 +91,7 @@ command_t cmd_list[] = {
 	{"stats", jt_stats, 0, "stats {show | help}"},
 	{"global", jt_global, 0, "global {show | help}"},
 	{"peer", jt_peers, 0, "peer {add | del | show | help}"},
+	{"policy", jt_policy, 0, "policy {add | del | show | help}"},
 	{"ping", jt_ping, 0, "ping nid,[nid,...]"},
 	{"discover", jt_discover, 0, "discover nid[,nid,...]"},
 	{"help", Parser_help, 0, "help"},
@@ -198,6 +203,18 @@ command_t peer_cmds[] = {
 	{ 0, 0, 0, NULL }
 };
 
+command_t policy_cmds[] = {
+	{"add", jt_add_policy, 0, "add a Multi-Rail selection policy\n"
+	 "\t--nid: list of local or peer NIDs the policy applies to,\n"
+	 "\t       ie: \"*@o2ib\" or \"10.1.1.[1-4]@tcp 10.2.2.5@tcp\"\n"
+	 "\t--priority: priority of the matching NIDs, 0 is the highest.\n"
+	 "\t            NIDs matching no policy are used last\n"},
+	{"del", jt_del_policy, 0, "delete a Multi-Rail selection policy\n"
+	 "\t--nid: list of NIDs of the policy, as it was added\n"},
+	{"show", jt_show_policy, 0, "show Multi-Rail selection policies\n"},
+	{ 0, 0, 0, NULL }
+};
+
 static inline void print_help(const command_t cmds[], const char *cmd_type,
 			      const char *pc_name)
 {
@@ -1067,6 +1084,121 @@ static int jt_peers(int argc, char **argv)
 	return Parser_execarg(argc - 1, &argv[1], peer_cmds);
 }
 
+static int jt_add_policy(int argc, char **argv)
+{
+	char *nids = NULL;
+	long int prio = -1;
+	struct cYAML *err_rc = NULL;
+	int rc, opt;
+
+	const char *const short_options = "n:p:";
+	static const struct option long_options[] = {
+	{ .name = "nid",      .has_arg = required_argument, .val = 'n' },
+	{ .name = "priority", .has_arg = required_argument, .val = 'p' },
+	{ .name = NULL } };
+
+	rc = check_cmd(policy_cmds, "policy", "add", 0, argc, argv);
+	if (rc)
+		return rc;
+
+	while ((opt = getopt_long(argc, argv, short_options,
+				   long_options, NULL)) != -1) {
+		switch (opt) {
+		case 'n':
+			nids = optarg;
+			break;
+		case 'p':
+			rc = parse_long(optarg, &prio);
+			if (rc != 0 || prio < 0) {
+				cYAML_build_error(-1, -1, "policy", "add",
+						  "bad priority",
+						  &err_rc);
+				cYAML_print_tree2file(stderr, err_rc);
+				cYAML_free_tree(err_rc);
+				return -1;
+			}
+			break;
+		default:
+			return 0;
+		}
+	}
+
+	rc = lustre_lnet_config_sel_policy(nids, prio, -1, &err_rc);
+	if (rc != LUSTRE_CFG_RC_NO_ERR)
+		cYAML_print_tree2file(stderr, err_rc);
+
+	cYAML_free_tree(err_rc);
+
+	return rc;
+}
+
+static int jt_del_policy(int argc, char **argv)
+{
+	char *nids = NULL;
+	struct cYAML *err_rc = NULL;
+	int rc, opt;
+
+	const char *const short_options = "n:";
+	static const struct option long_options[] = {
+	{ .name = "nid", .has_arg = required_argument, .val = 'n' },
+	{ .name = NULL } };
+
+	rc = check_cmd(policy_cmds, "policy", "del", 0, argc, argv);
+	if (rc)
+		return rc;
+
+	while ((opt = getopt_long(argc, argv, short_options,
+				   long_options, NULL)) != -1) {
+		switch (opt) {
+		case 'n':
+			nids = optarg;
+			break;
+		default:
+			return 0;
+		}
+	}
+
+	rc = lustre_lnet_del_sel_policy(nids, -1, &err_rc);
+	if (rc != LUSTRE_CFG_RC_NO_ERR)
+		cYAML_print_tree2file(stderr, err_rc);
+
+	cYAML_free_tree(err_rc);
+
+	return rc;
+}
+
+static int jt_show_policy(int argc, char **argv)
+{
+	int rc;
+	struct cYAML *show_rc = NULL, *err_rc = NULL;
+
+	rc = check_cmd(policy_cmds, "policy", "show", 0, argc, argv);
+	if (rc)
+		return rc;
+
+	rc = lustre_lnet_show_sel_policy(-1, &show_rc, &err_rc);
+	if (rc != LUSTRE_CFG_RC_NO_ERR)
+		cYAML_print_tree2file(stderr, err_rc);
+	else if (show_rc)
+		cYAML_print_tree(show_rc);
+
+	cYAML_free_tree(err_rc);
+	cYAML_free_tree(show_rc);
+
+	return rc;
+}
+
+static int jt_policy(int argc, char **argv)
+{
+	int rc;
+
+	rc = check_cmd(policy_cmds, "policy", NULL, 2, argc, argv);
+	if (rc)
+		return rc;
+
+	return Parser_execarg(argc - 1, &argv[1], policy_cmds);
+}
+
 static int jt_set(int argc, char **argv)
 {
 	int rc;
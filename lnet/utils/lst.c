@@ -58,7 +58,8 @@ static struct lst_sid session_id;
 static int                 session_key;
 static int lst_list_commands(int argc, char **argv);
 
-/* All nodes running 2.6.50 or later understand feature LST_FEAT_BULK_LEN */
+/* All nodes running 2.6.50 or later understand feature LST_FEAT_BULK_LEN,
+ * LST_FEAT_LAT_STATS needs 2.12 or later */
 static unsigned		session_features = LST_FEATS_MASK;
 static struct lstcon_trans_stat	trans_stat;
 
@@ -1561,7 +1562,8 @@ lst_stat_req_param_alloc(char *name, lst_stat_req_param_t **srpp, int save_old)
                 rc = lst_alloc_rpcent(&srp->srp_result[i], srp->srp_count,
 				      sizeof(struct sfw_counters)  +
 				      sizeof(struct srpc_counters) +
-				      sizeof(struct lnet_counters));
+				      sizeof(struct lnet_counters) +
+				      sizeof(struct sfw_lat_counters));
                 if (rc != 0) {
                         fprintf(stderr, "Out of memory\n");
                         break;
@@ -1613,6 +1615,19 @@ typedef struct {
 
 lst_lnet_stat_result_t lnet_stat_result;
 
+/* RPC latencies of a group over the last interval */
+typedef struct {
+	__u64		lat_count;
+	__u64		lat_sum_us;
+	__u64		lat_buckets[LST_LAT_NBKTS];
+} lst_lat_stat_result_t;
+
+static lst_lat_stat_result_t lat_stat_result;
+
+#define LST_STAT_TEXT	0
+#define LST_STAT_JSON	1
+#define LST_STAT_YAML	2
+
 static float
 lst_lnet_stat_value(int bw, int send, int off)
 {
@@ -1709,6 +1724,165 @@ lst_cal_lnet_stat(float delta, struct lnet_counters *lnet_new,
 					    lnet_stat_result.lnet_stat_count;
 }
 
+static void
+lst_cal_lat_stat(struct sfw_lat_counters *lat_new,
+		 struct sfw_lat_counters *lat_old)
+{
+	int i;
+
+	/* the node has joined a new session since last time */
+	if (lat_new->lat_count < lat_old->lat_count)
+		return;
+
+	lat_stat_result.lat_count += lat_new->lat_count - lat_old->lat_count;
+	lat_stat_result.lat_sum_us += lat_new->lat_sum_us -
+				      lat_old->lat_sum_us;
+
+	for (i = 0; i < LST_LAT_NBKTS; i++) {
+		lat_stat_result.lat_buckets[i] += (__u32)
+			(lat_new->lat_buckets[i] - lat_old->lat_buckets[i]);
+	}
+}
+
+/* largest latency counted in bucket \a idx, see struct sfw_lat_counters */
+static unsigned long long
+lst_lat_bucket_max(int idx)
+{
+	int shift;
+
+	idx++;
+	if (idx <= LST_LAT_SUBBKTS)
+		return idx - 1;
+
+	shift = idx / LST_LAT_SUBBKTS - 1;
+	return ((unsigned long long)(LST_LAT_SUBBKTS +
+				     idx % LST_LAT_SUBBKTS) << shift) - 1;
+}
+
+/* latency under which \a pct hundredths of a percent of the RPCs completed */
+static unsigned long long
+lst_lat_percentile(int pct)
+{
+	__u64	rank;
+	__u64	sum = 0;
+	int	i;
+
+	rank = (lat_stat_result.lat_count * pct + 9999) / 10000;
+
+	for (i = 0; i < LST_LAT_NBKTS - 1; i++) {
+		sum += lat_stat_result.lat_buckets[i];
+		if (sum >= rank)
+			break;
+	}
+
+	return lst_lat_bucket_max(i);
+}
+
+static unsigned long long
+lst_lat_avg(void)
+{
+	return lat_stat_result.lat_sum_us / lat_stat_result.lat_count;
+}
+
+static void
+lst_print_lat_stat(char *name)
+{
+	if (lat_stat_result.lat_count == 0)
+		return;
+
+	fprintf(stdout, "[RPC Latency of %s]\n", name);
+	fprintf(stdout, "Count: %-8llu Avg: %-8llu us p50: %-8llu us "
+		"p99: %-8llu us p99.9: %-8llu us Max: %-8llu us\n",
+		(unsigned long long)lat_stat_result.lat_count, lst_lat_avg(),
+		lst_lat_percentile(5000), lst_lat_percentile(9900),
+		lst_lat_percentile(9990), lst_lat_percentile(10000));
+}
+
+static const char *lst_lnet_stat_keys[2][2] = {
+	{ "recv_rate", "send_rate" },
+	{ "recv_bw", "send_bw" },
+};
+
+/* one JSON object per line and interval, for time series */
+static void
+lst_print_stat_json(char *name, int lnet, int nnodes, int errcount, int mbs)
+{
+	int	i;
+	int	j;
+
+	fprintf(stdout, "{\"time\": %lld, \"group\": \"%s\", "
+		"\"nodes\": %d, \"errors\": %d",
+		(long long)time(NULL), name, nnodes, errcount);
+
+	if (lnet && lnet_stat_result.lnet_stat_count > 0) {
+		fprintf(stdout, ", \"lnet\": {\"units\": \"%s\"",
+			mbs ? "MB/s" : "MiB/s");
+		for (i = 0; i <= 1; i++) {
+			for (j = 0; j <= 1; j++) {
+				fprintf(stdout, ", \"%s\": {\"avg\": %.2f, "
+					"\"min\": %.2f, \"max\": %.2f}",
+					lst_lnet_stat_keys[i][j],
+					lst_lnet_stat_value(i, j, 0),
+					lst_lnet_stat_value(i, j, 1),
+					lst_lnet_stat_value(i, j, 2));
+			}
+		}
+		fprintf(stdout, "}");
+	}
+
+	if (lat_stat_result.lat_count > 0) {
+		fprintf(stdout, ", \"latency_us\": {\"count\": %llu, "
+			"\"avg\": %llu, \"p50\": %llu, \"p99\": %llu, "
+			"\"p99.9\": %llu, \"max\": %llu}",
+			(unsigned long long)lat_stat_result.lat_count,
+			lst_lat_avg(), lst_lat_percentile(5000),
+			lst_lat_percentile(9900), lst_lat_percentile(9990),
+			lst_lat_percentile(10000));
+	}
+
+	fprintf(stdout, "}\n");
+	fflush(stdout);
+}
+
+/* one YAML sequence entry per interval, for time series */
+static void
+lst_print_stat_yaml(char *name, int lnet, int nnodes, int errcount, int mbs)
+{
+	int	i;
+	int	j;
+
+	fprintf(stdout, "- time: %lld\n  group: \"%s\"\n  nodes: %d\n"
+		"  errors: %d\n", (long long)time(NULL), name, nnodes,
+		errcount);
+
+	if (lnet && lnet_stat_result.lnet_stat_count > 0) {
+		fprintf(stdout, "  lnet:\n    units: %s\n",
+			mbs ? "MB/s" : "MiB/s");
+		for (i = 0; i <= 1; i++) {
+			for (j = 0; j <= 1; j++) {
+				fprintf(stdout, "    %s: { avg: %.2f, "
+					"min: %.2f, max: %.2f }\n",
+					lst_lnet_stat_keys[i][j],
+					lst_lnet_stat_value(i, j, 0),
+					lst_lnet_stat_value(i, j, 1),
+					lst_lnet_stat_value(i, j, 2));
+			}
+		}
+	}
+
+	if (lat_stat_result.lat_count > 0) {
+		fprintf(stdout, "  latency_us:\n    count: %llu\n"
+			"    avg: %llu\n    p50: %llu\n    p99: %llu\n"
+			"    p99.9: %llu\n    max: %llu\n",
+			(unsigned long long)lat_stat_result.lat_count,
+			lst_lat_avg(), lst_lat_percentile(5000),
+			lst_lat_percentile(9900), lst_lat_percentile(9990),
+			lst_lat_percentile(10000));
+	}
+
+	fflush(stdout);
+}
+
 static void
 lst_print_lnet_stat(char *name, int bwrt, int rdwr, int type, int mbs)
 {
@@ -1770,7 +1944,7 @@ lst_print_lnet_stat(char *name, int bwrt, int rdwr, int type, int mbs)
 static void
 lst_print_stat(char *name, struct list_head *resultp,
 	       int idx, int lnet, int bwrt, int rdwr, int type,
-	       int mbs)
+	       int mbs, int fmt)
 {
 	struct list_head        tmp[2];
 	struct lstcon_rpc_ent *new;
@@ -1781,13 +1955,17 @@ lst_print_stat(char *name, struct list_head *resultp,
 	struct srpc_counters  *srpc_old;
 	struct lnet_counters  *lnet_new;
 	struct lnet_counters  *lnet_old;
+	struct sfw_lat_counters *lat_new;
+	struct sfw_lat_counters *lat_old;
         float             delta;
         int               errcount = 0;
+	int		  nnodes = 0;
 
 	INIT_LIST_HEAD(&tmp[0]);
 	INIT_LIST_HEAD(&tmp[1]);
 
         memset(&lnet_stat_result, 0, sizeof(lnet_stat_result));
+	memset(&lat_stat_result, 0, sizeof(lat_stat_result));
 
 	while (!list_empty(&resultp[idx])) {
 		if (list_empty(&resultp[1 - idx])) {
@@ -1831,6 +2009,14 @@ lst_print_stat(char *name, struct list_head *resultp,
 		lnet_new = (struct lnet_counters *)((char *)srpc_new + sizeof(*srpc_new));
 		lnet_old = (struct lnet_counters *)((char *)srpc_old + sizeof(*srpc_old));
 
+		lat_new = (struct sfw_lat_counters *)((char *)lnet_new +
+						      sizeof(*lnet_new));
+		lat_old = (struct sfw_lat_counters *)((char *)lnet_old +
+						      sizeof(*lnet_old));
+
+		nnodes++;
+		lst_cal_lat_stat(lat_new, lat_old);
+
 		/* Prior to version 2.3, the running_ms field was a counter for
 		 * the number of running tests.  We are looking at this value
 		 * to determine if it is a millisecond timestamep (>= 2.3) or a
@@ -1861,13 +2047,25 @@ lst_print_stat(char *name, struct list_head *resultp,
 	list_splice(&tmp[idx], &resultp[idx]);
 	list_splice(&tmp[1 - idx], &resultp[1 - idx]);
 
+	if (fmt != LST_STAT_TEXT) {
+		/* nothing to report before the second data point */
+		if (nnodes == 0 && errcount == 0)
+			return;
+
+		if (fmt == LST_STAT_JSON)
+			lst_print_stat_json(name, lnet, nnodes, errcount, mbs);
+		else
+			lst_print_stat_yaml(name, lnet, nnodes, errcount, mbs);
+		return;
+	}
+
 	if (errcount > 0)
 		fprintf(stdout, "Failed to stat on %d nodes\n", errcount);
 
-	if (!lnet)  /* TODO */
-		return;
+	if (lnet) /* TODO: RPC stats */
+		lst_print_lnet_stat(name, bwrt, rdwr, type, mbs);
 
-	lst_print_lnet_stat(name, bwrt, rdwr, type, mbs);
+	lst_print_lat_stat(name);
 }
 
 int
@@ -1888,6 +2086,7 @@ jt_lst_stat(int argc, char **argv)
 	int		      rc;
 	int		      c;
 	int		      mbs     = 0; /* report as MB/s */
+	int		      fmt     = LST_STAT_TEXT;
 
 	static const struct option stat_opts[] = {
 		{ .name = "timeout", .has_arg = required_argument, .val = 't' },
@@ -1903,6 +2102,8 @@ jt_lst_stat(int argc, char **argv)
 		{ .name = "min",     .has_arg = no_argument,       .val = 'n' },
 		{ .name = "max",     .has_arg = no_argument,       .val = 'x' },
 		{ .name = "mbs",     .has_arg = no_argument,       .val = 'm' },
+		{ .name = "json",    .has_arg = no_argument,       .val = 'j' },
+		{ .name = "yaml",    .has_arg = no_argument,       .val = 'y' },
 		{ .name = NULL } };
 
         if (session_key == 0) {
@@ -1912,7 +2113,7 @@ jt_lst_stat(int argc, char **argv)
         }
 
         while (1) {
-		c = getopt_long(argc, argv, "t:d:lcbarwgnxm", stat_opts,
+		c = getopt_long(argc, argv, "t:d:lcbarwgnxmjy", stat_opts,
 				&optidx);
 
                 if (c == -1)
@@ -1970,6 +2171,12 @@ jt_lst_stat(int argc, char **argv)
 		case 'm':
 			mbs = 1;
 			break;
+		case 'j':
+			fmt = LST_STAT_JSON;
+			break;
+		case 'y':
+			fmt = LST_STAT_YAML;
+			break;
 
 		default:
 			lst_print_usage(argv[0]);
@@ -2026,7 +2233,7 @@ jt_lst_stat(int argc, char **argv)
                         }
 
 			lst_print_stat(srp->srp_name, srp->srp_result,
-				       idx, lnet, bwrt, rdwr, type, mbs);
+				       idx, lnet, bwrt, rdwr, type, mbs, fmt);
 
 			lst_reset_rpcent(&srp->srp_result[1 - idx]);
 		}
@@ -3259,7 +3466,7 @@ static command_t lst_cmdlist[] = {
           "Usage: lst list_group [--active] [--busy] [--down] [--unknown] GROUP ..."    },
 	{"stat",                jt_lst_stat,            NULL,
 	 "Usage: lst stat [--bw] [--rate] [--read] [--write] [--max] [--min] [--avg] "
-	 " [--mbs] [--timeout #] [--delay #] [--count #] GROUP [GROUP]"                 },
+	 " [--mbs] [--json | --yaml] [--timeout #] [--delay #] [--count #] GROUP [GROUP]" },
         {"show_error",          jt_lst_show_error,      NULL,
          "Usage: lst show_error NAME | IDS ..."                                         },
         {"add_batch",           jt_lst_add_batch,       NULL,
@@ -429,6 +429,8 @@ int llapi_changelog_clear(const char *mdtname, const char *idstr,
 			  long long endrec);
 extern int llapi_changelog_set_xflags(void *priv,
 				    enum changelog_send_extra_flag extra_flags);
+int llapi_changelog_set_filter(void *priv, __u32 type_mask,
+			       __u32 shard_index, __u32 shard_count);
 
 /* HSM copytool interface.
  * priv is private state, managed internally by these functions
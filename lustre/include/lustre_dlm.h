@@ -191,6 +191,9 @@ static inline int lockmode_compat(enum ldlm_mode exist_mode,
  * lr_lock
  *     ns_lock
  *
+ * lr_lock
+ *     nl_lock
+ *
  * lr_lvb_mutex
  *     lr_lock
  *
@@ -340,6 +343,40 @@ enum {
 	LDLM_NSS_LAST
 };
 
+enum {
+	/** number of LRU locks looked at by one LRU scan */
+	LDLM_LRU_SCANNED	= 0,
+	/** time an LRU part lock is held by one step of a scan, in usec */
+	LDLM_LRU_HOLD_TIME,
+	/** locks used while in the LRU and moved back to its tail */
+	LDLM_LRU_SECOND_CHANCE,
+	LDLM_LRU_LAST
+};
+
+enum {
+	/** cancels for blocking ASTs added to a batch */
+	LDLM_BL_CANCEL_BATCHED	= 0,
+	/** cancels for blocking ASTs sent at once */
+	LDLM_BL_CANCEL_DIRECT,
+	/** locks in each LDLM_CANCEL RPC of a batch */
+	LDLM_BL_CANCEL_RPC,
+	LDLM_BL_CANCEL_LAST
+};
+
+enum {
+	/** granted locks indexes built, \see struct ldlm_ibits_index */
+	LDLM_IBITS_INDEX_BUILT	= 0,
+	/** granted queue checks answered "compatible" by the index */
+	LDLM_IBITS_INDEX_COMPAT,
+	/** granted queue checks answered "conflict" by the index */
+	LDLM_IBITS_INDEX_CONFLICT,
+	/** granted queue checks of indexed resources still walking the queue */
+	LDLM_IBITS_INDEX_WALK,
+	/** lock groups looked at by one walk of a granted queue */
+	LDLM_IBITS_SCANNED,
+	LDLM_IBITS_LAST
+};
+
 enum ldlm_ns_type {
 	LDLM_NS_TYPE_UNKNOWN = 0,	/**< invalid type */
 	LDLM_NS_TYPE_MDC,		/**< MDC namespace */
@@ -350,6 +387,21 @@ enum ldlm_ns_type {
 	LDLM_NS_TYPE_MGT,		/**< MGT namespace */
 };
 
+/**
+ * Part of the LRU list of unused locks of a client namespace, one for each
+ * CPU partition of cfs_cpt_tab. A lock is added to the part of the CPT its
+ * last user runs on, so that threads on different CPTs caching locks do not
+ * contend on a single LRU lock.
+ */
+struct ldlm_ns_lru {
+	/** Protects the fields below and l_lru of the locks in nl_list */
+	spinlock_t		nl_lock;
+	/** Unused locks added on this CPT, the least recently used first */
+	struct list_head	nl_list;
+	/** Last lock checked by a LDLM_LRU_FLAG_NO_WAIT scan */
+	struct list_head	*nl_last_pos;
+};
+
 /**
  * LDLM Namespace.
  *
@@ -409,19 +461,33 @@ struct ldlm_namespace {
 	struct list_head	ns_list_chain;
 
 	/**
-	 * List of unused locks for this namespace. This list is also called
-	 * LRU lock list.
+	 * List of unused locks for this namespace, split per CPT. This list
+	 * is also called LRU lock list.
 	 * Unused locks are locks with zero reader/writer reference counts.
 	 * This list is only used on clients for lock caching purposes.
 	 * When we want to release some locks voluntarily or if server wants
 	 * us to release some locks due to e.g. memory pressure, we take locks
-	 * to release from the head of this list.
+	 * to release from the head of these lists.
 	 * Locks are linked via l_lru field in \see struct ldlm_lock.
 	 */
-	struct list_head	ns_unused_list;
-	/** Number of locks in the LRU list above */
-	int			ns_nr_unused;
-	struct list_head	*ns_last_pos;
+	struct ldlm_ns_lru	**ns_lru;
+	/** Number of locks in the LRU lists above */
+	atomic_t		ns_nr_unused;
+
+	/**
+	 * Locks cancelled in reply to blocking ASTs whose LDLM_CANCEL RPC is
+	 * batched until the queued blocking callbacks of this namespace are
+	 * done, linked via l_bl_ast. \see ldlm_cli_cancel_batch()
+	 */
+	struct list_head	ns_bl_cancels;
+	/** Number of locks in the list above */
+	int			ns_bl_cancel_count;
+	/** When the first lock of the list above was added */
+	ktime_t			ns_bl_cancel_start;
+	/** Sends the list above once it is LDLM_BL_BATCH_AGE_MS old */
+	struct delayed_work	ns_bl_cancel_work;
+	/** Number of blocking callbacks queued to the blocking threads */
+	int			ns_bl_pending;
 
 	/**
 	 * Maximum number of locks permitted in the LRU. If 0, means locks
@@ -508,6 +574,12 @@ struct ldlm_namespace {
 	/** Limit of parallel AST RPC count. */
 	unsigned		ns_max_parallel_ast;
 
+	/**
+	 * A resource gets a granted inodebits locks index once a walk of
+	 * its granted queue looked at this many lock groups.
+	 */
+	unsigned		ns_ibits_index_min_scan;
+
 	/**
 	 * Callback to check if a lock is good to be canceled by ELC or
 	 * during recovery.
@@ -517,6 +589,15 @@ struct ldlm_namespace {
 	/** LDLM lock stats */
 	struct lprocfs_stats	*ns_stats;
 
+	/** LRU scan stats, \see ldlm_prepare_lru_list() */
+	struct lprocfs_stats	*ns_lru_stats;
+
+	/** Granted inodebits locks index stats */
+	struct lprocfs_stats	*ns_ibits_stats;
+
+	/** Blocking AST cancel batching stats, \see ldlm_cli_cancel_batch() */
+	struct lprocfs_stats	*ns_bl_cancel_stats;
+
 	/**
 	 * Flag to indicate namespace is being freed. Used to determine if
 	 * recalculation of LDLM pool statistics should be skipped.
@@ -645,6 +726,23 @@ struct ldlm_interval_tree {
 	struct interval_node	*lit_root; /* actual ldlm_interval */
 };
 
+/**
+ * Index of granted IBITS locks of a resource by inodebit and lock mode.
+ *
+ * It allows to check a new lock for conflicts with the granted locks
+ * without walking the granted queue. The index is only allocated for
+ * resources with long granted queues, see ldlm_inodebits_compat_queue().
+ */
+struct ldlm_ibits_index {
+	/** number of granted locks per inodebit and lock mode index */
+	__u32			lii_granted[MDS_INODELOCK_MAXSHIFT + 1]
+					   [LCK_MODE_NUM];
+	/** number of granted locks with bits not covered by the index */
+	__u32			lii_unindexed;
+	/** longest walk of the granted queue, in lock groups */
+	__u32			lii_max_scan;
+};
+
 /** Whether to track references to exports by LDLM locks. */
 #define LUSTRE_TRACKS_LOCK_EXP_REFS (0)
 
@@ -731,9 +829,14 @@ struct ldlm_lock {
 	struct ldlm_resource	*l_resource;
 	/**
 	 * List item for client side LRU list.
-	 * Protected by ns_lock in struct ldlm_namespace.
+	 * Protected by nl_lock of the LRU part \a l_lru_cpt of the namespace.
 	 */
 	struct list_head	l_lru;
+	/**
+	 * CPT of the namespace LRU part the lock was last added to, set
+	 * under the resource lock.
+	 */
+	int			l_lru_cpt;
 	/**
 	 * Linkage to resource's lock queues according to current lock state.
 	 * (could be granted or waiting)
@@ -831,6 +934,17 @@ struct ldlm_lock {
 	 * Time, in nanoseconds, last used by e.g. being matched by lock match.
 	 */
 	ktime_t			l_last_used;
+	/**
+	 * Set when the lock is matched while it is in the LRU. Rather than
+	 * moving the lock to the LRU tail on every such use, the LRU scan
+	 * gives it a second chance, see ldlm_prepare_lru_list().
+	 */
+	bool			l_lru_touched;
+	/**
+	 * Client only, when the blocking AST of the server for this lock
+	 * was received, see ldlm_cli_cancel_batch().
+	 */
+	ktime_t			l_bl_ast_time;
 
 	/** Originally requested extent for the extent lock. */
 	struct ldlm_extent	l_req_extent;
@@ -975,7 +1089,8 @@ struct ldlm_resource {
 
 	/**
 	 * List item for list in namespace hash.
-	 * protected by ns_lock
+	 * protected by the hash bucket lock, walked under RCU by
+	 * ldlm_resource_get()
 	 */
 	struct hlist_node	lr_hash;
 
@@ -999,10 +1114,15 @@ struct ldlm_resource {
 	/** Resource name */
 	struct ldlm_res_id	lr_name;
 
-	/**
-	 * Interval trees (only for extent locks) for all modes of this resource
-	 */
-	struct ldlm_interval_tree *lr_itree;
+	union {
+		/**
+		 * Interval trees (only for extent locks) for all modes of
+		 * this resource
+		 */
+		struct ldlm_interval_tree *lr_itree;
+		/** Index of granted locks (only for inodebits locks) */
+		struct ldlm_ibits_index	*lr_ibits;
+	};
 
 	union {
 		/**
@@ -1032,6 +1152,9 @@ struct ldlm_resource {
 
 	/** List of references to this resource. For debugging. */
 	struct lu_ref		lr_reference;
+
+	/** Resource is freed after an RCU grace period */
+	struct rcu_head		lr_rcu;
 };
 
 static inline bool ldlm_has_layout(struct ldlm_lock *lock)
@@ -72,10 +72,43 @@ struct plain_handle_data {
 	struct llog_cookie	phd_cookie;
 };
 
+/* Changelog records wanted by the reader of a remote changelog catalog.
+ * It is sent with LLOG_ORIGIN_HANDLE_NEXT_BLOCK so that the server does not
+ * send the other records, see llog_client_next_block(). */
+struct llog_chlg_filter {
+	spinlock_t		lcf_lock;
+	struct changelog_filter	lcf_filter;
+};
+
+/**
+ * Check whether the changelog record \a rec passes the filter \a cf.
+ *
+ * \param[in] cf	filter of the reader
+ * \param[in] rec	changelog record
+ *
+ * \retval true if the record has to be delivered to the reader
+ */
+static inline bool llog_chlg_filter_match(const struct changelog_filter *cf,
+					  const struct changelog_rec *rec)
+{
+	if (cf->cf_type_mask != 0 && rec->cr_type < 32 &&
+	    !(cf->cf_type_mask & (1U << rec->cr_type)))
+		return false;
+
+	if (cf->cf_shard_count > 1 &&
+	    fid_flatten32(&rec->cr_tfid) % cf->cf_shard_count !=
+	    cf->cf_shard_index)
+		return false;
+
+	return true;
+}
+
 struct cat_handle_data {
 	struct list_head	chd_head;
 	struct llog_handle     *chd_current_log;/* currently open log */
 	struct llog_handle     *chd_next_log;	/* llog to be used next */
+	/* records wanted by the reader of a remote changelog, or NULL */
+	struct llog_chlg_filter	*chd_chlg_filter;
 };
 
 struct llog_handle;
@@ -95,6 +128,8 @@ int llog_reverse_process(const struct lu_env *env,
 			 void *data, void *catdata);
 int llog_cancel_rec(const struct lu_env *env, struct llog_handle *loghandle,
 		    int index);
+int llog_cancel_arr_rec(const struct lu_env *env,
+			struct llog_handle *loghandle, int num, int *index);
 int llog_open(const struct lu_env *env, struct llog_ctxt *ctxt,
 	      struct llog_handle **lgh, struct llog_logid *logid,
 	      char *name, enum llog_open_param open_param);
@@ -153,6 +188,9 @@ int llog_cat_add(const struct lu_env *env, struct llog_handle *cathandle,
 int llog_cat_cancel_records(const struct lu_env *env,
 			    struct llog_handle *cathandle, int count,
 			    struct llog_cookie *cookies);
+int llog_cat_cancel_arr_rec(const struct lu_env *env,
+			    struct llog_handle *cathandle,
+			    struct llog_logid *lgl, int count, int *index);
 int llog_cat_process_or_fork(const struct lu_env *env,
 			     struct llog_handle *cat_llh, llog_cb_t cat_cb,
 			     llog_cb_t cb, void *data, int startcat,
@@ -324,6 +362,18 @@ struct llog_ctxt {
 #define LLOG_DEL_RECORD 0x0002
 #define LLOG_DEL_PLAIN  0x0003
 
+/* max number of records of the same llog cancelled in one transaction by
+ * llog_cat_cancel_records() */
+#define LLOG_CAT_CANCEL_BATCH	64
+
+static inline bool llog_logid_eq(const struct llog_logid *a,
+				 const struct llog_logid *b)
+{
+	return ostid_id(&a->lgl_oi) == ostid_id(&b->lgl_oi) &&
+	       ostid_seq(&a->lgl_oi) == ostid_seq(&b->lgl_oi) &&
+	       a->lgl_ogen == b->lgl_ogen;
+}
+
 static inline int llog_obd2ops(struct llog_ctxt *ctxt,
                                struct llog_operations **lop)
 {
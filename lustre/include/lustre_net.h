@@ -124,6 +124,11 @@
 #endif
 
 #define PTLRPC_NTHRS_INIT	2
+/**
+ * Seconds a service thread above threads_min may stay idle before it
+ * exits, tunable per service by threads_idle_timeout
+ */
+#define PTLRPC_THR_IDLE_TIMEOUT	300
 
 /**
  * Buffer Constants
@@ -1683,6 +1688,8 @@ struct ptlrpc_service {
 	int				srv_nthrs_cpt_init;
 	/** limit of threads number for each partition */
 	int				srv_nthrs_cpt_limit;
+	/** seconds before an idle thread above the init number exits */
+	int				srv_thr_idle_timeout;
 	/** Root of debugfs dir tree for this service */
 	struct dentry		       *srv_debugfs_entry;
         /** Pointer to statistic data for this service */
@@ -1760,7 +1767,7 @@ struct ptlrpc_service_part {
 	int				scp_thr_nextid;
 	/** # of starting threads */
 	int				scp_nthrs_starting;
-	/** # of stopping threads, reserved for shrinking threads */
+	/** # of idle threads exiting to shrink the partition */
 	int				scp_nthrs_stopping;
 	/** # running threads */
 	int				scp_nthrs_running;
@@ -1820,6 +1827,8 @@ struct ptlrpc_service_part {
 	int				scp_nhreqs_active;
 	/** # hp requests handled */
 	int				scp_hreq_count;
+	/** time requests waited in the queue, in log2 ms */
+	struct obd_histogram		scp_queue_hist;
 
 	/** NRS head for regular requests */
 	struct ptlrpc_nrs		scp_nrs_reg;
@@ -1919,6 +1928,22 @@ struct ptlrpcd_ctl {
 	 * Error code if the thread failed to fully start.
 	 */
 	int				pc_error;
+	/**
+	 * Time the thread was started.
+	 */
+	ktime_t				pc_start_time;
+	/**
+	 * Time spent by the thread processing its request set, in ns.
+	 */
+	__u64				pc_busy_ns;
+	/**
+	 * Number of requests taken from the thread's own queue.
+	 */
+	__u64				pc_nr_queued;
+	/**
+	 * Number of requests taken from the queues of partner threads.
+	 */
+	__u64				pc_nr_stolen;
 };
 
 /* Bits for pc_flags */
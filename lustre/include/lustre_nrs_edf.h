@@ -0,0 +1,79 @@
+/*
+ * GPL HEADER START
+ *
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License version 2 for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this program; If not, see
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * GPL HEADER END
+ */
+/*
+ *
+ * Network Request Scheduler (NRS) Earliest Deadline First policy
+ *
+ */
+
+#ifndef _LUSTRE_NRS_EDF_H
+#define _LUSTRE_NRS_EDF_H
+
+/* \name edf
+ *
+ * EDF policy
+ * @{
+ */
+
+/**
+ * Private data structure for the EDF policy
+ */
+struct nrs_edf_data {
+	struct ptlrpc_nrs_resource	 edf_res;
+
+	/**
+	 * Queued requests, ordered by their deadline.
+	 */
+	struct cfs_binheap		*edf_binheap;
+
+	/**
+	 * Sequence number of the last enqueued request; used to keep
+	 * requests which share the same deadline in arrival order.
+	 */
+	__u64				 edf_sequence;
+
+	/**
+	 * Requests which had already missed their deadline when they were
+	 * dequeued, and are going to be dropped by the service.
+	 */
+	__u64				 edf_expired;
+};
+
+struct nrs_edf_req {
+	/**
+	 * Deadline of the request when it was enqueued; ptlrpc_request::
+	 * rq_deadline itself may be pushed back by early replies while the
+	 * request is queued, and must not change its position in the heap.
+	 */
+	time64_t	req_deadline;
+	/**
+	 * Arrival order of requests with identical deadlines.
+	 */
+	__u64		req_sequence;
+};
+
+enum nrs_ctl_edf {
+	NRS_CTL_EDF_RD_EXPIRED = PTLRPC_NRS_CTL_1ST_POL_SPEC,
+};
+
+/** @} edf */
+
+#endif
@@ -124,6 +124,13 @@ struct nrs_tbf_client {
 	struct cfs_binheap_node		 tc_node;
 	/** Whether the client is in heap. */
 	bool				 tc_in_heap;
+	/** Node in the heap of classes borrowing from the parent rule. */
+	struct cfs_binheap_node		 tc_borrow_node;
+	/**
+	 * Heap of the parent rule the client is in, NULL if none; it is
+	 * kept so the client can leave it after its rule changed.
+	 */
+	struct cfs_binheap		*tc_borrow_heap;
 	/** Sequence of the newest rule. */
 	__u32				 tc_rule_sequence;
 	/**
@@ -184,6 +191,22 @@ struct nrs_tbf_rule {
 	atomic_t			 tr_ref;
 	/** Generation of the rule. */
 	__u64				 tr_generation;
+	/**
+	 * Parent rule; classes of this rule may borrow unused tokens of
+	 * the bucket the parent shares among all its child rules.
+	 */
+	struct nrs_tbf_rule		*tr_parent;
+	/**
+	 * Heap of the queued classes of the child rules by deadline, only
+	 * for rules without a parent.
+	 */
+	struct cfs_binheap		*tr_borrow_heap;
+	/** Link into nrs_tbf_head::th_borrow_rules. */
+	struct list_head		 tr_borrow_linkage;
+	/** Tokens of the bucket shared by the child rules. */
+	__u64				 tr_ntoken;
+	/** Time check-point of the bucket shared by the child rules. */
+	__u64				 tr_check_time;
 };
 
 struct nrs_tbf_ops {
@@ -262,6 +285,15 @@ struct nrs_tbf_head {
 	 * Sequence of requests.
 	 */
 	__u64				 th_sequence;
+	/**
+	 * Number of rules with a parent rule.
+	 */
+	atomic_t			 th_nr_child_rules;
+	/**
+	 * Parent rules with queued classes of child rules, which may borrow
+	 * their tokens.
+	 */
+	struct list_head		 th_borrow_rules;
 	/**
 	 * Heap of queues.
 	 */
@@ -313,6 +345,7 @@ struct nrs_tbf_cmd {
 			__u32			 ts_valid_type;
 			enum nrs_rule_flags	 ts_rule_flags;
 			char			*ts_next_name;
+			char			*ts_parent_name;
 		} tc_start;
 		struct nrs_tbf_cmd_change {
 			__u64			 tc_rpc_rate;
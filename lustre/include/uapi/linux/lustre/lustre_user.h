@@ -416,6 +416,7 @@ struct ll_ioc_lease {
 #define LL_IOC_FID2MDTIDX		_IOWR('f', 248, struct lu_fid)
 #define LL_IOC_GETPARENT		_IOWR('f', 249, struct getparent)
 #define LL_IOC_LADVISE			_IOR('f', 250, struct llapi_lu_ladvise)
+#define LL_IOC_CHLG_SET_FILTER		_IOW('f', 251, struct changelog_filter)
 
 #ifndef	FS_IOC_FSGETXATTR
 /*
@@ -1215,6 +1216,23 @@ enum changelog_send_flag {
 	CHANGELOG_FLAG_EXTRA_FLAGS = 0x08,
 };
 
+/**
+ * Record filter applied by the kernel to a changelog character device reader,
+ * so that records which are not wanted are never copied to userspace.
+ * Records are sharded by the hash of their target FID, so that \a count
+ * readers, each with a different \a index, get disjoint sets of records and
+ * all the records of a given file are delivered to the same reader.
+ */
+struct changelog_filter {
+	/* bitmask of (1 << CL_*) record types to deliver, 0 for all */
+	__u32	cf_type_mask;
+	/* index of the shard delivered to this reader */
+	__u32	cf_shard_index;
+	/* number of shards, 0 or 1 to deliver all records */
+	__u32	cf_shard_count;
+	__u32	cf_padding;
+};
+
 enum changelog_send_extra_flag {
 	/* Pack uid/gid into the changelog record */
 	CHANGELOG_EXTRA_FLAG_UIDGID = 0x01,
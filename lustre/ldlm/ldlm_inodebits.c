@@ -56,7 +56,159 @@
 
 #include "ldlm_internal.h"
 
+/**
+ * Add \a delta to the counters of granted lock \a lock in the granted locks
+ * index \a lii.
+ */
+static void ldlm_ibits_index_update(struct ldlm_ibits_index *lii,
+				    struct ldlm_lock *lock, int delta)
+{
+	__u64 bits = lock->l_policy_data.l_inodebits.bits;
+	int idx = ldlm_mode_to_index(lock->l_granted_mode);
+	int bit;
+
+	if (bits & ~MDS_INODELOCK_FULL)
+		lii->lii_unindexed += delta;
+
+	bits &= MDS_INODELOCK_FULL;
+	for (bit = 0; bits != 0; bit++, bits >>= 1)
+		if (bits & 1)
+			lii->lii_granted[bit][idx] += delta;
+}
+
+/**
+ * Account lock \a lock just added to the granted queue in the granted locks
+ * index of its resource, if any.
+ * Must be called with the resource lock held.
+ */
+void ldlm_ibits_index_add(struct ldlm_lock *lock)
+{
+	struct ldlm_ibits_index *lii = lock->l_resource->lr_ibits;
+
+	if (lii != NULL)
+		ldlm_ibits_index_update(lii, lock, 1);
+}
+
+/**
+ * Remove lock \a lock from the granted locks index of its resource, if any.
+ * Only locks linked to the granted queue are accounted in the index.
+ * Must be called with the resource lock held, before the lock is unlinked.
+ */
+void ldlm_ibits_index_del(struct ldlm_lock *lock)
+{
+	struct ldlm_ibits_index *lii = lock->l_resource->lr_ibits;
+
+	if (lii != NULL && !list_empty(&lock->l_res_link) &&
+	    lock->l_granted_mode == lock->l_req_mode)
+		ldlm_ibits_index_update(lii, lock, -1);
+}
+
+/**
+ * Print the granted locks index of resource \a res to debug log.
+ */
+void ldlm_ibits_index_dump(int level, struct ldlm_resource *res)
+{
+	struct ldlm_ibits_index *lii = res->lr_ibits;
+	int bit, idx;
+
+	if (lii == NULL)
+		return;
+
+	CDEBUG(level, "Granted locks index: max scan %u, unindexed %u\n",
+	       lii->lii_max_scan, lii->lii_unindexed);
+	for (bit = 0; bit <= MDS_INODELOCK_MAXSHIFT; bit++) {
+		for (idx = 0; idx < LCK_MODE_NUM; idx++) {
+			if (lii->lii_granted[bit][idx] == 0)
+				continue;
+			CDEBUG(level, "  bit %#llx mode %s: %u\n", 1ULL << bit,
+			       ldlm_lockname[1 << idx],
+			       lii->lii_granted[bit][idx]);
+		}
+	}
+}
+
 #ifdef HAVE_SERVER_SUPPORT
+/**
+ * Build the granted locks index of resource \a res from its granted queue.
+ * The index is an optimization only, so it is fine to fail allocating it.
+ */
+static void ldlm_ibits_index_build(struct ldlm_resource *res, int scanned)
+{
+	struct ldlm_ibits_index *lii;
+	struct ldlm_lock *lock;
+
+	OBD_ALLOC_GFP(lii, sizeof(*lii), GFP_ATOMIC);
+	if (lii == NULL)
+		return;
+
+	list_for_each_entry(lock, &res->lr_granted, l_res_link)
+		ldlm_ibits_index_update(lii, lock, 1);
+	lii->lii_max_scan = scanned;
+	res->lr_ibits = lii;
+	lprocfs_counter_incr(ldlm_res_to_ns(res)->ns_ibits_stats,
+			     LDLM_IBITS_INDEX_BUILT);
+
+	CDEBUG(D_DLMTRACE, "res "DLDLMRES": index built after %d groups\n",
+	       PLDLMRES(res), scanned);
+}
+
+/**
+ * Check lock \a req against the granted locks index \a lii.
+ *
+ * This follows the same rules as ldlm_inodebits_compat_queue(), including
+ * the filtering of try_bits of \a req.
+ *
+ * \retval 1		if \a req is compatible with all granted locks
+ * \retval 0		if \a req conflicts with some granted locks
+ * \retval -EAGAIN	if the index can't tell, e.g. conflicting COS locks
+ *			may be owned by the same client
+ */
+static int ldlm_ibits_index_compat(struct ldlm_ibits_index *lii,
+				   struct ldlm_lock *req)
+{
+	__u64 req_bits = req->l_policy_data.l_inodebits.bits;
+	__u64 *try_bits = &req->l_policy_data.l_inodebits.try_bits;
+	__u64 conflict_bits = 0;
+	__u64 cos_bits = 0;
+	int bit, idx;
+
+	if (lii->lii_unindexed != 0)
+		return -EAGAIN;
+
+	for (idx = 0; idx < LCK_MODE_NUM; idx++) {
+		enum ldlm_mode mode = 1 << idx;
+		__u64 bits = 0;
+
+		if (mode == LCK_COS && !ldlm_is_cos_incompat(req) &&
+		    !ldlm_is_cos_enabled(req))
+			continue;
+
+		if (lockmode_compat(mode, req->l_req_mode))
+			continue;
+
+		for (bit = 0; bit <= MDS_INODELOCK_MAXSHIFT; bit++)
+			if (lii->lii_granted[bit][idx] != 0)
+				bits |= 1ULL << bit;
+
+		if (mode == LCK_COS && !ldlm_is_cos_incompat(req))
+			cos_bits = bits;
+		conflict_bits |= bits;
+	}
+
+	/* try_bits of granted locks are always zero */
+	*try_bits &= ~conflict_bits;
+	if ((req_bits | *try_bits) == 0)
+		return 0;
+
+	if (!(conflict_bits & req_bits))
+		return 1;
+
+	if (cos_bits & req_bits)
+		return -EAGAIN;
+
+	return 0;
+}
+
 /**
  * Determine if the lock is compatible with all locks on the queue.
  *
@@ -71,15 +223,23 @@
  * bunch contains a pointer to the end of the bunch.  This allows us to
  * skip an entire bunch when iterating the list in search for conflicting
  * locks if first lock of the bunch is not conflicting with us.
+ *
+ * Resources whose granted queue takes long to walk also get an index of
+ * granted locks by bit and mode, so that the granted queue is only walked
+ * to collect the conflicting locks into \a work_list.
  */
 static int
 ldlm_inodebits_compat_queue(struct list_head *queue, struct ldlm_lock *req,
 			    struct list_head *work_list)
 {
+	struct ldlm_resource *res = req->l_resource;
+	struct ldlm_namespace *ns = ldlm_res_to_ns(res);
 	struct list_head *tmp;
 	struct ldlm_lock *lock;
 	__u64 req_bits = req->l_policy_data.l_inodebits.bits;
 	__u64 *try_bits = &req->l_policy_data.l_inodebits.try_bits;
+	bool granted = queue == &res->lr_granted;
+	int scanned = 0;
 	int compat = 1;
 
 	ENTRY;
@@ -92,6 +252,23 @@ ldlm_inodebits_compat_queue(struct list_head *queue, struct ldlm_lock *req,
 	if ((req_bits | *try_bits) == 0)
 		RETURN(0);
 
+	if (granted && res->lr_ibits != NULL) {
+		compat = ldlm_ibits_index_compat(res->lr_ibits, req);
+		if (compat == 1) {
+			lprocfs_counter_incr(ns->ns_ibits_stats,
+					     LDLM_IBITS_INDEX_COMPAT);
+			RETURN(compat);
+		}
+		if (compat == 0 && work_list == NULL) {
+			lprocfs_counter_incr(ns->ns_ibits_stats,
+					     LDLM_IBITS_INDEX_CONFLICT);
+			RETURN(compat);
+		}
+		lprocfs_counter_incr(ns->ns_ibits_stats,
+				     LDLM_IBITS_INDEX_WALK);
+		compat = 1;
+	}
+
 	list_for_each(tmp, queue) {
 		struct list_head *mode_tail;
 
@@ -101,7 +278,9 @@ ldlm_inodebits_compat_queue(struct list_head *queue, struct ldlm_lock *req,
 		 * take conflicting locks enqueued after us into account,
 		 * or we'd wait forever. */
 		if (req == lock)
-			RETURN(compat);
+			GOTO(out, compat);
+
+		scanned++;
 
 		/* last lock in mode group */
 		LASSERT(lock->l_sl_mode.prev != NULL);
@@ -140,7 +319,7 @@ ldlm_inodebits_compat_queue(struct list_head *queue, struct ldlm_lock *req,
 				lock->l_policy_data.l_inodebits.try_bits);
 
 			if ((req_bits | *try_bits) == 0)
-				RETURN(0);
+				GOTO(out, compat = 0);
 
 			/* The new lock ibits is more preferable than try_bits
 			 * of waiting locks so drop conflicting try_bits in
@@ -162,7 +341,7 @@ ldlm_inodebits_compat_queue(struct list_head *queue, struct ldlm_lock *req,
 
 				/* Found a conflicting policy group. */
 				if (!work_list)
-					RETURN(0);
+					GOTO(out, compat = 0);
 
 				compat = 0;
 
@@ -183,10 +362,23 @@ not_conflicting:
 
 			tmp = tmp->next;
 			lock = list_entry(tmp, struct ldlm_lock, l_res_link);
+			scanned++;
 		} /* Loop over policy groups within one mode group. */
 	} /* Loop over mode groups within @queue. */
 
-	RETURN(compat);
+	EXIT;
+out:
+	if (granted) {
+		lprocfs_counter_add(ns->ns_ibits_stats, LDLM_IBITS_SCANNED,
+				    scanned);
+		if (res->lr_ibits != NULL) {
+			if (scanned > res->lr_ibits->lii_max_scan)
+				res->lr_ibits->lii_max_scan = scanned;
+		} else if (scanned >= ns->ns_ibits_index_min_scan) {
+			ldlm_ibits_index_build(res, scanned);
+		}
+	}
+	return compat;
 }
 
 /**
@@ -118,6 +118,11 @@ int ldlm_cancel_lru_local(struct ldlm_namespace *ns,
 			  struct list_head *cancels, int count, int max,
 			  enum ldlm_cancel_flags cancel_flags,
 			  enum ldlm_lru_flags lru_flags);
+bool ldlm_cli_cancel_batch(struct ldlm_namespace *ns, struct ldlm_lock *lock,
+			   int avail);
+void ldlm_cli_cancel_batch_done(struct ldlm_namespace *ns);
+void ldlm_cli_cancel_batch_flush(struct ldlm_namespace *ns);
+void ldlm_cli_cancel_batch_work(struct work_struct *ws);
 extern unsigned int ldlm_enqueue_min;
 /* ldlm_resource.c */
 extern struct kmem_cache *ldlm_resource_slab;
@@ -168,11 +173,17 @@ int ldlm_lock_remove_from_lru_check(struct ldlm_lock *lock, ktime_t last_use);
 #define ldlm_lock_remove_from_lru(lock) \
 		ldlm_lock_remove_from_lru_check(lock, ktime_set(0, 0))
 int ldlm_lock_remove_from_lru_nolock(struct ldlm_lock *lock);
-void ldlm_lock_add_to_lru_nolock(struct ldlm_lock *lock);
+void ldlm_lock_add_to_lru_nolock(struct ldlm_lock *lock, int cpt);
 void ldlm_lock_add_to_lru(struct ldlm_lock *lock);
 void ldlm_lock_touch_in_lru(struct ldlm_lock *lock);
 void ldlm_lock_destroy_nolock(struct ldlm_lock *lock);
 
+/* LRU part of the namespace the lock was last added to */
+static inline struct ldlm_ns_lru *ldlm_lock_lru(struct ldlm_lock *lock)
+{
+	return ldlm_lock_to_ns(lock)->ns_lru[lock->l_lru_cpt];
+}
+
 int ldlm_export_cancel_blocked_locks(struct obd_export *exp);
 int ldlm_export_cancel_locks(struct obd_export *exp);
 void ldlm_grant_lock_with_skiplist(struct ldlm_lock *lock);
@@ -208,6 +219,15 @@ int ldlm_process_extent_lock(struct ldlm_lock *lock, __u64 *flags,
 void ldlm_extent_add_lock(struct ldlm_resource *res, struct ldlm_lock *lock);
 void ldlm_extent_unlink_lock(struct ldlm_lock *lock);
 
+/* ldlm_inodebits.c */
+/* build the granted locks index of a resource after walking this many lock
+ * groups of its granted queue, default of ns_ibits_index_min_scan */
+#define LDLM_IBITS_INDEX_MIN_SCAN	16
+
+void ldlm_ibits_index_add(struct ldlm_lock *lock);
+void ldlm_ibits_index_del(struct ldlm_lock *lock);
+void ldlm_ibits_index_dump(int level, struct ldlm_resource *res);
+
 /* ldlm_flock.c */
 int ldlm_process_flock_lock(struct ldlm_lock *req, __u64 *flags,
 			    enum ldlm_process_intention intention,
@@ -229,6 +249,18 @@ struct ldlm_state {
         struct ldlm_bl_pool *ldlm_bl_pool;
 };
 
+static inline int ldlm_mode_to_index(enum ldlm_mode mode)
+{
+	int index;
+
+	LASSERT(mode != 0);
+	LASSERT(is_power_of_2(mode));
+	for (index = -1; mode != 0; index++, mode >>= 1)
+		/* do nothing */;
+	LASSERT(index < LCK_MODE_NUM);
+	return index;
+}
+
 /* interval tree, for LDLM_EXTENT. */
 extern struct kmem_cache *ldlm_interval_slab; /* slab cache for ldlm_interval */
 extern void ldlm_interval_attach(struct ldlm_interval *n, struct ldlm_lock *l);
@@ -227,20 +227,22 @@ void ldlm_lock_put(struct ldlm_lock *lock)
 EXPORT_SYMBOL(ldlm_lock_put);
 
 /**
- * Removes LDLM lock \a lock from LRU. Assumes LRU is already locked.
+ * Removes LDLM lock \a lock from LRU. Assumes the LRU part the lock is in,
+ * see ldlm_lock_lru(), is already locked.
  */
 int ldlm_lock_remove_from_lru_nolock(struct ldlm_lock *lock)
 {
 	int rc = 0;
 	if (!list_empty(&lock->l_lru)) {
 		struct ldlm_namespace *ns = ldlm_lock_to_ns(lock);
+		struct ldlm_ns_lru *nl = ldlm_lock_lru(lock);
 
 		LASSERT(lock->l_resource->lr_type != LDLM_FLOCK);
-		if (ns->ns_last_pos == &lock->l_lru)
-			ns->ns_last_pos = lock->l_lru.prev;
+		if (nl->nl_last_pos == &lock->l_lru)
+			nl->nl_last_pos = lock->l_lru.prev;
 		list_del_init(&lock->l_lru);
-		LASSERT(ns->ns_nr_unused > 0);
-		ns->ns_nr_unused--;
+		LASSERT(atomic_read(&ns->ns_nr_unused) > 0);
+		atomic_dec(&ns->ns_nr_unused);
 		rc = 1;
 	}
 	return rc;
@@ -259,7 +261,7 @@ int ldlm_lock_remove_from_lru_nolock(struct ldlm_lock *lock)
  */
 int ldlm_lock_remove_from_lru_check(struct ldlm_lock *lock, ktime_t last_use)
 {
-	struct ldlm_namespace *ns = ldlm_lock_to_ns(lock);
+	struct ldlm_ns_lru *nl;
 	int rc = 0;
 
 	ENTRY;
@@ -268,53 +270,65 @@ int ldlm_lock_remove_from_lru_check(struct ldlm_lock *lock, ktime_t last_use)
 		RETURN(0);
 	}
 
-	spin_lock(&ns->ns_lock);
+	nl = ldlm_lock_lru(lock);
+	spin_lock(&nl->nl_lock);
 	if (!ktime_compare(last_use, ktime_set(0, 0)) ||
 	    !ktime_compare(last_use, lock->l_last_used))
 		rc = ldlm_lock_remove_from_lru_nolock(lock);
-	spin_unlock(&ns->ns_lock);
+	spin_unlock(&nl->nl_lock);
 
 	RETURN(rc);
 }
 
 /**
- * Adds LDLM lock \a lock to namespace LRU. Assumes LRU is already locked.
+ * Adds LDLM lock \a lock to the LRU part of CPT \a cpt. Assumes this part
+ * is already locked.
  */
-void ldlm_lock_add_to_lru_nolock(struct ldlm_lock *lock)
+void ldlm_lock_add_to_lru_nolock(struct ldlm_lock *lock, int cpt)
 {
 	struct ldlm_namespace *ns = ldlm_lock_to_ns(lock);
 
 	lock->l_last_used = ktime_get();
+	lock->l_lru_touched = false;
 	LASSERT(list_empty(&lock->l_lru));
 	LASSERT(lock->l_resource->lr_type != LDLM_FLOCK);
-	list_add_tail(&lock->l_lru, &ns->ns_unused_list);
-	LASSERT(ns->ns_nr_unused >= 0);
-	ns->ns_nr_unused++;
+	lock->l_lru_cpt = cpt;
+	list_add_tail(&lock->l_lru, &ns->ns_lru[cpt]->nl_list);
+	atomic_inc(&ns->ns_nr_unused);
 }
 
 /**
- * Adds LDLM lock \a lock to namespace LRU. Obtains necessary LRU locks
- * first.
+ * Adds LDLM lock \a lock to the namespace LRU part of the current CPT.
+ * Obtains necessary LRU locks first.
+ * Assumes the resource of the lock is locked, as \a l_lru_cpt is read
+ * under it by ldlm_lock_lru().
  */
 void ldlm_lock_add_to_lru(struct ldlm_lock *lock)
 {
 	struct ldlm_namespace *ns = ldlm_lock_to_ns(lock);
+	struct ldlm_ns_lru *nl;
+	int cpt;
 
 	ENTRY;
-	spin_lock(&ns->ns_lock);
-	ldlm_lock_add_to_lru_nolock(lock);
-	spin_unlock(&ns->ns_lock);
+	cpt = cfs_cpt_current(cfs_cpt_tab, 1);
+	nl = ns->ns_lru[cpt];
+	spin_lock(&nl->nl_lock);
+	ldlm_lock_add_to_lru_nolock(lock, cpt);
+	spin_unlock(&nl->nl_lock);
 	EXIT;
 }
 
 /**
- * Moves LDLM lock \a lock that is already in namespace LRU to the tail of
- * the LRU. Performs necessary LRU locking
+ * Marks LDLM lock \a lock that is already in namespace LRU as recently used.
+ *
+ * The lock is not moved to the tail of the LRU here, that would take
+ * the LRU lock on every match. Instead, the LRU scan moves it there when it
+ * finds the lock marked, like a CLOCK reference bit.
+ * Assumes the resource of the lock is locked, as l_last_used is checked
+ * under it by ldlm_lock_remove_from_lru_check().
  */
 void ldlm_lock_touch_in_lru(struct ldlm_lock *lock)
 {
-	struct ldlm_namespace *ns = ldlm_lock_to_ns(lock);
-
 	ENTRY;
 	if (ldlm_is_ns_srv(lock)) {
 		LASSERT(list_empty(&lock->l_lru));
@@ -322,12 +336,10 @@ void ldlm_lock_touch_in_lru(struct ldlm_lock *lock)
 		return;
 	}
 
-	spin_lock(&ns->ns_lock);
 	if (!list_empty(&lock->l_lru)) {
-		ldlm_lock_remove_from_lru_nolock(lock);
-		ldlm_lock_add_to_lru_nolock(lock);
+		lock->l_last_used = ktime_get();
+		lock->l_lru_touched = true;
 	}
-	spin_unlock(&ns->ns_lock);
 	EXIT;
 }
 
@@ -1083,6 +1095,8 @@ void ldlm_grant_lock_with_skiplist(struct ldlm_lock *lock)
 
 	search_granted_lock(&lock->l_resource->lr_granted, lock, &prev);
 	ldlm_granted_list_add_lock(lock, &prev);
+	if (lock->l_resource->lr_type == LDLM_IBITS)
+		ldlm_ibits_index_add(lock);
 }
 
 /**
@@ -2384,6 +2398,8 @@ void ldlm_unlink_lock_skiplist(struct ldlm_lock *req)
             req->l_resource->lr_type != LDLM_IBITS)
                 return;
 
+	if (req->l_resource->lr_type == LDLM_IBITS)
+		ldlm_ibits_index_del(req);
 	list_del_init(&req->l_sl_policy);
 	list_del_init(&req->l_sl_mode);
 }
@@ -1272,6 +1272,8 @@ int ldlm_handle_enqueue0(struct ldlm_namespace *ns,
         }
 
         lock->l_export = class_export_lock_get(req->rq_export, lock);
+	/* the export is actively using locks, see ldlm_reclaim_res() */
+	lock->l_export->exp_last_lock_time = ktime_get_seconds();
         if (lock->l_export->exp_lock_hash)
                 cfs_hash_add(lock->l_export->exp_lock_hash,
                              &lock->l_remote_handle,
@@ -1805,6 +1807,7 @@ static void ldlm_handle_cp_callback(struct ptlrpc_request *req,
 		 * Let ldlm_cancel_lru() be fast. */
                 ldlm_lock_remove_from_lru(lock);
 		lock->l_flags |= LDLM_FL_CBPENDING | LDLM_FL_BL_AST;
+		lock->l_bl_ast_time = ktime_get();
                 LDLM_DEBUG(lock, "completion AST includes blocking AST");
         }
 
@@ -1999,7 +2002,18 @@ static int ldlm_bl_to_thread(struct ldlm_namespace *ns,
 int ldlm_bl_to_thread_lock(struct ldlm_namespace *ns, struct ldlm_lock_desc *ld,
 			   struct ldlm_lock *lock)
 {
-	return ldlm_bl_to_thread(ns, ld, lock, NULL, 0, LCF_ASYNC);
+	int rc;
+
+	/* account the callback before queueing, it can be done at once */
+	spin_lock(&ns->ns_lock);
+	ns->ns_bl_pending++;
+	spin_unlock(&ns->ns_lock);
+
+	rc = ldlm_bl_to_thread(ns, ld, lock, NULL, 0, LCF_ASYNC);
+	if (rc != 0)
+		ldlm_cli_cancel_batch_done(ns);
+
+	return rc;
 }
 
 int ldlm_bl_to_thread_list(struct ldlm_namespace *ns, struct ldlm_lock_desc *ld,
@@ -2190,6 +2204,7 @@ static int ldlm_callback_handler(struct ptlrpc_request *req)
 		 * Let ldlm_cancel_lru() be fast. */
 		ldlm_lock_remove_from_lru(lock);
 		ldlm_set_bl_ast(lock);
+		lock->l_bl_ast_time = ktime_get();
 	}
         unlock_res_and_lock(lock);
 
@@ -2599,6 +2614,7 @@ static int ldlm_bl_thread_blwi(struct ldlm_bl_pool *blp,
 	} else {
 		ldlm_handle_bl_callback(blwi->blwi_ns, &blwi->blwi_ld,
 					blwi->blwi_lock);
+		ldlm_cli_cancel_batch_done(blwi->blwi_ns);
 	}
 	if (blwi->blwi_mem_pressure)
 		memory_pressure_clr();
@@ -3175,6 +3191,8 @@ void ldlm_exit(void)
 {
 	if (ldlm_refcount)
 		CERROR("ldlm_refcount is %d in ldlm_exit!\n", ldlm_refcount);
+	/* wait for the resources freed by call_rcu() in ldlm_resource_free */
+	rcu_barrier();
 	kmem_cache_destroy(ldlm_resource_slab);
 	/* ldlm_lock_put() use RCU to call ldlm_lock_free, so need call
 	 * synchronize_rcu() to wait a grace period elapsed, so that
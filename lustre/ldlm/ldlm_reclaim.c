@@ -48,6 +48,14 @@
  * ldlm_reclaim_threshold & ldlm_lock_limit is set to 20% & 30% of the
  * total memory by default. It is tunable via proc entry, when it's set
  * to 0, the feature is disabled.
+ *
+ * Locks held by the least active clients are reclaimed first: a client
+ * which hasn't enqueued any lock for longer than the lock age in use is
+ * asked to drop its old locks before any lock of an active client is
+ * revoked. Once the granted locks exceed LDLM_RECLAIM_PROACTIVE_RATIO
+ * percent of ldlm_reclaim_threshold, such idle clients are already
+ * trimmed at a limited rate by a work item in the background, so that
+ * the hard threshold is rarely hit.
  */
 
 #ifdef HAVE_SERVER_SUPPORT
@@ -65,6 +73,9 @@ struct percpu_counter		ldlm_granted_total;
 static atomic_t			ldlm_nr_reclaimer;
 static s64			ldlm_last_reclaim_age_ns;
 static ktime_t			ldlm_last_reclaim_time;
+static time64_t			ldlm_proactive_reclaim_next;
+static time64_t			ldlm_proactive_reclaim_interval;
+static struct work_struct	ldlm_proactive_reclaim_work;
 
 struct ldlm_reclaim_cb_data {
 	struct list_head	 rcd_rpc_list;
@@ -74,9 +85,27 @@ struct ldlm_reclaim_cb_data {
 	int			 rcd_start;
 	bool			 rcd_skip;
 	s64			 rcd_age_ns;
+	/* only revoke locks of exports idle for so many seconds */
+	time64_t		 rcd_idle;
 	struct cfs_hash_bd	*rcd_prev_bd;
 };
 
+/**
+ * Check if the lock holder has been idle for long enough, the lock of
+ * an idle export is preferred to be reclaimed.
+ */
+static inline bool ldlm_lock_export_idle(struct ldlm_lock *lock,
+					 time64_t idle)
+{
+	struct obd_export *exp = lock->l_export;
+
+	if (idle == 0)
+		return true;
+
+	return exp != NULL &&
+	       exp->exp_last_lock_time + idle <= ktime_get_seconds();
+}
+
 static inline bool ldlm_lock_reclaimable(struct ldlm_lock *lock)
 {
 	struct ldlm_namespace *ns = ldlm_lock_to_ns(lock);
@@ -148,6 +177,9 @@ static int ldlm_reclaim_lock_cb(struct cfs_hash *hs, struct cfs_hash_bd *bd,
 					      data->rcd_age_ns)))
 			continue;
 
+		if (!ldlm_lock_export_idle(lock, data->rcd_idle))
+			continue;
+
 		if (!ldlm_is_ast_sent(lock)) {
 			ldlm_set_ast_sent(lock);
 			LASSERT(list_empty(&lock->l_rk_ast));
@@ -171,13 +203,15 @@ static int ldlm_reclaim_lock_cb(struct cfs_hash *hs, struct cfs_hash_bd *bd,
  * \param[in] ns	namespace to do the lock revoke on
  * \param[in] count	count of lock to be revoked
  * \param[in] age	only revoke locks older than the 'age'
+ * \param[in] idle	only revoke locks of the exports which haven't
+ *			enqueued any lock during the 'age'
  * \param[in] skip	scan from the first lock on resource if the
  *			'skip' is false, otherwise, continue scan
  *			from the last scanned position
  * \param[out] count	count of lock still to be revoked
  */
 static void ldlm_reclaim_res(struct ldlm_namespace *ns, int *count,
-			     s64 age_ns, bool skip)
+			     s64 age_ns, bool idle, bool skip)
 {
 	struct ldlm_reclaim_cb_data	data;
 	int				idx, type, start;
@@ -202,6 +236,7 @@ static void ldlm_reclaim_res(struct ldlm_namespace *ns, int *count,
 	data.rcd_added = 0;
 	data.rcd_total = *count;
 	data.rcd_age_ns = age_ns;
+	data.rcd_idle = idle ? div_s64(age_ns, NSEC_PER_SEC) : 0;
 	data.rcd_skip = skip;
 	data.rcd_prev_bd = NULL;
 	start = ns->ns_reclaim_start % CFS_HASH_NBKT(ns->ns_rs_hash);
@@ -210,8 +245,8 @@ static void ldlm_reclaim_res(struct ldlm_namespace *ns, int *count,
 				 start);
 
 	CDEBUG(D_DLMTRACE, "NS(%s): %d locks to be reclaimed, found %d/%d "
-	       "locks.\n", ldlm_ns_name(ns), *count, data.rcd_added,
-	       data.rcd_total);
+	       "locks%s.\n", ldlm_ns_name(ns), *count, data.rcd_added,
+	       data.rcd_total, idle ? " of idle exports" : "");
 
 	LASSERTF(*count >= data.rcd_added, "count:%d, added:%d\n", *count,
 		 data.rcd_added);
@@ -224,6 +259,11 @@ static void ldlm_reclaim_res(struct ldlm_namespace *ns, int *count,
 #define LDLM_RECLAIM_BATCH	512
 #define LDLM_RECLAIM_AGE_MIN	(300 * NSEC_PER_SEC)
 #define LDLM_RECLAIM_AGE_MAX	(LDLM_DEFAULT_MAX_ALIVE * NSEC_PER_SEC * 3 / 4)
+/* start trimming idle exports at this percentage of reclaim threshold */
+#define LDLM_RECLAIM_PROACTIVE_RATIO	75
+/* seconds between two proactive reclaims, doubled after an empty one */
+#define LDLM_RECLAIM_PROACTIVE_INTERVAL	1
+#define LDLM_RECLAIM_PROACTIVE_INTERVAL_MAX	64
 
 static inline s64 ldlm_reclaim_age(void)
 {
@@ -243,24 +283,29 @@ static inline s64 ldlm_reclaim_age(void)
 /**
  * Revoke certain amount of locks from all the server namespaces
  * in a roundrobin manner. Lock age is used to avoid reclaim on
- * the non-aged locks.
+ * the non-aged locks, and the locks of idle exports are revoked
+ * before the locks of the active ones.
+ *
+ * \param[in] idle_only	don't touch the locks of active exports
+ *
+ * \retval		number of locks revoked
+ * \retval -EALREADY	another reclaim is running
  */
-static void ldlm_reclaim_ns(void)
+static int ldlm_reclaim_ns(bool idle_only)
 {
 	struct ldlm_namespace	*ns;
 	int			 count = LDLM_RECLAIM_BATCH;
 	int			 ns_nr, nr_processed;
 	enum ldlm_side		 ns_cli = LDLM_NAMESPACE_SERVER;
-	s64 age_ns;
+	s64 age_ns, start_age_ns;
 	bool			 skip = true;
+	bool			 idle = true;
 	ENTRY;
 
-	if (!atomic_add_unless(&ldlm_nr_reclaimer, 1, 1)) {
-		EXIT;
-		return;
-	}
+	if (!atomic_add_unless(&ldlm_nr_reclaimer, 1, 1))
+		RETURN(-EALREADY);
 
-	age_ns = ldlm_reclaim_age();
+	start_age_ns = age_ns = ldlm_reclaim_age();
 again:
 	nr_processed = 0;
 	ns_nr = ldlm_namespace_nr_read(ns_cli);
@@ -276,7 +321,7 @@ again:
 		ldlm_namespace_move_to_active_locked(ns, ns_cli);
 		mutex_unlock(ldlm_namespace_lock(ns_cli));
 
-		ldlm_reclaim_res(ns, &count, age_ns, skip);
+		ldlm_reclaim_res(ns, &count, age_ns, idle, skip);
 		ldlm_namespace_put(ns);
 		nr_processed++;
 	}
@@ -289,11 +334,44 @@ again:
 		goto again;
 	}
 
-	ldlm_last_reclaim_age_ns = age_ns;
-	ldlm_last_reclaim_time = ktime_get();
+	/* not enough locks from idle exports, take the active ones */
+	if (count > 0 && idle && !idle_only) {
+		age_ns = start_age_ns;
+		idle = false;
+		skip = false;
+		goto again;
+	}
+
+	/* proactive reclaim doesn't tell how old the active locks are */
+	if (!idle_only) {
+		ldlm_last_reclaim_age_ns = age_ns;
+		ldlm_last_reclaim_time = ktime_get();
+	}
 out:
 	atomic_add_unless(&ldlm_nr_reclaimer, -1, 0);
-	EXIT;
+	RETURN(LDLM_RECLAIM_BATCH - count);
+}
+
+/**
+ * Revoke the locks of idle exports before the reclaim threshold is hit.
+ * The interval to the next run is doubled as long as no lock is found,
+ * to not keep scanning the namespaces for nothing.
+ */
+static void ldlm_reclaim_proactive(struct work_struct *ws)
+{
+	int rc;
+
+	rc = ldlm_reclaim_ns(true);
+	if (rc == 0)
+		ldlm_proactive_reclaim_interval =
+			min_t(time64_t, ldlm_proactive_reclaim_interval * 2,
+			      LDLM_RECLAIM_PROACTIVE_INTERVAL_MAX);
+	else if (rc > 0)
+		ldlm_proactive_reclaim_interval =
+			LDLM_RECLAIM_PROACTIVE_INTERVAL;
+
+	ldlm_proactive_reclaim_next = ktime_get_seconds() +
+				      ldlm_proactive_reclaim_interval;
 }
 
 void ldlm_reclaim_add(struct ldlm_lock *lock)
@@ -324,13 +402,24 @@ bool ldlm_reclaim_full(void)
 {
 	__u64 high = ldlm_lock_limit;
 	__u64 low = ldlm_reclaim_threshold;
+	__u64 granted;
 
 	if (low != 0 && OBD_FAIL_CHECK(OBD_FAIL_LDLM_WATERMARK_LOW))
 		low = cfs_fail_val;
 
-	if (low != 0 &&
-	    percpu_counter_sum_positive(&ldlm_granted_total) > low)
-		ldlm_reclaim_ns();
+	if (low != 0) {
+		granted = percpu_counter_sum_positive(&ldlm_granted_total);
+		if (granted > low) {
+			ldlm_reclaim_ns(false);
+		} else if (granted > div_u64(low * LDLM_RECLAIM_PROACTIVE_RATIO,
+					     100) &&
+			   ktime_get_seconds() >= ldlm_proactive_reclaim_next) {
+			/* not on the enqueue path, the run sets the next */
+			ldlm_proactive_reclaim_next = ktime_get_seconds() +
+				ldlm_proactive_reclaim_interval;
+			schedule_work(&ldlm_proactive_reclaim_work);
+		}
+	}
 
 	if (high != 0 && OBD_FAIL_CHECK(OBD_FAIL_LDLM_WATERMARK_HIGH))
 		high = cfs_fail_val;
@@ -371,6 +460,9 @@ int ldlm_reclaim_setup(void)
 
 	ldlm_last_reclaim_age_ns = LDLM_RECLAIM_AGE_MAX;
 	ldlm_last_reclaim_time = ktime_get();
+	ldlm_proactive_reclaim_next = 0;
+	ldlm_proactive_reclaim_interval = LDLM_RECLAIM_PROACTIVE_INTERVAL;
+	INIT_WORK(&ldlm_proactive_reclaim_work, ldlm_reclaim_proactive);
 
 #ifdef HAVE_PERCPU_COUNTER_INIT_GFP_FLAG
 	return percpu_counter_init(&ldlm_granted_total, 0, GFP_KERNEL);
@@ -381,6 +473,7 @@ int ldlm_reclaim_setup(void)
 
 void ldlm_reclaim_cleanup(void)
 {
+	cancel_work_sync(&ldlm_proactive_reclaim_work);
 	percpu_counter_destroy(&ldlm_granted_total);
 }
 
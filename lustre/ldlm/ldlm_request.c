@@ -685,6 +685,7 @@ int ldlm_cli_enqueue_fini(struct obd_export *exp, struct ptlrpc_request *req,
 	if ((*flags) & LDLM_FL_AST_SENT) {
 		lock_res_and_lock(lock);
 		lock->l_flags |= LDLM_FL_CBPENDING | LDLM_FL_BL_AST;
+		lock->l_bl_ast_time = ktime_get();
 		unlock_res_and_lock(lock);
 		LDLM_DEBUG(lock, "enqueue reply includes blocking AST");
 	}
@@ -1103,8 +1104,6 @@ static int lock_convert_interpret(const struct lu_env *env,
 		 * finish with convert otherwise.
 		 */
 		if (!ldlm_is_bl_ast(lock)) {
-			struct ldlm_namespace *ns = ldlm_lock_to_ns(lock);
-
 			/* Drop cancel_bits since there are no more converts
 			 * and put lock into LRU if it is still not used and
 			 * is not there yet.
@@ -1112,11 +1111,9 @@ static int lock_convert_interpret(const struct lu_env *env,
 			lock->l_policy_data.l_inodebits.cancel_bits = 0;
 			if (!lock->l_readers && !lock->l_writers &&
 			    !ldlm_is_canceling(lock)) {
-				spin_lock(&ns->ns_lock);
 				/* there is check for list_empty() inside */
-				ldlm_lock_remove_from_lru_nolock(lock);
-				ldlm_lock_add_to_lru_nolock(lock);
-				spin_unlock(&ns->ns_lock);
+				ldlm_lock_remove_from_lru(lock);
+				ldlm_lock_add_to_lru(lock);
 			}
 		}
 	}
@@ -1546,7 +1543,6 @@ int ldlm_cli_cancel(const struct lustre_handle *lockh,
 	 * RPC which goes to canceld portal, so we can cancel other LRU locks
 	 * here and send them all as one LDLM_CANCEL RPC. */
 	LASSERT(list_empty(&lock->l_bl_ast));
-	list_add(&lock->l_bl_ast, &cancels);
 
 	exp = lock->l_conn_export;
 	if (exp_connect_cancelset(exp)) {
@@ -1556,16 +1552,186 @@ int ldlm_cli_cancel(const struct lustre_handle *lockh,
 		LASSERT(avail > 0);
 
 		ns = ldlm_lock_to_ns(lock);
+		/* More blocking callbacks are coming for this namespace,
+		 * send this cancel together with theirs. */
+		if (rc == LDLM_FL_BL_AST && cancel_flags & LCF_ASYNC &&
+		    ldlm_cli_cancel_batch(ns, lock, avail))
+			RETURN(0);
+		if (rc == LDLM_FL_BL_AST)
+			lprocfs_counter_incr(ns->ns_bl_cancel_stats,
+					     LDLM_BL_CANCEL_DIRECT);
+
+		list_add(&lock->l_bl_ast, &cancels);
 		lru_flags = ns_connect_lru_resize(ns) ?
 			LDLM_LRU_FLAG_LRUR : LDLM_LRU_FLAG_AGED;
 		count += ldlm_cancel_lru_local(ns, &cancels, 0, avail - 1,
 					       LCF_BL_AST, lru_flags);
+	} else {
+		list_add(&lock->l_bl_ast, &cancels);
 	}
 	ldlm_cli_cancel_list(&cancels, count, NULL, cancel_flags);
 	RETURN(0);
 }
 EXPORT_SYMBOL(ldlm_cli_cancel);
 
+/**
+ * Send the batched cancels in \a cancels, see ldlm_cli_cancel_batch().
+ *
+ * Unused locks from the LRU are added to fill the LDLM_CANCEL RPC, as
+ * ldlm_cli_cancel() does for a single lock.
+ */
+static void ldlm_cli_cancel_batch_send(struct ldlm_namespace *ns,
+				       struct list_head *cancels, int count)
+{
+	struct ldlm_lock *lock;
+	enum ldlm_lru_flags lru_flags;
+	int avail;
+
+	lock = list_entry(cancels->next, struct ldlm_lock, l_bl_ast);
+	avail = ldlm_format_handles_avail(class_exp2cliimp(lock->l_conn_export),
+					  &RQF_LDLM_CANCEL, RCL_CLIENT, 0);
+	if (count < avail) {
+		lru_flags = ns_connect_lru_resize(ns) ?
+			LDLM_LRU_FLAG_LRUR : LDLM_LRU_FLAG_AGED;
+		count += ldlm_cancel_lru_local(ns, cancels, 0, avail - count,
+					       LCF_BL_AST, lru_flags);
+	}
+
+	CDEBUG(D_DLMTRACE, "%s: sending %d batched cancels\n",
+	       ldlm_ns_name(ns), count);
+	lprocfs_counter_add(ns->ns_bl_cancel_stats, LDLM_BL_CANCEL_RPC, count);
+	ldlm_cli_cancel_list(cancels, count, NULL, LCF_ASYNC);
+}
+
+/*
+ * Longest time a cancel is held in the batch. The server evicts the client
+ * when the cancel does not come within the AST timeout, which is never
+ * below ldlm_enqueue_min seconds, so keep well clear of it.
+ */
+#define LDLM_BL_BATCH_AGE_MS	100
+
+static inline bool ldlm_cli_cancel_batch_old(ktime_t now, ktime_t since)
+{
+	return ktime_us_delta(now, since) >=
+	       LDLM_BL_BATCH_AGE_MS * USEC_PER_MSEC;
+}
+
+/* Take the whole batch of namespace \a ns to \a cancels, under ns_lock. */
+static int ldlm_cli_cancel_batch_take(struct ldlm_namespace *ns,
+				      struct list_head *cancels)
+{
+	int count = ns->ns_bl_cancel_count;
+
+	list_splice_init(&ns->ns_bl_cancels, cancels);
+	ns->ns_bl_cancel_count = 0;
+
+	return count;
+}
+
+/**
+ * Batch the cancel of \a lock, already cancelled locally in reply to a
+ * blocking AST, with the cancels of the blocking callbacks still queued to
+ * the blocking threads for namespace \a ns.
+ *
+ * When a resource is revoked the server sends blocking ASTs for all the
+ * locks of the client on it at once, so cancelling them one RPC per lock
+ * makes the revocation slow. The batch is sent when it fills an
+ * LDLM_CANCEL RPC of \a avail handles, when the last queued blocking
+ * callback of the namespace is done, see ldlm_cli_cancel_batch_done(), or
+ * at the latest LDLM_BL_BATCH_AGE_MS after its first cancel was added.
+ *
+ * Only cancels for a blocking AST received within LDLM_BL_BATCH_AGE_MS are
+ * batched: if the lock was still in use when the AST came, the server has
+ * been waiting for it already and the cancel is sent right away.
+ *
+ * \retval true	if the cancel is batched, the batch owns the lock
+ *			reference then
+ * \retval false	if the cancel is not batched, the caller has to send it
+ *			itself
+ */
+bool ldlm_cli_cancel_batch(struct ldlm_namespace *ns, struct ldlm_lock *lock,
+			   int avail)
+{
+	struct list_head cancels = LIST_HEAD_INIT(cancels);
+	ktime_t now = ktime_get();
+	bool first;
+	int count = 0;
+
+	if (ldlm_cli_cancel_batch_old(now, lock->l_bl_ast_time))
+		return false;
+
+	spin_lock(&ns->ns_lock);
+	if (ns->ns_bl_pending == 0 || ns->ns_stopping) {
+		spin_unlock(&ns->ns_lock);
+		return false;
+	}
+
+	list_add_tail(&lock->l_bl_ast, &ns->ns_bl_cancels);
+	lprocfs_counter_incr(ns->ns_bl_cancel_stats, LDLM_BL_CANCEL_BATCHED);
+	first = ns->ns_bl_cancel_count++ == 0;
+	if (first)
+		ns->ns_bl_cancel_start = now;
+	if (ns->ns_bl_cancel_count >= avail ||
+	    ldlm_cli_cancel_batch_old(now, ns->ns_bl_cancel_start))
+		count = ldlm_cli_cancel_batch_take(ns, &cancels);
+	spin_unlock(&ns->ns_lock);
+
+	if (count > 0)
+		ldlm_cli_cancel_batch_send(ns, &cancels, count);
+	else if (first)
+		schedule_delayed_work(&ns->ns_bl_cancel_work,
+				      msecs_to_jiffies(LDLM_BL_BATCH_AGE_MS));
+
+	return true;
+}
+
+/**
+ * Called by the blocking threads when a blocking callback queued by
+ * ldlm_bl_to_thread_lock() is done. The batched cancels are sent once there
+ * are no more blocking callbacks queued for namespace \a ns, or once the
+ * batch is LDLM_BL_BATCH_AGE_MS old.
+ */
+void ldlm_cli_cancel_batch_done(struct ldlm_namespace *ns)
+{
+	struct list_head cancels = LIST_HEAD_INIT(cancels);
+	int count = 0;
+
+	spin_lock(&ns->ns_lock);
+	LASSERT(ns->ns_bl_pending > 0);
+	if (--ns->ns_bl_pending == 0 ||
+	    ldlm_cli_cancel_batch_old(ktime_get(), ns->ns_bl_cancel_start))
+		count = ldlm_cli_cancel_batch_take(ns, &cancels);
+	spin_unlock(&ns->ns_lock);
+
+	if (count > 0)
+		ldlm_cli_cancel_batch_send(ns, &cancels, count);
+}
+
+/**
+ * Send the batched cancels of namespace \a ns now.
+ */
+void ldlm_cli_cancel_batch_flush(struct ldlm_namespace *ns)
+{
+	struct list_head cancels = LIST_HEAD_INIT(cancels);
+	int count;
+
+	spin_lock(&ns->ns_lock);
+	count = ldlm_cli_cancel_batch_take(ns, &cancels);
+	spin_unlock(&ns->ns_lock);
+
+	if (count > 0)
+		ldlm_cli_cancel_batch_send(ns, &cancels, count);
+}
+
+/* Sends the batch once it is LDLM_BL_BATCH_AGE_MS old, see ns_bl_cancel_work */
+void ldlm_cli_cancel_batch_work(struct work_struct *ws)
+{
+	struct ldlm_namespace *ns = container_of(ws, struct ldlm_namespace,
+						 ns_bl_cancel_work.work);
+
+	ldlm_cli_cancel_batch_flush(ns);
+}
+
 /**
  * Locally cancel up to \a count locks in list \a cancels.
  * Return the number of cancelled locks.
@@ -1858,34 +2024,66 @@ static int ldlm_prepare_lru_list(struct ldlm_namespace *ns,
 				 enum ldlm_lru_flags lru_flags)
 {
 	ldlm_cancel_lru_policy_t pf;
+	int nr_parts = cfs_percpt_number(ns->ns_lru);
 	int added = 0;
+	int scanned = 0;
+	int idle = 0;
+	int cpt = 0;
 	int no_wait = lru_flags & LDLM_LRU_FLAG_NO_WAIT;
 
 	ENTRY;
 
 	if (!ns_connect_lru_resize(ns))
-		count += ns->ns_nr_unused - ns->ns_max_unused;
+		count += atomic_read(&ns->ns_nr_unused) - ns->ns_max_unused;
 
 	pf = ldlm_cancel_lru_policy(ns, lru_flags);
 	LASSERT(pf != NULL);
 
-	/* For any flags, stop scanning if @max is reached. */
-	while (!list_empty(&ns->ns_unused_list) && (max == 0 || added < max)) {
+	/* The LRU parts of the CPTs are scanned in turn, one lock at a time,
+	 * so the least recently used locks of all CPTs go first. Stop once
+	 * none of the parts gave a lock to cancel in a whole round: a part
+	 * is empty, or its first lock is kept by the policy and the locks
+	 * after it were used more recently.
+	 * For any flags, stop scanning if @max is reached. */
+	for (; idle < nr_parts && (max == 0 || added < max);
+	     cpt = (cpt + 1) % nr_parts) {
+		struct ldlm_ns_lru *nl = ns->ns_lru[cpt];
 		struct ldlm_lock *lock;
 		struct list_head *item, *next;
 		enum ldlm_policy_res result;
 		ktime_t last_use = ktime_set(0, 0);
+		ktime_t start;
 
-		spin_lock(&ns->ns_lock);
-		item = no_wait ? ns->ns_last_pos : &ns->ns_unused_list;
+		idle++;
+		if (list_empty(&nl->nl_list))
+			continue;
+
+		spin_lock(&nl->nl_lock);
+		start = ktime_get();
+		item = no_wait ? nl->nl_last_pos : &nl->nl_list;
 		for (item = item->next, next = item->next;
-		     item != &ns->ns_unused_list;
+		     item != &nl->nl_list;
 		     item = next, next = item->next) {
 			lock = list_entry(item, struct ldlm_lock, l_lru);
+			scanned++;
 
 			/* No locks which got blocking requests. */
 			LASSERT(!ldlm_is_bl_ast(lock));
 
+			/* The lock was matched since it was added to the LRU,
+			 * give it a second chance at the LRU tail. It is seen
+			 * again unmarked if all the locks before it are kept,
+			 * so this pass always terminates. */
+			if (lock->l_lru_touched) {
+				lock->l_lru_touched = false;
+				if (nl->nl_last_pos == &lock->l_lru)
+					nl->nl_last_pos = lock->l_lru.prev;
+				list_move_tail(&lock->l_lru, &nl->nl_list);
+				lprocfs_counter_incr(ns->ns_lru_stats,
+						     LDLM_LRU_SECOND_CHANCE);
+				continue;
+			}
+
 			if (!ldlm_is_canceling(lock) ||
 			    !ldlm_is_converting(lock))
 				break;
@@ -1894,15 +2092,17 @@ static int ldlm_prepare_lru_list(struct ldlm_namespace *ns,
 			 * lock in LRU, do not traverse it again. */
 			ldlm_lock_remove_from_lru_nolock(lock);
 		}
-		if (item == &ns->ns_unused_list) {
-			spin_unlock(&ns->ns_lock);
-			break;
+		lprocfs_counter_add(ns->ns_lru_stats, LDLM_LRU_HOLD_TIME,
+				    ktime_us_delta(ktime_get(), start));
+		if (item == &nl->nl_list) {
+			spin_unlock(&nl->nl_lock);
+			continue;
 		}
 
 		last_use = lock->l_last_used;
 
 		LDLM_LOCK_GET(lock);
-		spin_unlock(&ns->ns_lock);
+		spin_unlock(&nl->nl_lock);
 		lu_ref_add(&lock->l_reference, __FUNCTION__, current);
 
 		/* Pass the lock through the policy filter and see if it
@@ -1918,22 +2118,24 @@ static int ldlm_prepare_lru_list(struct ldlm_namespace *ns,
 		 * old locks, but additionally choose them by
 		 * their weight. Big extent locks will stay in
 		 * the cache. */
-		result = pf(ns, lock, ns->ns_nr_unused, added, count);
+		result = pf(ns, lock, atomic_read(&ns->ns_nr_unused), added,
+			    count);
 		if (result == LDLM_POLICY_KEEP_LOCK) {
 			lu_ref_del(&lock->l_reference, __func__, current);
 			LDLM_LOCK_RELEASE(lock);
-			break;
+			continue;
 		}
 
+		idle = 0;
 		if (result == LDLM_POLICY_SKIP_LOCK) {
 			lu_ref_del(&lock->l_reference, __func__, current);
 			LDLM_LOCK_RELEASE(lock);
 			if (no_wait) {
-				spin_lock(&ns->ns_lock);
+				spin_lock(&nl->nl_lock);
 				if (!list_empty(&lock->l_lru) &&
-				    lock->l_lru.prev == ns->ns_last_pos)
-					ns->ns_last_pos = &lock->l_lru;
-				spin_unlock(&ns->ns_lock);
+				    lock->l_lru.prev == nl->nl_last_pos)
+					nl->nl_last_pos = &lock->l_lru;
+				spin_unlock(&nl->nl_lock);
 			}
 			continue;
 		}
@@ -1987,6 +2189,9 @@ static int ldlm_prepare_lru_list(struct ldlm_namespace *ns,
 		lu_ref_del(&lock->l_reference, __FUNCTION__, current);
 		added++;
 	}
+	if (scanned > 0)
+		lprocfs_counter_add(ns->ns_lru_stats, LDLM_LRU_SCANNED,
+				    scanned);
 	RETURN(added);
 }
 
@@ -2495,12 +2700,13 @@ static void ldlm_cancel_unused_locks_for_replay(struct ldlm_namespace *ns)
 
 	CDEBUG(D_DLMTRACE, "Dropping as many unused locks as possible before"
 			   "replay for namespace %s (%d)\n",
-			   ldlm_ns_name(ns), ns->ns_nr_unused);
+			   ldlm_ns_name(ns), atomic_read(&ns->ns_nr_unused));
 
 	/* We don't need to care whether or not LRU resize is enabled
 	 * because the LDLM_LRU_FLAG_NO_WAIT policy doesn't use the
 	 * count parameter */
-	canceled = ldlm_cancel_lru_local(ns, &cancels, ns->ns_nr_unused, 0,
+	canceled = ldlm_cancel_lru_local(ns, &cancels,
+					 atomic_read(&ns->ns_nr_unused), 0,
 					 LCF_LOCAL, LDLM_LRU_FLAG_NO_WAIT);
 
 	CDEBUG(D_DLMTRACE, "Canceled %d unused locks from namespace %s\n",
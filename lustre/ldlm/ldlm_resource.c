@@ -36,6 +36,7 @@
  */
 
 #define DEBUG_SUBSYSTEM S_LDLM
+#include <linux/kthread.h>
 #include <lustre_dlm.h>
 #include <lustre_fid.h>
 #include <obd_class.h>
@@ -195,6 +196,200 @@ static const struct file_operations ldlm_granted_fops = {
 	.release = seq_release,
 };
 
+/* largest number of threads and lookups per thread of one lookup_bench run */
+#define LDLM_LOOKUP_BENCH_THREADS	256
+#define LDLM_LOOKUP_BENCH_COUNT		100000
+/* number of resources all the lookup_bench threads look up */
+#define LDLM_LOOKUP_BENCH_RES		16
+
+struct ldlm_lookup_bench {
+	struct ldlm_namespace	*lb_ns;
+	struct ldlm_resource	*lb_res[LDLM_LOOKUP_BENCH_RES];
+	unsigned int		 lb_count;
+	/* look up under the hash bucket lock instead of under RCU */
+	bool			 lb_locked;
+	atomic_t		 lb_running;
+	struct completion	 lb_start;
+	struct completion	 lb_done;
+};
+
+static DEFINE_MUTEX(ldlm_lookup_bench_mutex);
+static char ldlm_lookup_bench_result[256];
+
+static int ldlm_lookup_bench_thread(void *arg)
+{
+	struct ldlm_lookup_bench *lb = arg;
+	struct cfs_hash *hs = lb->lb_ns->ns_rs_hash;
+	struct ldlm_resource *res;
+	struct hlist_node *hnode;
+	struct cfs_hash_bd bd;
+	unsigned int i;
+
+	wait_for_completion(&lb->lb_start);
+
+	for (i = 0; i < lb->lb_count; i++) {
+		struct ldlm_res_id *name;
+
+		name = &lb->lb_res[i % LDLM_LOOKUP_BENCH_RES]->lr_name;
+		if (lb->lb_locked) {
+			cfs_hash_bd_get_and_lock(hs, name, &bd, 0);
+			hnode = cfs_hash_bd_lookup_locked(hs, &bd, name);
+			cfs_hash_bd_unlock(hs, &bd, 0);
+			res = hnode == NULL ? NULL :
+			      hlist_entry(hnode, struct ldlm_resource, lr_hash);
+		} else {
+			res = ldlm_resource_get(lb->lb_ns, NULL, name, 0, 0);
+		}
+		/* the bench holds a reference, so this never frees it */
+		if (!IS_ERR_OR_NULL(res))
+			ldlm_resource_putref(res);
+
+		if ((i & 1023) == 1023)
+			cond_resched();
+	}
+
+	if (atomic_dec_and_test(&lb->lb_running))
+		complete(&lb->lb_done);
+
+	return 0;
+}
+
+/**
+ * Time \a count lookups of LDLM_LOOKUP_BENCH_RES resources of \a lb by each
+ * of \a threads threads running at once.
+ *
+ * \retval wall clock nanoseconds of the whole run, or negative errno
+ */
+static s64 ldlm_lookup_bench_run(struct ldlm_lookup_bench *lb,
+				 unsigned int threads, bool locked)
+{
+	struct task_struct *task;
+	ktime_t start;
+	unsigned int i;
+	int rc = 0;
+
+	lb->lb_locked = locked;
+	/* one count for this thread, so lb_done waits for the start */
+	atomic_set(&lb->lb_running, 1);
+	init_completion(&lb->lb_start);
+	init_completion(&lb->lb_done);
+
+	for (i = 0; i < threads; i++) {
+		atomic_inc(&lb->lb_running);
+		task = kthread_run(ldlm_lookup_bench_thread, lb,
+				   "ldlm_bench_%02u", i);
+		if (IS_ERR(task)) {
+			atomic_dec(&lb->lb_running);
+			rc = PTR_ERR(task);
+			break;
+		}
+	}
+
+	start = ktime_get();
+	complete_all(&lb->lb_start);
+	if (!atomic_dec_and_test(&lb->lb_running))
+		wait_for_completion(&lb->lb_done);
+
+	return rc ? rc : ktime_to_ns(ktime_sub(ktime_get(), start));
+}
+
+static int ldlm_lookup_bench_seq_show(struct seq_file *m, void *v)
+{
+	mutex_lock(&ldlm_lookup_bench_mutex);
+	seq_puts(m, ldlm_lookup_bench_result);
+	mutex_unlock(&ldlm_lookup_bench_mutex);
+	return 0;
+}
+
+/*
+ * Writing "<namespace> <threads> [count]" times \a count resource lookups
+ * by each of \a threads threads in a server namespace, first lockless as
+ * ldlm_resource_get() does, then under the hash bucket lock as it did
+ * before. Reading shows the nanoseconds each thread spent per lookup, which
+ * stay flat as threads are added if lookups scale.
+ */
+static ssize_t ldlm_lookup_bench_seq_write(struct file *file,
+					   const char __user *buffer,
+					   size_t count, loff_t *off)
+{
+	struct ldlm_lookup_bench *lb;
+	struct ldlm_namespace *ns;
+	struct ldlm_res_id name = { .name = { -1ULL } };
+	unsigned int threads;
+	unsigned int lookups = 1000;
+	char kbuf[96];
+	char nsname[64];
+	s64 rcu_ns;
+	s64 locked_ns;
+	int rc;
+	int i;
+
+	if (count >= sizeof(kbuf))
+		return -EINVAL;
+	if (copy_from_user(kbuf, buffer, count))
+		return -EFAULT;
+	kbuf[count] = '\0';
+
+	rc = sscanf(kbuf, "%63s %u %u", nsname, &threads, &lookups);
+	if (rc < 2 || threads == 0 || threads > LDLM_LOOKUP_BENCH_THREADS ||
+	    lookups == 0 || lookups > LDLM_LOOKUP_BENCH_COUNT)
+		return -EINVAL;
+
+	OBD_ALLOC_PTR(lb);
+	if (lb == NULL)
+		return -ENOMEM;
+
+	mutex_lock(&ldlm_lookup_bench_mutex);
+
+	mutex_lock(ldlm_namespace_lock(LDLM_NAMESPACE_SERVER));
+	list_for_each_entry(ns, ldlm_namespace_list(LDLM_NAMESPACE_SERVER),
+			    ns_list_chain) {
+		if (strcmp(ldlm_ns_name(ns), nsname) == 0) {
+			ldlm_namespace_get(ns);
+			lb->lb_ns = ns;
+			break;
+		}
+	}
+	mutex_unlock(ldlm_namespace_lock(LDLM_NAMESPACE_SERVER));
+	if (lb->lb_ns == NULL)
+		GOTO(out, rc = -ENOENT);
+
+	lb->lb_count = lookups;
+	for (i = 0; i < LDLM_LOOKUP_BENCH_RES; i++) {
+		name.name[1] = i + 1;
+		lb->lb_res[i] = ldlm_resource_get(lb->lb_ns, NULL, &name,
+						  LDLM_PLAIN, 1);
+		if (IS_ERR(lb->lb_res[i])) {
+			rc = PTR_ERR(lb->lb_res[i]);
+			lb->lb_res[i] = NULL;
+			GOTO(out_res, rc);
+		}
+	}
+
+	rcu_ns = ldlm_lookup_bench_run(lb, threads, false);
+	if (rcu_ns < 0)
+		GOTO(out_res, rc = rcu_ns);
+	locked_ns = ldlm_lookup_bench_run(lb, threads, true);
+	if (locked_ns < 0)
+		GOTO(out_res, rc = locked_ns);
+
+	snprintf(ldlm_lookup_bench_result, sizeof(ldlm_lookup_bench_result),
+		 "namespace: %s\nthreads: %u\ncount: %u\nrcu_ns: %llu\n"
+		 "locked_ns: %llu\n", nsname, threads, lookups,
+		 div_u64(rcu_ns, lookups), div_u64(locked_ns, lookups));
+	rc = count;
+out_res:
+	for (i = 0; i < LDLM_LOOKUP_BENCH_RES && lb->lb_res[i] != NULL; i++)
+		ldlm_resource_putref(lb->lb_res[i]);
+	ldlm_namespace_put(lb->lb_ns);
+out:
+	mutex_unlock(&ldlm_lookup_bench_mutex);
+	OBD_FREE_PTR(lb);
+	return rc;
+}
+
+LDEBUGFS_SEQ_FOPS(ldlm_lookup_bench);
+
 #endif /* HAVE_SERVER_SUPPORT */
 
 static struct lprocfs_vars ldlm_debugfs_list[] = {
@@ -214,6 +409,8 @@ static struct lprocfs_vars ldlm_debugfs_list[] = {
 	{ .name =	"lock_granted_count",
 	  .fops =	&ldlm_granted_fops,
 	  .data =	&ldlm_granted_total },
+	{ .name =	"lookup_bench",
+	  .fops =	&ldlm_lookup_bench_fops },
 #endif
 	{ NULL }
 };
@@ -325,7 +522,7 @@ static ssize_t lock_unused_count_show(struct kobject *kobj,
 	struct ldlm_namespace *ns = container_of(kobj, struct ldlm_namespace,
 						 ns_kobj);
 
-	return sprintf(buf, "%d\n", ns->ns_nr_unused);
+	return sprintf(buf, "%d\n", atomic_read(&ns->ns_nr_unused));
 }
 LUSTRE_RO_ATTR(lock_unused_count);
 
@@ -334,11 +531,11 @@ static ssize_t lru_size_show(struct kobject *kobj, struct attribute *attr,
 {
 	struct ldlm_namespace *ns = container_of(kobj, struct ldlm_namespace,
 						 ns_kobj);
-	__u32 *nr = &ns->ns_max_unused;
+	__u32 nr = ns->ns_max_unused;
 
 	if (ns_connect_lru_resize(ns))
-		nr = &ns->ns_nr_unused;
-	return sprintf(buf, "%u\n", *nr);
+		nr = atomic_read(&ns->ns_nr_unused);
+	return sprintf(buf, "%u\n", nr);
 }
 
 static ssize_t lru_size_store(struct kobject *kobj, struct attribute *attr,
@@ -356,7 +553,7 @@ static ssize_t lru_size_store(struct kobject *kobj, struct attribute *attr,
                        ldlm_ns_name(ns));
                 if (ns_connect_lru_resize(ns)) {
 			/* Try to cancel all @ns_nr_unused locks. */
-			ldlm_cancel_lru(ns, ns->ns_nr_unused, 0,
+			ldlm_cancel_lru(ns, atomic_read(&ns->ns_nr_unused), 0,
 					LDLM_LRU_FLAG_PASSED |
 					LDLM_LRU_FLAG_CLEANUP);
 		} else {
@@ -377,17 +574,18 @@ static ssize_t lru_size_store(struct kobject *kobj, struct attribute *attr,
 	lru_resize = (tmp == 0);
 
 	if (ns_connect_lru_resize(ns)) {
+		unsigned int unused = atomic_read(&ns->ns_nr_unused);
+
 		if (!lru_resize)
 			ns->ns_max_unused = (unsigned int)tmp;
 
-		if (tmp > ns->ns_nr_unused)
-			tmp = ns->ns_nr_unused;
-		tmp = ns->ns_nr_unused - tmp;
+		if (tmp > unused)
+			tmp = unused;
+		tmp = unused - tmp;
 
 		CDEBUG(D_DLMTRACE,
 		       "changing namespace %s unused locks from %u to %u\n",
-		       ldlm_ns_name(ns), ns->ns_nr_unused,
-		       (unsigned int)tmp);
+		       ldlm_ns_name(ns), unused, (unsigned int)tmp);
 		ldlm_cancel_lru(ns, tmp, LCF_ASYNC, LDLM_LRU_FLAG_PASSED);
 
 		if (!lru_resize) {
@@ -663,6 +861,38 @@ static ssize_t max_parallel_ast_store(struct kobject *kobj,
 }
 LUSTRE_RW_ATTR(max_parallel_ast);
 
+static ssize_t ibits_index_min_scan_show(struct kobject *kobj,
+					 struct attribute *attr, char *buf)
+{
+	struct ldlm_namespace *ns = container_of(kobj, struct ldlm_namespace,
+						 ns_kobj);
+
+	return sprintf(buf, "%u\n", ns->ns_ibits_index_min_scan);
+}
+
+static ssize_t ibits_index_min_scan_store(struct kobject *kobj,
+					  struct attribute *attr,
+					  const char *buffer, size_t count)
+{
+	struct ldlm_namespace *ns = container_of(kobj, struct ldlm_namespace,
+						 ns_kobj);
+	unsigned long tmp;
+	int err;
+
+	err = kstrtoul(buffer, 10, &tmp);
+	if (err != 0)
+		return -EINVAL;
+
+	/* the index is only worth it when the granted queue is not short */
+	if (tmp == 0)
+		return -ERANGE;
+
+	ns->ns_ibits_index_min_scan = tmp;
+
+	return count;
+}
+LUSTRE_RW_ATTR(ibits_index_min_scan);
+
 #endif /* HAVE_SERVER_SUPPORT */
 
 /* These are for namespaces in /sys/fs/lustre/ldlm/namespaces/ */
@@ -681,6 +911,7 @@ static struct attribute *ldlm_ns_attrs[] = {
 	&lustre_attr_contention_seconds.attr,
 	&lustre_attr_contended_locks.attr,
 	&lustre_attr_max_parallel_ast.attr,
+	&lustre_attr_ibits_index_min_scan.attr,
 #endif
 	NULL,
 };
@@ -708,6 +939,12 @@ static void ldlm_namespace_debugfs_unregister(struct ldlm_namespace *ns)
 
 	if (ns->ns_stats != NULL)
 		lprocfs_free_stats(&ns->ns_stats);
+	if (ns->ns_lru_stats != NULL)
+		lprocfs_free_stats(&ns->ns_lru_stats);
+	if (ns->ns_ibits_stats != NULL)
+		lprocfs_free_stats(&ns->ns_ibits_stats);
+	if (ns->ns_bl_cancel_stats != NULL)
+		lprocfs_free_stats(&ns->ns_bl_cancel_stats);
 }
 
 void ldlm_namespace_sysfs_unregister(struct ldlm_namespace *ns)
@@ -734,12 +971,63 @@ int ldlm_namespace_sysfs_register(struct ldlm_namespace *ns)
 	lprocfs_counter_init(ns->ns_stats, LDLM_NSS_LOCKS,
 			     LPROCFS_CNTR_AVGMINMAX, "locks", "locks");
 
+	ns->ns_lru_stats = lprocfs_alloc_stats(LDLM_LRU_LAST, 0);
+	if (!ns->ns_lru_stats) {
+		lprocfs_free_stats(&ns->ns_stats);
+		kobject_put(&ns->ns_kobj);
+		return -ENOMEM;
+	}
+
+	lprocfs_counter_init(ns->ns_lru_stats, LDLM_LRU_SCANNED,
+			     LPROCFS_CNTR_AVGMINMAX, "lru_scanned", "locks");
+	lprocfs_counter_init(ns->ns_lru_stats, LDLM_LRU_HOLD_TIME,
+			     LPROCFS_CNTR_AVGMINMAX, "lru_hold_time", "usec");
+	lprocfs_counter_init(ns->ns_lru_stats, LDLM_LRU_SECOND_CHANCE,
+			     0, "lru_second_chance", "locks");
+
+	ns->ns_ibits_stats = lprocfs_alloc_stats(LDLM_IBITS_LAST, 0);
+	if (!ns->ns_ibits_stats) {
+		lprocfs_free_stats(&ns->ns_lru_stats);
+		lprocfs_free_stats(&ns->ns_stats);
+		kobject_put(&ns->ns_kobj);
+		return -ENOMEM;
+	}
+
+	lprocfs_counter_init(ns->ns_ibits_stats, LDLM_IBITS_INDEX_BUILT,
+			     0, "index_built", "resources");
+	lprocfs_counter_init(ns->ns_ibits_stats, LDLM_IBITS_INDEX_COMPAT,
+			     0, "index_compat", "checks");
+	lprocfs_counter_init(ns->ns_ibits_stats, LDLM_IBITS_INDEX_CONFLICT,
+			     0, "index_conflict", "checks");
+	lprocfs_counter_init(ns->ns_ibits_stats, LDLM_IBITS_INDEX_WALK,
+			     0, "index_walk", "checks");
+	lprocfs_counter_init(ns->ns_ibits_stats, LDLM_IBITS_SCANNED,
+			     LPROCFS_CNTR_AVGMINMAX, "granted_scanned",
+			     "groups");
+
+	ns->ns_bl_cancel_stats = lprocfs_alloc_stats(LDLM_BL_CANCEL_LAST, 0);
+	if (!ns->ns_bl_cancel_stats) {
+		lprocfs_free_stats(&ns->ns_ibits_stats);
+		lprocfs_free_stats(&ns->ns_lru_stats);
+		lprocfs_free_stats(&ns->ns_stats);
+		kobject_put(&ns->ns_kobj);
+		return -ENOMEM;
+	}
+
+	lprocfs_counter_init(ns->ns_bl_cancel_stats, LDLM_BL_CANCEL_BATCHED,
+			     0, "batched", "locks");
+	lprocfs_counter_init(ns->ns_bl_cancel_stats, LDLM_BL_CANCEL_DIRECT,
+			     0, "direct", "locks");
+	lprocfs_counter_init(ns->ns_bl_cancel_stats, LDLM_BL_CANCEL_RPC,
+			     LPROCFS_CNTR_AVGMINMAX, "batch_rpc", "locks");
+
 	return err;
 }
 
 static int ldlm_namespace_debugfs_register(struct ldlm_namespace *ns)
 {
 	struct dentry *ns_entry;
+	int rc;
 
 	if (!IS_ERR_OR_NULL(ns->ns_debugfs_entry)) {
 		ns_entry = ns->ns_debugfs_entry;
@@ -751,7 +1039,17 @@ static int ldlm_namespace_debugfs_register(struct ldlm_namespace *ns)
 		ns->ns_debugfs_entry = ns_entry;
 	}
 
-	return 0;
+	rc = ldebugfs_register_stats(ns_entry, "lru_stats", ns->ns_lru_stats);
+	if (rc)
+		return rc;
+
+	rc = ldebugfs_register_stats(ns_entry, "ibits_stats",
+				     ns->ns_ibits_stats);
+	if (rc)
+		return rc;
+
+	return ldebugfs_register_stats(ns_entry, "bl_cancel_stats",
+				       ns->ns_bl_cancel_stats);
 }
 #undef MAX_STRING_SIZE
 
@@ -862,6 +1160,8 @@ typedef struct ldlm_ns_hash_def {
 	unsigned		nsd_bkt_bits;
 	/** hash bits */
 	unsigned		nsd_all_bits;
+	/** if non-zero, size hash by memory up to so many bits */
+	unsigned		nsd_max_bits;
 	/** hash operations */
 	struct cfs_hash_ops *nsd_hops;
 } ldlm_ns_hash_def_t;
@@ -878,6 +1178,7 @@ static struct ldlm_ns_hash_def ldlm_ns_hash_defs[] =
                 .nsd_type       = LDLM_NS_TYPE_MDT,
                 .nsd_bkt_bits   = 14,
                 .nsd_all_bits   = 21,
+		.nsd_max_bits	= 22,
                 .nsd_hops       = &ldlm_ns_fid_hash_ops,
         },
         {
@@ -890,6 +1191,7 @@ static struct ldlm_ns_hash_def ldlm_ns_hash_defs[] =
                 .nsd_type       = LDLM_NS_TYPE_OST,
                 .nsd_bkt_bits   = 11,
                 .nsd_all_bits   = 17,
+		.nsd_max_bits	= 18,
                 .nsd_hops       = &ldlm_ns_hash_ops,
         },
         {
@@ -909,6 +1211,36 @@ static struct ldlm_ns_hash_def ldlm_ns_hash_defs[] =
         },
 };
 
+/*
+ * hash heads of a server namespace may use 1/4096 of the memory, capped
+ * by nsd_max_bits at 64MB for an MDT and 4MB for an OST
+ */
+#define LDLM_NS_HASH_MEM_SHIFT	12
+
+/**
+ * Pick the hash size of a new namespace. Client namespaces use the fixed
+ * nsd_all_bits, since a client has a namespace per target. The resource
+ * hash of a server namespace is sized by the memory of the node, which
+ * also bounds the number of locks and resources it can grant, see
+ * ldlm_reclaim_threshold.
+ */
+static unsigned int ldlm_ns_hash_bits(struct ldlm_ns_hash_def *nsd)
+{
+	unsigned long heads;
+	unsigned int bits;
+
+	if (nsd->nsd_max_bits == 0)
+		return nsd->nsd_all_bits;
+
+	/* a hash head with depth takes about two words */
+	heads = ((unsigned long)NUM_CACHEPAGES << PAGE_SHIFT) >>
+		LDLM_NS_HASH_MEM_SHIFT;
+	heads /= 2 * sizeof(void *);
+	bits = heads > 1 ? ilog2(heads) : 1;
+
+	return clamp(bits, nsd->nsd_bkt_bits, nsd->nsd_max_bits);
+}
+
 /**
  * Create and initialize new empty namespace.
  */
@@ -920,7 +1252,9 @@ struct ldlm_namespace *ldlm_namespace_new(struct obd_device *obd, char *name,
 	struct ldlm_namespace *ns = NULL;
 	struct ldlm_ns_bucket *nsb;
 	struct ldlm_ns_hash_def *nsd;
+	struct ldlm_ns_lru *nl;
 	struct cfs_hash_bd bd;
+	unsigned int bits;
 	int idx;
 	int rc;
 	ENTRY;
@@ -948,8 +1282,13 @@ struct ldlm_namespace *ldlm_namespace_new(struct obd_device *obd, char *name,
         if (!ns)
                 GOTO(out_ref, NULL);
 
-        ns->ns_rs_hash = cfs_hash_create(name,
-                                         nsd->nsd_all_bits, nsd->nsd_all_bits,
+	bits = ldlm_ns_hash_bits(nsd);
+	CDEBUG(D_INFO, "%s: resource hash of %u bits\n", name, bits);
+
+	/* The hash isn't rehashed at runtime: a rehash would take the
+	 * hash-wide lock on every lookup, and moves resources away from
+	 * the ldlm_ns_bucket they refer to by lr_ns_bucket. */
+        ns->ns_rs_hash = cfs_hash_create(name, bits, bits,
                                          nsd->nsd_bkt_bits, sizeof(*nsb),
                                          CFS_HASH_MIN_THETA,
                                          CFS_HASH_MAX_THETA,
@@ -968,6 +1307,16 @@ struct ldlm_namespace *ldlm_namespace_new(struct obd_device *obd, char *name,
 		nsb->nsb_reclaim_start = 0;
         }
 
+	ns->ns_lru = cfs_percpt_alloc(cfs_cpt_tab, sizeof(*nl));
+	if (!ns->ns_lru)
+		GOTO(out_hash, NULL);
+
+	cfs_percpt_for_each(nl, idx, ns->ns_lru) {
+		spin_lock_init(&nl->nl_lock);
+		INIT_LIST_HEAD(&nl->nl_list);
+		nl->nl_last_pos = &nl->nl_list;
+	}
+
 	ns->ns_obd = obd;
 	ns->ns_appetite = apt;
 	ns->ns_client = client;
@@ -976,7 +1325,8 @@ struct ldlm_namespace *ldlm_namespace_new(struct obd_device *obd, char *name,
 		goto out_hash;
 
 	INIT_LIST_HEAD(&ns->ns_list_chain);
-	INIT_LIST_HEAD(&ns->ns_unused_list);
+	INIT_LIST_HEAD(&ns->ns_bl_cancels);
+	INIT_DELAYED_WORK(&ns->ns_bl_cancel_work, ldlm_cli_cancel_batch_work);
 	spin_lock_init(&ns->ns_lock);
 	atomic_set(&ns->ns_bref, 0);
 	init_waitqueue_head(&ns->ns_waitq);
@@ -986,7 +1336,8 @@ struct ldlm_namespace *ldlm_namespace_new(struct obd_device *obd, char *name,
 	ns->ns_contended_locks    = NS_DEFAULT_CONTENDED_LOCKS;
 
         ns->ns_max_parallel_ast   = LDLM_DEFAULT_PARALLEL_AST_LIMIT;
-        ns->ns_nr_unused          = 0;
+	ns->ns_ibits_index_min_scan = LDLM_IBITS_INDEX_MIN_SCAN;
+	atomic_set(&ns->ns_nr_unused, 0);
         ns->ns_max_unused         = LDLM_DEFAULT_LRU_SIZE;
 	ns->ns_max_age            = ktime_set(LDLM_DEFAULT_MAX_ALIVE, 0);
         ns->ns_ctime_age_limit    = LDLM_CTIME_AGE_LIMIT;
@@ -996,7 +1347,6 @@ struct ldlm_namespace *ldlm_namespace_new(struct obd_device *obd, char *name,
         ns->ns_connect_flags      = 0;
         ns->ns_stopping           = 0;
 	ns->ns_reclaim_start	  = 0;
-	ns->ns_last_pos		  = &ns->ns_unused_list;
 
 	rc = ldlm_namespace_sysfs_register(ns);
 	if (rc) {
@@ -1007,7 +1357,7 @@ struct ldlm_namespace *ldlm_namespace_new(struct obd_device *obd, char *name,
 	rc = ldlm_namespace_debugfs_register(ns);
 	if (rc) {
 		CERROR("Can't initialize ns proc, rc %d\n", rc);
-		GOTO(out_sysfs, rc);
+		GOTO(out_proc, rc);
 	}
 
         idx = ldlm_namespace_nr_read(client);
@@ -1026,6 +1376,8 @@ out_sysfs:
 	ldlm_namespace_cleanup(ns, 0);
 out_hash:
 	kfree(ns->ns_name);
+	if (ns->ns_lru)
+		cfs_percpt_free(ns->ns_lru);
 	cfs_hash_putref(ns->ns_rs_hash);
 out_ns:
         OBD_FREE_PTR(ns);
@@ -1247,6 +1599,10 @@ void ldlm_namespace_free_prior(struct ldlm_namespace *ns,
 	ns->ns_stopping = 1;
 	spin_unlock(&ns->ns_lock);
 
+	/* batched cancels hold references on their locks */
+	cancel_delayed_work_sync(&ns->ns_bl_cancel_work);
+	ldlm_cli_cancel_batch_flush(ns);
+
         /*
          * Can fail with -EINTR when force == 0 in which case try harder.
          */
@@ -1291,6 +1647,7 @@ void ldlm_namespace_free_post(struct ldlm_namespace *ns)
 	ldlm_namespace_debugfs_unregister(ns);
 	ldlm_namespace_sysfs_unregister(ns);
 	cfs_hash_putref(ns->ns_rs_hash);
+	cfs_percpt_free(ns->ns_lru);
 	kfree(ns->ns_name);
 	/* Namespace \a ns should be not on list at this time, otherwise
 	 * this will cause issues related to using freed \a ns in poold
@@ -1440,6 +1797,68 @@ static struct ldlm_resource *ldlm_resource_new(enum ldlm_type ldlm_type)
 	return res;
 }
 
+static void ldlm_resource_free_rcu(struct rcu_head *head)
+{
+	struct ldlm_resource *res = container_of(head, struct ldlm_resource,
+						 lr_rcu);
+
+	OBD_SLAB_FREE(res, ldlm_resource_slab, sizeof(*res));
+}
+
+/**
+ * Free resource \a res along with the lock type specific data. The
+ * resource itself is freed after an RCU grace period, as it may still
+ * be seen by a lockless lookup in ldlm_resource_get().
+ */
+static void ldlm_resource_free(struct ldlm_resource *res)
+{
+	if (res->lr_type == LDLM_EXTENT) {
+		if (res->lr_itree != NULL)
+			OBD_SLAB_FREE(res->lr_itree, ldlm_interval_tree_slab,
+				      sizeof(*res->lr_itree) * LCK_MODE_NUM);
+	} else if (res->lr_type == LDLM_IBITS) {
+		if (res->lr_ibits != NULL)
+			OBD_FREE_PTR(res->lr_ibits);
+	}
+	call_rcu(&res->lr_rcu, ldlm_resource_free_rcu);
+}
+
+/**
+ * Find resource \a name in the namespace hash without taking the hash
+ * bucket lock. Only a resource still referenced by somebody else can be
+ * found, i.e. one whose refcount can be taken from non-zero; a resource
+ * being released is left to the locked lookup.
+ *
+ * A chain walk may end early if it meets a resource unlinked in the
+ * meantime, so a NULL return only means the caller has to retry under
+ * the bucket lock.
+ */
+static struct ldlm_resource *
+ldlm_resource_lookup_rcu(struct ldlm_namespace *ns,
+			 const struct ldlm_res_id *name)
+{
+	struct ldlm_resource *res;
+	struct cfs_hash_bd bd;
+
+	cfs_hash_bd_get(ns->ns_rs_hash, (void *)name, &bd);
+
+	rcu_read_lock();
+	hlist_for_each_entry_rcu(res, cfs_hash_bd_hhead(ns->ns_rs_hash, &bd),
+				 lr_hash) {
+		if (!ldlm_res_eq(&res->lr_name, name))
+			continue;
+
+		if (!atomic_inc_not_zero(&res->lr_refcount))
+			break;
+
+		rcu_read_unlock();
+		return res;
+	}
+	rcu_read_unlock();
+
+	return NULL;
+}
+
 /**
  * Return a reference to resource with given name, creating it if necessary.
  * Args: namespace with ns_lock unlocked
@@ -1462,6 +1881,10 @@ ldlm_resource_get(struct ldlm_namespace *ns, struct ldlm_resource *parent,
         LASSERT(ns->ns_rs_hash != NULL);
         LASSERT(name->name[0] != 0);
 
+	res = ldlm_resource_lookup_rcu(ns, name);
+	if (res != NULL)
+		return res;
+
         cfs_hash_bd_get_and_lock(ns->ns_rs_hash, (void *)name, &bd, 0);
         hnode = cfs_hash_bd_lookup_locked(ns->ns_rs_hash, &bd, (void *)name);
         if (hnode != NULL) {
@@ -1494,10 +1917,7 @@ ldlm_resource_get(struct ldlm_namespace *ns, struct ldlm_resource *parent,
 		cfs_hash_bd_unlock(ns->ns_rs_hash, &bd, 1);
 		/* Clean lu_ref for failed resource. */
 		lu_ref_fini(&res->lr_reference);
-		if (res->lr_itree != NULL)
-			OBD_SLAB_FREE(res->lr_itree, ldlm_interval_tree_slab,
-				      sizeof(*res->lr_itree) * LCK_MODE_NUM);
-		OBD_SLAB_FREE(res, ldlm_resource_slab, sizeof *res);
+		ldlm_resource_free(res);
 found:
 		res = hlist_entry(hnode, struct ldlm_resource, lr_hash);
 		return res;
@@ -1573,10 +1993,7 @@ int ldlm_resource_putref(struct ldlm_resource *res)
 		cfs_hash_bd_unlock(ns->ns_rs_hash, &bd, 1);
 		if (ns->ns_lvbo && ns->ns_lvbo->lvbo_free)
 			ns->ns_lvbo->lvbo_free(res);
-		if (res->lr_itree != NULL)
-			OBD_SLAB_FREE(res->lr_itree, ldlm_interval_tree_slab,
-				      sizeof(*res->lr_itree) * LCK_MODE_NUM);
-		OBD_SLAB_FREE(res, ldlm_resource_slab, sizeof *res);
+		ldlm_resource_free(res);
 		return 1;
 	}
 	return 0;
@@ -1738,6 +2155,9 @@ void ldlm_resource_dump(int level, struct ldlm_resource *res)
                 }
         }
 
+	if (res->lr_type == LDLM_IBITS)
+		ldlm_ibits_index_dump(level, res);
+
 	if (!list_empty(&res->lr_waiting)) {
 		CDEBUG(level, "Waiting locks:\n");
 		list_for_each_entry(lock, &res->lr_waiting, l_res_link)
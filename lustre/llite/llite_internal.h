@@ -532,6 +532,8 @@ struct ll_sb_info {
 	atomic_t		  ll_sa_running; /* running statahead thread
 						  * count */
 	atomic_t		  ll_agl_total;  /* AGL thread started count */
+	atomic_t		  ll_agl_glimpse; /* AGL glimpses sent */
+	atomic_t		  ll_agl_skipped; /* AGL entries not glimpsed */
 
 	dev_t			  ll_sdev_orig; /* save s_dev before assign for
 						 * clustred nfs */
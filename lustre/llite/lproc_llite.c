@@ -762,10 +762,14 @@ static int ll_statahead_stats_seq_show(struct seq_file *m, void *v)
 
 	seq_printf(m, "statahead total: %u\n"
 		    "statahead wrong: %u\n"
-		    "agl total: %u\n",
+		    "agl total: %u\n"
+		    "agl glimpse: %u\n"
+		    "agl skipped: %u\n",
 		    atomic_read(&sbi->ll_sa_total),
 		    atomic_read(&sbi->ll_sa_wrong),
-		    atomic_read(&sbi->ll_agl_total));
+		    atomic_read(&sbi->ll_agl_total),
+		    atomic_read(&sbi->ll_agl_glimpse),
+		    atomic_read(&sbi->ll_agl_skipped));
 	return 0;
 }
 LPROC_SEQ_FOPS_RO(ll_statahead_stats);
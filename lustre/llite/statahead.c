@@ -493,6 +493,7 @@ static void ll_sai_put(struct ll_statahead_info *sai)
 static void ll_agl_trigger(struct inode *inode, struct ll_statahead_info *sai)
 {
 	struct ll_inode_info *lli = ll_i2info(inode);
+	struct ll_sb_info *sbi = ll_i2sbi(inode);
 	u64 index = lli->lli_agl_index;
 	ktime_t expire;
 	int rc;
@@ -502,6 +503,7 @@ static void ll_agl_trigger(struct inode *inode, struct ll_statahead_info *sai)
 
         /* AGL maybe fall behind statahead with one entry */
         if (is_omitted_entry(sai, index + 1)) {
+                atomic_inc(&sbi->ll_agl_skipped);
                 lli->lli_agl_index = 0;
                 iput(inode);
                 RETURN_EXIT;
@@ -514,6 +516,7 @@ static void ll_agl_trigger(struct inode *inode, struct ll_statahead_info *sai)
 	 * the MDT holds the layout lock so the glimpse will block up to the
 	 * end of restore (statahead/agl will block) */
 	if (ll_file_test_flag(lli, LLIF_FILE_RESTORING)) {
+		atomic_inc(&sbi->ll_agl_skipped);
 		lli->lli_agl_index = 0;
 		iput(inode);
 		RETURN_EXIT;
@@ -522,6 +525,7 @@ static void ll_agl_trigger(struct inode *inode, struct ll_statahead_info *sai)
         /* Someone is in glimpse (sync or async), do nothing. */
 	rc = down_write_trylock(&lli->lli_glimpse_sem);
         if (rc == 0) {
+                atomic_inc(&sbi->ll_agl_skipped);
                 lli->lli_agl_index = 0;
                 iput(inode);
                 RETURN_EXIT;
@@ -544,6 +548,7 @@ static void ll_agl_trigger(struct inode *inode, struct ll_statahead_info *sai)
 	if (ktime_to_ns(lli->lli_glimpse_time) &&
 	    ktime_before(expire, lli->lli_glimpse_time)) {
 		up_write(&lli->lli_glimpse_sem);
+                atomic_inc(&sbi->ll_agl_skipped);
                 lli->lli_agl_index = 0;
                 iput(inode);
                 RETURN_EXIT;
@@ -553,6 +558,7 @@ static void ll_agl_trigger(struct inode *inode, struct ll_statahead_info *sai)
 	       DFID", idx = %llu\n", PFID(&lli->lli_fid), index);
 
         cl_agl(inode);
+	atomic_inc(&sbi->ll_agl_glimpse);
         lli->lli_agl_index = 0;
 	lli->lli_glimpse_time = ktime_get();
 	up_write(&lli->lli_glimpse_sem);
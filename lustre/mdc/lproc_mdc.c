@@ -305,6 +305,12 @@ static int mdc_unstable_stats_seq_show(struct seq_file *m, void *v)
 }
 LPROC_SEQ_FOPS_RO(mdc_unstable_stats);
 
+static int mdc_changelog_readers_seq_show(struct seq_file *m, void *v)
+{
+	return mdc_changelog_readers_show(m, m->private);
+}
+LPROC_SEQ_FOPS_RO(mdc_changelog_readers);
+
 static ssize_t mdc_rpc_stats_seq_write(struct file *file,
 				       const char __user *buf,
 				       size_t len, loff_t *off)
@@ -484,6 +490,8 @@ struct lprocfs_vars lprocfs_mdc_obd_vars[] = {
 	  .fops	=	&mdc_rpc_stats_fops		},
 	{ .name	=	"unstable_stats",
 	  .fops	=	&mdc_unstable_stats_fops	},
+	{ .name	=	"changelog_readers",
+	  .fops	=	&mdc_changelog_readers_fops	},
 	{ .name	=	"mdc_stats",
 	  .fops	=	&mdc_stats_fops			},
 	{ NULL }
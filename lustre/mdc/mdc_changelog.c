@@ -34,6 +34,7 @@
 #include <linux/kthread.h>
 #include <linux/poll.h>
 #include <linux/miscdevice.h>
+#include <linux/compat.h>
 
 #include <lustre_log.h>
 
@@ -54,6 +55,12 @@ static DEFINE_MUTEX(chlg_registered_dev_lock);
  */
 static LIST_HEAD(chlg_registered_devices);
 
+/**
+ * Global linked list of all open changelog readers, also protected by
+ * chlg_registered_dev_lock.
+ */
+static LIST_HEAD(chlg_readers);
+
 
 struct chlg_registered_dev {
 	/* Device name of the form "changelog-{MDTNAME}" */
@@ -89,6 +96,21 @@ struct chlg_reader_state {
 	__u64			 crs_rec_count;
 	/* List of prefetched enqueued_record::enq_linkage_items */
 	struct list_head	 crs_rec_queue;
+	/* Records to deliver, also sent to the MDT. Changed under both
+	 * crs_lock and its own lock, see chlg_set_filter() */
+	struct llog_chlg_filter	 crs_filter;
+	/* Link within the global chlg_readers list */
+	struct list_head	 crs_linkage;
+	/* Process which opened the device and when */
+	pid_t			 crs_pid;
+	char			 crs_comm[TASK_COMM_LEN];
+	ktime_t			 crs_opened;
+	/* Records and bytes copied to userland */
+	__u64			 crs_rec_read;
+	__u64			 crs_bytes_read;
+	/* Records filtered out by the MDT and by the prefetch thread */
+	__u64			 crs_rec_skipped_mdt;
+	__u64			 crs_rec_skipped;
 };
 
 struct chlg_rec_entry {
@@ -105,6 +127,24 @@ enum {
 	CDEV_CHLG_MAX_PREFETCH = 1024,
 };
 
+/**
+ * Check whether a record passes the filter set by the reader, and count it
+ * as skipped if it does not. The caller holds crs_lock.
+ *
+ * @param[in,out]  crs  Internal reader state.
+ * @param[in]      rec  Changelog record.
+ * @return true if the record has to be delivered to the reader.
+ */
+static bool chlg_rec_wanted(struct chlg_reader_state *crs,
+			    const struct changelog_rec *rec)
+{
+	if (llog_chlg_filter_match(&crs->crs_filter.lcf_filter, rec))
+		return true;
+
+	crs->crs_rec_skipped++;
+	return false;
+}
+
 /**
  * ChangeLog catalog processing callback invoked on each record.
  * If the current record is eligible to userland delivery, push
@@ -125,12 +165,19 @@ static int chlg_read_cat_process_cb(const struct lu_env *env,
 	struct chlg_reader_state *crs = data;
 	struct chlg_rec_entry *enq;
 	size_t len;
+	bool wanted;
 	int rc;
 	ENTRY;
 
 	LASSERT(crs != NULL);
 	LASSERT(hdr != NULL);
 
+	/* filtered out by the MDT, see llog_chlg_filter_block() */
+	if (hdr->lrh_type == LLOG_PAD_MAGIC) {
+		crs->crs_rec_skipped_mdt++;
+		RETURN(0);
+	}
+
 	rec = container_of(hdr, struct llog_changelog_rec, cr_hdr);
 
 	if (rec->cr_hdr.lrh_type != CHANGELOG_REC) {
@@ -146,6 +193,13 @@ static int chlg_read_cat_process_cb(const struct lu_env *env,
 	if (rec->cr.cr_index < crs->crs_start_offset)
 		RETURN(0);
 
+	/* Skip filtered out records, before they are ever copied */
+	mutex_lock(&crs->crs_lock);
+	wanted = chlg_rec_wanted(crs, &rec->cr);
+	mutex_unlock(&crs->crs_lock);
+	if (!wanted)
+		RETURN(0);
+
 	CDEBUG(D_HSM, "%llu %02d%-5s %llu 0x%x t="DFID" p="DFID" %.*s\n",
 	       rec->cr.cr_index, rec->cr.cr_type,
 	       changelog_type2str(rec->cr.cr_type), rec->cr.cr_time,
@@ -170,6 +224,13 @@ static int chlg_read_cat_process_cb(const struct lu_env *env,
 	memcpy(enq->enq_record, &rec->cr, len);
 
 	mutex_lock(&crs->crs_lock);
+	/* the filter may have been narrowed while waiting for room in the
+	 * queue, and chlg_set_filter() only drops records already queued */
+	if (!chlg_rec_wanted(crs, &rec->cr)) {
+		mutex_unlock(&crs->crs_lock);
+		OBD_FREE(enq, sizeof(*enq) + len);
+		RETURN(0);
+	}
 	list_add_tail(&enq->enq_linkage, &crs->crs_rec_queue);
 	crs->crs_rec_count++;
 	mutex_unlock(&crs->crs_lock);
@@ -231,6 +292,9 @@ static int chlg_load(void *args)
 		GOTO(err_out, rc);
 	}
 
+	/* let the MDT skip the records the reader does not want */
+	llh->u.chd.chd_chlg_filter = &crs->crs_filter;
+
 	rc = llog_cat_process(NULL, llh, chlg_read_cat_process_cb, crs, 0, 0);
 	if (rc < 0) {
 		CERROR("%s: fail to process llog: rc = %d\n", obd->obd_name, rc);
@@ -304,6 +368,8 @@ static ssize_t chlg_read(struct file *file, char __user *buff, size_t count,
 		buff += rec->enq_length;
 		written_total += rec->enq_length;
 
+		crs->crs_rec_read++;
+		crs->crs_bytes_read += rec->enq_length;
 		crs->crs_rec_count--;
 		list_move_tail(&rec->enq_linkage, &consumed);
 
@@ -465,6 +531,137 @@ out_kbuf:
 	return rc < 0 ? rc : count;
 }
 
+/**
+ * Set the record filter of a changelog reader. Records already prefetched
+ * which do not pass the new filter are dropped. The filter is sent to the
+ * MDT with the next block read, records in the block being read are still
+ * filtered locally.
+ *
+ * @param[in,out]  crs  Internal reader state.
+ * @param[in]      cf   New filter.
+ * @return 0 on success, negated error code on failure.
+ */
+static int chlg_set_filter(struct chlg_reader_state *crs,
+			   const struct changelog_filter *cf)
+{
+	struct chlg_rec_entry *rec;
+	struct chlg_rec_entry *tmp;
+
+	if (cf->cf_shard_count > 1 && cf->cf_shard_index >= cf->cf_shard_count)
+		return -EINVAL;
+
+	mutex_lock(&crs->crs_lock);
+	spin_lock(&crs->crs_filter.lcf_lock);
+	crs->crs_filter.lcf_filter = *cf;
+	crs->crs_filter.lcf_filter.cf_padding = 0;
+	spin_unlock(&crs->crs_filter.lcf_lock);
+
+	list_for_each_entry_safe(rec, tmp, &crs->crs_rec_queue, enq_linkage) {
+		if (chlg_rec_wanted(crs, rec->enq_record))
+			continue;
+
+		crs->crs_rec_count--;
+		enq_record_delete(rec);
+	}
+	mutex_unlock(&crs->crs_lock);
+
+	wake_up_all(&crs->crs_waitq_prod);
+	return 0;
+}
+
+/**
+ * Handle ioctl() on the changelog character device.
+ *
+ * @param[in]  file  File pointer to the changelog character device
+ * @param[in]  cmd   Ioctl command
+ * @param[in]  arg   Userland argument of the command
+ * @return 0 on success, negated error code on failure.
+ */
+static long chlg_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
+{
+	struct chlg_reader_state *crs = file->private_data;
+	struct changelog_filter cf;
+	int rc;
+	ENTRY;
+
+	switch (cmd) {
+	case LL_IOC_CHLG_SET_FILTER:
+		if (copy_from_user(&cf, (void __user *)arg, sizeof(cf)))
+			RETURN(-EFAULT);
+
+		rc = chlg_set_filter(crs, &cf);
+		break;
+	default:
+		rc = -ENOTTY;
+		break;
+	}
+
+	RETURN(rc);
+}
+
+#ifdef CONFIG_COMPAT
+/**
+ * Handle ioctl() on the changelog character device from a 32-bit process.
+ * struct changelog_filter has the same layout for 32 and 64-bit processes,
+ * only the pointer needs to be converted.
+ */
+static long chlg_compat_ioctl(struct file *file, unsigned int cmd,
+			      unsigned long arg)
+{
+	return chlg_ioctl(file, cmd, (unsigned long)compat_ptr(arg));
+}
+#endif
+
+/**
+ * Print the throughput of the changelog readers of an MDC.
+ *
+ * @param[in]  m    Seq file of the "changelog_readers" proc file.
+ * @param[in]  obd  MDC obd_device.
+ * @return 0
+ */
+int mdc_changelog_readers_show(struct seq_file *m, struct obd_device *obd)
+{
+	struct chlg_reader_state *crs;
+	struct changelog_filter cf;
+	__u64 rate;
+	s64 ms;
+
+	mutex_lock(&chlg_registered_dev_lock);
+	list_for_each_entry(crs, &chlg_readers, crs_linkage) {
+		if (crs->crs_obd != obd)
+			continue;
+
+		ms = max_t(s64, ktime_ms_delta(ktime_get(), crs->crs_opened),
+			   1);
+
+		mutex_lock(&crs->crs_lock);
+		cf = crs->crs_filter.lcf_filter;
+		rate = crs->crs_rec_read * MSEC_PER_SEC;
+		do_div(rate, ms);
+		seq_printf(m, "- pid: %d\n"
+			   "  comm: %s\n"
+			   "  type_mask: %#x\n"
+			   "  shard: %u/%u\n"
+			   "  next_index: %llu\n"
+			   "  records: %llu\n"
+			   "  bytes: %llu\n"
+			   "  skipped_mdt: %llu\n"
+			   "  skipped_local: %llu\n"
+			   "  queued: %llu\n"
+			   "  elapsed_ms: %lld\n"
+			   "  records_per_sec: %llu\n",
+			   crs->crs_pid, crs->crs_comm, cf.cf_type_mask,
+			   cf.cf_shard_index, cf.cf_shard_count,
+			   crs->crs_start_offset, crs->crs_rec_read,
+			   crs->crs_bytes_read, crs->crs_rec_skipped_mdt,
+			   crs->crs_rec_skipped, crs->crs_rec_count, ms, rate);
+		mutex_unlock(&crs->crs_lock);
+	}
+	mutex_unlock(&chlg_registered_dev_lock);
+
+	return 0;
+}
+
 /**
  * Find the OBD device associated to a changelog character device.
  * @param[in]  cdev  character device instance descriptor
@@ -520,6 +717,10 @@ static int chlg_open(struct inode *inode, struct file *file)
 	INIT_LIST_HEAD(&crs->crs_rec_queue);
 	init_waitqueue_head(&crs->crs_waitq_prod);
 	init_waitqueue_head(&crs->crs_waitq_cons);
+	spin_lock_init(&crs->crs_filter.lcf_lock);
+	crs->crs_pid = current->pid;
+	get_task_comm(crs->crs_comm, current);
+	crs->crs_opened = ktime_get();
 
 	if (file->f_mode & FMODE_READ) {
 		task = kthread_run(chlg_load, crs, "chlg_load_thread");
@@ -532,6 +733,10 @@ static int chlg_open(struct inode *inode, struct file *file)
 		crs->crs_prod_task = task;
 	}
 
+	mutex_lock(&chlg_registered_dev_lock);
+	list_add_tail(&crs->crs_linkage, &chlg_readers);
+	mutex_unlock(&chlg_registered_dev_lock);
+
 	file->private_data = crs;
 	RETURN(0);
 
@@ -554,6 +759,10 @@ static int chlg_release(struct inode *inode, struct file *file)
 	struct chlg_rec_entry *tmp;
 	int rc = 0;
 
+	mutex_lock(&chlg_registered_dev_lock);
+	list_del(&crs->crs_linkage);
+	mutex_unlock(&chlg_registered_dev_lock);
+
 	if (crs->crs_prod_task)
 		rc = kthread_stop(crs->crs_prod_task);
 
@@ -595,6 +804,10 @@ static const struct file_operations chlg_fops = {
 	.llseek		= chlg_llseek,
 	.read		= chlg_read,
 	.write		= chlg_write,
+	.unlocked_ioctl	= chlg_ioctl,
+#ifdef CONFIG_COMPAT
+	.compat_ioctl	= chlg_compat_ioctl,
+#endif
 	.open		= chlg_open,
 	.release	= chlg_release,
 	.poll		= chlg_poll,
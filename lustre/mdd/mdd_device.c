@@ -297,14 +297,45 @@ static int changelog_user_detect_orphan_cb(const struct lu_env *env,
 struct changelog_cancel_cookie {
 	long long endrec;
 	struct mdd_device *mdd;
+	/* plain llog of the records pending cancellation */
+	struct llog_logid lgl;
+	/* number of records pending cancellation */
+	int count;
+	/* max number of pending records, a whole plain llog */
+	int max;
+	/* indexes of the records pending cancellation */
+	int *index;
 };
 
+/**
+ * Cancel the changelog records gathered by llog_changelog_cancel_cb().
+ * They all belong to the same plain llog and are cancelled in a single
+ * transaction, the llog being destroyed if they were the last ones.
+ */
+static int llog_changelog_cancel_flush(const struct lu_env *env,
+				       struct llog_handle *cathandle,
+				       struct changelog_cancel_cookie *cl_cookie)
+{
+	int rc;
+
+	if (cl_cookie->count == 0)
+		return 0;
+
+	rc = llog_cat_cancel_arr_rec(env, cathandle, &cl_cookie->lgl,
+				     cl_cookie->count, cl_cookie->index);
+	cl_cookie->count = 0;
+	/* give other threads a chance between large batches */
+	cond_resched();
+
+	return rc;
+}
+
 static int llog_changelog_cancel_cb(const struct lu_env *env,
 				    struct llog_handle *llh,
 				    struct llog_rec_hdr *hdr, void *data)
 {
 	struct llog_changelog_rec *rec = (struct llog_changelog_rec *)hdr;
-	struct llog_cookie	 cookie;
+	struct llog_handle	*cathandle = llh->u.phd.phd_cat_handle;
 	struct changelog_cancel_cookie *cl_cookie =
 		(struct changelog_cancel_cookie *)data;
 	int			 rc;
@@ -333,19 +364,31 @@ static int llog_changelog_cancel_cb(const struct lu_env *env,
 			RETURN(LLOG_PROC_BREAK);
 	}
 
+	/* records of the previous plain llog are all known now */
+	if (cl_cookie->count > 0 &&
+	    !llog_logid_eq(&cl_cookie->lgl, &llh->lgh_id)) {
+		rc = llog_changelog_cancel_flush(env, cathandle, cl_cookie);
+		if (rc < 0)
+			RETURN(rc);
+	}
+
 	if (rec->cr.cr_index > cl_cookie->endrec)
 		/* records are in order, so we're done */
 		RETURN(LLOG_PROC_BREAK);
 
-	cookie.lgc_lgl = llh->lgh_id;
-	cookie.lgc_index = hdr->lrh_index;
+	/* Store up the records of a plain llog and cancel them all at once,
+	 * so a fully consumed llog costs a single transaction which destroys
+	 * it, instead of one transaction per record. */
+	cl_cookie->lgl = llh->lgh_id;
+	cl_cookie->index[cl_cookie->count++] = hdr->lrh_index;
+	if (cl_cookie->count == cl_cookie->max ||
+	    hdr->lrh_index == llh->lgh_last_idx) {
+		rc = llog_changelog_cancel_flush(env, cathandle, cl_cookie);
+		if (rc < 0)
+			RETURN(rc);
+	}
 
-	/* cancel them one at a time.  I suppose we could store up the cookies
-	 * and cancel them all at once; probably more efficient, but this is
-	 * done as a user call, so who cares... */
-	rc = llog_cat_cancel_records(env, llh->u.phd.phd_cat_handle, 1,
-				     &cookie);
-	RETURN(rc < 0 ? rc : 0);
+	RETURN(0);
 }
 
 static int llog_changelog_cancel(const struct lu_env *env,
@@ -360,12 +403,26 @@ static int llog_changelog_cancel(const struct lu_env *env,
 	/* This should only be called with the catalog handle */
 	LASSERT(cathandle->lgh_hdr->llh_flags & LLOG_F_IS_CAT);
 
+	/* plain llogs have the same chunk size, thus bitmap, as the catalog */
+	cookie->count = 0;
+	cookie->max = LLOG_HDR_BITMAP_SIZE(cathandle->lgh_hdr);
+	OBD_ALLOC_LARGE(cookie->index, cookie->max * sizeof(*cookie->index));
+	if (cookie->index == NULL)
+		RETURN(-ENOMEM);
+
 	rc = llog_cat_process(env, cathandle, llog_changelog_cancel_cb,
 			      cookie, 0, 0);
-	if (rc >= 0)
+	if (rc >= 0) {
 		/* 0 or 1 means we're done */
-		rc = 0;
-	else
+		rc = llog_changelog_cancel_flush(env, cathandle, cookie);
+		if (rc > 0)
+			rc = 0;
+	}
+
+	OBD_FREE_LARGE(cookie->index, cookie->max * sizeof(*cookie->index));
+	cookie->index = NULL;
+
+	if (rc < 0)
 		CERROR("%s: cancel idx %u of catalog "DFID": rc = %d\n",
 		       ctxt->loc_obd->obd_name, cathandle->lgh_last_idx,
 		       PFID(&cathandle->lgh_id.lgl_oi.oi_fid), rc);
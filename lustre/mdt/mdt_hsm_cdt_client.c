@@ -363,9 +363,17 @@ static int mdt_hsm_register_hal(struct mdt_thread_info *mti,
 
 		/* if restore, take an exclusive lock on layout */
 		if (hai->hai_action == HSMA_RESTORE) {
-			/* in V1 only whole file is supported. */
-			if (hai->hai_extent.offset != 0)
-				GOTO(out, rc = -EPROTO);
+			/* The layout cannot describe a partially restored
+			 * file, only whole file restores are supported. */
+			if (hai->hai_extent.offset != 0 ||
+			    hai->hai_extent.length != OBD_OBJECT_EOF) {
+				CDEBUG(D_HSM, DFID" restore of range "
+				       "[%#llx, %#llx] is not supported\n",
+				       PFID(&hai->hai_fid),
+				       hai->hai_extent.offset,
+				       hai->hai_extent.length);
+				GOTO(out, rc = -EOPNOTSUPP);
+			}
 
 			rc = cdt_restore_handle_add(mti, cdt, &hai->hai_fid,
 						    &hai->hai_extent);
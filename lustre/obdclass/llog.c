@@ -190,9 +190,26 @@ out_trans:
 }
 EXPORT_SYMBOL(llog_destroy);
 
-/* returns negative on error; 0 if success; 1 if success & log destroyed */
-int llog_cancel_rec(const struct lu_env *env, struct llog_handle *loghandle,
-		    int index)
+/**
+ * Cancel a set of records of the same plain llog in a single transaction.
+ *
+ * The bits of all the records are cleared in the llog bitmap and the llog
+ * header is written once, so cancelling many records costs one transaction
+ * instead of one per record.
+ *
+ * \param[in] env	execution environment
+ * \param[in] loghandle	llog handle the records belong to
+ * \param[in] num	number of records to cancel
+ * \param[in,out] index	array of \a num record indexes, the entries of
+ *			records which were already cancelled are zeroed
+ *
+ * \retval LLOG_DEL_PLAIN	on success, the llog became empty and was
+ *				destroyed
+ * \retval 0		on success
+ * \retval negative	negated errno on failure
+ */
+int llog_cancel_arr_rec(const struct lu_env *env,
+			struct llog_handle *loghandle, int num, int *index)
 {
 	struct llog_thread_info *lgi = llog_info(env);
 	struct dt_device	*dt;
@@ -200,22 +217,26 @@ int llog_cancel_rec(const struct lu_env *env, struct llog_handle *loghandle,
 	struct thandle		*th;
 	int			 rc;
 	int rc1;
-	bool subtract_count = false;
+	int i;
+	int cleared = 0;
 
 	ENTRY;
 
 	LASSERT(loghandle != NULL);
 	LASSERT(loghandle->lgh_ctxt != NULL);
 	LASSERT(loghandle->lgh_obj != NULL);
+	LASSERT(num > 0);
 
 	llh = loghandle->lgh_hdr;
 
-	CDEBUG(D_RPCTRACE, "Canceling %d in log "DFID"\n", index,
-	       PFID(&loghandle->lgh_id.lgl_oi.oi_fid));
+	CDEBUG(D_RPCTRACE, "Canceling %d records from %d in log "DFID"\n",
+	       num, index[0], PFID(&loghandle->lgh_id.lgl_oi.oi_fid));
 
-	if (index == 0) {
-		CERROR("Can't cancel index 0 which is header\n");
-		RETURN(-EINVAL);
+	for (i = 0; i < num; i++) {
+		if (index[i] == 0) {
+			CERROR("Can't cancel index 0 which is header\n");
+			RETURN(-EINVAL);
+		}
 	}
 
 	dt = lu2dt_dev(loghandle->lgh_obj->do_lu.lo_dev);
@@ -224,7 +245,8 @@ int llog_cancel_rec(const struct lu_env *env, struct llog_handle *loghandle,
 	if (IS_ERR(th))
 		RETURN(PTR_ERR(th));
 
-	rc = llog_declare_write_rec(env, loghandle, &llh->llh_hdr, index, th);
+	rc = llog_declare_write_rec(env, loghandle, &llh->llh_hdr,
+				    num == 1 ? index[0] : LLOG_HEADER_IDX, th);
 	if (rc < 0)
 		GOTO(out_trans, rc);
 
@@ -242,22 +264,22 @@ int llog_cancel_rec(const struct lu_env *env, struct llog_handle *loghandle,
 	down_write(&loghandle->lgh_lock);
 	/* clear bitmap */
 	mutex_lock(&loghandle->lgh_hdr_mutex);
-	if (!ext2_clear_bit(index, LLOG_HDR_BITMAP(llh))) {
-		CDEBUG(D_RPCTRACE, "Catalog index %u already clear?\n", index);
-		GOTO(out_unlock, rc);
+	for (i = 0; i < num; i++) {
+		if (!ext2_clear_bit(index[i], LLOG_HDR_BITMAP(llh))) {
+			CDEBUG(D_RPCTRACE, "Catalog index %u already clear?\n",
+			       index[i]);
+			/* keep it out of the rollback below */
+			index[i] = 0;
+			continue;
+		}
+		cleared++;
 	}
 
-	loghandle->lgh_hdr->llh_count--;
-	subtract_count = true;
-	/* Pass this index to llog_osd_write_rec(), which will use the index
-	 * to only update the necesary bitmap. */
-	lgi->lgi_cookie.lgc_index = index;
-	/* update header */
-	rc = llog_write_rec(env, loghandle, &llh->llh_hdr, &lgi->lgi_cookie,
-			    LLOG_HEADER_IDX, th);
-	if (rc != 0)
+	if (cleared == 0)
 		GOTO(out_unlock, rc);
 
+	loghandle->lgh_hdr->llh_count -= cleared;
+
 	if ((llh->llh_flags & LLOG_F_ZAP_WHEN_EMPTY) &&
 	    (llh->llh_count == 1) &&
 	    ((loghandle->lgh_last_idx == LLOG_HDR_BITMAP_SIZE(llh) - 1) ||
@@ -266,20 +288,28 @@ int llog_cancel_rec(const struct lu_env *env, struct llog_handle *loghandle,
 		loghandle))) {
 		/* never try to destroy it again */
 		llh->llh_flags &= ~LLOG_F_ZAP_WHEN_EMPTY;
+		/* the whole llog is consumed, no need to update its header
+		 * before destroying it */
 		rc = llog_trans_destroy(env, loghandle, th);
-		if (rc < 0) {
-			/* Sigh, can not destroy the final plain llog, but
-			 * the bitmap has been clearly, so the record can not
-			 * be accessed anymore, let's return 0 for now, and
-			 * the orphan will be handled by LFSCK. */
-			CERROR("%s: can't destroy empty llog "DFID": rc = %d\n",
-			       loghandle->lgh_ctxt->loc_obd->obd_name,
-			       PFID(&loghandle->lgh_id.lgl_oi.oi_fid), rc);
-			GOTO(out_unlock, rc = 0);
-		}
-		rc = LLOG_DEL_PLAIN;
+		if (rc == 0)
+			GOTO(out_unlock, rc = LLOG_DEL_PLAIN);
+
+		/* Sigh, can not destroy the final plain llog, just update
+		 * the bitmap so the records can not be accessed anymore,
+		 * the orphan will be handled by LFSCK. */
+		CERROR("%s: can't destroy empty llog "DFID": rc = %d\n",
+		       loghandle->lgh_ctxt->loc_obd->obd_name,
+		       PFID(&loghandle->lgh_id.lgl_oi.oi_fid), rc);
 	}
 
+	/* For a single record, pass its index to llog_osd_write_rec(), which
+	 * will use the index to only update the necessary bitmap. Otherwise
+	 * the whole header is written at once. */
+	lgi->lgi_cookie.lgc_index = index[0];
+	rc = llog_write_rec(env, loghandle, &llh->llh_hdr,
+			    num == 1 ? &lgi->lgi_cookie : NULL,
+			    LLOG_HEADER_IDX, th);
+
 out_unlock:
 	mutex_unlock(&loghandle->lgh_hdr_mutex);
 	up_write(&loghandle->lgh_lock);
@@ -287,15 +317,24 @@ out_trans:
 	rc1 = dt_trans_stop(env, dt, th);
 	if (rc == 0)
 		rc = rc1;
-	if (rc < 0 && subtract_count) {
+	if (rc < 0 && cleared > 0) {
 		mutex_lock(&loghandle->lgh_hdr_mutex);
-		loghandle->lgh_hdr->llh_count++;
-		ext2_set_bit(index, LLOG_HDR_BITMAP(llh));
+		loghandle->lgh_hdr->llh_count += cleared;
+		for (i = 0; i < num; i++)
+			if (index[i] != 0)
+				ext2_set_bit(index[i], LLOG_HDR_BITMAP(llh));
 		mutex_unlock(&loghandle->lgh_hdr_mutex);
 	}
 	RETURN(rc);
 }
 
+/* returns negative on error; 0 if success; 1 if success & log destroyed */
+int llog_cancel_rec(const struct lu_env *env, struct llog_handle *loghandle,
+		    int index)
+{
+	return llog_cancel_arr_rec(env, loghandle, 1, &index);
+}
+
 int llog_read_header(const struct lu_env *env, struct llog_handle *handle,
 		     const struct obd_uuid *uuid)
 {
@@ -726,12 +726,99 @@ out_trans:
 }
 EXPORT_SYMBOL(llog_cat_add);
 
+/**
+ * Cancel a set of records of the same plain llog in a catalog, and tell
+ * whether the plain llog itself could not be found, see
+ * llog_cat_cancel_arr_rec().
+ *
+ * \param[in] env	execution environment
+ * \param[in] cathandle	catalog handle
+ * \param[in] lgl	id of the plain llog the records belong to
+ * \param[in] count	number of records to cancel
+ * \param[in] index	array of \a count record indexes
+ * \param[out] nolog	set if the plain llog was not found
+ *
+ * \retval 0		on success
+ * \retval negative	negated errno on failure
+ */
+static int __llog_cat_cancel_arr_rec(const struct lu_env *env,
+				     struct llog_handle *cathandle,
+				     struct llog_logid *lgl, int count,
+				     int *index, bool *nolog)
+{
+	struct llog_handle *loghandle;
+	int rc;
+
+	ENTRY;
+
+	*nolog = false;
+	rc = llog_cat_id2handle(env, cathandle, &loghandle, lgl);
+	if (rc) {
+		CDEBUG(D_HA, "%s: cannot find llog for handle "DFID":%x"
+		       ": rc = %d\n",
+		       cathandle->lgh_ctxt->loc_obd->obd_name,
+		       PFID(&lgl->lgl_oi.oi_fid), lgl->lgl_ogen, rc);
+		*nolog = true;
+		RETURN(rc);
+	}
+
+	if ((cathandle->lgh_ctxt->loc_flags &
+	     LLOG_CTXT_FLAG_NORMAL_FID) && !llog_exist(loghandle)) {
+		/* For update log, some of loghandles of cathandle
+		 * might not exist because remote llog creation might
+		 * be failed, so let's skip the record cancellation
+		 * for these non-exist llogs.
+		 */
+		rc = -ENOENT;
+		CDEBUG(D_HA, "%s: llog "DFID":%x does not exist"
+		       ": rc = %d\n",
+		       cathandle->lgh_ctxt->loc_obd->obd_name,
+		       PFID(&lgl->lgl_oi.oi_fid), lgl->lgl_ogen, rc);
+		*nolog = true;
+		GOTO(out, rc);
+	}
+
+	rc = llog_cancel_arr_rec(env, loghandle, count, index);
+	if (rc == LLOG_DEL_PLAIN) /* log has been destroyed */
+		rc = llog_cat_cleanup(env, cathandle, loghandle,
+				      loghandle->u.phd.phd_cookie.lgc_index);
+out:
+	llog_handle_put(loghandle);
+	RETURN(rc);
+}
+
+/**
+ * Cancel a set of records of the same plain llog in a catalog, in a single
+ * transaction, see llog_cancel_arr_rec(). If the plain llog becomes empty,
+ * it is destroyed and removed from the catalog.
+ *
+ * \param[in] env	execution environment
+ * \param[in] cathandle	catalog handle
+ * \param[in] lgl	id of the plain llog the records belong to
+ * \param[in] count	number of records to cancel
+ * \param[in] index	array of \a count record indexes
+ *
+ * \retval 0		on success
+ * \retval negative	negated errno on failure
+ */
+int llog_cat_cancel_arr_rec(const struct lu_env *env,
+			    struct llog_handle *cathandle,
+			    struct llog_logid *lgl, int count, int *index)
+{
+	bool nolog;
+
+	return __llog_cat_cancel_arr_rec(env, cathandle, lgl, count, index,
+					 &nolog);
+}
+EXPORT_SYMBOL(llog_cat_cancel_arr_rec);
+
 /* For each cookie in the cookie array, we clear the log in-use bit and either:
  * - the log is empty, so mark it free in the catalog header and delete it
  * - the log is not empty, just write out the log header
  *
  * The cookies may be in different log files, so we need to get new logs
- * each time.
+ * each time. Consecutive cookies of the same log are cancelled together
+ * in a single transaction.
  *
  * Assumes caller has already pushed us into the kernel context.
  */
@@ -739,59 +826,37 @@ int llog_cat_cancel_records(const struct lu_env *env,
 			    struct llog_handle *cathandle, int count,
 			    struct llog_cookie *cookies)
 {
-	int i, index, rc = 0, failed = 0;
+	int index[LLOG_CAT_CANCEL_BATCH];
+	int i, j, rc = 0, failed = 0;
 
 	ENTRY;
 
-	for (i = 0; i < count; i++, cookies++) {
-		struct llog_handle *loghandle;
-		struct llog_logid *lgl = &cookies->lgc_lgl;
+	for (i = 0; i < count; i += j) {
+		struct llog_logid *lgl = &cookies[i].lgc_lgl;
+		bool nolog;
 		int  lrc;
 
-		rc = llog_cat_id2handle(env, cathandle, &loghandle, lgl);
-		if (rc) {
-			CDEBUG(D_HA, "%s: cannot find llog for handle "DFID":%x"
-			       ": rc = %d\n",
-			       cathandle->lgh_ctxt->loc_obd->obd_name,
-			       PFID(&lgl->lgl_oi.oi_fid), lgl->lgl_ogen, rc);
-			failed++;
-			continue;
-		}
-
-		if ((cathandle->lgh_ctxt->loc_flags &
-		     LLOG_CTXT_FLAG_NORMAL_FID) && !llog_exist(loghandle)) {
-			/* For update log, some of loghandles of cathandle
-			 * might not exist because remote llog creation might
-			 * be failed, so let's skip the record cancellation
-			 * for these non-exist llogs.
-			 */
-			lrc = -ENOENT;
-			CDEBUG(D_HA, "%s: llog "DFID":%x does not exist"
-			       ": rc = %d\n",
-			       cathandle->lgh_ctxt->loc_obd->obd_name,
-			       PFID(&lgl->lgl_oi.oi_fid), lgl->lgl_ogen, lrc);
-			failed++;
-			if (rc == 0)
-				rc = lrc;
-			continue;
+		for (j = 0; i + j < count && j < ARRAY_SIZE(index); j++) {
+			if (!llog_logid_eq(&cookies[i + j].lgc_lgl, lgl))
+				break;
+			index[j] = cookies[i + j].lgc_index;
 		}
 
-		lrc = llog_cancel_rec(env, loghandle, cookies->lgc_index);
-		if (lrc == LLOG_DEL_PLAIN) { /* log has been destroyed */
-			index = loghandle->u.phd.phd_cookie.lgc_index;
-			lrc = llog_cat_cleanup(env, cathandle, loghandle,
-					       index);
+		lrc = __llog_cat_cancel_arr_rec(env, cathandle, lgl, j, index,
+						&nolog);
+		if (nolog) {
+			/* the records of a missing llog are not cancelled */
+			failed += j;
 			if (rc == 0)
 				rc = lrc;
 		} else if (lrc == -ENOENT) {
 			if (rc == 0) /* ENOENT shouldn't rewrite any error */
 				rc = lrc;
 		} else if (lrc < 0) {
-			failed++;
+			failed += j;
 			if (rc == 0)
 				rc = lrc;
 		}
-		llog_handle_put(loghandle);
 	}
 	if (rc)
 		CERROR("%s: fail to cancel %d of %d llog-records: rc = %d\n",
@@ -99,6 +99,14 @@ void lustre_swab_llogd_body (struct llogd_body *d)
 }
 EXPORT_SYMBOL(lustre_swab_llogd_body);
 
+void lustre_swab_changelog_filter(struct changelog_filter *cf)
+{
+	__swab32s(&cf->cf_type_mask);
+	__swab32s(&cf->cf_shard_index);
+	__swab32s(&cf->cf_shard_count);
+}
+EXPORT_SYMBOL(lustre_swab_changelog_filter);
+
 void lustre_swab_llogd_conn_body (struct llogd_conn_body *d)
 {
         __swab64s (&d->lgdc_gen.mnt_cnt);
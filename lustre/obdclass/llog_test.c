@@ -1962,6 +1962,94 @@ ctxt_release:
 	RETURN(rc);
 }
 
+/* Test batched cancel of records from the same plain llog */
+static int llog_test_11(const struct lu_env *env, struct obd_device *obd)
+{
+	struct llog_handle	*cath;
+	char			 name[10];
+	int			 rc, rc2, i;
+	struct llog_mini_rec	 lmr;
+	struct llog_cookie	*cookies;
+	int			 count = LLOG_CAT_CANCEL_BATCH + 1;
+	int			 index[LLOG_CAT_CANCEL_BATCH / 2];
+	struct llog_ctxt	*ctxt;
+
+	ENTRY;
+
+	OBD_ALLOC(cookies, count * sizeof(*cookies));
+	if (cookies == NULL)
+		RETURN(-ENOMEM);
+
+	ctxt = llog_get_context(obd, LLOG_TEST_ORIG_CTXT);
+	LASSERT(ctxt);
+
+	lmr.lmr_hdr.lrh_len = lmr.lmr_tail.lrt_len = LLOG_MIN_REC_SIZE;
+	lmr.lmr_hdr.lrh_type = 0xf00f00;
+
+	snprintf(name, sizeof(name), "%x", llog_test_rand + 3);
+	CWARN("11a: create a catalog log with name: %s\n", name);
+	rc = llog_open_create(env, ctxt, &cath, NULL, name);
+	if (rc) {
+		CERROR("11a: llog_create with name %s failed: %d\n", name, rc);
+		GOTO(ctxt_release, rc);
+	}
+	rc = llog_init_handle(env, cath, LLOG_F_IS_CAT, &uuid);
+	if (rc) {
+		CERROR("11a: can't init llog handle: %d\n", rc);
+		GOTO(out, rc);
+	}
+
+	CWARN("11b: write %d log records\n", count);
+	for (i = 0; i < count; i++) {
+		rc = llog_cat_add(env, cath, &lmr.lmr_hdr, &cookies[i]);
+		if (rc != 1) {
+			CERROR("11b: write %d records failed at #%d: %d\n",
+			       count, i + 1, rc);
+			GOTO(out, rc);
+		}
+	}
+	rc = verify_handle("11b", cath->u.chd.chd_current_log, count + 1);
+	if (rc)
+		GOTO(out, rc);
+
+	CWARN("11c: cancel %d records at once\n", (int)ARRAY_SIZE(index));
+	for (i = 0; i < ARRAY_SIZE(index); i++)
+		index[i] = cookies[2 * i].lgc_index;
+	rc = llog_cat_cancel_arr_rec(env, cath, &cookies[0].lgc_lgl,
+				     ARRAY_SIZE(index), index);
+	if (rc) {
+		CERROR("11c: batch cancel failed: %d\n", rc);
+		GOTO(out, rc);
+	}
+	rc = verify_handle("11c", cath->u.chd.chd_current_log,
+			   count - ARRAY_SIZE(index) + 1);
+	if (rc)
+		GOTO(out, rc);
+
+	CWARN("11d: cancel all records, some of them twice\n");
+	rc = llog_cat_cancel_records(env, cath, count, cookies);
+	if (rc) {
+		CERROR("11d: cancel records failed: %d\n", rc);
+		GOTO(out, rc);
+	}
+	rc = verify_handle("11d", cath->u.chd.chd_current_log, 1);
+	if (rc)
+		GOTO(out, rc);
+
+out:
+	CWARN("11: put newly-created catalog\n");
+	rc2 = llog_cat_close(env, cath);
+	if (rc2) {
+		CERROR("11: close log %s failed: %d\n", name, rc2);
+		if (rc == 0)
+			rc = rc2;
+	}
+ctxt_release:
+	llog_ctxt_put(ctxt);
+	OBD_FREE(cookies, count * sizeof(*cookies));
+	RETURN(rc);
+}
+
 /* -------------------------------------------------------------------------
  * Tests above, boring obd functions below
  * ------------------------------------------------------------------------- */
@@ -2018,6 +2106,10 @@ static int llog_run_tests(const struct lu_env *env, struct obd_device *obd)
 	if (rc)
 		GOTO(cleanup, rc);
 
+	rc = llog_test_11(env, obd);
+	if (rc)
+		GOTO(cleanup, rc);
+
 cleanup:
 	err = llog_destroy(env, llh);
 	if (err)
@@ -354,6 +354,129 @@ static int lprocfs_exp_hash_seq_show(struct seq_file *m, void *data)
 }
 LPROC_SEQ_FOPS_RO(lprocfs_exp_hash);
 
+static int
+lprocfs_exp_lock_age_cb(struct cfs_hash *hs, struct cfs_hash_bd *bd,
+			struct hlist_node *hnode, void *cb_data)
+{
+	struct obd_histogram *oh = cb_data;
+	struct ldlm_lock *lock = cfs_hash_object(hs, hnode);
+	s64 age;
+
+	/* only IBITS and EXTENT locks are aged, see ldlm_reclaim_add() */
+	if (lock->l_granted_mode != lock->l_req_mode ||
+	    (lock->l_resource->lr_type != LDLM_IBITS &&
+	     lock->l_resource->lr_type != LDLM_EXTENT))
+		return 0;
+
+	age = div_s64(ktime_us_delta(ktime_get(), lock->l_last_used),
+		      USEC_PER_SEC);
+	lprocfs_oh_tally_log2(oh, age > 0 ? age : 0);
+	return 0;
+}
+
+/* references to the exports of a NID, see lprocfs_exp_ldlm_locks_seq_show() */
+struct lprocfs_exp_snap {
+	struct obd_export	**les_exps;
+	int			  les_max;
+	int			  les_count;
+};
+
+static int
+lprocfs_exp_snap_cb(struct cfs_hash *hs, struct cfs_hash_bd *bd,
+		    struct hlist_node *hnode, void *cb_data)
+{
+	struct lprocfs_exp_snap *snap = cb_data;
+	struct obd_export *exp = cfs_hash_object(hs, hnode);
+
+	if (snap->les_exps == NULL) {
+		snap->les_count++;
+		return 0;
+	}
+	/* the NID has got more exports since they were counted */
+	if (snap->les_count == snap->les_max)
+		return 1;
+
+	snap->les_exps[snap->les_count++] = class_export_get(exp);
+	return 0;
+}
+
+static void lprocfs_exp_print_ldlm_locks(struct seq_file *m,
+					 struct obd_export *exp)
+{
+	struct obd_histogram oh;
+	int i;
+
+	if (exp->exp_nid_stats == NULL || exp->exp_lock_hash == NULL)
+		return;
+
+	spin_lock_init(&oh.oh_lock);
+	lprocfs_oh_clear(&oh);
+	cfs_hash_for_each(exp->exp_lock_hash, lprocfs_exp_lock_age_cb, &oh);
+
+	seq_printf(m, "%s:\n"
+		   "    lock_count: %lu\n"
+		   "    granted: %lu\n"
+		   "    idle_time: %lld\n"
+		   "    granted_age:\n",
+		   obd_uuid2str(&exp->exp_client_uuid),
+		   (unsigned long)cfs_hash_size_get(exp->exp_lock_hash),
+		   lprocfs_oh_sum(&oh),
+		   ktime_get_seconds() - exp->exp_last_lock_time);
+	for (i = 0; i < OBD_HIST_MAX; i++) {
+		if (oh.oh_buckets[i] == 0)
+			continue;
+		seq_printf(m, "        %lu: %lu\n",
+			   1UL << i, oh.oh_buckets[i]);
+	}
+}
+
+/**
+ * Show the lock footprint of the exports of a client NID: the number of
+ * locks held, the seconds since the last lock enqueue and a histogram of
+ * the granted lock ages, each bucket is keyed by its highest age in
+ * seconds.
+ *
+ * 5f0b2e36-1c6f-8a0a-72d4-fd6f5a3bb6f1:
+ *     lock_count: 1203
+ *     granted: 1203
+ *     idle_time: 14
+ *     granted_age:
+ *         16: 3
+ *         512: 1200
+ *
+ * The lock hash of an export is walked with a reference on the export
+ * only, not under the lock of the NID hash.
+ */
+static int lprocfs_exp_ldlm_locks_seq_show(struct seq_file *m, void *data)
+{
+	struct nid_stat *stats = m->private;
+	struct obd_device *obd = stats->nid_obd;
+	struct lprocfs_exp_snap snap = { NULL, 0, 0 };
+	int i;
+
+	cfs_hash_for_each_key(obd->obd_nid_hash, &stats->nid,
+			      lprocfs_exp_snap_cb, &snap);
+	if (snap.les_count == 0)
+		return 0;
+
+	snap.les_max = snap.les_count;
+	snap.les_count = 0;
+	OBD_ALLOC(snap.les_exps, snap.les_max * sizeof(*snap.les_exps));
+	if (snap.les_exps == NULL)
+		return -ENOMEM;
+
+	cfs_hash_for_each_key(obd->obd_nid_hash, &stats->nid,
+			      lprocfs_exp_snap_cb, &snap);
+
+	for (i = 0; i < snap.les_count; i++) {
+		lprocfs_exp_print_ldlm_locks(m, snap.les_exps[i]);
+		class_export_put(snap.les_exps[i]);
+	}
+	OBD_FREE(snap.les_exps, snap.les_max * sizeof(*snap.les_exps));
+	return 0;
+}
+LPROC_SEQ_FOPS_RO(lprocfs_exp_ldlm_locks);
+
 int lprocfs_exp_print_replydata_seq(struct cfs_hash *hs, struct cfs_hash_bd *bd,
 				    struct hlist_node *hnode, void *cb_data)
 
@@ -541,6 +664,15 @@ int lprocfs_exp_setup(struct obd_export *exp, lnet_nid_t *nid)
 		GOTO(destroy_new_ns, rc);
 	}
 
+	entry = lprocfs_add_simple(new_stat->nid_proc, "ldlm_locks", new_stat,
+				   &lprocfs_exp_ldlm_locks_fops);
+	if (IS_ERR(entry)) {
+		rc = PTR_ERR(entry);
+		CWARN("%s: error adding the ldlm_locks file: rc = %d\n",
+		      obd->obd_name, rc);
+		GOTO(destroy_new_ns, rc);
+	}
+
 	entry = lprocfs_add_simple(new_stat->nid_proc, "reply_data", new_stat,
 				   &lprocfs_exp_replydata_fops);
 	if (IS_ERR(entry)) {
@@ -430,6 +430,144 @@ osp_max_create_count_seq_write(struct file *file, const char __user *buffer,
 }
 LPROC_SEQ_FOPS(osp_max_create_count);
 
+/**
+ * Show seconds of objects to keep precreated at the current create rate
+ *
+ * \param[in] m		seq_file handle
+ * \param[in] data	unused for single entry
+ * \retval		0 on success
+ * \retval		negative number on error
+ */
+static int osp_create_seconds_seq_show(struct seq_file *m, void *data)
+{
+	struct obd_device *obd = m->private;
+	struct osp_device *osp = lu2osp_dev(obd->obd_lu_dev);
+
+	if (osp == NULL || osp->opd_pre == NULL)
+		return 0;
+
+	seq_printf(m, "%u\n", osp->opd_pre_create_seconds);
+	return 0;
+}
+
+/**
+ * Change seconds of objects to keep precreated at the current create rate
+ *
+ * 0 disables the create rate based sizing of the precreation window, which
+ * is then only grown when it runs low, and can be set with create_count.
+ *
+ * \param[in] file	proc file
+ * \param[in] buffer	string which represents number of seconds
+ * \param[in] count	\a buffer length
+ * \param[in] off	unused for single entry
+ * \retval		\a count on success
+ * \retval		negative number on error
+ */
+static ssize_t
+osp_create_seconds_seq_write(struct file *file, const char __user *buffer,
+			     size_t count, loff_t *off)
+{
+	struct seq_file *m = file->private_data;
+	struct obd_device *obd = m->private;
+	struct osp_device *osp = lu2osp_dev(obd->obd_lu_dev);
+	unsigned int val;
+	int rc;
+
+	if (osp == NULL || osp->opd_pre == NULL)
+		return 0;
+
+	rc = kstrtouint_from_user(buffer, count, 0, &val);
+	if (rc)
+		return rc;
+
+	/* the window is bounded by max_create_count anyway */
+	if (val > obd_timeout)
+		return -ERANGE;
+
+	osp->opd_pre_create_seconds = val;
+
+	return count;
+}
+LPROC_SEQ_FOPS(osp_create_seconds);
+
+#define pct(a, b) (b ? a * 100 / b : 0)
+
+/**
+ * Show precreation statistics: the measured create rate, the precreate RPC
+ * latency and a histogram of the time spent in osp_precreate_reserve()
+ *
+ * \param[in] m		seq_file handle
+ * \param[in] data	unused for single entry
+ * \retval		0 on success
+ * \retval		negative number on error
+ */
+static int osp_precreate_stats_seq_show(struct seq_file *m, void *data)
+{
+	struct obd_device *obd = m->private;
+	struct osp_device *osp = lu2osp_dev(obd->obd_lu_dev);
+	struct obd_histogram *h;
+	struct timespec64 now;
+	unsigned long tot, cum = 0;
+	unsigned int rate;
+	int i;
+
+	if (osp == NULL || osp->opd_pre == NULL)
+		return 0;
+
+	h = &osp->opd_pre_reserve_wait_hist;
+	ktime_get_real_ts64(&now);
+
+	spin_lock(&osp->opd_pre_lock);
+	rate = osp_precreate_rate_nolock(osp);
+	spin_unlock(&osp->opd_pre_lock);
+
+	seq_printf(m, "snapshot_time:         %lld.%09lu (secs.nsecs)\n",
+		   (s64)now.tv_sec, now.tv_nsec);
+	seq_printf(m, "create_rate:           %u objs/s\n", rate);
+	seq_printf(m, "precreate_rpc_latency: %u usecs\n",
+		   osp->opd_pre_rpc_latency);
+	seq_printf(m, "create_count:          %d\n",
+		   osp->opd_pre_create_count);
+
+	seq_printf(m, "\nreserve wait (usecs)  waits   %% cum %%\n");
+	tot = lprocfs_oh_sum(h);
+	for (i = 0; i < OBD_HIST_MAX && cum < tot; i++) {
+		unsigned long w = h->oh_buckets[i];
+
+		cum += w;
+		seq_printf(m, "%u:\t\t%10lu %3lu %3lu\n",
+			   1U << i, w, pct(w, tot), pct(cum, tot));
+	}
+
+	return 0;
+}
+
+/**
+ * Reset the histogram of the time spent in osp_precreate_reserve()
+ *
+ * \param[in] file	proc file
+ * \param[in] buffer	unused
+ * \param[in] count	\a buffer length
+ * \param[in] off	unused for single entry
+ * \retval		\a count
+ */
+static ssize_t
+osp_precreate_stats_seq_write(struct file *file, const char __user *buffer,
+			      size_t count, loff_t *off)
+{
+	struct seq_file *m = file->private_data;
+	struct obd_device *obd = m->private;
+	struct osp_device *osp = lu2osp_dev(obd->obd_lu_dev);
+
+	if (osp == NULL || osp->opd_pre == NULL)
+		return count;
+
+	lprocfs_oh_clear(&osp->opd_pre_reserve_wait_hist);
+
+	return count;
+}
+LPROC_SEQ_FOPS(osp_precreate_stats);
+
 /**
  * Show last id to assign in creation
  *
@@ -689,6 +827,29 @@ static int osp_old_sync_processed_seq_show(struct seq_file *m, void *data)
 }
 LPROC_SEQ_FOPS_RO(osp_old_sync_processed);
 
+/**
+ * Show how many committed llog records were cancelled by the sync thread,
+ * and in how many batches
+ *
+ * \param[in] m		seq_file handle
+ * \param[in] data	unused for single entry
+ * \retval		0 on success
+ * \retval		negative number on error
+ */
+static int osp_sync_cancel_stats_seq_show(struct seq_file *m, void *data)
+{
+	struct obd_device	*dev = m->private;
+	struct osp_device	*osp = lu2osp_dev(dev->obd_lu_dev);
+
+	if (osp == NULL)
+		return -EINVAL;
+
+	seq_printf(m, "records: %llu\nbatches: %llu\n",
+		   osp->opd_sync_cancel_recs, osp->opd_sync_cancel_batches);
+	return 0;
+}
+LPROC_SEQ_FOPS_RO(osp_sync_cancel_stats);
+
 /**
  * Show maximum number of RPCs in flight
  *
@@ -908,6 +1069,10 @@ static struct lprocfs_vars lprocfs_osp_obd_vars[] = {
 	  .fops =	&osp_create_count_fops		},
 	{ .name =	"max_create_count",
 	  .fops =	&osp_max_create_count_fops	},
+	{ .name =	"create_seconds",
+	  .fops =	&osp_create_seconds_fops	},
+	{ .name =	"precreate_stats",
+	  .fops =	&osp_precreate_stats_fops	},
 	{ .name =	"prealloc_next_id",
 	  .fops =	&osp_prealloc_next_id_fops	},
 	{ .name =	"prealloc_next_seq",
@@ -936,6 +1101,8 @@ static struct lprocfs_vars lprocfs_osp_obd_vars[] = {
 	  .fops =	&osp_sync_rpcs_in_progress_fops	},
 	{ .name =	"old_sync_processed",
 	  .fops =	&osp_old_sync_processed_fops	},
+	{ .name =	"sync_cancel_stats",
+	  .fops =	&osp_sync_cancel_stats_fops	},
 	{ .name =	"reserved_mb_high",
 	  .fops =	&osp_reserved_mb_high_fops	},
 	{ .name =	"reserved_mb_low",
@@ -42,6 +42,7 @@
 #include <dt_object.h>
 #include <md_object.h>
 #include <lustre_fid.h>
+#include <lustre_log.h>
 #include <lustre_update.h>
 #include <lu_target.h>
 #include <lustre_mdc.h>
@@ -88,6 +89,18 @@ struct osp_precreate {
 	int				 osp_pre_create_slow;
 	/* cleaning up orphans or recreating missing objects */
 	int				 osp_pre_recovering;
+	/* seconds of objects to keep precreated at the current create rate,
+	 * 0 to only grow the precreation window when it runs low */
+	unsigned int			 osp_pre_create_seconds;
+	/* objects reserved since osp_pre_rate_stamp */
+	unsigned int			 osp_pre_rate_objs;
+	ktime_t				 osp_pre_rate_stamp;
+	/* smoothed object reservation rate, objects per second */
+	unsigned int			 osp_pre_create_rate;
+	/* smoothed precreate RPC latency, in usec */
+	unsigned int			 osp_pre_rpc_latency;
+	/* time spent in osp_precreate_reserve(), in usec */
+	struct obd_histogram		 osp_pre_reserve_wait_hist;
 };
 
 struct osp_update_request_sub {
@@ -221,6 +234,10 @@ struct osp_device {
 	/* number of RPC in processing (including non-committed by OST) */
 	atomic_t			 opd_sync_rpcs_in_progress;
 	int				 opd_sync_max_rpcs_in_progress;
+	/* committed records cancelled by the sync thread, and the number of
+	 * llog_cat_cancel_records() calls it took */
+	__u64				 opd_sync_cancel_recs;
+	__u64				 opd_sync_cancel_batches;
 	/* osd api's commit cb control structure */
 	struct dt_txn_callback		 opd_sync_txn_cb;
 	/* last used change number -- semantically similar to transno */
@@ -271,6 +288,11 @@ struct osp_device {
 	int				opd_reserved_mb_low;
 };
 
+/* default seconds of objects to keep precreated at the current create rate */
+#define OSP_PRECREATE_SECONDS		2
+/* interval the object reservation rate is sampled over, in usec */
+#define OSP_PRECREATE_RATE_INTERVAL	USEC_PER_SEC
+
 #define opd_pre_lock			opd_pre->osp_pre_lock
 #define opd_pre_used_fid		opd_pre->osp_pre_used_fid
 #define opd_pre_last_created_fid	opd_pre->osp_pre_last_created_fid
@@ -282,6 +304,12 @@ struct osp_device {
 #define opd_pre_max_create_count	opd_pre->osp_pre_max_create_count
 #define opd_pre_create_slow		opd_pre->osp_pre_create_slow
 #define opd_pre_recovering		opd_pre->osp_pre_recovering
+#define opd_pre_create_seconds		opd_pre->osp_pre_create_seconds
+#define opd_pre_rate_objs		opd_pre->osp_pre_rate_objs
+#define opd_pre_rate_stamp		opd_pre->osp_pre_rate_stamp
+#define opd_pre_create_rate		opd_pre->osp_pre_create_rate
+#define opd_pre_rpc_latency		opd_pre->osp_pre_rpc_latency
+#define opd_pre_reserve_wait_hist	opd_pre->osp_pre_reserve_wait_hist
 
 extern struct kmem_cache *osp_object_kmem;
 
@@ -338,6 +366,8 @@ struct osp_thread_info {
 		struct llog_gen_rec		osi_gen;
 	};
 	struct llog_cookie	 osi_cookie;
+	/* committed records cancelled together by the sync thread */
+	struct llog_cookie	 osi_cookies[LLOG_CAT_CANCEL_BATCH];
 	struct llog_catid	 osi_cid;
 	struct lu_seq_range	 osi_seq;
 	struct ldlm_res_id	 osi_resid;
@@ -792,6 +822,7 @@ extern const struct dt_index_operations osp_md_index_ops;
 /* osp_precreate.c */
 int osp_init_precreate(struct osp_device *d);
 int osp_precreate_reserve(const struct lu_env *env, struct osp_device *d);
+unsigned int osp_precreate_rate_nolock(struct osp_device *d);
 __u64 osp_precreate_get_id(struct osp_device *d);
 int osp_precreate_get_fid(const struct lu_env *env, struct osp_device *d,
 			  struct lu_fid *fid);
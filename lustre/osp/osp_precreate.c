@@ -283,6 +283,108 @@ static inline int osp_objs_precreated(const struct lu_env *env,
 			    &osp->opd_pre_used_fid);
 }
 
+/**
+ * Fold the objects reserved since the last sample into the create rate
+ *
+ * The object reservation rate is sampled every OSP_PRECREATE_RATE_INTERVAL
+ * and smoothed with an exponentially weighted moving average. A sample
+ * which spans several intervals, because there were no reservations for
+ * a while, is weighted as that many samples, so the rate decays with the
+ * elapsed time when creates stop. Notice this function relies on an
+ * external locking.
+ *
+ * \param[in] d		OSP device
+ * \param[in] now	current time
+ */
+static void osp_precreate_rate_fold_nolock(struct osp_device *d, ktime_t now)
+{
+	s64 delta = ktime_us_delta(now, d->opd_pre_rate_stamp);
+	unsigned int rate;
+	int n;
+
+	if (delta < OSP_PRECREATE_RATE_INTERVAL)
+		return;
+
+	rate = div64_s64((s64)d->opd_pre_rate_objs * USEC_PER_SEC, delta);
+	/* after 32 intervals the old rate has no weight left */
+	n = min_t(s64, div64_s64(delta, OSP_PRECREATE_RATE_INTERVAL), 32);
+	while (n-- > 0)
+		d->opd_pre_create_rate = (d->opd_pre_create_rate * 3 +
+					  rate) / 4;
+	d->opd_pre_rate_objs = 0;
+	d->opd_pre_rate_stamp = now;
+}
+
+/**
+ * Account a reserved object in the create rate of the OSP
+ *
+ * Notice this function relies on an external locking.
+ *
+ * \param[in] d		OSP device
+ */
+static void osp_precreate_rate_update_nolock(struct osp_device *d)
+{
+	d->opd_pre_rate_objs++;
+	osp_precreate_rate_fold_nolock(d, ktime_get());
+}
+
+/**
+ * Current create rate of the OSP, decayed by the time elapsed since the
+ * last reservation
+ *
+ * Notice this function relies on an external locking.
+ *
+ * \param[in] d		OSP device
+ *
+ * \retval		objects per second
+ */
+unsigned int osp_precreate_rate_nolock(struct osp_device *d)
+{
+	osp_precreate_rate_fold_nolock(d, ktime_get());
+
+	return d->opd_pre_create_rate;
+}
+
+/**
+ * Number of objects consumed in \a usec at the current create rate
+ *
+ * Notice this function relies on an external locking.
+ *
+ * \param[in] d		OSP device
+ * \param[in] usec	time in usec
+ *
+ * \retval		number of objects, not more than OST_MAX_PRECREATE
+ */
+static inline int osp_precreate_rate_objs(struct osp_device *d, __u64 usec)
+{
+	return min_t(__u64, div_u64((__u64)osp_precreate_rate_nolock(d) * usec,
+				    USEC_PER_SEC),
+		     OST_MAX_PRECREATE);
+}
+
+/**
+ * Number of objects to precreate to sustain the current create rate
+ *
+ * Ask for enough objects to last opd_pre_create_seconds plus the time of a
+ * precreate RPC at the measured create rate, so that creations do not have
+ * to wait for objects while the next precreate RPC is in flight. Notice this
+ * function relies on an external locking.
+ *
+ * \param[in] d		OSP device
+ *
+ * \retval		number of objects to precreate
+ */
+static int osp_precreate_target_nolock(struct osp_device *d)
+{
+	int target;
+
+	target = osp_precreate_rate_objs(d, (__u64)d->opd_pre_create_seconds *
+					 USEC_PER_SEC + d->opd_pre_rpc_latency);
+	target = max(target, d->opd_pre_min_create_count);
+
+	return min(target, d->opd_pre_max_create_count);
+}
+
 /**
  * Check pool of precreated objects is nearly empty
  *
@@ -301,10 +403,18 @@ static inline int osp_precreate_near_empty_nolock(const struct lu_env *env,
 						  struct osp_device *d)
 {
 	int window = osp_objs_precreated(env, d);
+	int low = d->opd_pre_create_count / 2;
+
+	/* keep enough objects to last two precreate RPCs at the current
+	 * create rate, so the next precreation is done before the pool
+	 * gets empty even if the OST is slow to answer */
+	if (d->opd_pre_create_seconds > 0)
+		low = max(low, osp_precreate_rate_objs(d,
+					2 * d->opd_pre_rpc_latency));
 
 	/* don't consider new precreation till OST is healty and
 	 * has free space */
-	return ((window - d->opd_pre_reserved < d->opd_pre_create_count / 2) &&
+	return ((window - d->opd_pre_reserved < low) &&
 		(d->opd_pre_status == 0));
 }
 
@@ -576,6 +686,8 @@ static int osp_precreate_send(const struct lu_env *env, struct osp_device *d)
 	struct ost_body		*body;
 	int			 rc, grow, diff;
 	struct lu_fid		*fid = &oti->osi_fid;
+	ktime_t			 start;
+	s64			 latency;
 	ENTRY;
 
 	/* don't precreate new objects till OST healthy and has free space */
@@ -606,6 +718,9 @@ static int osp_precreate_send(const struct lu_env *env, struct osp_device *d)
 	}
 
 	spin_lock(&d->opd_pre_lock);
+	/* follow the create rate, unless the OST can't keep up */
+	if (d->opd_pre_create_seconds > 0 && d->opd_pre_create_slow == 0)
+		d->opd_pre_create_count = osp_precreate_target_nolock(d);
 	if (d->opd_pre_create_count > d->opd_pre_max_create_count / 2)
 		d->opd_pre_create_count = d->opd_pre_max_create_count / 2;
 	grow = d->opd_pre_create_count;
@@ -641,6 +756,7 @@ static int osp_precreate_send(const struct lu_env *env, struct osp_device *d)
 	if (OBD_FAIL_CHECK(OBD_FAIL_OSP_FAKE_PRECREATE))
 		GOTO(ready, rc = 0);
 
+	start = ktime_get();
 	rc = ptlrpc_queue_wait(req);
 	if (rc) {
 		CERROR("%s: can't precreate: rc = %d\n", d->opd_obd->obd_name,
@@ -649,6 +765,15 @@ static int osp_precreate_send(const struct lu_env *env, struct osp_device *d)
 	}
 	LASSERT(req->rq_transno == 0);
 
+	latency = ktime_us_delta(ktime_get(), start);
+	spin_lock(&d->opd_pre_lock);
+	if (d->opd_pre_rpc_latency == 0)
+		d->opd_pre_rpc_latency = latency;
+	else
+		d->opd_pre_rpc_latency = (d->opd_pre_rpc_latency * 3 +
+					  latency) / 4;
+	spin_unlock(&d->opd_pre_lock);
+
 	body = req_capsule_server_get(&req->rq_pill, &RMF_OST_BODY);
 	if (body == NULL)
 		GOTO(out_req, rc = -EPROTO);
@@ -1386,8 +1511,10 @@ static int osp_precreate_timeout_condition(void *data)
 int osp_precreate_reserve(const struct lu_env *env, struct osp_device *d)
 {
 	time64_t expire = ktime_get_seconds() + obd_timeout;
+	ktime_t start = ktime_get();
 	struct l_wait_info lwi;
 	int precreated, rc, synced = 0;
+	bool wakeup;
 
 	ENTRY;
 
@@ -1413,7 +1540,8 @@ int osp_precreate_reserve(const struct lu_env *env, struct osp_device *d)
 		 * increase number of precreations
 		 */
 		precreated = osp_objs_precreated(env, d);
-		if (d->opd_pre_create_count < d->opd_pre_max_create_count &&
+		if (d->opd_pre_create_seconds == 0 &&
+		    d->opd_pre_create_count < d->opd_pre_max_create_count &&
 		    d->opd_pre_create_slow == 0 &&
 		    precreated <= (d->opd_pre_create_count / 4 + 1)) {
 			spin_lock(&d->opd_pre_lock);
@@ -1427,12 +1555,20 @@ int osp_precreate_reserve(const struct lu_env *env, struct osp_device *d)
 		if (precreated > d->opd_pre_reserved &&
 		    !d->opd_pre_recovering) {
 			d->opd_pre_reserved++;
+			osp_precreate_rate_update_nolock(d);
+			/* size the window after the measured create rate */
+			if (d->opd_pre_create_seconds > 0 &&
+			    d->opd_pre_create_slow == 0)
+				d->opd_pre_create_count =
+					max(d->opd_pre_create_count,
+					    osp_precreate_target_nolock(d));
+			/* XXX: don't wake up if precreation is in progress */
+			wakeup = osp_precreate_near_empty_nolock(env, d) &&
+				 !osp_precreate_end_seq_nolock(env, d);
 			spin_unlock(&d->opd_pre_lock);
 			rc = 0;
 
-			/* XXX: don't wake up if precreation is in progress */
-			if (osp_precreate_near_empty_nolock(env, d) &&
-			   !osp_precreate_end_seq_nolock(env, d))
+			if (wakeup)
 				wake_up(&d->opd_pre_waitq);
 
 			break;
@@ -1477,6 +1613,9 @@ int osp_precreate_reserve(const struct lu_env *env, struct osp_device *d)
 			     osp_precreate_ready_condition(env, d), &lwi);
 	}
 
+	lprocfs_oh_tally_log2(&d->opd_pre_reserve_wait_hist,
+			      ktime_us_delta(ktime_get(), start));
+
 	RETURN(rc);
 }
 
@@ -1689,6 +1828,9 @@ int osp_init_precreate(struct osp_device *d)
 	d->opd_pre_create_count = OST_MIN_PRECREATE;
 	d->opd_pre_min_create_count = OST_MIN_PRECREATE;
 	d->opd_pre_max_create_count = OST_MAX_PRECREATE;
+	d->opd_pre_create_seconds = OSP_PRECREATE_SECONDS;
+	d->opd_pre_rate_stamp = ktime_get();
+	spin_lock_init(&d->opd_pre_reserve_wait_hist.oh_lock);
 	d->opd_reserved_mb_high = 0;
 	d->opd_reserved_mb_low = 0;
 
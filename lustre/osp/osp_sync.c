@@ -999,12 +999,13 @@ static void osp_sync_process_committed(const struct lu_env *env,
 {
 	struct obd_device	*obd = d->opd_obd;
 	struct obd_import	*imp = obd->u.cli.cl_import;
+	struct osp_thread_info	*osi = osp_env_info(env);
 	struct ost_body		*body;
 	struct ptlrpc_request	*req;
 	struct llog_ctxt	*ctxt;
 	struct llog_handle	*llh;
 	struct list_head	 list;
-	int			 rc, done = 0;
+	int			 rc, done = 0, count = 0;
 
 	ENTRY;
 
@@ -1022,9 +1023,9 @@ static void osp_sync_process_committed(const struct lu_env *env,
 		osp_statfs_need_now(d);
 
 	/*
-	 * now cancel them all
-	 * XXX: can we improve this using some batching?
-	 *      with batch RPC that'll happen automatically?
+	 * now cancel them all, records are gathered in batches so that
+	 * the records of the same plain llog are cancelled in a single
+	 * transaction by llog_cat_cancel_records()
 	 * XXX: can we store ctxt in lod_device and save few cycles ?
 	 */
 	ctxt = llog_get_context(obd, LLOG_MDS_OST_ORIG_CTXT);
@@ -1055,17 +1056,25 @@ static void osp_sync_process_committed(const struct lu_env *env,
 		/* import can be closing, thus all commit cb's are
 		 * called we can check committness directly */
 		if (req->rq_import_generation == imp->imp_generation) {
-			rc = llog_cat_cancel_records(env, llh, 1,
-						     &jra->jra_lcookie);
-			if (rc)
-				CERROR("%s: can't cancel record: %d\n",
-				       obd->obd_name, rc);
+			osi->osi_cookies[count++] = jra->jra_lcookie;
 		} else {
 			DEBUG_REQ(D_OTHER, req, "imp_committed = %llu",
 				  imp->imp_peer_committed_transno);
 		}
 		ptlrpc_req_finished(req);
 		done++;
+
+		if (count == ARRAY_SIZE(osi->osi_cookies) ||
+		    (count > 0 && list_empty(&list))) {
+			rc = llog_cat_cancel_records(env, llh, count,
+						     osi->osi_cookies);
+			if (rc)
+				CERROR("%s: can't cancel %d records: %d\n",
+				       obd->obd_name, count, rc);
+			d->opd_sync_cancel_recs += count;
+			d->opd_sync_cancel_batches++;
+			count = 0;
+		}
 	}
 
 	llog_ctxt_put(ctxt);
@@ -570,6 +570,12 @@ static const struct req_msg_field *llog_log_hdr_only[] = {
         &RMF_LLOG_LOG_HDR
 };
 
+static const struct req_msg_field *llog_origin_handle_next_block_client[] = {
+	&RMF_PTLRPC_BODY,
+	&RMF_LLOGD_BODY,
+	&RMF_CHANGELOG_FILTER
+};
+
 static const struct req_msg_field *llog_origin_handle_next_block_server[] = {
         &RMF_PTLRPC_BODY,
         &RMF_LLOGD_BODY,
@@ -1013,6 +1019,12 @@ struct req_msg_field RMF_LLOGD_BODY =
                     sizeof(struct llogd_body), lustre_swab_llogd_body, NULL);
 EXPORT_SYMBOL(RMF_LLOGD_BODY);
 
+/* empty unless the reader of a changelog filters records */
+struct req_msg_field RMF_CHANGELOG_FILTER =
+	DEFINE_MSGF("changelog_filter", 0, sizeof(struct changelog_filter),
+		    lustre_swab_changelog_filter, NULL);
+EXPORT_SYMBOL(RMF_CHANGELOG_FILTER);
+
 struct req_msg_field RMF_LLOG_LOG_HDR =
         DEFINE_MSGF("llog_log_hdr", 0,
                     sizeof(struct llog_log_hdr), lustre_swab_llog_hdr, NULL);
@@ -1604,8 +1616,9 @@ struct req_format RQF_LLOG_ORIGIN_HANDLE_CREATE =
 EXPORT_SYMBOL(RQF_LLOG_ORIGIN_HANDLE_CREATE);
 
 struct req_format RQF_LLOG_ORIGIN_HANDLE_NEXT_BLOCK =
-        DEFINE_REQ_FMT0("LLOG_ORIGIN_HANDLE_NEXT_BLOCK",
-                        llogd_body_only, llog_origin_handle_next_block_server);
+	DEFINE_REQ_FMT0("LLOG_ORIGIN_HANDLE_NEXT_BLOCK",
+			llog_origin_handle_next_block_client,
+			llog_origin_handle_next_block_server);
 EXPORT_SYMBOL(RQF_LLOG_ORIGIN_HANDLE_NEXT_BLOCK);
 
 struct req_format RQF_LLOG_ORIGIN_HANDLE_PREV_BLOCK =
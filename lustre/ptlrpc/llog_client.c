@@ -136,24 +136,72 @@ out:
 	return rc;
 }
 
+/**
+ * Get the filter of the reader of the remote changelog \a loghandle is part
+ * of, if it filters records.
+ *
+ * \param[in] loghandle	plain llog handle
+ * \param[out] cf		filter of the reader
+ *
+ * \retval true if the reader filters records
+ */
+static bool llog_client_chlg_filter(struct llog_handle *loghandle,
+				    struct changelog_filter *cf)
+{
+	struct llog_handle *cathandle;
+	struct llog_chlg_filter *lcf;
+
+	if (!(loghandle->lgh_hdr->llh_flags & LLOG_F_IS_PLAIN))
+		return false;
+
+	cathandle = loghandle->u.phd.phd_cat_handle;
+	if (cathandle == NULL || cathandle->u.chd.chd_chlg_filter == NULL)
+		return false;
+
+	lcf = cathandle->u.chd.chd_chlg_filter;
+	spin_lock(&lcf->lcf_lock);
+	*cf = lcf->lcf_filter;
+	spin_unlock(&lcf->lcf_lock);
+
+	return cf->cf_type_mask != 0 || cf->cf_shard_count > 1;
+}
+
 static int llog_client_next_block(const struct lu_env *env,
 				  struct llog_handle *loghandle,
 				  int *cur_idx, int next_idx,
 				  __u64 *cur_offset, void *buf, int len)
 {
-        struct obd_import     *imp;
-        struct ptlrpc_request *req = NULL;
-        struct llogd_body     *body;
-        void                  *ptr;
-        int                    rc;
-        ENTRY;
+	struct obd_import     *imp;
+	struct ptlrpc_request *req = NULL;
+	struct llogd_body     *body;
+	struct changelog_filter cf;
+	struct changelog_filter *pcf;
+	bool		       filter;
+	void                  *ptr;
+	__u32		       size;
+	int                    rc;
+	ENTRY;
+
+	LLOG_CLIENT_ENTRY(loghandle->lgh_ctxt, imp);
+	req = ptlrpc_request_alloc(imp, &RQF_LLOG_ORIGIN_HANDLE_NEXT_BLOCK);
+	if (req == NULL)
+		GOTO(err_exit, rc = -ENOMEM);
+
+	filter = llog_client_chlg_filter(loghandle, &cf);
+	req_capsule_set_size(&req->rq_pill, &RMF_CHANGELOG_FILTER, RCL_CLIENT,
+			     filter ? sizeof(cf) : 0);
+	rc = ptlrpc_request_pack(req, LUSTRE_LOG_VERSION,
+				 LLOG_ORIGIN_HANDLE_NEXT_BLOCK);
+	if (rc) {
+		ptlrpc_request_free(req);
+		GOTO(err_exit, rc);
+	}
 
-        LLOG_CLIENT_ENTRY(loghandle->lgh_ctxt, imp);
-        req = ptlrpc_request_alloc_pack(imp, &RQF_LLOG_ORIGIN_HANDLE_NEXT_BLOCK,
-                                        LUSTRE_LOG_VERSION,
-                                        LLOG_ORIGIN_HANDLE_NEXT_BLOCK);
-        if (req == NULL)
-                GOTO(err_exit, rc =-ENOMEM);
+	if (filter) {
+		pcf = req_capsule_client_get(&req->rq_pill,
+					     &RMF_CHANGELOG_FILTER);
+		*pcf = cf;
+	}
 
         body = req_capsule_client_get(&req->rq_pill, &RMF_LLOGD_BODY);
         body->lgd_logid = loghandle->lgh_id;
@@ -192,13 +240,18 @@ static int llog_client_next_block(const struct lu_env *env,
 	if (rc < 0)
 		GOTO(out, rc);
 
-        /* The log records are swabbed as they are processed */
-        ptr = req_capsule_server_get(&req->rq_pill, &RMF_EADATA);
-        if (ptr == NULL)
-                GOTO(out, rc =-EFAULT);
+	/* The log records are swabbed as they are processed. A block
+	 * filtered by the server is shorter, see llog_chlg_filter_block() */
+	size = min_t(__u32, len, req_capsule_get_size(&req->rq_pill,
+						      &RMF_EADATA, RCL_SERVER));
 
-        memcpy(buf, ptr, len);
-        EXIT;
+	ptr = req_capsule_server_sized_get(&req->rq_pill, &RMF_EADATA, size);
+	if (ptr == NULL)
+		GOTO(out, rc = -EFAULT);
+
+	memcpy(buf, ptr, size);
+	memset((char *)buf + size, 0, len - size);
+	EXIT;
 out:
         ptlrpc_req_finished(req);
 err_exit:
@@ -111,14 +111,97 @@ out_ctxt:
 	return rc;
 }
 
+/**
+ * Drop the changelog records of a block which the reader does not want.
+ *
+ * Each of them is replaced by a LLOG_MIN_REC_SIZE padding record with the
+ * same index, so that the reader still sees every index it expects, and the
+ * records are packed at the start of the block. A full block is terminated
+ * by a padding record header which covers the rest of the block and carries
+ * the index of the last record, which the reader skips. The end of a partial
+ * block is zeroed, as when it is read from disk.
+ *
+ * \param[in] cf	filter sent by the reader
+ * \param[in,out] buf	block read by llog_next_block()
+ * \param[in] len	size of \a buf
+ * \param[in] partial	whether the block is the partial last block of the log
+ *
+ * \retval		number of bytes of \a buf to send to the reader
+ */
+static int llog_chlg_filter_block(const struct changelog_filter *cf,
+				  char *buf, int len, bool partial)
+{
+	struct llog_rec_hdr *rec;
+	struct llog_rec_tail *tail;
+	char *end = buf + len;
+	char *src = buf;
+	char *dst = buf;
+	__u32 last_index = 0;
+	__u32 rec_len;
+	__u32 index;
+	bool filtered = false;
+
+	while (end - src >= LLOG_MIN_REC_SIZE) {
+		rec = (struct llog_rec_hdr *)src;
+		rec_len = rec->lrh_len;
+		index = rec->lrh_index;
+		if (index == 0 || rec_len < LLOG_MIN_REC_SIZE ||
+		    rec_len > end - src)
+			break;
+
+		if (rec->lrh_type == CHANGELOG_REC &&
+		    !llog_chlg_filter_match(cf,
+			&((struct llog_changelog_rec *)rec)->cr)) {
+			rec = (struct llog_rec_hdr *)dst;
+			rec->lrh_len = LLOG_MIN_REC_SIZE;
+			rec->lrh_index = index;
+			rec->lrh_type = LLOG_PAD_MAGIC;
+			rec->lrh_id = 0;
+			tail = rec_tail(rec);
+			tail->lrt_len = LLOG_MIN_REC_SIZE;
+			tail->lrt_index = index;
+			dst += LLOG_MIN_REC_SIZE;
+			filtered = true;
+		} else {
+			if (dst != src)
+				memmove(dst, src, rec_len);
+			dst += rec_len;
+		}
+		last_index = index;
+		src += rec_len;
+	}
+
+	if (!filtered)
+		return len;
+
+	/* anything unexpected is left for the reader to complain about */
+	if (src < end && !partial) {
+		memmove(dst, src, end - src);
+		return dst - buf + (end - src);
+	}
+
+	memset(dst, 0, end - dst);
+	if (partial)
+		return dst - buf;
+
+	rec = (struct llog_rec_hdr *)dst;
+	rec->lrh_len = end - dst;
+	rec->lrh_index = last_index;
+	rec->lrh_type = LLOG_PAD_MAGIC;
+
+	return dst - buf + sizeof(*rec);
+}
+
 int llog_origin_handle_next_block(struct ptlrpc_request *req)
 {
 	struct llog_handle	*loghandle;
 	struct llogd_body	*body;
 	struct llogd_body	*repbody;
+	struct changelog_filter	*cf = NULL;
 	struct llog_ctxt	*ctxt;
 	__u32			 flags;
 	void			*ptr;
+	int			 len;
 	int			 rc;
 
 	ENTRY;
@@ -127,6 +210,16 @@ int llog_origin_handle_next_block(struct ptlrpc_request *req)
 	if (body == NULL)
 		RETURN(err_serious(-EFAULT));
 
+	/* older clients do not send the field, and others only when the
+	 * reader of a changelog filters records */
+	if (req_capsule_get_size(&req->rq_pill, &RMF_CHANGELOG_FILTER,
+				 RCL_CLIENT) != 0) {
+		cf = req_capsule_client_get(&req->rq_pill,
+					    &RMF_CHANGELOG_FILTER);
+		if (cf == NULL)
+			RETURN(err_serious(-EFAULT));
+	}
+
 	req_capsule_set_size(&req->rq_pill, &RMF_EADATA, RCL_SERVER,
 			     LLOG_MIN_CHUNK_SIZE);
 	rc = req_capsule_server_pack(&req->rq_pill);
@@ -164,6 +257,15 @@ int llog_origin_handle_next_block(struct ptlrpc_request *req)
 			     LLOG_MIN_CHUNK_SIZE);
 	if (rc)
 		GOTO(out_close, rc);
+
+	if (cf != NULL && (flags & LLOG_F_IS_PLAIN)) {
+		len = llog_chlg_filter_block(cf, ptr, LLOG_MIN_CHUNK_SIZE,
+				(repbody->lgd_cur_offset &
+				 (LLOG_MIN_CHUNK_SIZE - 1)) != 0);
+		if (len < LLOG_MIN_CHUNK_SIZE)
+			req_capsule_shrink(&req->rq_pill, &RMF_EADATA, len,
+					   RCL_SERVER);
+	}
 	EXIT;
 out_close:
 	llog_origin_close(req->rq_svc_thread->t_env, loghandle);
@@ -476,6 +476,39 @@ static ssize_t threads_max_store(struct kobject *kobj, struct attribute *attr,
 }
 LUSTRE_RW_ATTR(threads_max);
 
+static ssize_t threads_idle_timeout_show(struct kobject *kobj,
+					 struct attribute *attr, char *buf)
+{
+	struct ptlrpc_service *svc = container_of(kobj, struct ptlrpc_service,
+						  srv_kobj);
+
+	return sprintf(buf, "%d\n", svc->srv_thr_idle_timeout);
+}
+
+static ssize_t threads_idle_timeout_store(struct kobject *kobj,
+					  struct attribute *attr,
+					  const char *buffer, size_t count)
+{
+	struct ptlrpc_service *svc = container_of(kobj, struct ptlrpc_service,
+						  srv_kobj);
+	unsigned int val;
+	int rc;
+
+	rc = kstrtouint(buffer, 10, &val);
+	if (rc < 0)
+		return rc;
+
+	if (val > INT_MAX / HZ)
+		return -ERANGE;
+
+	spin_lock(&svc->srv_lock);
+	svc->srv_thr_idle_timeout = val;
+	spin_unlock(&svc->srv_lock);
+
+	return count;
+}
+LUSTRE_RW_ATTR(threads_idle_timeout);
+
 /**
  * Translates \e ptlrpc_nrs_pol_state values to human-readable strings.
  *
@@ -1119,6 +1152,73 @@ static int ptlrpc_lprocfs_timeouts_seq_show(struct seq_file *m, void *n)
 
 LDEBUGFS_SEQ_FOPS_RO(ptlrpc_lprocfs_timeouts);
 
+#define pct(a, b) (b ? a * 100 / b : 0)
+
+/**
+ * Show for each partition of the service the number of requests by the
+ * time they waited in the queue before a thread picked them up. Threads
+ * are added when all of them are busy and retired after idling for
+ * threads_idle_timeout, so long queue times with threads_started at
+ * threads_max mean the service is short of threads.
+ */
+static int ptlrpc_lprocfs_req_queue_time_seq_show(struct seq_file *m, void *n)
+{
+	struct ptlrpc_service *svc = m->private;
+	struct ptlrpc_service_part *svcpt;
+	struct timespec64 now;
+	unsigned long tot;
+	unsigned long cum;
+	unsigned long r;
+	int i;
+	int j;
+
+	ktime_get_real_ts64(&now);
+	seq_printf(m, "snapshot_time:         %lld.%09ld (secs.nsecs)\n",
+		   (s64)now.tv_sec, now.tv_nsec);
+
+	ptlrpc_service_for_each_part(svcpt, i, svc) {
+		seq_printf(m, "\ncpt %d: threads %d (stopping %d)\n",
+			   svcpt->scp_cpt, svcpt->scp_nthrs_running,
+			   svcpt->scp_nthrs_stopping);
+		seq_printf(m, "%-22s %-5s %% cum %%\n", "queue time", "rpcs");
+
+		tot = lprocfs_oh_sum(&svcpt->scp_queue_hist);
+		cum = 0;
+		for (j = 0; j < OBD_HIST_MAX && cum < tot; j++) {
+			r = svcpt->scp_queue_hist.oh_buckets[j];
+			cum += r;
+			if (cum == 0)
+				continue;
+
+			if (j < 10)
+				seq_printf(m, "%lums:", 1UL << j);
+			else
+				seq_printf(m, "%lus:", 1UL << (j - 10));
+			seq_printf(m, "\t\t%10lu %3lu %3lu\n",
+				   r, pct(r, tot), pct(cum, tot));
+		}
+	}
+
+	return 0;
+}
+
+static ssize_t
+ptlrpc_lprocfs_req_queue_time_seq_write(struct file *file,
+					const char __user *buffer,
+					size_t count, loff_t *off)
+{
+	struct seq_file *m = file->private_data;
+	struct ptlrpc_service *svc = m->private;
+	struct ptlrpc_service_part *svcpt;
+	int i;
+
+	ptlrpc_service_for_each_part(svcpt, i, svc)
+		lprocfs_oh_clear(&svcpt->scp_queue_hist);
+
+	return count;
+}
+LDEBUGFS_SEQ_FOPS(ptlrpc_lprocfs_req_queue_time);
+
 static ssize_t high_priority_ratio_show(struct kobject *kobj,
 					struct attribute *attr,
 					char *buf)
@@ -1155,6 +1255,7 @@ static struct attribute *ptlrpc_svc_attrs[] = {
 	&lustre_attr_threads_min.attr,
 	&lustre_attr_threads_started.attr,
 	&lustre_attr_threads_max.attr,
+	&lustre_attr_threads_idle_timeout.attr,
 	&lustre_attr_high_priority_ratio.attr,
 	NULL,
 };
@@ -1210,6 +1311,9 @@ void ptlrpc_ldebugfs_register_service(struct dentry *entry,
 		{ .name = "req_buffers_max",
 		  .fops = &ptlrpc_lprocfs_req_buffers_max_fops,
 		  .data = svc },
+		{ .name = "req_queue_time",
+		  .fops = &ptlrpc_lprocfs_req_queue_time_fops,
+		  .data = svc },
 		{ NULL }
         };
         static struct file_operations req_history_fops = {
@@ -82,6 +82,8 @@ static enum hrtimer_restart nrs_tbf_timer_cb(struct hrtimer *timer)
 
 #define NRS_TBF_DEFAULT_RULE "default"
 
+static void nrs_tbf_rule_put(struct nrs_tbf_rule *rule);
+
 static void nrs_tbf_rule_fini(struct nrs_tbf_rule *rule)
 {
 	LASSERT(atomic_read(&rule->tr_ref) == 0);
@@ -89,6 +91,14 @@ static void nrs_tbf_rule_fini(struct nrs_tbf_rule *rule)
 	LASSERT(list_empty(&rule->tr_linkage));
 
 	rule->tr_head->th_ops->o_rule_fini(rule);
+	if (rule->tr_borrow_heap != NULL) {
+		LASSERT(cfs_binheap_is_empty(rule->tr_borrow_heap));
+		cfs_binheap_destroy(rule->tr_borrow_heap);
+	}
+	if (rule->tr_parent != NULL) {
+		atomic_dec(&rule->tr_head->th_nr_child_rules);
+		nrs_tbf_rule_put(rule->tr_parent);
+	}
 	OBD_FREE_PTR(rule);
 }
 
@@ -112,6 +122,128 @@ static inline void nrs_tbf_rule_get(struct nrs_tbf_rule *rule)
 	atomic_inc(&rule->tr_ref);
 }
 
+/**
+ * Refills the token bucket which \a rule shares among its child rules.
+ *
+ * \param[in] rule	the parent rule
+ * \param[in] now	current time in nanoseconds
+ *
+ * \retval the number of tokens available to the child rules
+ */
+static __u64
+nrs_tbf_rule_refill(struct nrs_tbf_rule *rule, __u64 now)
+{
+	__u64 passed;
+	__u64 ntoken;
+
+	if (now <= rule->tr_check_time)
+		return rule->tr_ntoken;
+
+	passed = now - rule->tr_check_time;
+	if (passed >= rule->tr_depth * rule->tr_nsecs) {
+		ntoken = rule->tr_depth;
+	} else {
+		ntoken = passed * rule->tr_rpc_rate;
+		do_div(ntoken, NSEC_PER_SEC);
+		/* Keep the fraction of a token earned so far */
+		if (ntoken == 0)
+			return rule->tr_ntoken;
+
+		ntoken += rule->tr_ntoken;
+		if (ntoken > rule->tr_depth)
+			ntoken = rule->tr_depth;
+	}
+
+	rule->tr_ntoken = ntoken;
+	rule->tr_check_time = now;
+
+	return ntoken;
+}
+
+/**
+ * Orders the classes of the child rules of a parent rule by deadline, as
+ * tbf_cli_compare() does for all the classes.
+ */
+static int
+tbf_borrow_cli_compare(struct cfs_binheap_node *e1,
+		       struct cfs_binheap_node *e2)
+{
+	struct nrs_tbf_client *cli1;
+	struct nrs_tbf_client *cli2;
+
+	cli1 = container_of(e1, struct nrs_tbf_client, tc_borrow_node);
+	cli2 = container_of(e2, struct nrs_tbf_client, tc_borrow_node);
+
+	if (cli1->tc_deadline < cli2->tc_deadline)
+		return 1;
+	else if (cli1->tc_deadline > cli2->tc_deadline)
+		return 0;
+
+	return cli1->tc_check_time <= cli2->tc_check_time;
+}
+
+static struct cfs_binheap_ops nrs_tbf_borrow_heap_ops = {
+	.hop_enter	= NULL,
+	.hop_exit	= NULL,
+	.hop_compare	= tbf_borrow_cli_compare,
+};
+
+/**
+ * Adds the queued class \a cli to the heap of its parent rule, if any, so
+ * that it may borrow the tokens of the parent. A class which cannot be
+ * added for lack of memory only uses its own tokens.
+ */
+static void
+nrs_tbf_cli_borrow_add(struct nrs_tbf_head *head, struct nrs_tbf_client *cli)
+{
+	struct nrs_tbf_rule *parent = cli->tc_rule->tr_parent;
+
+	if (parent == NULL || cli->tc_borrow_heap != NULL)
+		return;
+
+	LASSERT(parent->tr_borrow_heap != NULL);
+	if (cfs_binheap_insert(parent->tr_borrow_heap,
+			       &cli->tc_borrow_node) != 0)
+		return;
+
+	cli->tc_borrow_heap = parent->tr_borrow_heap;
+	if (list_empty(&parent->tr_borrow_linkage))
+		list_add_tail(&parent->tr_borrow_linkage,
+			      &head->th_borrow_rules);
+}
+
+/**
+ * Removes class \a cli from the heap of the parent rule it is in, if any.
+ */
+static void
+nrs_tbf_cli_borrow_del(struct nrs_tbf_client *cli)
+{
+	struct cfs_binheap *heap = cli->tc_borrow_heap;
+	struct nrs_tbf_rule *parent;
+
+	if (heap == NULL)
+		return;
+
+	cfs_binheap_remove(heap, &cli->tc_borrow_node);
+	cli->tc_borrow_heap = NULL;
+	if (cfs_binheap_is_empty(heap)) {
+		parent = heap->cbh_private;
+		list_del_init(&parent->tr_borrow_linkage);
+	}
+}
+
+/**
+ * Moves the queued class \a cli in the heaps after its deadline changed.
+ */
+static void
+nrs_tbf_cli_relocate(struct nrs_tbf_head *head, struct nrs_tbf_client *cli)
+{
+	cfs_binheap_relocate(head->th_binheap, &cli->tc_node);
+	if (cli->tc_borrow_heap != NULL)
+		cfs_binheap_relocate(cli->tc_borrow_heap,
+				     &cli->tc_borrow_node);
+}
+
 static void
 nrs_tbf_cli_rule_put(struct nrs_tbf_client *cli)
 {
@@ -139,9 +271,10 @@ nrs_tbf_cli_reset_value(struct nrs_tbf_head *head,
 	cli->tc_rule_sequence = atomic_read(&head->th_rule_sequence);
 	cli->tc_rule_generation = rule->tr_generation;
 
-	if (cli->tc_in_heap)
-		cfs_binheap_relocate(head->th_binheap,
-				     &cli->tc_node);
+	if (cli->tc_in_heap) {
+		nrs_tbf_cli_borrow_add(head, cli);
+		nrs_tbf_cli_relocate(head, cli);
+	}
 }
 
 static void
@@ -152,6 +285,8 @@ nrs_tbf_cli_reset(struct nrs_tbf_head *head,
 	spin_lock(&cli->tc_rule_lock);
 	if (cli->tc_rule != NULL && !list_empty(&cli->tc_linkage)) {
 		LASSERT(rule != cli->tc_rule);
+		/* The parent rule of the new rule may differ */
+		nrs_tbf_cli_borrow_del(cli);
 		nrs_tbf_cli_rule_put(cli);
 	}
 	LASSERT(cli->tc_rule == NULL);
@@ -168,7 +303,17 @@ nrs_tbf_cli_reset(struct nrs_tbf_head *head,
 static int
 nrs_tbf_rule_dump(struct nrs_tbf_rule *rule, struct seq_file *m)
 {
-	return rule->tr_head->th_ops->o_rule_dump(rule, m);
+	int rc;
+
+	rc = rule->tr_head->th_ops->o_rule_dump(rule, m);
+	if (rc)
+		return rc;
+
+	if (rule->tr_parent != NULL)
+		seq_printf(m, ", parent %s", rule->tr_parent->tr_name);
+	seq_putc(m, '\n');
+
+	return 0;
 }
 
 static int
@@ -286,9 +431,15 @@ nrs_tbf_rule_start(struct ptlrpc_nrs_policy *policy,
 	struct nrs_tbf_rule	*rule;
 	struct nrs_tbf_rule	*tmp_rule;
 	struct nrs_tbf_rule	*next_rule;
+	struct nrs_tbf_rule	*parent_rule;
 	char			*next_name = start->u.tc_start.ts_next_name;
+	char			*parent_name = start->u.tc_start.ts_parent_name;
 	int			 rc;
 
+	/* Realtime rules do not borrow, they get exactly their own rate */
+	if (parent_name && start->u.tc_start.ts_rule_flags & NTRS_REALTIME)
+		return -EINVAL;
+
 	rule = nrs_tbf_rule_find(head, start->tc_name);
 	if (rule) {
 		nrs_tbf_rule_put(rule);
@@ -305,15 +456,33 @@ nrs_tbf_rule_start(struct ptlrpc_nrs_policy *policy,
 	rule->tr_nsecs = NSEC_PER_SEC;
 	do_div(rule->tr_nsecs, rule->tr_rpc_rate);
 	rule->tr_depth = tbf_depth;
+	rule->tr_ntoken = rule->tr_depth;
+	rule->tr_check_time = ktime_to_ns(ktime_get());
 	atomic_set(&rule->tr_ref, 1);
 	INIT_LIST_HEAD(&rule->tr_cli_list);
 	INIT_LIST_HEAD(&rule->tr_nids);
 	INIT_LIST_HEAD(&rule->tr_linkage);
+	INIT_LIST_HEAD(&rule->tr_borrow_linkage);
 	spin_lock_init(&rule->tr_rule_lock);
 	rule->tr_head = head;
 
+	/* Any rule without a parent may become the parent of others */
+	if (parent_name == NULL) {
+		rule->tr_borrow_heap = cfs_binheap_create(
+					&nrs_tbf_borrow_heap_ops,
+					CBH_FLAG_ATOMIC_GROW, 0, rule,
+					nrs_pol2cptab(policy),
+					nrs_pol2cptid(policy));
+		if (rule->tr_borrow_heap == NULL) {
+			OBD_FREE_PTR(rule);
+			return -ENOMEM;
+		}
+	}
+
 	rc = head->th_ops->o_rule_init(policy, rule, start);
 	if (rc) {
+		if (rule->tr_borrow_heap != NULL)
+			cfs_binheap_destroy(rule->tr_borrow_heap);
 		OBD_FREE_PTR(rule);
 		return rc;
 	}
@@ -328,6 +497,27 @@ nrs_tbf_rule_start(struct ptlrpc_nrs_policy *policy,
 		return -EEXIST;
 	}
 
+	if (parent_name) {
+		parent_rule = nrs_tbf_rule_find_nolock(head, parent_name);
+		if (!parent_rule) {
+			spin_unlock(&head->th_rule_lock);
+			nrs_tbf_rule_put(rule);
+			return -ENOENT;
+		}
+
+		/* Only a single level of nesting is supported */
+		if (parent_rule->tr_parent != NULL) {
+			spin_unlock(&head->th_rule_lock);
+			nrs_tbf_rule_put(parent_rule);
+			nrs_tbf_rule_put(rule);
+			return -EINVAL;
+		}
+
+		/* The reference is dropped in nrs_tbf_rule_fini() */
+		rule->tr_parent = parent_rule;
+		atomic_inc(&head->th_nr_child_rules);
+	}
+
 	if (next_name) {
 		next_rule = nrs_tbf_rule_find_nolock(head, next_name);
 		if (!next_rule) {
@@ -350,8 +540,10 @@ nrs_tbf_rule_start(struct ptlrpc_nrs_policy *policy,
 		head->th_rule = rule;
 	}
 
-	CDEBUG(D_RPCTRACE, "TBF starts rule@%p rate %llu gen %llu\n",
-	       rule, rule->tr_rpc_rate, rule->tr_generation);
+	CDEBUG(D_RPCTRACE,
+	       "TBF starts rule@%p rate %llu gen %llu parent %s\n",
+	       rule, rule->tr_rpc_rate, rule->tr_generation,
+	       rule->tr_parent ? rule->tr_parent->tr_name : "none");
 
 	return 0;
 }
@@ -457,17 +649,31 @@ nrs_tbf_rule_stop(struct ptlrpc_nrs_policy *policy,
 		  struct nrs_tbf_cmd *stop)
 {
 	struct nrs_tbf_rule *rule;
+	struct nrs_tbf_rule *tmp_rule;
 
 	assert_spin_locked(&policy->pol_nrs->nrs_lock);
 
 	if (strcmp(stop->tc_name, NRS_TBF_DEFAULT_RULE) == 0)
 		return -EPERM;
 
-	rule = nrs_tbf_rule_find(head, stop->tc_name);
-	if (rule == NULL)
+	spin_lock(&head->th_rule_lock);
+	rule = nrs_tbf_rule_find_nolock(head, stop->tc_name);
+	if (rule == NULL) {
+		spin_unlock(&head->th_rule_lock);
 		return -ENOENT;
+	}
+
+	/* Child rules have to be stopped before their parent */
+	list_for_each_entry(tmp_rule, &head->th_list, tr_linkage) {
+		if (tmp_rule->tr_parent == rule) {
+			spin_unlock(&head->th_rule_lock);
+			nrs_tbf_rule_put(rule);
+			return -EBUSY;
+		}
+	}
 
 	list_del_init(&rule->tr_linkage);
+	spin_unlock(&head->th_rule_lock);
 	rule->tr_flags |= NTRS_STOPPING;
 	nrs_tbf_rule_put(rule);
 	nrs_tbf_rule_put(rule);
@@ -1003,7 +1209,7 @@ static int nrs_tbf_jobid_rule_init(struct ptlrpc_nrs_policy *policy,
 static int
 nrs_tbf_jobid_rule_dump(struct nrs_tbf_rule *rule, struct seq_file *m)
 {
-	seq_printf(m, "%s {%s} %llu, ref %d\n", rule->tr_name,
+	seq_printf(m, "%s {%s} %llu, ref %d", rule->tr_name,
 		   rule->tr_jobids_str, rule->tr_rpc_rate,
 		   atomic_read(&rule->tr_ref) - 1);
 	return 0;
@@ -1208,7 +1414,7 @@ static int nrs_tbf_nid_rule_init(struct ptlrpc_nrs_policy *policy,
 static int
 nrs_tbf_nid_rule_dump(struct nrs_tbf_rule *rule, struct seq_file *m)
 {
-	seq_printf(m, "%s {%s} %llu, ref %d\n", rule->tr_name,
+	seq_printf(m, "%s {%s} %llu, ref %d", rule->tr_name,
 		   rule->tr_nids_str, rule->tr_rpc_rate,
 		   atomic_read(&rule->tr_ref) - 1);
 	return 0;
@@ -2065,7 +2271,7 @@ nrs_tbf_rule_init(struct ptlrpc_nrs_policy *policy,
 static int
 nrs_tbf_generic_rule_dump(struct nrs_tbf_rule *rule, struct seq_file *m)
 {
-	seq_printf(m, "%s %s %llu, ref %d\n", rule->tr_name,
+	seq_printf(m, "%s %s %llu, ref %d", rule->tr_name,
 		   rule->tr_conds_str, rule->tr_rpc_rate,
 		   atomic_read(&rule->tr_ref) - 1);
 	return 0;
@@ -2359,7 +2565,7 @@ static int nrs_tbf_opcode_rule_init(struct ptlrpc_nrs_policy *policy,
 static int
 nrs_tbf_opcode_rule_dump(struct nrs_tbf_rule *rule, struct seq_file *m)
 {
-	seq_printf(m, "%s {%s} %llu, ref %d\n", rule->tr_name,
+	seq_printf(m, "%s {%s} %llu, ref %d", rule->tr_name,
 		   rule->tr_opcodes_str, rule->tr_rpc_rate,
 		   atomic_read(&rule->tr_ref) - 1);
 	return 0;
@@ -2674,7 +2880,7 @@ nrs_tbf_id_rule_init(struct ptlrpc_nrs_policy *policy,
 static int
 nrs_tbf_id_rule_dump(struct nrs_tbf_rule *rule, struct seq_file *m)
 {
-	seq_printf(m, "%s {%s} %llu, ref %d\n", rule->tr_name,
+	seq_printf(m, "%s {%s} %llu, ref %d", rule->tr_name,
 		   rule->tr_ids_str, rule->tr_rpc_rate,
 		   atomic_read(&rule->tr_ref) - 1);
 	return 0;
@@ -2804,6 +3010,8 @@ static int nrs_tbf_start(struct ptlrpc_nrs_policy *policy, char *arg)
 		GOTO(out_free_head, rc = -ENOMEM);
 
 	atomic_set(&head->th_rule_sequence, 0);
+	atomic_set(&head->th_nr_child_rules, 0);
+	INIT_LIST_HEAD(&head->th_borrow_rules);
 	spin_lock_init(&head->th_rule_lock);
 	INIT_LIST_HEAD(&head->th_list);
 	hrtimer_init(&head->th_timer, CLOCK_MONOTONIC, HRTIMER_MODE_ABS);
@@ -3030,6 +3238,193 @@ static void nrs_tbf_res_put(struct ptlrpc_nrs_policy *policy,
 	head->th_ops->o_cli_put(head, cli);
 }
 
+/**
+ * Tokens of the bucket of the non-realtime class \a cli at time \a now.
+ */
+static __u64 nrs_tbf_cli_tokens(struct nrs_tbf_client *cli, __u64 now)
+{
+	__u64 ntoken;
+
+	LASSERT(now >= cli->tc_check_time);
+	ntoken = (now - cli->tc_check_time) * cli->tc_rpc_rate;
+	do_div(ntoken, NSEC_PER_SEC);
+	ntoken += cli->tc_ntoken;
+
+	return min(ntoken, cli->tc_depth);
+}
+
+/**
+ * Take a token for a request of class \a cli, which has \a ntoken tokens
+ * of its own. A token of its own also counts against the bucket of the
+ * parent rule, if any; without one the token is borrowed from the parent.
+ * Either way the class is charged, its bucket restarts from \a now.
+ */
+static void nrs_tbf_cli_charge(struct nrs_tbf_client *cli, __u64 ntoken,
+			       __u64 now)
+{
+	struct nrs_tbf_rule *parent = cli->tc_rule->tr_parent;
+
+	if (ntoken > 0) {
+		cli->tc_ntoken = ntoken - 1;
+		if (parent != NULL && nrs_tbf_rule_refill(parent, now) > 0)
+			parent->tr_ntoken--;
+	} else {
+		LASSERT(parent != NULL && parent->tr_ntoken > 0);
+		parent->tr_ntoken--;
+		cli->tc_ntoken = 0;
+	}
+	cli->tc_check_time = now;
+}
+
+/**
+ * Remove the first request of class \a cli, already charged for it, and
+ * requeue the class in the heap by its next deadline.
+ */
+static struct ptlrpc_nrs_request *
+nrs_tbf_cli_dequeue(struct nrs_tbf_head *head, struct nrs_tbf_client *cli,
+		    __u64 now, bool borrow)
+{
+	struct ptlrpc_nrs_request *nrq;
+
+	nrq = list_entry(cli->tc_list.next, struct ptlrpc_nrs_request,
+			 nr_u.tbf.tr_list);
+	list_del_init(&nrq->nr_u.tbf.tr_list);
+	if (list_empty(&cli->tc_list)) {
+		cfs_binheap_remove(head->th_binheap, &cli->tc_node);
+		nrs_tbf_cli_borrow_del(cli);
+		cli->tc_in_heap = false;
+	} else {
+		if (!(cli->tc_rule->tr_flags & NTRS_REALTIME))
+			cli->tc_deadline = now + cli->tc_nsecs;
+		nrs_tbf_cli_relocate(head, cli);
+	}
+	CDEBUG(D_RPCTRACE,
+	       "TBF dequeues: class@%p rate %llu gen %llu "
+	       "token %llu, rule@%p rate %llu gen %llu%s\n",
+	       cli, cli->tc_rpc_rate,
+	       cli->tc_rule_generation, cli->tc_ntoken,
+	       cli->tc_rule, cli->tc_rule->tr_rpc_rate,
+	       cli->tc_rule->tr_generation,
+	       borrow ? " borrowed" : "");
+
+	return nrq;
+}
+
+/**
+ * Find, when the class at the root of the heap cannot be served, the class
+ * with the earliest deadline among the child rules whose parent rule has a
+ * token to lend. Any class in the heap can be the one, not only the root,
+ * as the classes are ordered by their own deadline only; the root of the
+ * heap of each parent rule is its candidate, so this costs one step per
+ * parent rule with queued classes.
+ *
+ * \param[out] ntoken	tokens of the class itself
+ * \param[in,out] deadline	lowered to the next token of a parent rule
+ *				which has none to lend now
+ *
+ * \retval		class to serve, NULL if none
+ */
+static struct nrs_tbf_client *
+nrs_tbf_child_cli_find(struct nrs_tbf_head *head, __u64 now, __u64 *ntoken,
+		       __u64 *deadline)
+{
+	struct nrs_tbf_client *best = NULL;
+	struct nrs_tbf_client *cli;
+	struct nrs_tbf_rule *parent;
+
+	list_for_each_entry(parent, &head->th_borrow_rules, tr_borrow_linkage) {
+		cli = container_of(cfs_binheap_root(parent->tr_borrow_heap),
+				   struct nrs_tbf_client, tc_borrow_node);
+		if (best != NULL && best->tc_deadline <= cli->tc_deadline)
+			continue;
+
+		if (nrs_tbf_rule_refill(parent, now) == 0) {
+			if (parent->tr_check_time + parent->tr_nsecs <
+			    *deadline)
+				*deadline = parent->tr_check_time +
+					    parent->tr_nsecs;
+			continue;
+		}
+
+		best = cli;
+	}
+
+	if (best != NULL)
+		*ntoken = nrs_tbf_cli_tokens(best, now);
+
+	return best;
+}
+
+/**
+ * Select the class whose first request is to be handled next at \a now:
+ * the class at the root of the heap if it has a token of its own or may
+ * borrow one from its parent rule, else the class of a child rule which
+ * may borrow one. The selection only has side effects on the heap order
+ * of realtime classes.
+ *
+ * \param[out] ntoken	tokens of the class itself
+ * \param[out] resid	remainder of the time to a token of a realtime class
+ * \param[out] deadline	when a token is due if no class can be served
+ *
+ * \retval		class to serve, NULL if none
+ */
+static struct nrs_tbf_client *
+nrs_tbf_cli_select(struct nrs_tbf_head *head, __u64 now, __u64 *ntoken,
+		   __u64 *resid, __u64 *deadline)
+{
+	struct cfs_binheap_node *node;
+	struct nrs_tbf_client *cli;
+	struct nrs_tbf_rule *rule;
+	struct nrs_tbf_rule *parent;
+	__u64 passed;
+
+	while ((node = cfs_binheap_root(head->th_binheap)) != NULL) {
+		cli = container_of(node, struct nrs_tbf_client, tc_node);
+		LASSERT(cli->tc_in_heap);
+		rule = cli->tc_rule;
+		parent = rule->tr_parent;
+
+		*deadline = cli->tc_check_time + cli->tc_nsecs;
+		LASSERT(now >= cli->tc_check_time);
+		passed = now - cli->tc_check_time;
+		if (rule->tr_flags & NTRS_REALTIME) {
+			*ntoken = passed * cli->tc_rpc_rate;
+			do_div(*ntoken, NSEC_PER_SEC);
+			*ntoken += cli->tc_ntoken;
+			LASSERT(cli->tc_nsecs_resid < cli->tc_nsecs);
+			*resid = cli->tc_nsecs_resid + passed % cli->tc_nsecs;
+			if (*resid > cli->tc_nsecs) {
+				(*ntoken)++;
+				*resid -= cli->tc_nsecs;
+			}
+		} else {
+			*ntoken = nrs_tbf_cli_tokens(cli, now);
+		}
+
+		/**
+		 * A class which ran out of tokens may still use the tokens
+		 * its parent rule has not handed out to other classes.
+		 */
+		if (*ntoken > 0 ||
+		    (parent != NULL && nrs_tbf_rule_refill(parent, now) > 0))
+			return cli;
+
+		if (!(rule->tr_flags & NTRS_REALTIME))
+			break;
+
+		cli->tc_deadline = *deadline;
+		cfs_binheap_relocate(head->th_binheap, &cli->tc_node);
+		if (node == cfs_binheap_root(head->th_binheap))
+			break;
+	}
+
+	if (node == NULL || atomic_read(&head->th_nr_child_rules) == 0)
+		return NULL;
+
+	/* Another class may get a token from its parent */
+	return nrs_tbf_child_cli_find(head, now, ntoken, deadline);
+}
+
 /**
  * Called when getting a request from the TBF policy for handling, or just
  * peeking; removes the request from the policy when it is to be handled.
@@ -3042,7 +3437,9 @@ static void nrs_tbf_res_put(struct ptlrpc_nrs_policy *policy,
  *		     policy
  *
  * \retval The request to be handled; this is the next request in the TBF
- *	   rule
+ *	   rule. A peek returns the request that would be handled now, or
+ *	   the first request of the class at the root of the heap, to be
+ *	   handled when it gets a token.
  *
  * \see ptlrpc_nrs_req_get_nolock()
  * \see nrs_request_get()
@@ -3052,102 +3449,50 @@ struct ptlrpc_nrs_request *nrs_tbf_req_get(struct ptlrpc_nrs_policy *policy,
 					   bool peek, bool force)
 {
 	struct nrs_tbf_head	  *head = policy->pol_private;
-	struct ptlrpc_nrs_request *nrq = NULL;
 	struct nrs_tbf_client     *cli;
 	struct cfs_binheap_node	  *node;
+	__u64 now;
+	__u64 ntoken = 0;
+	__u64 resid = 0;
+	__u64 deadline = 0;
+	ktime_t time;
 
 	assert_spin_locked(&policy->pol_nrs->nrs_svcpt->scp_req_lock);
 
 	if (!peek && policy->pol_nrs->nrs_throttling)
 		return NULL;
 
-	node = cfs_binheap_root(head->th_binheap);
-	if (unlikely(node == NULL))
+	if (unlikely(cfs_binheap_is_empty(head->th_binheap)))
 		return NULL;
 
-	cli = container_of(node, struct nrs_tbf_client, tc_node);
-	LASSERT(cli->tc_in_heap);
+	now = ktime_to_ns(ktime_get());
+	cli = nrs_tbf_cli_select(head, now, &ntoken, &resid, &deadline);
 	if (peek) {
-		nrq = list_entry(cli->tc_list.next,
-				     struct ptlrpc_nrs_request,
-				     nr_u.tbf.tr_list);
-	} else {
-		struct nrs_tbf_rule *rule = cli->tc_rule;
-		__u64 now = ktime_to_ns(ktime_get());
-		__u64 passed;
-		__u64 ntoken;
-		__u64 deadline;
-		__u64 old_resid = 0;
-
-		deadline = cli->tc_check_time +
-			  cli->tc_nsecs;
-		LASSERT(now >= cli->tc_check_time);
-		passed = now - cli->tc_check_time;
-		ntoken = passed * cli->tc_rpc_rate;
-		do_div(ntoken, NSEC_PER_SEC);
-
-		ntoken += cli->tc_ntoken;
-		if (rule->tr_flags & NTRS_REALTIME) {
-			LASSERT(cli->tc_nsecs_resid < cli->tc_nsecs);
-			old_resid = cli->tc_nsecs_resid;
-			cli->tc_nsecs_resid += passed % cli->tc_nsecs;
-			if (cli->tc_nsecs_resid > cli->tc_nsecs) {
-				ntoken++;
-				cli->tc_nsecs_resid -= cli->tc_nsecs;
-			}
-		} else if (ntoken > cli->tc_depth)
-			ntoken = cli->tc_depth;
-
-		if (ntoken > 0) {
-			struct ptlrpc_request *req;
-			nrq = list_entry(cli->tc_list.next,
-					     struct ptlrpc_nrs_request,
-					     nr_u.tbf.tr_list);
-			req = container_of(nrq,
-					   struct ptlrpc_request,
-					   rq_nrq);
-			ntoken--;
-			cli->tc_ntoken = ntoken;
-			cli->tc_check_time = now;
-			list_del_init(&nrq->nr_u.tbf.tr_list);
-			if (list_empty(&cli->tc_list)) {
-				cfs_binheap_remove(head->th_binheap,
-						   &cli->tc_node);
-				cli->tc_in_heap = false;
-			} else {
-				if (!(rule->tr_flags & NTRS_REALTIME))
-					cli->tc_deadline = now + cli->tc_nsecs;
-				cfs_binheap_relocate(head->th_binheap,
-						     &cli->tc_node);
-			}
-			CDEBUG(D_RPCTRACE,
-			       "TBF dequeues: class@%p rate %llu gen %llu "
-			       "token %llu, rule@%p rate %llu gen %llu\n",
-			       cli, cli->tc_rpc_rate,
-			       cli->tc_rule_generation, cli->tc_ntoken,
-			       cli->tc_rule, cli->tc_rule->tr_rpc_rate,
-			       cli->tc_rule->tr_generation);
-		} else {
-			ktime_t time;
-
-			if (rule->tr_flags & NTRS_REALTIME) {
-				cli->tc_deadline = deadline;
-				cli->tc_nsecs_resid = old_resid;
-				cfs_binheap_relocate(head->th_binheap,
-						     &cli->tc_node);
-				if (node != cfs_binheap_root(head->th_binheap))
-					return nrs_tbf_req_get(policy,
-							       peek, force);
-			}
-			policy->pol_nrs->nrs_throttling = 1;
-			head->th_deadline = deadline;
-			time = ktime_set(0, 0);
-			time = ktime_add_ns(time, deadline);
-			hrtimer_start(&head->th_timer, time, HRTIMER_MODE_ABS);
+		if (cli == NULL) {
+			node = cfs_binheap_root(head->th_binheap);
+			cli = container_of(node, struct nrs_tbf_client,
+					   tc_node);
 		}
+		return list_entry(cli->tc_list.next,
+				  struct ptlrpc_nrs_request,
+				  nr_u.tbf.tr_list);
 	}
 
-	return nrq;
+	if (cli != NULL) {
+		if (cli->tc_rule->tr_flags & NTRS_REALTIME)
+			cli->tc_nsecs_resid = resid;
+		nrs_tbf_cli_charge(cli, ntoken, now);
+		return nrs_tbf_cli_dequeue(head, cli, now, ntoken == 0);
+	}
+
+	/* Wake up when any bucket gets a token */
+	policy->pol_nrs->nrs_throttling = 1;
+	head->th_deadline = deadline;
+	time = ktime_set(0, 0);
+	time = ktime_add_ns(time, deadline);
+	hrtimer_start(&head->th_timer, time, HRTIMER_MODE_ABS);
+
+	return NULL;
 }
 
 /**
@@ -3178,6 +3523,7 @@ static int nrs_tbf_req_add(struct ptlrpc_nrs_policy *policy,
 		rc = cfs_binheap_insert(head->th_binheap, &cli->tc_node);
 		if (rc == 0) {
 			cli->tc_in_heap = true;
+			nrs_tbf_cli_borrow_add(head, cli);
 			nrq->nr_u.tbf.tr_sequence = head->th_sequence++;
 			list_add_tail(&nrq->nr_u.tbf.tr_list,
 					  &cli->tc_list);
@@ -3238,10 +3584,10 @@ static void nrs_tbf_req_del(struct ptlrpc_nrs_policy *policy,
 	if (list_empty(&cli->tc_list)) {
 		cfs_binheap_remove(head->th_binheap,
 				   &cli->tc_node);
+		nrs_tbf_cli_borrow_del(cli);
 		cli->tc_in_heap = false;
 	} else {
-		cfs_binheap_relocate(head->th_binheap,
-				     &cli->tc_node);
+		nrs_tbf_cli_relocate(head, cli);
 	}
 }
 
@@ -3439,6 +3785,14 @@ nrs_tbf_parse_value_pair(struct nrs_tbf_cmd *cmd, char *buffer)
 			cmd->u.tc_change.tc_next_name = val;
 		else
 			return -EINVAL;
+	} else if (strcmp(key, "parent") == 0) {
+		if (!name_is_valid(val))
+			return -EINVAL;
+
+		if (cmd->tc_cmd == NRS_CTL_TBF_START_RULE)
+			cmd->u.tc_start.ts_parent_name = val;
+		else
+			return -EINVAL;
 	} else if (strcmp(key, "realtime") == 0) {
 		unsigned long realtime;
 
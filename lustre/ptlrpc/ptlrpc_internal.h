@@ -52,6 +52,7 @@ extern struct ptlrpc_nrs_pol_conf nrs_conf_orr;
 extern struct ptlrpc_nrs_pol_conf nrs_conf_trr;
 extern struct ptlrpc_nrs_pol_conf nrs_conf_tbf;
 extern struct ptlrpc_nrs_pol_conf nrs_conf_delay;
+extern struct ptlrpc_nrs_pol_conf nrs_conf_edf;
 #endif /* HAVE_SERVER_SUPPORT */
 
 /**
@@ -66,6 +67,8 @@ extern struct mutex pinger_mutex;
 int ptlrpc_start_thread(struct ptlrpc_service_part *svcpt, int wait);
 /* ptlrpcd.c */
 int ptlrpcd_start(struct ptlrpcd_ctl *pc);
+int ptlrpcd_debugfs_setup(void);
+void ptlrpcd_debugfs_cleanup(void);
 
 /* client.c */
 void ptlrpc_at_adj_net_latency(struct ptlrpc_request *req,
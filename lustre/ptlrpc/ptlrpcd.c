@@ -233,6 +233,10 @@ void ptlrpcd_add_rqset(struct ptlrpc_request_set *set)
 }
 
 /**
+ * Move the older half of the new requests queued on \a src to \a des, so
+ * that the owner of \a src and the stealing thread share the backlog rather
+ * than just trading places.
+ *
  * Return transferred RPCs count.
  */
 static int ptlrpcd_steal_rqset(struct ptlrpc_request_set *des,
@@ -240,20 +244,26 @@ static int ptlrpcd_steal_rqset(struct ptlrpc_request_set *des,
 {
 	struct list_head *tmp, *pos;
 	struct ptlrpc_request *req;
+	int count;
 	int rc = 0;
 
 	spin_lock(&src->set_new_req_lock);
-	if (likely(!list_empty(&src->set_new_requests))) {
-		list_for_each_safe(pos, tmp, &src->set_new_requests) {
-			req = list_entry(pos, struct ptlrpc_request,
-					 rq_set_chain);
-			req->rq_set = des;
-		}
-		list_splice_init(&src->set_new_requests,
-				 &des->set_requests);
-		rc = atomic_read(&src->set_new_count);
+	count = (atomic_read(&src->set_new_count) + 1) / 2;
+	list_for_each_safe(pos, tmp, &src->set_new_requests) {
+		if (rc >= count)
+			break;
+
+		req = list_entry(pos, struct ptlrpc_request, rq_set_chain);
+		req->rq_set = des;
+		list_move_tail(&req->rq_set_chain, &des->set_requests);
+		rc++;
+	}
+	if (rc > 0) {
 		atomic_add(rc, &des->set_remaining);
-		atomic_set(&src->set_new_count, 0);
+		if (list_empty(&src->set_new_requests))
+			atomic_set(&src->set_new_count, 0);
+		else
+			atomic_sub(rc, &src->set_new_count);
 	}
 	spin_unlock(&src->set_new_req_lock);
 	return rc;
@@ -307,6 +317,59 @@ static inline void ptlrpc_reqset_get(struct ptlrpc_request_set *set)
 	atomic_inc(&set->set_refcount);
 }
 
+/**
+ * Find the partner of \a pc with the most new requests waiting to be
+ * picked up, and take a reference on its request set.
+ *
+ * \param[in] pc	the idle ptlrpcd thread
+ * \param[out] index	index of the partner found
+ *
+ * \retval request set of the busiest partner
+ * \retval NULL if no partner has queued requests
+ */
+static struct ptlrpc_request_set *
+ptlrpcd_busiest_partner(struct ptlrpcd_ctl *pc, int *index)
+{
+	struct ptlrpcd_ctl *partner;
+	struct ptlrpcd_ctl *busiest = NULL;
+	struct ptlrpc_request_set *ps = NULL;
+	int first = pc->pc_cursor;
+	int i = first;
+	int max = 0;
+
+	/* Start at a different partner each time to break ties fairly */
+	if (++pc->pc_cursor >= pc->pc_npartners)
+		pc->pc_cursor = 0;
+
+	do {
+		partner = pc->pc_partners[i];
+		if (++i >= pc->pc_npartners)
+			i = 0;
+		if (partner == NULL)
+			continue;
+
+		spin_lock(&partner->pc_lock);
+		if (partner->pc_set != NULL &&
+		    atomic_read(&partner->pc_set->set_new_count) > max) {
+			max = atomic_read(&partner->pc_set->set_new_count);
+			busiest = partner;
+		}
+		spin_unlock(&partner->pc_lock);
+	} while (i != first);
+
+	if (busiest == NULL)
+		return NULL;
+
+	spin_lock(&busiest->pc_lock);
+	ps = busiest->pc_set;
+	if (ps != NULL)
+		ptlrpc_reqset_get(ps);
+	spin_unlock(&busiest->pc_lock);
+	*index = busiest->pc_index;
+
+	return ps;
+}
+
 /**
  * Check if there is more work to do on ptlrpcd set.
  * Returns 1 if yes.
@@ -316,6 +379,7 @@ static int ptlrpcd_check(struct lu_env *env, struct ptlrpcd_ctl *pc)
 	struct list_head *tmp, *pos;
         struct ptlrpc_request *req;
         struct ptlrpc_request_set *set = pc->pc_set;
+	ktime_t start = ktime_get();
         int rc = 0;
         int rc2;
         ENTRY;
@@ -325,6 +389,7 @@ static int ptlrpcd_check(struct lu_env *env, struct ptlrpcd_ctl *pc)
 		if (likely(!list_empty(&set->set_new_requests))) {
 			list_splice_init(&set->set_new_requests,
 					     &set->set_requests);
+			pc->pc_nr_queued += atomic_read(&set->set_new_count);
 			atomic_add(atomic_read(&set->set_new_count),
 				   &set->set_remaining);
 			atomic_set(&set->set_new_count, 0);
@@ -352,7 +417,7 @@ static int ptlrpcd_check(struct lu_env *env, struct ptlrpcd_ctl *pc)
 		 * new modules are loaded, i.e., early during boot up.
 		 */
 		CERROR("Failure to refill session: %d\n", rc2);
-		RETURN(rc);
+		GOTO(out, rc);
 	}
 
 	if (atomic_read(&set->set_remaining))
@@ -376,44 +441,30 @@ static int ptlrpcd_check(struct lu_env *env, struct ptlrpcd_ctl *pc)
 		 */
 		rc = atomic_read(&set->set_new_count);
 
-                /* If we have nothing to do, check whether we can take some
-                 * work from our partner threads. */
-                if (rc == 0 && pc->pc_npartners > 0) {
-                        struct ptlrpcd_ctl *partner;
-                        struct ptlrpc_request_set *ps;
-                        int first = pc->pc_cursor;
-
-                        do {
-                                partner = pc->pc_partners[pc->pc_cursor++];
-                                if (pc->pc_cursor >= pc->pc_npartners)
-                                        pc->pc_cursor = 0;
-                                if (partner == NULL)
-                                        continue;
-
-				spin_lock(&partner->pc_lock);
-				ps = partner->pc_set;
-				if (ps == NULL) {
-					spin_unlock(&partner->pc_lock);
-					continue;
-				}
-
-				ptlrpc_reqset_get(ps);
-				spin_unlock(&partner->pc_lock);
-
-				if (atomic_read(&ps->set_new_count)) {
-					rc = ptlrpcd_steal_rqset(set, ps);
-					if (rc > 0)
-						CDEBUG(D_RPCTRACE, "transfer %d"
-						       " async RPCs [%d->%d]\n",
-						       rc, partner->pc_index,
-						       pc->pc_index);
+		/* If we have nothing to do, take a share of the requests
+		 * queued on the busiest of our partner threads. */
+		if (rc == 0 && pc->pc_npartners > 0) {
+			struct ptlrpc_request_set *ps;
+			int index;
+
+			ps = ptlrpcd_busiest_partner(pc, &index);
+			if (ps != NULL) {
+				rc = ptlrpcd_steal_rqset(set, ps);
+				if (rc > 0) {
+					pc->pc_nr_stolen += rc;
+					CDEBUG(D_RPCTRACE, "transfer %d"
+					       " async RPCs [%d->%d]\n",
+					       rc, index, pc->pc_index);
 				}
 				ptlrpc_reqset_put(ps);
-			} while (rc == 0 && pc->pc_cursor != first);
+			}
 		}
 	}
 
-	RETURN(rc || test_bit(LIOD_STOP, &pc->pc_flags));
+	rc = rc || test_bit(LIOD_STOP, &pc->pc_flags);
+out:
+	pc->pc_busy_ns += ktime_to_ns(ktime_sub(ktime_get(), start));
+	RETURN(rc);
 }
 
 /**
@@ -466,6 +517,10 @@ static int ptlrpcd(void *arg)
 		GOTO(failed, rc);
 	}
 
+	pc->pc_start_time = ktime_get();
+	pc->pc_busy_ns = 0;
+	pc->pc_nr_queued = 0;
+	pc->pc_nr_stolen = 0;
 	complete(&pc->pc_starting);
 
         /*
@@ -938,6 +993,72 @@ out:
 	RETURN(rc);
 }
 
+static void ptlrpcd_stats_show_pc(struct seq_file *m, struct ptlrpcd_ctl *pc)
+{
+	__u64 elapsed;
+
+	if (!test_bit(LIOD_START, &pc->pc_flags))
+		return;
+
+	elapsed = ktime_to_ns(ktime_sub(ktime_get(), pc->pc_start_time));
+	seq_printf(m, "%-16s %4d %12llu %12llu %5llu\n", pc->pc_name,
+		   pc->pc_cpt, pc->pc_nr_queued, pc->pc_nr_stolen,
+		   elapsed > 0 ? div64_u64(pc->pc_busy_ns * 100, elapsed) : 0);
+}
+
+/**
+ * Show the number of requests each ptlrpcd thread took from its own queue
+ * and from the queues of its partners, and how busy the thread has been
+ * (in percent of the time since it was started).
+ */
+static int ptlrpcd_stats_seq_show(struct seq_file *m, void *data)
+{
+	int i;
+	int j;
+
+	seq_printf(m, "%-16s %4s %12s %12s %5s\n",
+		   "thread", "cpt", "queued", "stolen", "busy%");
+
+	mutex_lock(&ptlrpcd_mutex);
+	if (ptlrpcd_users == 0)
+		goto out;
+
+	ptlrpcd_stats_show_pc(m, &ptlrpcd_rcv);
+	for (i = 0; i < ptlrpcds_num; i++) {
+		if (ptlrpcds[i] == NULL)
+			break;
+		for (j = 0; j < ptlrpcds[i]->pd_nthreads; j++)
+			ptlrpcd_stats_show_pc(m, &ptlrpcds[i]->pd_threads[j]);
+	}
+out:
+	mutex_unlock(&ptlrpcd_mutex);
+
+	return 0;
+}
+LDEBUGFS_SEQ_FOPS_RO(ptlrpcd_stats);
+
+static struct dentry *ptlrpcd_debugfs_entry;
+
+int ptlrpcd_debugfs_setup(void)
+{
+	struct dentry *entry;
+
+	entry = ldebugfs_add_simple(debugfs_lustre_root, "ptlrpcd_stats",
+				    NULL, &ptlrpcd_stats_fops);
+	if (IS_ERR(entry))
+		return PTR_ERR(entry);
+
+	ptlrpcd_debugfs_entry = entry;
+
+	return 0;
+}
+
+void ptlrpcd_debugfs_cleanup(void)
+{
+	if (!IS_ERR_OR_NULL(ptlrpcd_debugfs_entry))
+		ldebugfs_remove(&ptlrpcd_debugfs_entry);
+}
+
 int ptlrpcd_addref(void)
 {
         int rc = 0;
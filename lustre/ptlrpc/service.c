@@ -579,6 +579,7 @@ ptlrpc_server_nthreads_check(struct ptlrpc_service *svc,
 	nthrs = max(nthrs, tc->tc_nthrs_init);
 	svc->srv_nthrs_cpt_limit = nthrs;
 	svc->srv_nthrs_cpt_init = init;
+	svc->srv_thr_idle_timeout = PTLRPC_THR_IDLE_TIMEOUT;
 
 	if (nthrs * svc->srv_ncpts > tc->tc_nthrs_max) {
 		CDEBUG(D_OTHER, "%s: This service may have more threads (%d) "
@@ -616,6 +617,7 @@ ptlrpc_service_part_init(struct ptlrpc_service *svc,
 
 	/* acitve requests and hp requests */
 	spin_lock_init(&svcpt->scp_req_lock);
+	spin_lock_init(&svcpt->scp_queue_hist.oh_lock);
 
 	/* reply states */
 	spin_lock_init(&svcpt->scp_rep_lock);
@@ -2088,6 +2090,9 @@ ptlrpc_server_handle_request(struct ptlrpc_service_part *svcpt,
 	work_start = ktime_get_real();
 	arrived = timespec64_to_ktime(request->rq_arrival_time);
 	timediff_usecs = ktime_us_delta(work_start, arrived);
+	lprocfs_oh_tally_log2(&svcpt->scp_queue_hist,
+			      timediff_usecs > 0 ?
+			      div_u64(timediff_usecs, USEC_PER_MSEC) : 0);
 	if (likely(svc->srv_stats != NULL)) {
                 lprocfs_counter_add(svc->srv_stats, PTLRPC_REQWAIT_CNTR,
 				    timediff_usecs);
@@ -2405,6 +2410,28 @@ ptlrpc_threads_increasable(struct ptlrpc_service_part *svcpt)
 	       svcpt->scp_service->srv_nthrs_cpt_limit;
 }
 
+/**
+ * more threads than needed are running, an idle thread can exit
+ * user can call it w/o any lock but need to hold
+ * ptlrpc_service_part::scp_lock to get reliable result
+ */
+static inline int
+ptlrpc_threads_shrinkable(struct ptlrpc_service_part *svcpt)
+{
+	return svcpt->scp_nthrs_running - svcpt->scp_nthrs_stopping >
+	       svcpt->scp_service->srv_nthrs_cpt_init;
+}
+
+/**
+ * threads_max was lowered below the number of running threads
+ */
+static inline int
+ptlrpc_threads_over_limit(struct ptlrpc_service_part *svcpt)
+{
+	return svcpt->scp_nthrs_running - svcpt->scp_nthrs_stopping >
+	       svcpt->scp_service->srv_nthrs_cpt_limit;
+}
+
 /**
  * too many requests and allowed to create more threads
  */
@@ -2446,6 +2473,32 @@ ptlrpc_server_request_incoming(struct ptlrpc_service_part *svcpt)
 	return !list_empty(&svcpt->scp_req_incoming);
 }
 
+/**
+ * Check if the calling thread should exit to shrink \a svcpt, because it
+ * has been idle for long, or threads_max was lowered below the number of
+ * running threads. The partition always keeps threads_min threads.
+ *
+ * \retval true	the thread is accounted in scp_nthrs_stopping and
+ *			has to exit
+ */
+static bool ptlrpc_thread_retire(struct ptlrpc_service_part *svcpt,
+				 bool idle)
+{
+	bool retire = false;
+
+	spin_lock(&svcpt->scp_lock);
+	if (ptlrpc_threads_shrinkable(svcpt) &&
+	    !ptlrpc_server_request_incoming(svcpt) &&
+	    !ptlrpc_server_request_pending(svcpt, false) &&
+	    (idle || ptlrpc_threads_over_limit(svcpt))) {
+		svcpt->scp_nthrs_stopping++;
+		retire = true;
+	}
+	spin_unlock(&svcpt->scp_lock);
+
+	return retire;
+}
+
 static __attribute__((__noinline__)) int
 ptlrpc_wait_event(struct ptlrpc_service_part *svcpt,
 		  struct ptlrpc_thread *thread)
@@ -2453,12 +2506,24 @@ ptlrpc_wait_event(struct ptlrpc_service_part *svcpt,
 	/* Don't exit while there are replies to be handled */
 	struct l_wait_info lwi = LWI_TIMEOUT(svcpt->scp_rqbd_timeout,
 					     ptlrpc_retry_rqbds, svcpt);
+	int idle_timeout = svcpt->scp_service->srv_thr_idle_timeout;
+	int rc;
 
 	lc_watchdog_disable(thread->t_watchdog);
 
+	if (ptlrpc_threads_over_limit(svcpt) &&
+	    ptlrpc_thread_retire(svcpt, false))
+		return -ETIMEDOUT;
+
+	/* threads above the init number exit after idling for long, wake
+	 * up to check it even if no thread can go now, as an idle thread
+	 * deep in the exclusive wait queue is not woken up by requests */
+	if (svcpt->scp_rqbd_timeout == 0 && idle_timeout > 0)
+		lwi = LWI_TIMEOUT(cfs_time_seconds(idle_timeout), NULL, NULL);
+
 	cond_resched();
 
-	l_wait_event_exclusive_head(svcpt->scp_waitq,
+	rc = l_wait_event_exclusive_head(svcpt->scp_waitq,
 				ptlrpc_thread_stopping(thread) ||
 				ptlrpc_server_request_incoming(svcpt) ||
 				ptlrpc_server_request_pending(svcpt, false) ||
@@ -2468,6 +2533,10 @@ ptlrpc_wait_event(struct ptlrpc_service_part *svcpt,
 	if (ptlrpc_thread_stopping(thread))
 		return -EINTR;
 
+	if (rc == -ETIMEDOUT && lwi.lwi_on_timeout == NULL &&
+	    ptlrpc_thread_retire(svcpt, true))
+		return -ETIMEDOUT;
+
 	lc_watchdog_touch(thread->t_watchdog,
 			  ptlrpc_server_get_timeout(svcpt));
 	return 0;
@@ -2487,6 +2556,7 @@ static int ptlrpc_main(void *arg)
 	struct ptlrpc_reply_state	*rs;
 	struct group_info *ginfo = NULL;
 	struct lu_env *env;
+	bool retired = false;
 	int counter = 0, rc = 0;
 	ENTRY;
 
@@ -2581,8 +2651,12 @@ static int ptlrpc_main(void *arg)
 
 	/* XXX maintain a list of all managed devices: insert here */
 	while (!ptlrpc_thread_stopping(thread)) {
-		if (ptlrpc_wait_event(svcpt, thread))
+		rc = ptlrpc_wait_event(svcpt, thread);
+		if (rc != 0) {
+			retired = rc == -ETIMEDOUT;
+			rc = 0;
 			break;
+		}
 
 		ptlrpc_check_rqbd_pool(svcpt);
 
@@ -2652,6 +2726,21 @@ out:
 		svcpt->scp_nthrs_running--;
 	}
 
+	if (retired) {
+		svcpt->scp_nthrs_stopping--;
+		/* nobody waits for a retired thread unless the service
+		 * is being stopped, free it to not pile up on the list */
+		if (!thread_is_stopping(thread)) {
+			CDEBUG(D_RPCTRACE, "%s: idle thread %s retired, %d left\n",
+			       svc->srv_name, thread->t_name,
+			       svcpt->scp_nthrs_running);
+			list_del(&thread->t_link);
+			spin_unlock(&svcpt->scp_lock);
+			OBD_FREE_PTR(thread);
+			return rc;
+		}
+	}
+
 	thread->t_id = rc;
 	thread_add_flags(thread, SVC_STOPPED);
 
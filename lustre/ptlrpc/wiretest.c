@@ -4035,6 +4035,26 @@ void lustre_assert_wire_constants(void)
 	LASSERTF((int)sizeof(((struct changelog_setinfo *)0)->cs_id) == 4, "found %lld\n",
 		 (long long)(int)sizeof(((struct changelog_setinfo *)0)->cs_id));
 
+	/* Checks for struct changelog_filter */
+	LASSERTF((int)sizeof(struct changelog_filter) == 16, "found %lld\n",
+		 (long long)(int)sizeof(struct changelog_filter));
+	LASSERTF((int)offsetof(struct changelog_filter, cf_type_mask) == 0, "found %lld\n",
+		 (long long)(int)offsetof(struct changelog_filter, cf_type_mask));
+	LASSERTF((int)sizeof(((struct changelog_filter *)0)->cf_type_mask) == 4, "found %lld\n",
+		 (long long)(int)sizeof(((struct changelog_filter *)0)->cf_type_mask));
+	LASSERTF((int)offsetof(struct changelog_filter, cf_shard_index) == 4, "found %lld\n",
+		 (long long)(int)offsetof(struct changelog_filter, cf_shard_index));
+	LASSERTF((int)sizeof(((struct changelog_filter *)0)->cf_shard_index) == 4, "found %lld\n",
+		 (long long)(int)sizeof(((struct changelog_filter *)0)->cf_shard_index));
+	LASSERTF((int)offsetof(struct changelog_filter, cf_shard_count) == 8, "found %lld\n",
+		 (long long)(int)offsetof(struct changelog_filter, cf_shard_count));
+	LASSERTF((int)sizeof(((struct changelog_filter *)0)->cf_shard_count) == 4, "found %lld\n",
+		 (long long)(int)sizeof(((struct changelog_filter *)0)->cf_shard_count));
+	LASSERTF((int)offsetof(struct changelog_filter, cf_padding) == 12, "found %lld\n",
+		 (long long)(int)offsetof(struct changelog_filter, cf_padding));
+	LASSERTF((int)sizeof(((struct changelog_filter *)0)->cf_padding) == 4, "found %lld\n",
+		 (long long)(int)sizeof(((struct changelog_filter *)0)->cf_padding));
+
 	/* Checks for struct llog_changelog_rec */
 	LASSERTF((int)sizeof(struct llog_changelog_rec) == 88, "found %lld\n",
 		 (long long)(int)sizeof(struct llog_changelog_rec));
@@ -1003,6 +1003,62 @@ void test112(void)
 	helper_archiving(test112_progress, length);
 }
 
+/* Helper to send a single HSM request on the test file. */
+static int helper_request(enum hsm_user_action action, __u64 offset,
+			  __u64 length)
+{
+	struct hsm_user_request	*hur;
+	int			 rc;
+
+	hur = llapi_hsm_user_request_alloc(1, 0);
+	ASSERTF(hur != NULL, "llapi_hsm_user_request_alloc returned NULL");
+
+	hur->hur_request.hr_action = action;
+	hur->hur_request.hr_archive_id = 1;
+	hur->hur_request.hr_flags = 0;
+	hur->hur_request.hr_itemcount = 1;
+	hur->hur_request.hr_data_len = 0;
+	hur->hur_user_item[0].hui_extent.offset = offset;
+	hur->hur_user_item[0].hui_extent.length = length;
+
+	rc = llapi_path2fid(testfile, &hur->hur_user_item[0].hui_fid);
+	ASSERTF(rc == 0, "llapi_path2fid failed: %s", strerror(-rc));
+
+	rc = llapi_hsm_request(testfile, hur);
+	free(hur);
+
+	return rc;
+}
+
+/* Ranged restores are rejected, the file stays released. */
+void test113(void)
+{
+	const size_t length = 1000;
+	struct hsm_user_state hus;
+	int rc;
+
+	helper_archiving(NULL, length);
+
+	rc = helper_request(HUA_RELEASE, 0, -1);
+	ASSERTF(rc == 0, "release failed: %s", strerror(-rc));
+
+	rc = helper_request(HUA_RESTORE, length / 2, length / 10);
+	ASSERTF(rc == -EOPNOTSUPP, "ranged restore returned %d", rc);
+
+	rc = helper_request(HUA_RESTORE, 0, length / 10);
+	ASSERTF(rc == -EOPNOTSUPP, "partial restore returned %d", rc);
+
+	rc = llapi_hsm_state_get(testfile, &hus);
+	ASSERTF(rc == 0, "llapi_hsm_state_get failed: %s", strerror(-rc));
+	ASSERTF(hus.hus_states == (HS_EXISTS | HS_ARCHIVED | HS_RELEASED),
+		"state=%u", hus.hus_states);
+
+	/* drop the released file so no restore is left pending */
+	rc = unlink(testfile);
+	ASSERTF(rc == 0, "unlink failed for '%s': %s",
+		testfile, strerror(errno));
+}
+
 static void usage(char *prog)
 {
 	fprintf(stderr, "Usage: %s [-d lustre_dir]\n", prog);
@@ -1070,6 +1126,7 @@ int main(int argc, char *argv[])
 	PERFORM(test110);
 	PERFORM(test111);
 	PERFORM(test112);
+	PERFORM(test113);
 
 	return EXIT_SUCCESS;
 }
@@ -181,6 +181,44 @@ test_smoke () {
 }
 run_test smoke "lst regression test"
 
+# lst stat with the default session features, which include the latency
+# histograms carried in the bulk of the stat RPC
+test_stat() {
+	lst_prepare
+
+	local log=$TMP/$tfile.log
+	local nc=$(echo ${lst_CLIENTS//,/ } | wc -w)
+	local ns=$(echo ${lst_SERVERS//,/ } | wc -w)
+
+	export LST_SESSION=$$
+	unset LST_FEATURES
+
+	$LST new_session --timeo 100 stat || error "new_session failed"
+	$LST add_group c $(nids_list $lst_CLIENTS) ||
+		error "add_group c failed"
+	$LST add_group s $(nids_list $lst_SERVERS) ||
+		error "add_group s failed"
+	$LST add_batch b || error "add_batch failed"
+	$LST add_test --batch b --concurrency 8 \
+		--distribute ${nc}:${ns} --from c --to s ping ||
+		error "add_test failed"
+	$LST run b || error "run failed"
+	sleep 1
+
+	$LST stat --json --count 2 --delay 2 --timeout 10 c s 2>&1 | tee $log
+	local rc=${PIPESTATUS[0]}
+
+	lst_cleanup_all
+
+	[ $rc -eq 0 ] || error "lst stat failed: $rc"
+	grep -q '"group": "c"' $log || error "no stat of group c"
+	grep -q '"group": "s"' $log || error "no stat of group s"
+	! grep -q '"errors": [1-9]' $log || error "lst stat RPC errors"
+	grep '"group": "c"' $log | grep -q '"latency_us"' ||
+		error "no RPC latency of group c"
+}
+run_test stat "lst stat with default features"
+
 complete $SECONDS
 _restore_mount
 check_and_cleanup_lustre
@@ -8640,7 +8640,7 @@ test_115() {
 	[ $PARALLEL == "yes" ] && skip "skip parallel run"
 	remote_ost_nodsh && skip "remote OST with nodsh"
 
-	# Lustre does not stop service threads once they are started.
+	# Service threads only exit after threads_idle_timeout.
 	# Reset number of running threads to default.
 	stopall
 	setupall
@@ -9790,6 +9790,45 @@ test_123b () { # statahead(bug 15027)
 }
 run_test 123b "not panic with network error in statahead enqueue (bug 15027)"
 
+test_123c() {
+	local count=100
+
+	$LCTL get_param -n llite.*.statahead_stats | grep -q "agl glimpse" ||
+		skip "client does not report AGL glimpses"
+
+	local agl=$($LCTL get_param -n llite.*.statahead_agl | head -n 1)
+
+	stack_trap "$LCTL set_param llite.*.statahead_agl=$agl" EXIT
+	$LCTL set_param llite.*.statahead_agl=1
+
+	test_mkdir $DIR/$tdir
+	createmany -o $DIR/$tdir/$tfile- $count || error "createmany failed"
+	stack_trap "unlinkmany $DIR/$tdir/$tfile- $count" EXIT
+
+	cancel_lru_locks mdc
+	cancel_lru_locks osc
+
+	local stats=$($LCTL get_param -n llite.*.statahead_stats)
+	local glimpse=$(awk '/^agl glimpse:/ { n += $3 } END { print n }' \
+			<<< "$stats")
+	local skipped=$(awk '/^agl skipped:/ { n += $3 } END { print n }' \
+			<<< "$stats")
+
+	ls -l $DIR/$tdir > /dev/null || error "ls -l failed"
+
+	stats=$($LCTL get_param -n llite.*.statahead_stats)
+	echo "$stats"
+	glimpse=$(($(awk '/^agl glimpse:/ { n += $3 } END { print n }' \
+		     <<< "$stats") - glimpse))
+	skipped=$(($(awk '/^agl skipped:/ { n += $3 } END { print n }' \
+		     <<< "$stats") - skipped))
+
+	(( glimpse > 0 )) || error "no AGL glimpse sent"
+	(( glimpse + skipped <= count )) ||
+		error "$glimpse glimpses + $skipped skipped > $count files"
+}
+run_test 123c "AGL glimpses are counted in statahead_stats"
+
 test_124a() {
 	[ $PARALLEL == "yes" ] && skip "skip parallel run"
 	$LCTL get_param -n mdc.*.connect_flags | grep -q lru_resize ||
@@ -12641,6 +12680,76 @@ test_160i() {
 }
 run_test 160i "changelog user register/unregister race"
 
+test_160j() {
+	remote_mds_nodsh && skip "remote MDS with nodsh"
+	[ $PARALLEL == "yes" ] && skip "skip parallel run"
+
+	local mdt=$(facet_svc $SINGLEMDS)
+	local all=$TMP/$tfile.all
+	local shard0=$TMP/$tfile.0
+	local shard1=$TMP/$tfile.1
+
+	changelog_register || error "changelog_register failed"
+	stack_trap "rm -f $all $shard0 $shard1" EXIT
+
+	test_mkdir -c1 -i0 $DIR/$tdir
+	createmany -o $DIR/$tdir/$tfile 100 || error "createmany failed"
+
+	# two readers with disjoint shards, running at the same time
+	$LFS changelog --shard 0/2 $mdt | awk '{ print $1 }' > $shard0 &
+	local pid0=$!
+	$LFS changelog --shard 1/2 $mdt | awk '{ print $1 }' > $shard1 &
+	local pid1=$!
+	$LFS changelog $mdt | awk '{ print $1 }' | sort -n > $all
+	wait $pid0 || error "reader of shard 0 failed"
+	wait $pid1 || error "reader of shard 1 failed"
+
+	(( $(wc -l < $shard0) > 0 && $(wc -l < $shard1) > 0 )) ||
+		error "one shard is empty"
+	[ -z "$(sort -n $shard0 $shard1 | uniq -d)" ] ||
+		error "a record was read by both readers"
+	sort -n $shard0 $shard1 | cmp -s - $all ||
+		error "records are missing from the shards"
+}
+run_test 160j "changelog readers with disjoint shards"
+
+test_160k() {
+	remote_mds_nodsh && skip "remote MDS with nodsh"
+	[ $PARALLEL == "yes" ] && skip "skip parallel run"
+
+	local mdt=$(facet_svc $SINGLEMDS)
+	local param="mdc.$FSNAME-MDT0000-mdc-*.changelog_readers"
+	local out=$TMP/$tfile.out
+	local stats
+	local pid
+
+	changelog_register || error "changelog_register failed"
+	stack_trap "rm -f $out" EXIT
+
+	test_mkdir -c1 -i0 $DIR/$tdir
+	createmany -o $DIR/$tdir/$tfile 200 || error "createmany failed"
+
+	$LFS changelog --follow --shard 0/2 $mdt > $out &
+	pid=$!
+	stack_trap "kill $pid 2>/dev/null" EXIT
+	wait_update $HOSTNAME "$LCTL get_param -n $param |
+		awk '/records:/ { print (\$2 > 0) }'" 1 30 ||
+		error "no record read"
+
+	stats=$($LCTL get_param -n $param)
+	echo "$stats"
+	echo "$stats" | grep -q "shard: 0/2" || error "shard not reported"
+	# the records of the other shard are dropped by the MDT, except in
+	# blocks read before the filter was set
+	(( $(echo "$stats" | awk '/skipped_mdt:/ { print $2 }') > 0 )) ||
+		error "no record filtered by the MDT"
+
+	kill $pid
+	wait $pid
+	[ -z "$($LCTL get_param -n $param)" ] || error "reader not removed"
+}
+run_test 160k "changelog shards are filtered by the MDT"
+
 test_161a() {
 	[ $PARALLEL == "yes" ] && skip "skip parallel run"
 
@@ -14102,12 +14211,12 @@ test_215() { # for bugs 18102, 21079, 21517
 	remove_lnet_proc_files "routers"
 
 	# lnet.peers should look like this:
-	# nid refs state last max rtr min tx min queue
+	# nid refs state last max rtr min tx min queue health
 	# where nid is a string like 192.168.1.1@tcp2, refs > 0,
 	# state is up/down/NA, max >= 0. last, rtr, min, tx, min are
-	# numeric (0 or >0 or <0), queue >= 0.
-	L1="^nid +refs +state +last +max +rtr +min +tx +min +queue$"
-	BR="^$NID +$P +(up|down|NA) +$I +$N +$I +$I +$I +$I +$N$"
+	# numeric (0 or >0 or <0), queue >= 0, health >= 0.
+	L1="^nid +refs +state +last +max +rtr +min +tx +min +queue +health$"
+	BR="^$NID +$P +(up|down|NA) +$I +$N +$I +$I +$I +$I +$N +$N$"
 	create_lnet_proc_files "peers"
 	check_lnet_proc_entry "peers.sys" "lnet.peers" "$BR" "$L1"
 	remove_lnet_proc_files "peers"
@@ -14122,18 +14231,43 @@ test_215() { # for bugs 18102, 21079, 21517
 	remove_lnet_proc_files "buffers"
 
 	# lnet.nis should look like this:
-	# nid status alive refs peer rtr max tx min
+	# nid status alive refs peer rtr max tx min health
 	# where nid is a string like 192.168.1.1@tcp2, status is up/down,
 	# alive is numeric (0 or >0 or <0), refs >= 0, peer >= 0,
-	# rtr >= 0, max >=0, tx and min are numeric (0 or >0 or <0).
-	L1="^nid +status +alive +refs +peer +rtr +max +tx +min$"
-	BR="^$NID +(up|down) +$I +$N +$N +$N +$N +$I +$I$"
+	# rtr >= 0, max >=0, tx and min are numeric (0 or >0 or <0),
+	# health >= 0.
+	L1="^nid +status +alive +refs +peer +rtr +max +tx +min +health$"
+	BR="^$NID +(up|down) +$I +$N +$N +$N +$N +$I +$I +$N$"
 	create_lnet_proc_files "nis"
 	check_lnet_proc_entry "nis.sys" "lnet.nis" "$BR" "$L1"
 	remove_lnet_proc_files "nis"
 
 	# can we successfully write to lnet.stats?
 	lctl set_param -n stats=0 || error "cannot write to lnet.stats"
+
+	# lnet.select_bench times path selection towards a directly
+	# connected peer, with and without the peer selection table
+	local nets=$(lctl get_param -n nis |
+		     awk 'NR > 1 && $1 !~ /@lo$/ { sub(/.*@/, "", $1); print $1 }' |
+		     tr '\n' ' ')
+	local nid=$(lctl get_param -n peers |
+		    awk -v nets="$nets" 'NR > 1 { n = $1; sub(/.*@/, "", n);
+			if (index(" " nets " ", " " n " ")) { print $1; exit } }')
+	if [ -n "$nid" ]; then
+		lctl set_param -n select_bench="$nid 1000" ||
+			error "cannot write to lnet.select_bench"
+		lctl get_param -n select_bench |
+			grep -qE "^cached_ns: [0-9]+$" ||
+			error "bad lnet.select_bench output"
+	fi
+
+	# lnet.portals has the match list walk statistics of all portals
+	# used so far, and a write resets them
+	lctl get_param -n portals | head -n 1 | grep -q "^portal cpt type" ||
+		error "bad lnet.portals header"
+	lctl get_param -n portals | awk 'NR > 1 && NF != 16 { exit 1 }' ||
+		error "bad lnet.portals output"
+	lctl set_param -n portals=0 || error "cannot write to lnet.portals"
 }
 run_test 215 "lnet exists and has proper content - bugs 18102, 21079, 21517"
 
@@ -18567,6 +18701,463 @@ test_414() {
 }
 run_test 414 "simulate ENOMEM in ptlrpc_register_bulk()"
 
+test_415() {
+	remote_mds_nodsh && skip "remote MDS with nodsh"
+	local mdtosc=$(get_mdtosc_proc_path $SINGLEMDS $FSNAME-OST0000)
+
+	do_facet $SINGLEMDS $LCTL get_param -n \
+		osp.$mdtosc.precreate_stats > /dev/null ||
+		skip "MDS does not support precreate_stats"
+
+	local seconds=$(do_facet $SINGLEMDS $LCTL get_param -n \
+			osp.$mdtosc.create_seconds)
+	stack_trap "do_facet $SINGLEMDS $LCTL set_param \
+		osp.$mdtosc.create_seconds=$seconds" EXIT
+	do_facet $SINGLEMDS $LCTL set_param osp.$mdtosc.create_seconds=2 ||
+		error "cannot set create_seconds"
+	do_facet $SINGLEMDS $LCTL set_param osp.$mdtosc.precreate_stats=0
+
+	local count=$(do_facet $SINGLEMDS $LCTL get_param -n \
+		      osp.$mdtosc.create_count)
+	stack_trap "do_facet $SINGLEMDS $LCTL set_param \
+		osp.$mdtosc.create_count=$count" EXIT
+	do_facet $SINGLEMDS $LCTL set_param osp.$mdtosc.create_count=32 ||
+		error "cannot set create_count"
+
+	mkdir -p $DIR/$tdir
+	$LFS setstripe -i 0 -c 1 $DIR/$tdir
+	createmany -o $DIR/$tdir/f 2000 || error "createmany failed"
+	sleep 1
+	createmany -o $DIR/$tdir/g 2000 || error "createmany failed"
+
+	local stats=$(do_facet $SINGLEMDS $LCTL get_param -n \
+		      osp.$mdtosc.precreate_stats)
+	echo "$stats"
+
+	local rate=$(awk '/^create_rate:/ { print $2 }' <<< "$stats")
+	(( rate > 0 )) || error "create rate not measured"
+
+	local waits=$(awk '/^[0-9]+:/ { sum += $2 } END { print sum }' \
+		      <<< "$stats")
+	(( waits >= 4000 )) || error "only $waits reservations accounted"
+
+	# the window grew with the create rate
+	local grown=$(do_facet $SINGLEMDS $LCTL get_param -n \
+		      osp.$mdtosc.create_count)
+	(( grown > 32 )) || error "create_count $grown did not grow"
+
+	# once idle the rate decays, and the next precreation asks for fewer
+	# objects than during the create storm
+	sleep 35
+	createmany -o $DIR/$tdir/h $((grown + 32)) ||
+		error "createmany failed"
+	do_facet $SINGLEMDS $LCTL get_param osp.$mdtosc.precreate_stats
+
+	local shrunk=$(do_facet $SINGLEMDS $LCTL get_param -n \
+		       osp.$mdtosc.create_count)
+	(( shrunk < grown )) ||
+		error "create_count $shrunk did not shrink from $grown"
+
+	unlinkmany $DIR/$tdir/f 2000
+	unlinkmany $DIR/$tdir/g 2000
+	unlinkmany $DIR/$tdir/h $((grown + 32))
+}
+run_test 415 "precreate window follows the create rate"
+
+test_416() {
+	local ns=$($LCTL list_param ldlm.namespaces.*-MDT0000-mdc-* | head -1)
+
+	$LCTL get_param -n $ns.lru_stats > /dev/null ||
+		skip "client does not support lru_stats"
+
+	mkdir -p $DIR/$tdir
+	createmany -o $DIR/$tdir/f 200 || error "createmany failed"
+	cancel_lru_locks mdc
+	# locks go to the LRU part of the CPT they were last used on, spread
+	# them over all the CPUs
+	local cpu
+	local ncpus=$(getconf _NPROCESSORS_ONLN)
+
+	# a CPU may be offline
+	for ((cpu = 0; cpu < ncpus; cpu++)); do
+		taskset -c $cpu stat $DIR/$tdir/f$((cpu % 200)) &> /dev/null
+	done
+	ls -l $DIR/$tdir > /dev/null || error "ls failed"
+	# matched locks are marked and kept in the LRU
+	ls -l $DIR/$tdir > /dev/null || error "ls failed"
+
+	$LCTL set_param $ns.lru_stats=clear
+	cancel_lru_locks mdc
+
+	local stats=$($LCTL get_param -n $ns.lru_stats)
+	echo "$stats"
+
+	local scanned=$(awk '/^lru_scanned/ { print $7 }' <<< "$stats")
+	(( scanned >= 200 )) || error "only ${scanned:-0} LRU locks scanned"
+	(( $($LCTL get_param -n $ns.lock_unused_count) == 0 )) ||
+		error "unused locks left after LRU clear"
+
+	unlinkmany $DIR/$tdir/f 200
+}
+run_test 416 "LRU scan of per-CPT LRUs with lazily aged locks"
+
+test_417() {
+	remote_mds_nodsh && skip "remote MDS with nodsh"
+
+	local nid
+
+	if remote_mds; then
+		nid=$($LCTL list_nids | head -1 | sed "s/\./\\\./g")
+	else
+		nid="0@lo"
+	fi
+
+	local param="mdt.$FSNAME-MDT0000.exports.'$nid'.ldlm_locks"
+
+	do_facet mds1 $LCTL get_param -n $param > /dev/null ||
+		skip "MDS does not support per-export ldlm_locks"
+
+	test_mkdir -c1 -i0 $DIR/$tdir
+	createmany -o $DIR/$tdir/f 100 || error "createmany failed"
+	ls -l $DIR/$tdir > /dev/null || error "ls failed"
+
+	local locks=$(do_facet mds1 $LCTL get_param -n $param)
+	echo "$locks"
+
+	local count=$(awk '/lock_count:/ { sum += $2 } END { print sum }' \
+		      <<< "$locks")
+	local idle=$(awk '/idle_time:/ { print $2; exit }' <<< "$locks")
+
+	(( count >= 100 )) || error "only ${count:-0} locks of the export"
+	(( idle <= 10 )) || error "export idle for $idle seconds"
+
+	cancel_lru_locks mdc
+	count=$(do_facet mds1 $LCTL get_param -n $param |
+		awk '/lock_count:/ { sum += $2 } END { print sum }')
+	(( count < 100 )) || error "$count locks left after LRU clear"
+
+	unlinkmany $DIR/$tdir/f 100
+}
+run_test 417 "per-export lock footprint"
+
+test_418() {
+	remote_mds_nodsh && skip "remote MDS with nodsh"
+
+	local param="mds.MDS.mdt"
+	local timeout
+
+	timeout=$(do_facet mds1 $LCTL get_param -n $param.threads_idle_timeout) ||
+		skip "MDS does not support threads_idle_timeout"
+
+	local tmin=$(do_facet mds1 $LCTL get_param -n $param.threads_min)
+	local tmax=$(do_facet mds1 $LCTL get_param -n $param.threads_max)
+	local started=$(do_facet mds1 $LCTL get_param -n $param.threads_started)
+
+	(( started > tmin )) || skip "only $started threads, threads_min $tmin"
+
+	stack_trap "do_facet mds1 $LCTL set_param \
+		$param.threads_max=$tmax $param.threads_idle_timeout=$timeout" EXIT
+	do_facet mds1 $LCTL set_param $param.threads_max=$tmin \
+		$param.threads_idle_timeout=1 || error "cannot set thread limits"
+
+	# threads above threads_max exit once they are done with a request,
+	# the idle ones when their wait times out
+	test_mkdir $DIR/$tdir
+	createmany -o $DIR/$tdir/f 1000 || error "createmany failed"
+	wait_update_facet mds1 "$LCTL get_param -n $param.threads_started" \
+		$tmin 10 || error "threads_started is not back to $tmin"
+
+	do_facet mds1 $LCTL get_param -n $param.req_queue_time |
+		grep -q "ms:" || error "no request queue time recorded"
+	unlinkmany $DIR/$tdir/f 1000
+}
+run_test 418 "service threads above threads_max exit"
+
+test_419() {
+	$LCTL get_param -n ptlrpcd_stats > /dev/null 2>&1 ||
+		skip "client does not support ptlrpcd_stats"
+
+	local before=$($LCTL get_param -n ptlrpcd_stats |
+		awk '/^ptlrpcd_[0-9]/ { sum += $3 + $4 } END { print sum }')
+
+	# async writes and their commits go through ptlrpcd
+	dd if=/dev/zero of=$DIR/$tfile bs=1M count=64 || error "dd failed"
+	sync
+
+	local stats=$($LCTL get_param -n ptlrpcd_stats)
+	echo "$stats"
+
+	local after=$(awk '/^ptlrpcd_[0-9]/ { sum += $3 + $4 } END { print sum }' \
+		      <<< "$stats")
+
+	(( after > before )) ||
+		error "no requests accounted to ptlrpcd threads ($before/$after)"
+	rm -f $DIR/$tfile
+}
+run_test 419 "ptlrpcd thread load statistics"
+
+test_420() {
+	local lnetctl=$LUSTRE/../lnet/utils/lnetctl
+
+	[[ -x $lnetctl ]] || lnetctl=$(which lnetctl 2> /dev/null)
+	[[ -n "$lnetctl" ]] || skip "lnetctl not found"
+	$lnetctl policy show > /dev/null 2>&1 ||
+		skip "LNet does not support selection policies"
+
+	local nid=$($LCTL list_nids | head -1)
+	local out
+
+	out=$($lnetctl policy add --nid $nid 2>&1) &&
+		error "policy added without a priority"
+	echo "$out"
+	grep -q "missing mandatory parameter: 'priority'" <<< "$out" ||
+		error "missing priority not reported"
+
+	stack_trap "$lnetctl policy del --nid $nid" EXIT
+	$lnetctl policy add --nid $nid --priority 2 ||
+		error "cannot add policy for $nid"
+	$lnetctl policy add --nid $nid --priority 1 ||
+		error "cannot change policy for $nid"
+
+	out=$($lnetctl policy show)
+	echo "$out"
+	grep -A1 "nid: $nid" <<< "$out" | grep -q "priority: 1" ||
+		error "policy for $nid not shown with priority 1"
+
+	# the selection still has to work with the policy in place
+	dd if=/dev/zero of=$DIR/$tfile bs=1M count=16 oflag=direct ||
+		error "dd failed"
+	rm -f $DIR/$tfile
+
+	$lnetctl policy del --nid $nid || error "cannot delete policy"
+	$lnetctl policy show | grep -q "nid: $nid" &&
+		error "policy for $nid still shown"
+	return 0
+}
+run_test 420 "LNet selection policies"
+
+test_421() {
+	local lnetctl=$LUSTRE/../lnet/utils/lnetctl
+	local param=/sys/module/lnet/parameters/router_tune_interval
+
+	[[ -x $lnetctl ]] || lnetctl=$(which lnetctl 2> /dev/null)
+	[[ -n "$lnetctl" ]] || skip "lnetctl not found"
+	[[ -f $param ]] || skip "LNet does not support router auto-tuning"
+	$lnetctl routing show | grep -q "enable: 1" &&
+		skip "node is already a router"
+
+	local interval=$(cat $param)
+	local before=$($lnetctl stats show | awk '/pool_shrink:/ { print $2 }')
+
+	stack_trap "echo $interval > $param" EXIT
+	stack_trap "$lnetctl set routing 0" EXIT
+	$lnetctl set routing 1 || error "cannot enable routing"
+	echo 1 > $param
+
+	# without routed traffic the default pools stay idle and the
+	# tuning shrinks them towards their minimum size
+	wait_update $HOSTNAME "$lnetctl stats show |
+		awk '/pool_shrink:/ { print (\$2 > ${before:-0}) }'" 1 20 ||
+		error "idle router buffer pools were not shrunk"
+	$lnetctl stats show | sed -n '/router_tuning:/,$p'
+	$lnetctl routing show
+}
+run_test 421 "router buffer pools auto-tuning"
+
+test_422() {
+	remote_mds_nodsh && skip "remote MDS with nodsh"
+	local mdtosc=$(get_mdtosc_proc_path $SINGLEMDS $FSNAME-OST0000)
+
+	do_facet $SINGLEMDS $LCTL get_param -n \
+		osp.$mdtosc.sync_cancel_stats > /dev/null ||
+		skip "MDS does not support sync_cancel_stats"
+
+	local stats=$(do_facet $SINGLEMDS $LCTL get_param -n \
+		      osp.$mdtosc.sync_cancel_stats)
+	local recs=$(awk '/^records:/ { print $2 }' <<< "$stats")
+	local batches=$(awk '/^batches:/ { print $2 }' <<< "$stats")
+
+	mkdir -p $DIR/$tdir
+	$LFS setstripe -i 0 -c 1 $DIR/$tdir
+	createmany -o $DIR/$tdir/f 1000 || error "createmany failed"
+	unlinkmany $DIR/$tdir/f 1000 || error "unlinkmany failed"
+	# OST destroys commit together, so do their llog cancels
+	wait_delete_completed
+
+	stats=$(do_facet $SINGLEMDS $LCTL get_param -n \
+		osp.$mdtosc.sync_cancel_stats)
+	echo "$stats"
+	recs=$(( $(awk '/^records:/ { print $2 }' <<< "$stats") - recs ))
+	batches=$(( $(awk '/^batches:/ { print $2 }' <<< "$stats") - batches ))
+
+	(( recs >= 1000 )) || error "only $recs records cancelled"
+	(( batches * 10 <= recs )) ||
+		error "$recs records cancelled in $batches batches"
+}
+run_test 422 "OSP sync llog records are cancelled in batches"
+
+test_423() {
+	local ns="mdt-$FSNAME-MDT0000_UUID"
+	local threads
+
+	do_facet mds1 $LCTL get_param -n ldlm.lookup_bench > /dev/null ||
+		skip "MDS does not support ldlm.lookup_bench"
+
+	# nanoseconds per lookup per thread, lockless and under the hash
+	# bucket lock, as more threads look up the same resources
+	for threads in 1 16; do
+		do_facet mds1 $LCTL set_param -n \
+			ldlm.lookup_bench=\"$ns $threads 10000\" ||
+			error "lookup_bench with $threads threads failed"
+		do_facet mds1 $LCTL get_param -n ldlm.lookup_bench |
+			tee $TMP/$tfile.log
+		grep -q "^threads: $threads$" $TMP/$tfile.log ||
+			error "lookup_bench did not run $threads threads"
+		grep -qE "^rcu_ns: [0-9]+$" $TMP/$tfile.log ||
+			error "bad ldlm.lookup_bench output"
+	done
+	rm -f $TMP/$tfile.log
+
+	do_facet mds1 $LCTL set_param -n ldlm.lookup_bench=\"$ns 0\" &&
+		error "lookup_bench with 0 threads succeeded" || true
+}
+run_test 423 "LDLM resource lookup microbenchmark"
+
+test_424() {
+	local param=/sys/module/lnet/parameters/lnet_health_sensitivity
+
+	$LCTL get_param -n health_stats > /dev/null 2>&1 ||
+		skip "LNet does not support health_stats"
+	[[ $(cat $param 2>/dev/null || echo 0) -gt 0 ]] ||
+		skip "LNet health is disabled"
+
+	local nid=$($LCTL get_param -n mdc.$FSNAME-MDT0000-mdc-*.import |
+		    awk '/current_connection:/ { print $2; exit }')
+
+	[ -n "$nid" ] || error "cannot find the MDS NID"
+	[[ $nid == *@lo ]] && skip "MDS is reached over the loopback"
+
+	local health="$LCTL get_param -n peers |
+		      awk '\$1 == \"$nid\" { print \$NF }'"
+
+	test_mkdir $DIR/$tdir
+	$LCTL set_param -n health_stats=0
+	# fail half of the PUTs to the MDS before they reach the LND, so
+	# they are resent
+	$LCTL net_drop_add -s "*" -d $nid -m PUT -r 2 --local ||
+		error "net_drop_add failed"
+	stack_trap "$LCTL net_drop_del -a" EXIT
+
+	createmany -o $DIR/$tdir/$tfile- 100 ||
+		error "createmany failed with local send failures"
+	local low=$(eval "$health")
+
+	$LCTL net_drop_list
+	$LCTL net_drop_del -a
+
+	local stats=$($LCTL get_param -n health_stats)
+	local failures=$(awk '/^failures:/ { print $2 }' <<< "$stats")
+	local resends=$(awk '/^resends:/ { print $2 }' <<< "$stats")
+
+	echo "$stats"
+	echo "health of $nid with failures: $low"
+	(( failures > 0 )) || error "no send failure counted"
+	(( resends > 0 && resends <= failures )) ||
+		error "$resends resends for $failures failures"
+	(( low < 1000 )) || error "health of $nid did not drop: $low"
+
+	# the health is earned back without failures
+	wait_update $HOSTNAME "$health" 1000 60 ||
+		error "health of $nid did not recover: $(eval "$health")"
+	unlinkmany $DIR/$tdir/$tfile- 100 || error "unlinkmany failed"
+}
+run_test 424 "LNet health: locally failed PUTs lower health, are resent"
+
+# sum "field N" of all the socklnd conns of this node
+tcp_conn_sum() {
+	$LCTL --net $NETTYPE conn_list |
+		awk -v f=$1 '{ for (i = 1; i < NF; i++) if ($i == f) n += $(i + 1) }
+			     END { print n + 0 }'
+}
+
+test_425() {
+	local param=/sys/module/ksocklnd/parameters/tx_coalesce
+
+	[[ $NETTYPE == tcp* ]] || skip "socklnd only"
+	[[ $(cat $param 2>/dev/null || echo 0) -gt 0 ]] ||
+		skip "socklnd does not coalesce small messages"
+	$LCTL --net $NETTYPE conn_list | grep -q " coalesced " ||
+		skip "socklnd does not count coalesced messages"
+
+	test_mkdir $DIR/$tdir
+	createmany -o $DIR/$tdir/$tfile- 500 || error "createmany failed"
+
+	local msgs=$(tcp_conn_sum msgs)
+	local coalesced=$(tcp_conn_sum coalesced)
+	local i
+
+	# many concurrent getattr RPCs queue small messages on the same conns
+	for i in {1..5}; do
+		cancel_lru_locks mdc
+		ls $DIR/$tdir | sed "s#^#$DIR/$tdir/#" |
+			xargs -P 32 -n 8 stat > /dev/null ||
+			error "stat of $DIR/$tdir failed"
+	done
+
+	msgs=$(($(tcp_conn_sum msgs) - msgs))
+	coalesced=$(($(tcp_conn_sum coalesced) - coalesced))
+	$LCTL --net $NETTYPE conn_list
+	echo "$coalesced of $msgs messages sent coalesced"
+	(( msgs > 0 )) || error "no message sent counted"
+	(( coalesced > 0 )) || error "no small message coalesced"
+	(( coalesced < msgs )) ||
+		error "$coalesced coalesced of $msgs messages sent"
+	unlinkmany $DIR/$tdir/$tfile- 500 || error "unlinkmany failed"
+}
+run_test 425 "socklnd coalesces small messages under a getattr storm"
+
+test_426() {
+	$LCTL help net_delay_add 2>&1 | grep -q -- "--queue" ||
+		skip "LNet delay rules do not support shaping"
+
+	local nid=$($LCTL get_param -n mdc.$FSNAME-MDT0000-mdc-*.import |
+		    awk '/current_connection:/ { print $2; exit }')
+
+	[ -n "$nid" ] || error "cannot find the MDS NID"
+	[[ $nid == *@lo ]] && skip "MDS is reached over the loopback"
+
+	# only the REPLYs of lctl ping are shaped, Lustre RPCs are not
+	$LCTL net_delay_add -s $nid -d "*" -m REPLY -u 500000 -b 1K -q 2 ||
+		error "net_delay_add failed"
+	stack_trap "$LCTL net_delay_del -a" EXIT
+
+	local start=$(date +%s%N)
+	local elapsed
+	local i
+
+	$LCTL ping $nid 5 || error "ping $nid failed"
+	elapsed=$((($(date +%s%N) - start) / 1000000))
+	echo "ping of $nid took ${elapsed}ms"
+	(( elapsed >= 500 )) || error "ping of $nid not delayed: ${elapsed}ms"
+
+	# more pings in flight than the rule queues, the rest are dropped
+	for i in {1..16}; do
+		$LCTL ping $nid 2 > /dev/null 2>&1 &
+	done
+	wait
+
+	local out=$($LCTL net_delay_list)
+	local overflow=$(awk '/shaping:/ { print $NF; exit }' <<< "$out")
+
+	echo "$out"
+	$LCTL net_delay_del -a
+	[ -n "$overflow" ] || error "no shaping shown for the delay rule"
+	(( overflow > 0 )) || error "no REPLY overflowed the queue of 2"
+
+	$LCTL ping $nid || error "ping $nid failed after the rule is removed"
+}
+run_test 426 "LNet delay rule with bandwidth and queue depth"
+
 prep_801() {
 	[[ $(lustre_version_code mds1) -lt $(version_code 2.9.55) ]] ||
 	[[ $(lustre_version_code ost1) -lt $(version_code 2.9.55) ]] &&
@@ -3801,6 +3801,59 @@ test_77n() { #LU-10802
 }
 run_test 77n "check wildcard support for TBF JobID NRS policy"
 
+test_77o() {
+	[ $(lustre_version_code ost1) -lt $(version_code 2.11.52) ] &&
+		skip "Need OST version at least 2.11.52" && return
+
+	local nodes=$(comma_list $(osts_nodes))
+
+	do_nodes $nodes lctl set_param ost.OSS.ost_io.nrs_policies="edf" ||
+		error "failed to set edf policy"
+	stack_trap "do_nodes $nodes lctl set_param \
+		ost.OSS.ost_io.nrs_policies=fifo" EXIT
+
+	nrs_write_read
+
+	do_facet ost1 lctl get_param -n ost.OSS.ost_io.nrs_edf_expired |
+		grep -q "reg_expired:" || error "no EDF expired count"
+}
+run_test 77o "check EDF NRS policy"
+
+test_77p() {
+	[ $(lustre_version_code ost1) -lt $(version_code 2.11.52) ] &&
+		skip "Need OST version at least 2.11.52" && return
+
+	local nodes=$(comma_list $(osts_nodes))
+
+	do_nodes $nodes lctl set_param ost.OSS.ost_io.nrs_policies="tbf" \
+		ost.OSS.ost_io.nrs_tbf_rule="start\ tenant\ jobid={dd.*}\ rate=20" \
+		ost.OSS.ost_io.nrs_tbf_rule="start\ tenant_u\ jobid={dd.$RUNAS_ID}\ rate=5\ parent=tenant" ||
+		error "failed to start nested TBF rules"
+
+	do_facet ost1 lctl get_param -n ost.OSS.ost_io.nrs_tbf_rule |
+		grep -q "tenant_u.*parent tenant" ||
+		error "child rule does not show its parent"
+
+	do_facet ost1 lctl set_param \
+		ost.OSS.ost_io.nrs_tbf_rule="stop\ tenant" &&
+		error "parent rule stopped while its child is active"
+
+	# the child may borrow unused tokens of the parent, but never more
+	nrs_write_read "$RUNAS"
+	tbf_verify 20 20 "$RUNAS"
+
+	do_nodes $nodes lctl set_param \
+		ost.OSS.ost_io.nrs_tbf_rule="stop\ tenant_u" \
+		ost.OSS.ost_io.nrs_tbf_rule="stop\ tenant" \
+		ost.OSS.ost_io.nrs_policies="fifo"
+
+	# sleep 3 seconds to wait the tbf policy stop completely,
+	# or the next test case is possible get -EAGAIN when
+	# setting the tbf policy
+	sleep 3
+}
+run_test 77p "check hierarchical TBF rules"
+
 test_78() { #LU-6673
 	local rc
 
@@ -4412,6 +4465,98 @@ test_101c() {
 }
 run_test 101c "Discard DoM data on close-unlink"
 
+test_102() {
+	local ns="ldlm.namespaces.mdt-$FSNAME-MDT0000_UUID"
+
+	do_facet mds1 $LCTL get_param -n $ns.ibits_stats > /dev/null ||
+		skip "MDS does not support ibits_stats"
+
+	local min_scan=$(do_facet mds1 $LCTL get_param -n \
+			 $ns.ibits_index_min_scan)
+
+	stack_trap "do_facet mds1 $LCTL set_param \
+		$ns.ibits_index_min_scan=$min_scan" EXIT
+	# index the granted locks of the file from the first lock
+	do_facet mds1 $LCTL set_param $ns.ibits_index_min_scan=1
+	do_facet mds1 $LCTL set_param $ns.ibits_stats=clear
+
+	$LFS mkdir -i 0 $DIR1/$tdir || error "mkdir failed"
+	touch $DIR1/$tdir/$tfile || error "touch failed"
+
+	local i
+	local dirs=("$DIR1" "$DIR2")
+
+	for ((i = 0; i < 10; i++)); do
+		local d1=${dirs[$((i % 2))]}
+		local d2=${dirs[$(((i + 1) % 2))]}
+		local mode=$(printf "%o" $((0600 + i)))
+
+		# locks on disjoint bits from both clients are granted
+		# together: lookup/update/perm, xattr and layout
+		stat $d1/$tdir/$tfile > /dev/null || error "stat $d1 failed"
+		stat $d2/$tdir/$tfile > /dev/null || error "stat $d2 failed"
+		getfattr -d $d1/$tdir/$tfile > /dev/null ||
+			error "getfattr $d1 failed"
+		$LFS getstripe $d2/$tdir/$tfile > /dev/null ||
+			error "getstripe $d2 failed"
+
+		# conflicting updates revoke the locks of the other client
+		chmod $mode $d1/$tdir/$tfile || error "chmod $d1 failed"
+		setfattr -n user.round -v $i $d1/$tdir/$tfile ||
+			error "setfattr $d1 failed"
+		[[ $(stat -c %a $d2/$tdir/$tfile) == $mode ]] ||
+			error "round $i: stale mode on $d2"
+		[[ $(getfattr --only-values -n user.round \
+		     $d2/$tdir/$tfile) == $i ]] ||
+			error "round $i: stale xattr on $d2"
+	done
+
+	local stats=$(do_facet mds1 $LCTL get_param -n $ns.ibits_stats)
+
+	echo "$stats"
+	(( $(awk '/^index_built/ { print $2 }' <<< "$stats") > 0 )) ||
+		error "granted locks index not built"
+	(( $(awk '/^index_compat/ { print $2 }' <<< "$stats") > 0 )) ||
+		error "no lock granted from the index"
+	(( $(awk '/^index_(conflict|walk)/ { n += $2 } END { print n + 0 }' \
+	   <<< "$stats") > 0 )) || error "no conflict found with the index"
+}
+run_test 102 "inodebits locks index: grants and conflicts of disjoint bits"
+
+test_103() {
+	local inst=$($LFS getname $MOUNT1 | cut -d' ' -f1)
+	local ns="ldlm.namespaces.$FSNAME-MDT0000-mdc-${inst#$FSNAME-}"
+	local count=500
+
+	$LCTL get_param -n $ns.bl_cancel_stats > /dev/null ||
+		skip "client does not support bl_cancel_stats"
+
+	$LFS mkdir -i 0 $DIR1/$tdir || error "mkdir failed"
+	createmany -o $DIR1/$tdir/$tfile- $count || error "createmany failed"
+	stack_trap "unlinkmany $DIR1/$tdir/$tfile- $count" EXIT
+
+	# cache the locks of all the files on the first mount
+	cancel_lru_locks mdc
+	ls -l $DIR1/$tdir > /dev/null || error "ls $DIR1 failed"
+	$LCTL set_param $ns.bl_cancel_stats=clear
+
+	# revoke them from the second mount concurrently
+	ls $DIR2/$tdir | (cd $DIR2/$tdir; xargs -P 32 -n 8 chmod 0600) ||
+		error "chmod $DIR2 failed"
+	# the pending batch is flushed within a second
+	sleep 2
+
+	local stats=$($LCTL get_param -n $ns.bl_cancel_stats)
+	local batched=$(awk '/^batched/ { print $2 }' <<< "$stats")
+	local rpcs=$(awk '/^batch_rpc/ { print $2 }' <<< "$stats")
+
+	echo "$stats"
+	(( ${batched:-0} > 0 )) || error "no blocking AST cancel batched"
+	(( ${rpcs:-0} > 0 && rpcs < batched )) ||
+		error "$batched batched cancels sent in ${rpcs:-0} RPCs"
+}
+run_test 103 "blocking AST cancels are batched into fewer RPCs"
+
 log "cleanup: ======================================================"
 
 # kill and wait in each test only guarentee script finish, but command in script
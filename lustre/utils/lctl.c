@@ -117,7 +117,10 @@ command_t cmdlist[] = {
 	 "		      <<-r | --rate DROP_RATE> |\n"
 	 "		      <-i | --interval SECONDS>>\n"
 	 "		      [<-p | --portal> PORTAL...]\n"
-	 "		      [<-m | --message> <PUT|ACK|GET|REPLY>...]\n"},
+	 "		      [<-m | --message> <PUT|ACK|GET|REPLY>...]\n"
+	 "		      [-L | --local]\n"
+	 "--local fails matching sends on the sender, before they reach\n"
+	 "the LND, instead of losing them on the receiver\n"},
 	{"net_drop_del", jt_ptl_drop_del, 0, "remove LNet drop rule\n"
 	 "usage: net_drop_del <[-a | --all] |\n"
 	 "		      <-s | --source NID>\n"
@@ -133,7 +136,18 @@ command_t cmdlist[] = {
 	 "			<-i | --interval SECONDS>>\n"
 	 "		       <-l | --latency SECONDS>\n"
 	 "		       [<-p | --portal> PORTAL...]\n"
-	 "		       [<-m | --message> <PUT|ACK|GET|REPLY>...]\n"},
+	 "		       [<-m | --message> <PUT|ACK|GET|REPLY>...]\n"
+	 "		       [<-u | --latency_us> USECONDS]\n"
+	 "		       [<-j | --jitter> USECONDS]\n"
+	 "		       [<-D | --distribution> <uniform|normal>]\n"
+	 "		       [<-b | --bandwidth> BYTES_PER_SEC[K|M|G]]\n"
+	 "		       [<-B | --burst> BYTES[K|M|G]]\n"
+	 "		       [<-q | --queue> DEPTH]\n"
+	 "shaping options (-u, -j, -b, -q) delay all matching messages\n"
+	 "unless a rate or an interval is given, and make latency optional\n"
+	 "messages are never reordered, so jitter shows on sparse traffic\n"
+	 "only, a loaded rule releases messages at the largest latencies\n"
+	 "bandwidth and burst are rounded down to KiB, at least 1K\n"},
 	{"net_delay_del", jt_ptl_delay_del, 0, "remove LNet delay rule\n"
 	 "usage: net_delay_del <[-a | --all] |\n"
 	 "		       <-s | --source NID>\n"
@@ -465,7 +465,8 @@ command_t cmdlist[] = {
          "usage: ls [OPTION]... [FILE]..."},
         {"changelog", lfs_changelog, 0,
          "Show the metadata changes on an MDT."
-         "\nusage: changelog <mdtname> [startrec [endrec]]"},
+         "\nusage: changelog [--follow] [--shard <index>/<count>] <mdtname>"
+	 " [startrec [endrec]]"},
         {"changelog_clear", lfs_changelog_clear, 0,
          "Indicate that old changelog records up to <endrec> are no longer of "
          "interest to consumer <id>, allowing the system to free up space.\n"
@@ -6404,11 +6405,14 @@ static int lfs_changelog(int argc, char **argv)
 	void *changelog_priv;
 	struct changelog_rec *rec;
 	long long startrec = 0, endrec = 0;
+	unsigned int shard_index = 0, shard_count = 0;
 	char *mdd;
+	char *end;
 	struct option long_opts[] = {
 		{ .val = 'f', .name = "follow", .has_arg = no_argument },
+		{ .val = 's', .name = "shard", .has_arg = required_argument },
 		{ .name = NULL } };
-	char short_opts[] = "f";
+	char short_opts[] = "fs:";
 	int rc, follow = 0;
 
 	while ((rc = getopt_long(argc, argv, short_opts,
@@ -6417,6 +6421,19 @@ static int lfs_changelog(int argc, char **argv)
                 case 'f':
                         follow++;
                         break;
+		case 's':
+			/* <index>/<count> */
+			shard_index = strtoul(optarg, &end, 0);
+			if (*end == '/')
+				shard_count = strtoul(end + 1, &end, 0);
+			if (*end != '\0' || shard_count == 0 ||
+			    shard_index >= shard_count) {
+				fprintf(stderr,
+					"%s changelog: bad shard '%s'\n",
+					progname, optarg);
+				return CMD_HELP;
+			}
+			break;
                 default:
 			fprintf(stderr,
 				"%s changelog: unrecognized option '%s'\n",
@@ -6460,6 +6477,19 @@ static int lfs_changelog(int argc, char **argv)
 		return rc;
 	}
 
+	if (shard_count > 1) {
+		rc = llapi_changelog_set_filter(changelog_priv, 0,
+						shard_index, shard_count);
+		if (rc < 0) {
+			fprintf(stderr,
+				"%s changelog: cannot set shard %u/%u: %s\n",
+				progname, shard_index, shard_count,
+				strerror(errno = -rc));
+			llapi_changelog_fini(&changelog_priv);
+			return rc;
+		}
+	}
+
 	while ((rc = llapi_changelog_recv(changelog_priv, &rec)) == 0) {
 		time_t secs;
 		struct tm ts;
@@ -34,6 +34,7 @@
 #include <unistd.h>
 #include <errno.h>
 #include <poll.h>
+#include <sys/ioctl.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 
@@ -55,7 +56,7 @@ static int chlg_dev_path(char *path, size_t path_len, const char *device)
 }
 
 #define CHANGELOG_PRIV_MAGIC 0xCA8E1080
-#define CHANGELOG_BUFFER_SZ  4096
+#define CHANGELOG_BUFFER_SZ  65536
 
 /**
  * Record state for efficient changelog consumption.
@@ -371,3 +372,42 @@ int llapi_changelog_set_xflags(void *priv,
 
 	return 0;
 }
+
+/**
+ * Only receive a subset of the changelog records. Filtering is done by the
+ * kernel, so skipped records are never copied to userspace.
+ *
+ * @param priv		Opaque private control structure
+ * @param type_mask	Bitmask of (1 << CL_*) record types to receive, 0 for all
+ * @param shard_index	Index of the FID hash shard to receive
+ * @param shard_count	Number of shards, 0 or 1 to receive all records
+ *
+ * Running \a shard_count readers with different \a shard_index values
+ * spreads the records of an MDT among them, the records of a given file
+ * always being received by the same reader.
+ * Just call this function right after llapi_changelog_start().
+ */
+int llapi_changelog_set_filter(void *priv, __u32 type_mask,
+			       __u32 shard_index, __u32 shard_count)
+{
+	struct changelog_private *cp = priv;
+	struct changelog_filter cf = {
+		.cf_type_mask = type_mask,
+		.cf_shard_index = shard_index,
+		.cf_shard_count = shard_count,
+	};
+	int rc;
+
+	if (!cp || cp->clp_magic != CHANGELOG_PRIV_MAGIC)
+		return -EINVAL;
+
+	rc = ioctl(cp->clp_fd, LL_IOC_CHLG_SET_FILTER, &cf);
+	if (rc < 0) {
+		rc = -errno;
+		llapi_error(LLAPI_MSG_ERROR, rc,
+			    "cannot set changelog filter");
+		return rc;
+	}
+
+	return 0;
+}
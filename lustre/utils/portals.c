@@ -769,6 +769,7 @@ jt_ptl_print_connections (int argc, char **argv)
 {
         struct libcfs_ioctl_data data;
 	struct lnet_process_id        id;
+	struct socklnd_conn_stats stats;
 	char                     buffer[2][HOST_NAME_MAX + 1];
         int                      index;
         int                      rc;
@@ -781,14 +782,30 @@ jt_ptl_print_connections (int argc, char **argv)
                 data.ioc_net     = g_net;
                 data.ioc_count   = index;
 
-                rc = l_ioctl(LNET_DEV_ID, IOC_LIBCFS_GET_CONN, &data);
+		/* socklnd also reports traffic and CPU usage of the conn */
+		memset(&stats, 0, sizeof(stats));
+		stats.scs_rx_cpu = -1;
+		data.ioc_inllen1 = sizeof(stats);
+		data.ioc_inlbuf1 = (char *)&stats;
+		if (libcfs_ioctl_pack(&data, &ioc_buf, IOC_BUF_SIZE) != 0) {
+			fprintf(stderr, "libcfs_ioctl_pack failed\n");
+			return -1;
+		}
+
+		rc = l_ioctl(LNET_DEV_ID, IOC_LIBCFS_GET_CONN, ioc_buf);
                 if (rc != 0)
                         break;
 
+		libcfs_ioctl_unpack(&data, ioc_buf);
+
 		if (g_net_is_compatible(NULL, SOCKLND, 0)) {
+			__u64 age = stats.scs_age > 0 ? stats.scs_age : 1;
+
 			id.nid = data.ioc_nid;
 			id.pid = data.ioc_u32[6];
-			printf("%-20s %s[%d]%s->%s:%d %d/%d %s\n",
+			printf("%-20s %s[%d]%s->%s:%d %d/%d %s "
+			       "tx %llu rx %llu cpu %llu%% rxcpu %d "
+			       "msgs %llu coalesced %llu\n",
 			       libcfs_id2str(id),
 			       (data.ioc_u32[3] == SOCKLND_CONN_ANY) ? "A" :
 			       (data.ioc_u32[3] == SOCKLND_CONN_CONTROL) ? "C" :
@@ -804,7 +821,15 @@ jt_ptl_print_connections (int argc, char **argv)
 			       data.ioc_u32[1],         /* remote port */
 			       data.ioc_count, /* tx buffer size */
 			       data.ioc_u32[5], /* rx buffer size */
-			       data.ioc_flags ? "nagle" : "nonagle");
+			       data.ioc_flags ? "nagle" : "nonagle",
+			       (unsigned long long)stats.scs_tx_bytes,
+			       (unsigned long long)stats.scs_rx_bytes,
+			       (unsigned long long)((stats.scs_tx_usecs +
+						     stats.scs_rx_usecs) /
+						    (age * 10000)),
+			       stats.scs_rx_cpu,
+			       (unsigned long long)stats.scs_tx_msgs,
+			       (unsigned long long)stats.scs_tx_coalesced);
 		} else if (g_net_is_compatible(NULL, O2IBLND, 0)) {
 			printf("%s mtu %d\n",
 			       libcfs_nid2str(data.ioc_nid),
@@ -1314,6 +1339,68 @@ fault_attr_ptl_parse(char *ptl_str, __u64 *mask_p)
 	return 0;
 }
 
+/*
+ * parse a size in bytes with an optional K/M/G suffix, to KiB; zero is
+ * allowed, but not a size below 1K which would be taken as zero
+ */
+static int
+fault_attr_size_parse(char *str, __u32 *kib_p)
+{
+	unsigned long long size;
+	char *end;
+
+	size = strtoull(str, &end, 0);
+	switch (*end) {
+	case 'g':
+	case 'G':
+		size <<= 10;
+		/* fallthrough */
+	case 'm':
+	case 'M':
+		size <<= 10;
+		/* fallthrough */
+	case 'k':
+	case 'K':
+		size <<= 10;
+		end++;
+		/* fallthrough */
+	case '\0':
+		break;
+	default:
+		fprintf(stderr, "invalid size: %s\n", str);
+		return -1;
+	}
+
+	if (*end != '\0' || (size >> 10) > UINT_MAX) {
+		fprintf(stderr, "invalid size: %s\n", str);
+		return -1;
+	}
+
+	if (size != 0 && size < 1024) {
+		fprintf(stderr, "size %s below 1K, the unit of the limit\n",
+			str);
+		return -1;
+	}
+
+	*kib_p = size >> 10;
+	return 0;
+}
+
+static int
+fault_attr_dist_parse(char *str, __u32 *dist_p)
+{
+	if (!strcasecmp(str, "uniform")) {
+		*dist_p = LNET_DELAY_DIST_UNIFORM;
+		return 0;
+	} else if (!strcasecmp(str, "normal")) {
+		*dist_p = LNET_DELAY_DIST_NORMAL;
+		return 0;
+	}
+
+	fprintf(stderr, "unknown distribution %s\n", str);
+	return -1;
+}
+
 static int
 fault_simul_rule_add(__u32 opc, char *name, int argc, char **argv)
 {
@@ -1330,6 +1417,13 @@ fault_simul_rule_add(__u32 opc, char *name, int argc, char **argv)
 	{ .name = "latency",  .has_arg = required_argument, .val = 'l' },
 	{ .name = "portal",   .has_arg = required_argument, .val = 'p' },
 	{ .name = "message",  .has_arg = required_argument, .val = 'm' },
+	{ .name = "latency_us", .has_arg = required_argument, .val = 'u' },
+	{ .name = "jitter",   .has_arg = required_argument, .val = 'j' },
+	{ .name = "distribution", .has_arg = required_argument, .val = 'D' },
+	{ .name = "bandwidth", .has_arg = required_argument, .val = 'b' },
+	{ .name = "burst",    .has_arg = required_argument, .val = 'B' },
+	{ .name = "queue",    .has_arg = required_argument, .val = 'q' },
+	{ .name = "local",    .has_arg = no_argument,	    .val = 'L' },
 	{ .name = NULL } };
 
 	if (argc == 1) {
@@ -1338,7 +1432,8 @@ fault_simul_rule_add(__u32 opc, char *name, int argc, char **argv)
 		return -1;
 	}
 
-	optstr = opc == LNET_CTL_DROP_ADD ? "s:d:r:i:p:m:" : "s:d:r:l:p:m:";
+	optstr = opc == LNET_CTL_DROP_ADD ? "s:d:r:i:p:m:L" :
+					    "s:d:r:i:l:p:m:u:j:D:b:B:q:";
 	memset(&attr, 0, sizeof(attr));
 	while (1) {
 		char c = getopt_long(argc, argv, optstr, opts, NULL);
@@ -1391,6 +1486,43 @@ fault_simul_rule_add(__u32 opc, char *name, int argc, char **argv)
 				goto getopt_failed;
 			break;
 
+		case 'u': /* microseconds added to latency */
+			attr.u.delay.la_latency_us = strtoul(optarg, NULL, 0);
+			break;
+
+		case 'j': /* spread of latency in microseconds */
+			attr.u.delay.la_jitter_us = strtoul(optarg, NULL, 0);
+			break;
+
+		case 'D': /* distribution of latency */
+			rc = fault_attr_dist_parse(optarg,
+						   &attr.u.delay.la_dist);
+			if (rc != 0)
+				goto getopt_failed;
+			break;
+
+		case 'b': /* bandwidth limit, bytes per second */
+			rc = fault_attr_size_parse(optarg,
+						   &attr.u.delay.la_bandwidth);
+			if (rc != 0)
+				goto getopt_failed;
+			break;
+
+		case 'B': /* size of token bucket */
+			rc = fault_attr_size_parse(optarg,
+						   &attr.u.delay.la_burst);
+			if (rc != 0)
+				goto getopt_failed;
+			break;
+
+		case 'q': /* max # of queued messages */
+			attr.u.delay.la_queue_depth = strtoul(optarg, NULL, 0);
+			break;
+
+		case 'L': /* fail sends locally instead of losing them */
+			attr.u.drop.da_local = 1;
+			break;
+
 		default:
 			fprintf(stderr, "error: %s: option '%s' "
 				"unrecognized\n", argv[0], argv[optind - 1]);
@@ -1399,6 +1531,16 @@ fault_simul_rule_add(__u32 opc, char *name, int argc, char **argv)
 	}
 	optind = 1;
 
+	if (opc == LNET_CTL_DELAY_ADD &&
+	    attr.u.delay.la_rate == 0 && attr.u.delay.la_interval == 0 &&
+	    (attr.u.delay.la_latency_us != 0 ||
+	     attr.u.delay.la_jitter_us != 0 ||
+	     attr.u.delay.la_bandwidth != 0 ||
+	     attr.u.delay.la_queue_depth != 0)) {
+		/* shaping applies to all messages unless told otherwise */
+		attr.u.delay.la_rate = 1;
+	}
+
 	if (opc == LNET_CTL_DROP_ADD) {
 		/* NB: drop rate and interval are exclusive to each other */
 		if (!((attr.u.drop.da_rate == 0) ^
@@ -1417,7 +1559,11 @@ fault_simul_rule_add(__u32 opc, char *name, int argc, char **argv)
 			return -1;
 		}
 
-		if (attr.u.delay.la_latency == 0) {
+		if (attr.u.delay.la_latency == 0 &&
+		    attr.u.delay.la_latency_us == 0 &&
+		    attr.u.delay.la_jitter_us == 0 &&
+		    attr.u.delay.la_bandwidth == 0 &&
+		    attr.u.delay.la_queue_depth == 0) {
 			fprintf(stderr, "latency cannot be zero\n");
 			return -1;
 		}
@@ -1620,12 +1766,13 @@ fault_simul_rule_list(__u32 opc, char *name, int argc, char **argv)
 		libcfs_ioctl_unpack(&data, ioc_buf);
 
 		if (opc == LNET_CTL_DROP_LIST) {
-			printf("%s->%s (1/%d | %d) ptl %#jx, msg %x, "
+			printf("%s->%s (1/%d | %d%s) ptl %#jx, msg %x, "
 			       "%ju/%ju, PUT %ju, ACK %ju, GET "
 			       "%ju, REP %ju\n",
 			       libcfs_nid2str(attr.fa_src),
 			       libcfs_nid2str(attr.fa_dst),
 			       attr.u.drop.da_rate, attr.u.drop.da_interval,
+			       attr.u.drop.da_local ? ", local" : "",
 			       (uintmax_t)attr.fa_ptl_mask, attr.fa_msg_mask,
 			       (uintmax_t)stat.u.drop.ds_dropped,
 			       (uintmax_t)stat.fs_count,
@@ -1649,6 +1796,25 @@ fault_simul_rule_list(__u32 opc, char *name, int argc, char **argv)
 			       (uintmax_t)stat.fs_ack,
 			       (uintmax_t)stat.fs_get,
 			       (uintmax_t)stat.fs_reply);
+
+			if (attr.u.delay.la_latency_us == 0 &&
+			    attr.u.delay.la_jitter_us == 0 &&
+			    attr.u.delay.la_bandwidth == 0 &&
+			    attr.u.delay.la_queue_depth == 0)
+				continue;
+
+			printf("    shaping: latency_us %u, jitter %u (%s)"
+			       ", bandwidth %uKiB/s, burst %uKiB, queue %u"
+			       ", queued %ju, overflow %ju\n",
+			       attr.u.delay.la_latency_us,
+			       attr.u.delay.la_jitter_us,
+			       attr.u.delay.la_dist == LNET_DELAY_DIST_NORMAL ?
+			       "normal" : "uniform",
+			       attr.u.delay.la_bandwidth,
+			       attr.u.delay.la_burst,
+			       attr.u.delay.la_queue_depth,
+			       (uintmax_t)stat.u.delay.ls_queued,
+			       (uintmax_t)stat.u.delay.ls_overflow);
 		}
 	}
 	printf("found total %d\n", pos);
@@ -1776,6 +1776,17 @@ check_changelog_setinfo(void)
 	CHECK_MEMBER(changelog_setinfo, cs_id);
 }
 
+static void
+check_changelog_filter(void)
+{
+	BLANK_LINE();
+	CHECK_STRUCT(changelog_filter);
+	CHECK_MEMBER(changelog_filter, cf_type_mask);
+	CHECK_MEMBER(changelog_filter, cf_shard_index);
+	CHECK_MEMBER(changelog_filter, cf_shard_count);
+	CHECK_MEMBER(changelog_filter, cf_padding);
+}
+
 static void
 check_llog_changelog_rec(void)
 {
@@ -2822,6 +2833,7 @@ main(int argc, char **argv)
 	check_changelog_ext_rename();
 	check_changelog_ext_jobid();
 	check_changelog_setinfo();
+	check_changelog_filter();
 	check_llog_changelog_rec();
 	check_llog_changelog_user_rec();
 	check_llog_gen();